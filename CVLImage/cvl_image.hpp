@@ -0,0 +1,243 @@
+#ifndef CVL_IMAGE_HPP
+#define CVL_IMAGE_HPP
+
+#include "cvl_image_utils.h"
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+
+
+namespace cvl {
+
+/**
+ * Reference counted image handle over CVLImageBuffer with copy-on-write semantics.
+ *
+ * Copies of an image and its subimages share pixel memory, which stays alive while any of them
+ * exists. Read access never copies. The first write access through a handle that shares memory
+ * with other handles copies its own area into new memory (see mutable_buffer), so writes are never
+ * visible through other handles.
+ *
+ * Handles interoperate with C routines without copying: buffer() and mutable_buffer() return
+ * CVLImageBuffer pointers, adopt() takes ownership of a C image and wrap() references memory
+ * owned elsewhere.
+ *
+ * Allocation failures produce empty images, mutable_buffer returns NULL if copy fails.
+ * One handle must not be used by several threads at once, different handles sharing memory may be.
+ */
+class Image {
+public:
+    /** Empty image. */
+    Image() : storage_(NULL), view_(cvl_image_make_empty()), pixel_size_(0) {}
+
+    /**
+     * Allocate image.
+     * @param allocator Image allocator or NULL to use cvl_image_create. Allocator must outlive image
+     * memory.
+     */
+    Image(const CVLImagePixelCount height,
+          const CVLImagePixelCount width,
+          const CVLImageBytesCount pixel_size,
+          const CVLImageAllocator * const allocator = NULL)
+        : storage_(NULL), view_(cvl_image_make_empty()), pixel_size_(pixel_size)
+    {
+        CVLImageBuffer image = cvl_image_create_with_allocator(allocator, height, width, pixel_size);
+        if (image.data) {
+            own(image, allocator);
+        }
+    }
+
+    Image(const Image &other) : storage_(other.storage_), view_(other.view_), pixel_size_(other.pixel_size_) {
+        retain();
+    }
+
+    Image(Image &&other) noexcept : storage_(other.storage_), view_(other.view_), pixel_size_(other.pixel_size_) {
+        other.storage_ = NULL;
+        other.view_ = cvl_image_make_empty();
+    }
+
+    ~Image() {
+        reset();
+    }
+
+    Image &operator=(const Image &other) {
+        if (this != &other) {
+            other.retain();
+            reset();
+            storage_ = other.storage_;
+            view_ = other.view_;
+            pixel_size_ = other.pixel_size_;
+        }
+        return *this;
+    }
+
+    Image &operator=(Image &&other) noexcept {
+        if (this != &other) {
+            reset();
+            storage_ = other.storage_;
+            view_ = other.view_;
+            pixel_size_ = other.pixel_size_;
+            other.storage_ = NULL;
+            other.view_ = cvl_image_make_empty();
+        }
+        return *this;
+    }
+
+    /**
+     * Take ownership of C image created by cvl_image_create or by @a allocator.
+     * @a image is reset to empty image. If handle cannot be allocated, image is released.
+     */
+    static Image adopt(CVLImageBuffer * const image,
+                       const CVLImageBytesCount pixel_size,
+                       const CVLImageAllocator * const allocator = NULL)
+    {
+        Image result;
+        result.pixel_size_ = pixel_size;
+        if (image->data) {
+            result.own(*image, allocator);
+        }
+        *image = cvl_image_make_empty();
+        return result;
+    }
+
+    /**
+     * Reference C image memory owned elsewhere without copying.
+     *
+     * Wrapped image is not reference counted: the caller keeps memory alive while the handle and
+     * its copies exist, and writes through any of them are shared.
+     */
+    static Image wrap(const CVLImageBuffer &image, const CVLImageBytesCount pixel_size) {
+        Image result;
+        result.view_ = image;
+        result.pixel_size_ = pixel_size;
+        return result;
+    }
+
+    /** Create image holding a deep copy of C image. */
+    static Image copy_of(const CVLImageBuffer &image, const CVLImageBytesCount pixel_size) {
+        Image result(image.height, image.width, pixel_size);
+        if (!result.empty()) {
+            cvl_image_copy(&image, &result.view_, pixel_size);
+        }
+        return result;
+    }
+
+    /** Return deep copy of image. */
+    Image clone() const {
+        return empty() ? Image() : copy_of(view_, pixel_size_);
+    }
+
+    /** Return subimage sharing memory with this image and keeping it alive. */
+    Image subimage(const CVLRect roi) const {
+        Image result(*this);
+        result.view_ = cvl_image_subimage(&view_, roi, pixel_size_);
+        return result;
+    }
+
+    /** Return C view for read access, valid while image memory is alive. */
+    const CVLImageBuffer *buffer() const {
+        return &view_;
+    }
+
+    /**
+     * Return C view for write access.
+     *
+     * If memory is shared with other handles, area of this image is first copied into new memory
+     * owned by this handle alone.
+     * @return NULL if copy could not be allocated.
+     */
+    CVLImageBuffer *mutable_buffer() {
+        if (storage_ && storage_->references.load(std::memory_order_acquire) > 1) {
+            Image copy = clone();
+            if (copy.empty()) {
+                return NULL;
+            }
+            *this = std::move(copy);
+        }
+        return &view_;
+    }
+
+    /** Return typed pointer to row @a y for read access. */
+    template <typename PixelT>
+    const PixelT *line(const CVLImagePixelCount y) const {
+        return CVL_GET_LINE(const PixelT, &view_, y);
+    }
+
+    /** Return typed pointer to row @a y for write access, see mutable_buffer. */
+    template <typename PixelT>
+    PixelT *mutable_line(const CVLImagePixelCount y) {
+        CVLImageBuffer * const image = mutable_buffer();
+        return image ? CVL_GET_LINE(PixelT, image, y) : NULL;
+    }
+
+    /** Release reference, image becomes empty. */
+    void reset() {
+        release();
+        storage_ = NULL;
+        view_ = cvl_image_make_empty();
+    }
+
+    bool empty() const { return view_.data == NULL; }
+    CVLImagePixelCount height() const { return view_.height; }
+    CVLImagePixelCount width() const { return view_.width; }
+    CVLImageBytesCount row_bytes() const { return view_.rowBytes; }
+    CVLImageBytesCount pixel_size() const { return pixel_size_; }
+
+    /** Return true if memory is owned by the library, false for empty and wrapped images. */
+    bool is_owned() const { return storage_ != NULL; }
+
+    /** Return number of handles sharing memory, 0 for empty and wrapped images. */
+    size_t use_count() const {
+        return storage_ ? storage_->references.load(std::memory_order_acquire) : 0;
+    }
+
+    /** Return true if memory is shared with other handles. */
+    bool is_shared() const { return use_count() > 1; }
+
+private:
+    /** Shared memory block. */
+    struct Storage {
+        std::atomic<size_t> references;
+        CVLImageBuffer image;                ///< Whole allocated image.
+        const CVLImageAllocator *allocator;  ///< Allocator of image or NULL.
+    };
+
+    void own(const CVLImageBuffer &image, const CVLImageAllocator * const allocator) {
+        storage_ = new (std::nothrow) Storage;
+        if (!storage_) {
+            CVLImageBuffer released = image;
+            cvl_image_release_with_allocator(allocator, &released);
+            view_ = cvl_image_make_empty();
+            return;
+        }
+        storage_->references.store(1, std::memory_order_relaxed);
+        storage_->image = image;
+        storage_->allocator = allocator;
+        view_ = image;
+    }
+
+    void retain() const {
+        if (storage_) {
+            storage_->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release() {
+        if (storage_ && storage_->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            cvl_image_release_with_allocator(storage_->allocator, &storage_->image);
+            delete storage_;
+        }
+    }
+
+    Storage *storage_;
+    CVLImageBuffer view_;
+    CVLImageBytesCount pixel_size_;
+};
+
+}  // namespace cvl
+
+
+
+#endif //CVL_IMAGE_HPP
@@ -0,0 +1,157 @@
+#ifndef CVL_IMAGE_ARENA_H
+#define CVL_IMAGE_ARENA_H
+
+
+#include "cvl_image_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Frame arena for short-lived images.
+ *
+ * Arena hands out images from one preallocated memory block by bumping an offset. Individual
+ * images are never released, the whole arena is reset at once (e.g. at the end of a frame).
+ * Arena is not thread-safe.
+ *
+ * @see cvl_image_create_in_arena
+ * @see cvl_image_arena_reset
+ */
+typedef struct {
+    CVLPixel_8 *base;              ///< Arena memory block.
+    size_t capacity;               ///< Size of memory block in bytes.
+    size_t offset;                 ///< Number of bytes in use.
+    size_t peak;                   ///< Maximal number of bytes used since initialization.
+    CVLImageBytesCount alignment;  ///< Alignment of images data.
+} CVLImageArena;
+
+
+
+/**
+ * Initialize arena and allocate its memory block.
+ *
+ * @param capacity Size of memory block in bytes.
+ * @param alignment Power of two alignment of images data, 0 for CVL_IMAGE_DEFAULT_ALIGNMENT.
+ * @return false if memory could not be allocated.
+ * @see cvl_image_arena_destroy
+ */
+static inline bool cvl_image_arena_init(CVLImageArena * const arena,
+                                        const size_t capacity,
+                                        const CVLImageBytesCount alignment)
+{
+    arena->alignment = alignment ? alignment : CVL_IMAGE_DEFAULT_ALIGNMENT;
+    arena->base = (CVLPixel_8 *)cvl_image_data_alloc(capacity, arena->alignment);
+    arena->capacity = arena->base ? capacity : 0;
+    arena->offset = 0;
+    arena->peak = 0;
+    return arena->base != NULL;
+}
+
+
+
+/** Free arena memory block. All images created in arena become invalid. */
+static inline void cvl_image_arena_destroy(CVLImageArena * const arena) {
+    cvl_image_data_free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->offset = 0;
+}
+
+
+
+/** Release all images created in arena. All images created in arena become invalid. */
+static inline void cvl_image_arena_reset(CVLImageArena * const arena) {
+    arena->offset = 0;
+}
+
+
+
+/** Return current arena position, to be passed to cvl_image_arena_rewind later. */
+static inline size_t cvl_image_arena_mark(const CVLImageArena * const arena) {
+    return arena->offset;
+}
+
+
+
+/** Release images created in arena after @a mark was taken. */
+static inline void cvl_image_arena_rewind(CVLImageArena * const arena, const size_t mark) {
+    assert(mark <= arena->offset);
+    arena->offset = mark;
+}
+
+
+
+/**
+ * Create image in arena.
+ *
+ * Image is continuous, its data is aligned to arena alignment. Image content is undefined.
+ * Image must not be released with cvl_image_release, it lives until arena is reset or rewound.
+ * @return Empty image if arena has not enough free memory.
+ */
+static inline CVLImageBuffer cvl_image_create_in_arena(CVLImageArena * const arena,
+                                                       const CVLImagePixelCount height,
+                                                       const CVLImagePixelCount width,
+                                                       const CVLImageBytesCount pixel_size)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    const size_t start = (arena->offset + arena->alignment - 1) & ~(size_t)(arena->alignment - 1);
+    const size_t size = height * width * pixel_size;
+    if (start > arena->capacity || size > arena->capacity - start) {
+        return cvl_image_make_empty();
+    }
+    arena->offset = start + size;
+    if (arena->offset > arena->peak) {
+        arena->peak = arena->offset;
+    }
+#ifdef _MSC_VER
+    CVLImageBuffer image;
+    image.data = arena->base + start;
+    image.height = height;
+    image.width = width;
+    image.rowBytes = width * pixel_size;
+    return image;
+#else
+    return (CVLImageBuffer){arena->base + start, height, width, width * pixel_size};
+#endif
+}
+
+
+
+static inline CVLImageBuffer cvl_image_arena_allocator_create(void * const context,
+                                                              const CVLImagePixelCount height,
+                                                              const CVLImagePixelCount width,
+                                                              const CVLImageBytesCount pixel_size)
+{
+    return cvl_image_create_in_arena((CVLImageArena *)context, height, width, pixel_size);
+}
+
+
+
+static inline void cvl_image_arena_allocator_release(void * const context, CVLImageBuffer * const image) {
+    CVL_UNUSED(context);
+    CVL_UNUSED(image);
+}
+
+
+
+/**
+ * Return allocator backed by arena.
+ *
+ * Releasing image through this allocator does nothing, memory is reclaimed by arena reset.
+ */
+static inline CVLImageAllocator cvl_image_arena_allocator(CVLImageArena * const arena) {
+    CVLImageAllocator allocator;
+    allocator.create = cvl_image_arena_allocator_create;
+    allocator.release = cvl_image_arena_allocator_release;
+    allocator.context = arena;
+    return allocator;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_ARENA_H
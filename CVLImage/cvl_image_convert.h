@@ -0,0 +1,605 @@
+#ifndef CVL_IMAGE_CONVERT_H
+#define CVL_IMAGE_CONVERT_H
+
+
+#include "cvl_image_utils.h"
+#include "cvl_simd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Fixed point (8 fractional bits) BT.601 luma weights of red, green and blue channels. */
+#define CVL_GRAY_WEIGHT_R 77
+#define CVL_GRAY_WEIGHT_G 150
+#define CVL_GRAY_WEIGHT_B 29
+
+/** Channel order which swaps first and third channels (RGBA <-> BGRA). */
+#define CVL_SWIZZLE_RGBA_BGRA {2, 1, 0, 3}
+
+
+
+/*
+ * Row kernels.
+ *
+ * Each kernel converts @a n pixels of one row. They are used by image level routines below and
+ * can be reused by other row oriented code.
+ */
+
+/** Convert row of Pixel_8 to Pixel_F: dst = src * scale + offset. */
+static inline void cvl_convert_row_8_to_F(const CVLPixel_8 * const src,
+                                          CVLPixel_F * const dst,
+                                          const size_t n,
+                                          const float scale,
+                                          const float offset)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 voffset = _mm_set1_ps(offset);
+    for (; x + 16 <= n; x += 16) {
+        const __m128i v8 = _mm_loadu_si128((const __m128i *)(src + x));
+        const __m128i lo16 = _mm_unpacklo_epi8(v8, zero);
+        const __m128i hi16 = _mm_unpackhi_epi8(v8, zero);
+        const __m128 f0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo16, zero));
+        const __m128 f1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo16, zero));
+        const __m128 f2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi16, zero));
+        const __m128 f3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi16, zero));
+        _mm_storeu_ps(dst + x,      _mm_add_ps(_mm_mul_ps(f0, vscale), voffset));
+        _mm_storeu_ps(dst + x + 4,  _mm_add_ps(_mm_mul_ps(f1, vscale), voffset));
+        _mm_storeu_ps(dst + x + 8,  _mm_add_ps(_mm_mul_ps(f2, vscale), voffset));
+        _mm_storeu_ps(dst + x + 12, _mm_add_ps(_mm_mul_ps(f3, vscale), voffset));
+    }
+#endif
+    for (; x < n; ++x) {
+        dst[x] = src[x] * scale + offset;
+    }
+}
+
+
+
+/**
+ * Convert row of Pixel_F to Pixel_8: dst = saturate(round(src * scale + offset)).
+ * Halves are rounded up.
+ */
+static inline void cvl_convert_row_F_to_8(const CVLPixel_F * const src,
+                                          CVLPixel_8 * const dst,
+                                          const size_t n,
+                                          const float scale,
+                                          const float offset)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    const __m128 vscale = _mm_set1_ps(scale);
+    const __m128 voffset = _mm_set1_ps(offset + 0.5f);
+    const __m128 vmin = _mm_set1_ps(0.0f);
+    const __m128 vmax = _mm_set1_ps(255.0f);
+    for (; x + 16 <= n; x += 16) {
+        __m128 f[4];
+        for (int i = 0; i < 4; ++i) {
+            f[i] = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + x + 4 * i), vscale), voffset);
+            f[i] = _mm_min_ps(_mm_max_ps(f[i], vmin), vmax);
+        }
+        const __m128i lo16 = _mm_packs_epi32(_mm_cvttps_epi32(f[0]), _mm_cvttps_epi32(f[1]));
+        const __m128i hi16 = _mm_packs_epi32(_mm_cvttps_epi32(f[2]), _mm_cvttps_epi32(f[3]));
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(lo16, hi16));
+    }
+#endif
+    for (; x < n; ++x) {
+        float v = src[x] * scale + offset + 0.5f;
+        v = v > 0.0f ? v : 0.0f;
+        v = v < 255.0f ? v : 255.0f;
+        dst[x] = (CVLPixel_8)(int)v;
+    }
+}
+
+
+
+/** Convert row of Pixel_8888 to Pixel_FFFF: dst = src * scale + offset (per channel). */
+static inline void cvl_convert_row_8888_to_FFFF(const CVLPixel_8 * const src,
+                                                CVLPixel_F * const dst,
+                                                const size_t n,
+                                                const float scale,
+                                                const float offset)
+{
+    cvl_convert_row_8_to_F(src, dst, 4 * n, scale, offset);
+}
+
+
+
+/** Convert row of Pixel_FFFF to Pixel_8888: dst = saturate(round(src * scale + offset)) (per channel). */
+static inline void cvl_convert_row_FFFF_to_8888(const CVLPixel_F * const src,
+                                                CVLPixel_8 * const dst,
+                                                const size_t n,
+                                                const float scale,
+                                                const float offset)
+{
+    cvl_convert_row_F_to_8(src, dst, 4 * n, scale, offset);
+}
+
+
+
+#if CVL_SIMD_SSE2
+
+/** Deinterleave 16 Pixel_8888 pixels into 4 vectors of 16 channel values. */
+static inline void cvl_convert_split16_sse2(const CVLPixel_8 * const src, __m128i channels[4]) {
+    const __m128i v0 = _mm_loadu_si128((const __m128i *)(src));
+    const __m128i v1 = _mm_loadu_si128((const __m128i *)(src + 16));
+    const __m128i v2 = _mm_loadu_si128((const __m128i *)(src + 32));
+    const __m128i v3 = _mm_loadu_si128((const __m128i *)(src + 48));
+    const __m128i t0 = _mm_unpacklo_epi8(v0, v1);
+    const __m128i t1 = _mm_unpackhi_epi8(v0, v1);
+    const __m128i t2 = _mm_unpacklo_epi8(v2, v3);
+    const __m128i t3 = _mm_unpackhi_epi8(v2, v3);
+    const __m128i u0 = _mm_unpacklo_epi8(t0, t1);
+    const __m128i u1 = _mm_unpackhi_epi8(t0, t1);
+    const __m128i u2 = _mm_unpacklo_epi8(t2, t3);
+    const __m128i u3 = _mm_unpackhi_epi8(t2, t3);
+    const __m128i w0 = _mm_unpacklo_epi8(u0, u1);
+    const __m128i w1 = _mm_unpackhi_epi8(u0, u1);
+    const __m128i w2 = _mm_unpacklo_epi8(u2, u3);
+    const __m128i w3 = _mm_unpackhi_epi8(u2, u3);
+    channels[0] = _mm_unpacklo_epi64(w0, w2);
+    channels[1] = _mm_unpackhi_epi64(w0, w2);
+    channels[2] = _mm_unpacklo_epi64(w1, w3);
+    channels[3] = _mm_unpackhi_epi64(w1, w3);
+}
+
+#endif
+
+
+
+/** Split row of Pixel_8888 into four rows of Pixel_8 (one per channel). */
+static inline void cvl_convert_row_split_8888(const CVLPixel_8 * const src,
+                                              CVLPixel_8 * const dst0,
+                                              CVLPixel_8 * const dst1,
+                                              CVLPixel_8 * const dst2,
+                                              CVLPixel_8 * const dst3,
+                                              const size_t n)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    for (; x + 16 <= n; x += 16) {
+        __m128i c[4];
+        cvl_convert_split16_sse2(src + 4 * x, c);
+        _mm_storeu_si128((__m128i *)(dst0 + x), c[0]);
+        _mm_storeu_si128((__m128i *)(dst1 + x), c[1]);
+        _mm_storeu_si128((__m128i *)(dst2 + x), c[2]);
+        _mm_storeu_si128((__m128i *)(dst3 + x), c[3]);
+    }
+#endif
+    for (; x < n; ++x) {
+        dst0[x] = src[4 * x];
+        dst1[x] = src[4 * x + 1];
+        dst2[x] = src[4 * x + 2];
+        dst3[x] = src[4 * x + 3];
+    }
+}
+
+
+
+/** Merge four rows of Pixel_8 (one per channel) into row of Pixel_8888. */
+static inline void cvl_convert_row_merge_8888(const CVLPixel_8 * const src0,
+                                              const CVLPixel_8 * const src1,
+                                              const CVLPixel_8 * const src2,
+                                              const CVLPixel_8 * const src3,
+                                              CVLPixel_8 * const dst,
+                                              const size_t n)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    for (; x + 16 <= n; x += 16) {
+        const __m128i c0 = _mm_loadu_si128((const __m128i *)(src0 + x));
+        const __m128i c1 = _mm_loadu_si128((const __m128i *)(src1 + x));
+        const __m128i c2 = _mm_loadu_si128((const __m128i *)(src2 + x));
+        const __m128i c3 = _mm_loadu_si128((const __m128i *)(src3 + x));
+        const __m128i c01_lo = _mm_unpacklo_epi8(c0, c1);
+        const __m128i c01_hi = _mm_unpackhi_epi8(c0, c1);
+        const __m128i c23_lo = _mm_unpacklo_epi8(c2, c3);
+        const __m128i c23_hi = _mm_unpackhi_epi8(c2, c3);
+        _mm_storeu_si128((__m128i *)(dst + 4 * x),      _mm_unpacklo_epi16(c01_lo, c23_lo));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 16), _mm_unpackhi_epi16(c01_lo, c23_lo));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 32), _mm_unpacklo_epi16(c01_hi, c23_hi));
+        _mm_storeu_si128((__m128i *)(dst + 4 * x + 48), _mm_unpackhi_epi16(c01_hi, c23_hi));
+    }
+#endif
+    for (; x < n; ++x) {
+        dst[4 * x]     = src0[x];
+        dst[4 * x + 1] = src1[x];
+        dst[4 * x + 2] = src2[x];
+        dst[4 * x + 3] = src3[x];
+    }
+}
+
+
+
+/** Split row of Pixel_FFFF into four rows of Pixel_F (one per channel). */
+static inline void cvl_convert_row_split_FFFF(const CVLPixel_F * const src,
+                                              CVLPixel_F * const dst0,
+                                              CVLPixel_F * const dst1,
+                                              CVLPixel_F * const dst2,
+                                              CVLPixel_F * const dst3,
+                                              const size_t n)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    for (; x + 4 <= n; x += 4) {
+        __m128 c0 = _mm_loadu_ps(src + 4 * x);
+        __m128 c1 = _mm_loadu_ps(src + 4 * x + 4);
+        __m128 c2 = _mm_loadu_ps(src + 4 * x + 8);
+        __m128 c3 = _mm_loadu_ps(src + 4 * x + 12);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(dst0 + x, c0);
+        _mm_storeu_ps(dst1 + x, c1);
+        _mm_storeu_ps(dst2 + x, c2);
+        _mm_storeu_ps(dst3 + x, c3);
+    }
+#endif
+    for (; x < n; ++x) {
+        dst0[x] = src[4 * x];
+        dst1[x] = src[4 * x + 1];
+        dst2[x] = src[4 * x + 2];
+        dst3[x] = src[4 * x + 3];
+    }
+}
+
+
+
+/** Merge four rows of Pixel_F (one per channel) into row of Pixel_FFFF. */
+static inline void cvl_convert_row_merge_FFFF(const CVLPixel_F * const src0,
+                                              const CVLPixel_F * const src1,
+                                              const CVLPixel_F * const src2,
+                                              const CVLPixel_F * const src3,
+                                              CVLPixel_F * const dst,
+                                              const size_t n)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    for (; x + 4 <= n; x += 4) {
+        __m128 p0 = _mm_loadu_ps(src0 + x);
+        __m128 p1 = _mm_loadu_ps(src1 + x);
+        __m128 p2 = _mm_loadu_ps(src2 + x);
+        __m128 p3 = _mm_loadu_ps(src3 + x);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        _mm_storeu_ps(dst + 4 * x,      p0);
+        _mm_storeu_ps(dst + 4 * x + 4,  p1);
+        _mm_storeu_ps(dst + 4 * x + 8,  p2);
+        _mm_storeu_ps(dst + 4 * x + 12, p3);
+    }
+#endif
+    for (; x < n; ++x) {
+        dst[4 * x]     = src0[x];
+        dst[4 * x + 1] = src1[x];
+        dst[4 * x + 2] = src2[x];
+        dst[4 * x + 3] = src3[x];
+    }
+}
+
+
+
+#if CVL_SIMD_X86
+
+CVL_SIMD_TARGET("avx2")
+static inline size_t cvl_convert_row_swizzle_8888_avx2(const CVLPixel_8 * const src,
+                                                       CVLPixel_8 * const dst,
+                                                       const size_t n,
+                                                       const uint8_t order[4])
+{
+    char mask[32];
+    for (int i = 0; i < 32; ++i) {
+        mask[i] = (char)((i & ~3 & 15) + order[i & 3]);
+    }
+    const __m256i vmask = _mm256_loadu_si256((const __m256i *)mask);
+    size_t x = 0;
+    for (; x + 8 <= n; x += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(src + 4 * x));
+        _mm256_storeu_si256((__m256i *)(dst + 4 * x), _mm256_shuffle_epi8(v, vmask));
+    }
+    return x;
+}
+
+#endif
+
+
+
+/**
+ * Reorder channels of Pixel_8888 row: dst[c] = src[order[c]].
+ * Source and destination may be the same row.
+ */
+static inline void cvl_convert_row_swizzle_8888(const CVLPixel_8 * const src,
+                                                CVLPixel_8 * const dst,
+                                                const size_t n,
+                                                const uint8_t order[4])
+{
+    assert(order[0] < 4 && order[1] < 4 && order[2] < 4 && order[3] < 4);
+    size_t x = 0;
+#if CVL_SIMD_X86
+    if (cvl_simd_level() >= CVL_SIMD_LEVEL_AVX2) {
+        x = cvl_convert_row_swizzle_8888_avx2(src, dst, n, order);
+    }
+#endif
+    for (; x < n; ++x) {
+        const CVLPixel_8 p0 = src[4 * x + order[0]];
+        const CVLPixel_8 p1 = src[4 * x + order[1]];
+        const CVLPixel_8 p2 = src[4 * x + order[2]];
+        const CVLPixel_8 p3 = src[4 * x + order[3]];
+        dst[4 * x]     = p0;
+        dst[4 * x + 1] = p1;
+        dst[4 * x + 2] = p2;
+        dst[4 * x + 3] = p3;
+    }
+}
+
+
+
+/**
+ * Convert row of Pixel_8888 to Pixel_8 as weighted sum of channels.
+ *
+ * @param weights Fixed point channel weights with 8 fractional bits, their sum must not exceed 256.
+ */
+static inline void cvl_convert_row_8888_to_8(const CVLPixel_8 * const src,
+                                             CVLPixel_8 * const dst,
+                                             const size_t n,
+                                             const uint16_t weights[4])
+{
+    assert(weights[0] + weights[1] + weights[2] + weights[3] <= 256);
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+    __m128i w[4];
+    for (int c = 0; c < 4; ++c) {
+        w[c] = _mm_set1_epi16((short)weights[c]);
+    }
+    for (; x + 16 <= n; x += 16) {
+        __m128i c[4];
+        cvl_convert_split16_sse2(src + 4 * x, c);
+        __m128i lo = half;
+        __m128i hi = half;
+        for (int i = 0; i < 4; ++i) {
+            lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(c[i], zero), w[i]));
+            hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(c[i], zero), w[i]));
+        }
+        _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+#endif
+    for (; x < n; ++x) {
+        const unsigned int sum = src[4 * x] * weights[0] + src[4 * x + 1] * weights[1] +
+                                 src[4 * x + 2] * weights[2] + src[4 * x + 3] * weights[3];
+        dst[x] = (CVLPixel_8)((sum + 128) >> 8);
+    }
+}
+
+
+
+/*
+ * Image level routines.
+ *
+ * Source and destination must have the same width and height, both may be strided.
+ */
+
+/** Convert Pixel_8 image to Pixel_F image: dst = src * scale + offset. */
+static inline void cvl_image_convert_8_to_F(const CVLImageBuffer * const source_image,
+                                            const CVLImageBuffer * const dest_image,
+                                            const float scale,
+                                            const float offset)
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_8_sz));
+    assert(cvl_image_is_good(dest_image,   CVLPixel_F_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_8_to_F(CVL_GET_LINE(const CVLPixel_8, source_image, y),
+                               CVL_GET_LINE(CVLPixel_F, dest_image, y),
+                               source_image->width, scale, offset);
+    }
+}
+
+
+
+/** Convert Pixel_F image to Pixel_8 image: dst = saturate(round(src * scale + offset)). */
+static inline void cvl_image_convert_F_to_8(const CVLImageBuffer * const source_image,
+                                            const CVLImageBuffer * const dest_image,
+                                            const float scale,
+                                            const float offset)
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_F_sz));
+    assert(cvl_image_is_good(dest_image,   CVLPixel_8_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_F_to_8(CVL_GET_LINE(const CVLPixel_F, source_image, y),
+                               CVL_GET_LINE(CVLPixel_8, dest_image, y),
+                               source_image->width, scale, offset);
+    }
+}
+
+
+
+/** Convert Pixel_8888 image to Pixel_FFFF image: dst = src * scale + offset (per channel). */
+static inline void cvl_image_convert_8888_to_FFFF(const CVLImageBuffer * const source_image,
+                                                  const CVLImageBuffer * const dest_image,
+                                                  const float scale,
+                                                  const float offset)
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_8888_sz));
+    assert(cvl_image_is_good(dest_image,   CVLPixel_FFFF_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_8888_to_FFFF(CVL_GET_LINE(const CVLPixel_8, source_image, y),
+                                     CVL_GET_LINE(CVLPixel_F, dest_image, y),
+                                     source_image->width, scale, offset);
+    }
+}
+
+
+
+/** Convert Pixel_FFFF image to Pixel_8888 image: dst = saturate(round(src * scale + offset)) (per channel). */
+static inline void cvl_image_convert_FFFF_to_8888(const CVLImageBuffer * const source_image,
+                                                  const CVLImageBuffer * const dest_image,
+                                                  const float scale,
+                                                  const float offset)
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_FFFF_sz));
+    assert(cvl_image_is_good(dest_image,   CVLPixel_8888_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_FFFF_to_8888(CVL_GET_LINE(const CVLPixel_F, source_image, y),
+                                     CVL_GET_LINE(CVLPixel_8, dest_image, y),
+                                     source_image->width, scale, offset);
+    }
+}
+
+
+
+/** Split Pixel_8888 image into four Pixel_8 channel images. */
+static inline void cvl_image_split_8888(const CVLImageBuffer * const source_image,
+                                        const CVLImageBuffer dest_images[4])
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_8888_sz));
+    for (int c = 0; c < 4; ++c) {
+        assert(cvl_image_is_good(&dest_images[c], CVLPixel_8_sz));
+        assert(source_image->width == dest_images[c].width && source_image->height == dest_images[c].height);
+    }
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_split_8888(CVL_GET_LINE(const CVLPixel_8, source_image, y),
+                                   CVL_GET_LINE(CVLPixel_8, &dest_images[0], y),
+                                   CVL_GET_LINE(CVLPixel_8, &dest_images[1], y),
+                                   CVL_GET_LINE(CVLPixel_8, &dest_images[2], y),
+                                   CVL_GET_LINE(CVLPixel_8, &dest_images[3], y),
+                                   source_image->width);
+    }
+}
+
+
+
+/** Merge four Pixel_8 channel images into Pixel_8888 image. */
+static inline void cvl_image_merge_8888(const CVLImageBuffer source_images[4],
+                                        const CVLImageBuffer * const dest_image)
+{
+    assert(cvl_image_is_good(dest_image, CVLPixel_8888_sz));
+    for (int c = 0; c < 4; ++c) {
+        assert(cvl_image_is_good(&source_images[c], CVLPixel_8_sz));
+        assert(source_images[c].width == dest_image->width && source_images[c].height == dest_image->height);
+    }
+    for (CVLImagePixelCount y = 0; y < dest_image->height; ++y) {
+        cvl_convert_row_merge_8888(CVL_GET_LINE(const CVLPixel_8, &source_images[0], y),
+                                   CVL_GET_LINE(const CVLPixel_8, &source_images[1], y),
+                                   CVL_GET_LINE(const CVLPixel_8, &source_images[2], y),
+                                   CVL_GET_LINE(const CVLPixel_8, &source_images[3], y),
+                                   CVL_GET_LINE(CVLPixel_8, dest_image, y),
+                                   dest_image->width);
+    }
+}
+
+
+
+/** Split Pixel_FFFF image into four Pixel_F channel images. */
+static inline void cvl_image_split_FFFF(const CVLImageBuffer * const source_image,
+                                        const CVLImageBuffer dest_images[4])
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_FFFF_sz));
+    for (int c = 0; c < 4; ++c) {
+        assert(cvl_image_is_good(&dest_images[c], CVLPixel_F_sz));
+        assert(source_image->width == dest_images[c].width && source_image->height == dest_images[c].height);
+    }
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_split_FFFF(CVL_GET_LINE(const CVLPixel_F, source_image, y),
+                                   CVL_GET_LINE(CVLPixel_F, &dest_images[0], y),
+                                   CVL_GET_LINE(CVLPixel_F, &dest_images[1], y),
+                                   CVL_GET_LINE(CVLPixel_F, &dest_images[2], y),
+                                   CVL_GET_LINE(CVLPixel_F, &dest_images[3], y),
+                                   source_image->width);
+    }
+}
+
+
+
+/** Merge four Pixel_F channel images into Pixel_FFFF image. */
+static inline void cvl_image_merge_FFFF(const CVLImageBuffer source_images[4],
+                                        const CVLImageBuffer * const dest_image)
+{
+    assert(cvl_image_is_good(dest_image, CVLPixel_FFFF_sz));
+    for (int c = 0; c < 4; ++c) {
+        assert(cvl_image_is_good(&source_images[c], CVLPixel_F_sz));
+        assert(source_images[c].width == dest_image->width && source_images[c].height == dest_image->height);
+    }
+    for (CVLImagePixelCount y = 0; y < dest_image->height; ++y) {
+        cvl_convert_row_merge_FFFF(CVL_GET_LINE(const CVLPixel_F, &source_images[0], y),
+                                   CVL_GET_LINE(const CVLPixel_F, &source_images[1], y),
+                                   CVL_GET_LINE(const CVLPixel_F, &source_images[2], y),
+                                   CVL_GET_LINE(const CVLPixel_F, &source_images[3], y),
+                                   CVL_GET_LINE(CVLPixel_F, dest_image, y),
+                                   dest_image->width);
+    }
+}
+
+
+
+/**
+ * Reorder channels of Pixel_8888 image: dst[c] = src[order[c]].
+ *
+ * Use CVL_SWIZZLE_RGBA_BGRA order to swap RGBA and BGRA. Conversion may be done in place.
+ */
+static inline void cvl_image_swizzle_8888(const CVLImageBuffer * const source_image,
+                                          const CVLImageBuffer * const dest_image,
+                                          const uint8_t order[4])
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_8888_sz));
+    assert(cvl_image_is_good(dest_image,   CVLPixel_8888_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_swizzle_8888(CVL_GET_LINE(const CVLPixel_8, source_image, y),
+                                     CVL_GET_LINE(CVLPixel_8, dest_image, y),
+                                     source_image->width, order);
+    }
+}
+
+
+
+/**
+ * Convert Pixel_8888 image to Pixel_8 image as weighted sum of channels.
+ *
+ * @param weights Fixed point channel weights with 8 fractional bits, their sum must not exceed 256.
+ * @see cvl_image_convert_rgba_to_gray
+ */
+static inline void cvl_image_convert_8888_to_8(const CVLImageBuffer * const source_image,
+                                               const CVLImageBuffer * const dest_image,
+                                               const uint16_t weights[4])
+{
+    assert(cvl_image_is_good(source_image, CVLPixel_8888_sz));
+    assert(cvl_image_is_good(dest_image,   CVLPixel_8_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_convert_row_8888_to_8(CVL_GET_LINE(const CVLPixel_8, source_image, y),
+                                  CVL_GET_LINE(CVLPixel_8, dest_image, y),
+                                  source_image->width, weights);
+    }
+}
+
+
+
+/** Convert RGBA Pixel_8888 image to BT.601 gray Pixel_8 image. */
+static inline void cvl_image_convert_rgba_to_gray(const CVLImageBuffer * const source_image,
+                                                  const CVLImageBuffer * const dest_image)
+{
+    const uint16_t weights[4] = {CVL_GRAY_WEIGHT_R, CVL_GRAY_WEIGHT_G, CVL_GRAY_WEIGHT_B, 0};
+    cvl_image_convert_8888_to_8(source_image, dest_image, weights);
+}
+
+
+
+/** Convert BGRA Pixel_8888 image to BT.601 gray Pixel_8 image. */
+static inline void cvl_image_convert_bgra_to_gray(const CVLImageBuffer * const source_image,
+                                                  const CVLImageBuffer * const dest_image)
+{
+    const uint16_t weights[4] = {CVL_GRAY_WEIGHT_B, CVL_GRAY_WEIGHT_G, CVL_GRAY_WEIGHT_R, 0};
+    cvl_image_convert_8888_to_8(source_image, dest_image, weights);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_CONVERT_H
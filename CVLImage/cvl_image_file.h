@@ -0,0 +1,543 @@
+#ifndef CVL_IMAGE_FILE_H
+#define CVL_IMAGE_FILE_H
+
+
+#include "cvl_image_utils.h"
+
+#include <stdio.h>
+
+#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32)) && !defined(__CYGWIN__)
+
+#ifndef WINDOWS_H
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+#define CVL_IMAGE_FILE_WINDOWS 1
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CVL_IMAGE_FILE_WINDOWS 0
+
+#endif
+
+/*
+ * Raw image container files.
+ *
+ * File consists of CVLImageFileHeader followed by frames of equal layout. Frame data starts at
+ * header data_offset and frames follow each other every frame_stride bytes; both are multiples of
+ * CVL_IMAGE_FILE_ALIGNMENT, so every frame starts at page boundary. Frame rows are stored with
+ * rowBytes of header, padding bytes are zero. Numbers are stored in native byte order, files
+ * written on machine with different byte order are rejected.
+ *
+ * Files are read through memory mapping: cvl_image_file_frame returns CVLImageBuffer pointing into
+ * the mapping without any copy, pages are read from disk on first access.
+ *
+ * Usage:
+ * CVLImageFile file;
+ * if (cvl_image_file_open(&file, "frames.cvlraw", false)) {
+ *     cvl_image_file_advise(&file, CVL_IMAGE_FILE_ADVICE_SEQUENTIAL);
+ *     for (uint64_t i = 0; i < file.header.frame_count; ++i) {
+ *         const CVLImageBuffer frame = cvl_image_file_frame(&file, i);
+ *         ...
+ *     }
+ *     cvl_image_file_close(&file);
+ * }
+ */
+
+/** Alignment of frames in file. Multiple of page size of all supported platforms. */
+#define CVL_IMAGE_FILE_ALIGNMENT 16384
+
+/** Current format version. */
+#define CVL_IMAGE_FILE_VERSION 1
+
+/** Byte order mark of header. */
+#define CVL_IMAGE_FILE_BYTE_ORDER 0x01020304u
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Raw image file header, 128 bytes at the beginning of file. */
+typedef struct {
+    char magic[8];           ///< "CVLRAW\0\0".
+    uint32_t version;        ///< CVL_IMAGE_FILE_VERSION.
+    uint32_t header_size;    ///< sizeof(CVLImageFileHeader).
+    uint32_t byte_order;     ///< CVL_IMAGE_FILE_BYTE_ORDER in byte order of writer.
+    uint32_t pixel_type;     ///< CVLPixelType.
+    uint32_t pixel_size;     ///< Pixel memory size in bytes.
+    uint32_t alignment;      ///< Frame alignment, CVL_IMAGE_FILE_ALIGNMENT.
+    uint64_t height;         ///< Frame height in pixels.
+    uint64_t width;          ///< Frame width in pixels.
+    uint64_t row_bytes;      ///< Bytes between frame rows, at least width * pixel_size.
+    uint64_t frame_count;    ///< Number of frames.
+    uint64_t frame_stride;   ///< Bytes between frame starts, multiple of alignment.
+    uint64_t data_offset;    ///< Offset of the first frame, multiple of alignment.
+    uint64_t reserved[6];    ///< Zero.
+} CVLImageFileHeader;
+
+
+
+/** Memory mapped image file. */
+typedef struct {
+    CVLImageFileHeader header;
+    void *mapping;           ///< Start of file mapping.
+    size_t size;             ///< Size of mapping.
+    bool writable;           ///< Frames may be written, changes go to file.
+#if CVL_IMAGE_FILE_WINDOWS
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#else
+    int fd;
+#endif
+} CVLImageFile;
+
+
+
+/** Access pattern hints for mapped frames. */
+typedef enum {
+    CVL_IMAGE_FILE_ADVICE_NORMAL = 0,  ///< No special treatment.
+    CVL_IMAGE_FILE_ADVICE_SEQUENTIAL,  ///< Frames are read in order, read ahead aggressively.
+    CVL_IMAGE_FILE_ADVICE_RANDOM       ///< Frames are read in random order, do not read ahead.
+} CVLImageFileAdvice;
+
+
+
+/** Image file writer. */
+typedef struct {
+    FILE *file;
+    CVLImageFileHeader header;
+    bool failed;             ///< Some write failed, file is incomplete.
+} CVLImageFileWriter;
+
+
+
+/** Return @a value rounded up to multiple of power of two @a alignment. */
+static inline uint64_t cvl_image_file_align(const uint64_t value, const uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+
+
+/**
+ * Fill header of file with frames of specified layout.
+ *
+ * @param pixel_size Pixel memory size, used for CVL_PIXEL_TYPE_UNKNOWN and checked for known types.
+ * @param row_bytes Bytes between rows in file or 0 for width * pixel_size.
+ * @return false if layout is invalid.
+ */
+static inline bool cvl_image_file_header_init(CVLImageFileHeader * const header,
+                                              const CVLImagePixelCount height,
+                                              const CVLImagePixelCount width,
+                                              const CVLPixelType pixel_type,
+                                              const CVLImageBytesCount pixel_size,
+                                              const CVLImageBytesCount row_bytes)
+{
+    const CVLImageBytesCount type_size = cvl_pixel_type_size(pixel_type);
+    if (!height || !width || !pixel_size || (type_size && type_size != pixel_size) ||
+        (row_bytes && row_bytes < width * pixel_size))
+    {
+        return false;
+    }
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "CVLRAW\0\0", sizeof(header->magic));
+    header->version = CVL_IMAGE_FILE_VERSION;
+    header->header_size = (uint32_t)sizeof(CVLImageFileHeader);
+    header->byte_order = CVL_IMAGE_FILE_BYTE_ORDER;
+    header->pixel_type = (uint32_t)pixel_type;
+    header->pixel_size = (uint32_t)pixel_size;
+    header->alignment = CVL_IMAGE_FILE_ALIGNMENT;
+    header->height = height;
+    header->width = width;
+    header->row_bytes = row_bytes ? row_bytes : width * pixel_size;
+    header->frame_count = 0;
+    header->frame_stride = cvl_image_file_align(header->row_bytes * header->height, CVL_IMAGE_FILE_ALIGNMENT);
+    header->data_offset = cvl_image_file_align(sizeof(CVLImageFileHeader), CVL_IMAGE_FILE_ALIGNMENT);
+    return true;
+}
+
+
+
+/**
+ * Check header read from file of @a file_size bytes.
+ * @return false if header is damaged, of other version or byte order, or frames exceed file.
+ */
+static inline bool cvl_image_file_header_is_good(const CVLImageFileHeader * const header,
+                                                 const uint64_t file_size)
+{
+    if (memcmp(header->magic, "CVLRAW\0\0", sizeof(header->magic)) != 0 ||
+        header->version != CVL_IMAGE_FILE_VERSION ||
+        header->header_size != sizeof(CVLImageFileHeader) ||
+        header->byte_order != CVL_IMAGE_FILE_BYTE_ORDER ||
+        !header->alignment || (header->alignment & (header->alignment - 1)) ||
+        !header->height || !header->width || !header->pixel_size)
+    {
+        return false;
+    }
+    const uint64_t type_size = cvl_pixel_type_size((CVLPixelType)header->pixel_type);
+    if ((type_size && type_size != header->pixel_size) || header->width > UINT64_MAX / header->pixel_size ||
+        header->row_bytes < header->width * header->pixel_size ||
+        header->height > UINT64_MAX / header->row_bytes ||
+        header->frame_stride < header->height * header->row_bytes ||
+        (header->frame_stride & (header->alignment - 1)) || (header->data_offset & (header->alignment - 1)) ||
+        header->data_offset < header->header_size || header->data_offset > file_size)
+    {
+        return false;
+    }
+    return header->frame_count <= (file_size - header->data_offset) / header->frame_stride;
+}
+
+
+
+/** Return closed file. Closing it does nothing. */
+static inline CVLImageFile cvl_image_file_make_empty(void) {
+    CVLImageFile file;
+    memset(&file, 0, sizeof(file));
+#if CVL_IMAGE_FILE_WINDOWS
+    file.file_handle = INVALID_HANDLE_VALUE;
+#else
+    file.fd = -1;
+#endif
+    return file;
+}
+
+
+
+/**
+ * Close mapping and file.
+ *
+ * File must be opened with cvl_image_file_open or made with cvl_image_file_make_empty, a zero
+ * initialized file refers to descriptor 0.
+ */
+static inline void cvl_image_file_close(CVLImageFile * const file) {
+#if CVL_IMAGE_FILE_WINDOWS
+    if (file->mapping) {
+        UnmapViewOfFile(file->mapping);
+    }
+    if (file->mapping_handle) {
+        CloseHandle(file->mapping_handle);
+    }
+    if (file->file_handle && file->file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file->file_handle);
+    }
+#else
+    if (file->mapping) {
+        munmap(file->mapping, file->size);
+    }
+    if (file->fd != -1) {
+        close(file->fd);
+    }
+#endif
+    *file = cvl_image_file_make_empty();
+}
+
+
+
+/**
+ * Open image file and map it into memory.
+ *
+ * @param writable Map file for writing, frame changes are written back to file. Otherwise frame
+ * memory must not be written.
+ * @return false if file cannot be opened or mapped or is not valid image file.
+ * @see cvl_image_file_close
+ */
+static inline bool cvl_image_file_open(CVLImageFile * const file, const char * const path, const bool writable) {
+    *file = cvl_image_file_make_empty();
+    file->writable = writable;
+    uint64_t file_size = 0;
+#if CVL_IMAGE_FILE_WINDOWS
+    file->file_handle = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ,
+                                    NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (file->file_handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file->file_handle, &size)) {
+        cvl_image_file_close(file);
+        return false;
+    }
+    file_size = (uint64_t)size.QuadPart;
+#else
+    file->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    struct stat status;
+    if (file->fd < 0 || fstat(file->fd, &status) != 0) {
+        cvl_image_file_close(file);
+        return false;
+    }
+    file_size = (uint64_t)status.st_size;
+#endif
+    if (file_size < sizeof(CVLImageFileHeader) || file_size > SIZE_MAX) {
+        cvl_image_file_close(file);
+        return false;
+    }
+    file->size = (size_t)file_size;
+
+#if CVL_IMAGE_FILE_WINDOWS
+    file->mapping_handle = CreateFileMappingA(file->file_handle, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                              0, 0, NULL);
+    file->mapping = file->mapping_handle ?
+        MapViewOfFile(file->mapping_handle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    file->mapping = mmap(NULL, file->size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file->fd, 0);
+    if (file->mapping == MAP_FAILED) {
+        file->mapping = NULL;
+    }
+#endif
+    if (!file->mapping) {
+        cvl_image_file_close(file);
+        return false;
+    }
+    memcpy(&file->header, file->mapping, sizeof(CVLImageFileHeader));
+    if (!cvl_image_file_header_is_good(&file->header, file_size) ||
+        (uint64_t)(CVLImagePixelCount)file->header.height != file->header.height ||
+        (uint64_t)(CVLImagePixelCount)file->header.width != file->header.width)
+    {
+        cvl_image_file_close(file);
+        return false;
+    }
+    return true;
+}
+
+
+
+/** Return frame count of opened file. */
+static inline uint64_t cvl_image_file_frame_count(const CVLImageFile * const file) {
+    return file->header.frame_count;
+}
+
+
+
+/**
+ * Return view of frame @a index pointing into file mapping.
+ * View is valid until file is closed. Frame data start at page boundary.
+ */
+static inline CVLImageBuffer cvl_image_file_frame(const CVLImageFile * const file, const uint64_t index) {
+    assert(index < file->header.frame_count);
+    CVLImageBuffer frame = cvl_image_make_empty();
+    frame.data = (CVLPixel_8 *)file->mapping + file->header.data_offset + index * file->header.frame_stride;
+    frame.height = (CVLImagePixelCount)file->header.height;
+    frame.width = (CVLImagePixelCount)file->header.width;
+    frame.rowBytes = (CVLImageBytesCount)file->header.row_bytes;
+    return frame;
+}
+
+
+
+/**
+ * Set access pattern hint for the whole mapping.
+ *
+ * Does nothing where hints are unavailable, including strict ISO C modes without POSIX feature
+ * test macros (e.g. -std=c99 without _POSIX_C_SOURCE).
+ */
+static inline void cvl_image_file_advise(const CVLImageFile * const file, const CVLImageFileAdvice advice) {
+#if !CVL_IMAGE_FILE_WINDOWS && defined(MADV_SEQUENTIAL)
+    const int flags[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM};
+    madvise(file->mapping, file->size, flags[advice]);
+#elif !CVL_IMAGE_FILE_WINDOWS && defined(POSIX_MADV_NORMAL)
+    const int flags[] = {POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM};
+    posix_madvise(file->mapping, file->size, flags[advice]);
+#else
+    CVL_UNUSED(file);
+    CVL_UNUSED(advice);
+#endif
+}
+
+
+
+/** Return page aligned mapping range covering frames [first, first + count). */
+static inline void cvl_image_file_frames_range(const CVLImageFile * const file,
+                                               uint64_t first,
+                                               uint64_t count,
+                                               CVLPixel_8 ** const start,
+                                               size_t * const length)
+{
+    const uint64_t frame_count = file->header.frame_count;
+    first = first < frame_count ? first : frame_count;
+    count = count < frame_count - first ? count : frame_count - first;
+    *start = (CVLPixel_8 *)file->mapping + file->header.data_offset + first * file->header.frame_stride;
+    *length = (size_t)(count * file->header.frame_stride);
+}
+
+
+
+/**
+ * Ask system to start reading frames [first, first + count) in background, e.g. a few frames
+ * ahead of sequential playback. Does nothing where hints are unavailable.
+ */
+static inline void cvl_image_file_prefetch_frames(const CVLImageFile * const file,
+                                                  const uint64_t first,
+                                                  const uint64_t count)
+{
+    CVLPixel_8 *start;
+    size_t length;
+    cvl_image_file_frames_range(file, first, count, &start, &length);
+    if (!length) {
+        return;
+    }
+#if CVL_IMAGE_FILE_WINDOWS
+#if _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = start;
+    range.NumberOfBytes = length;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#elif defined(MADV_WILLNEED)
+    madvise(start, length, MADV_WILLNEED);
+#elif defined(POSIX_MADV_WILLNEED)
+    posix_madvise(start, length, POSIX_MADV_WILLNEED);
+#else
+    CVL_UNUSED(start);
+#endif
+}
+
+
+
+/**
+ * Tell system that frames [first, first + count) are not needed soon, e.g. frames already played,
+ * so their pages may be dropped from memory. Frames stay readable, pages are read again on access.
+ * Does nothing where hints are unavailable.
+ */
+static inline void cvl_image_file_evict_frames(const CVLImageFile * const file,
+                                               const uint64_t first,
+                                               const uint64_t count)
+{
+    CVLPixel_8 *start;
+    size_t length;
+    cvl_image_file_frames_range(file, first, count, &start, &length);
+    if (!length) {
+        return;
+    }
+#if CVL_IMAGE_FILE_WINDOWS
+    CVL_UNUSED(start);
+#elif defined(MADV_DONTNEED)
+    // Mapping is shared, so dropped pages including written ones are kept by the file.
+    madvise(start, length, MADV_DONTNEED);
+#elif defined(POSIX_MADV_DONTNEED)
+    posix_madvise(start, length, POSIX_MADV_DONTNEED);
+#else
+    CVL_UNUSED(start);
+#endif
+}
+
+
+
+/** Write @a size zero bytes. */
+static inline bool cvl_image_file_write_zeros(FILE * const file, uint64_t size) {
+    static const CVLPixel_8 zeros[4096] = {0};
+    while (size) {
+        const size_t chunk = size < sizeof(zeros) ? (size_t)size : sizeof(zeros);
+        if (fwrite(zeros, 1, chunk, file) != chunk) {
+            return false;
+        }
+        size -= chunk;
+    }
+    return true;
+}
+
+
+
+/**
+ * Create image file for frames of specified layout. Existing file is replaced.
+ *
+ * @param pixel_size Pixel memory size, must match @a pixel_type unless it is CVL_PIXEL_TYPE_UNKNOWN.
+ * @param row_bytes Bytes between rows in file or 0 for width * pixel_size.
+ * @return false if file cannot be created or layout is invalid.
+ * @see cvl_image_file_writer_append, cvl_image_file_writer_close
+ */
+static inline bool cvl_image_file_writer_open(CVLImageFileWriter * const writer,
+                                              const char * const path,
+                                              const CVLImagePixelCount height,
+                                              const CVLImagePixelCount width,
+                                              const CVLPixelType pixel_type,
+                                              const CVLImageBytesCount pixel_size,
+                                              const CVLImageBytesCount row_bytes)
+{
+    memset(writer, 0, sizeof(*writer));
+    if (!cvl_image_file_header_init(&writer->header, height, width, pixel_type, pixel_size, row_bytes)) {
+        return false;
+    }
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        return false;
+    }
+    // Header is written again with frame count on close.
+    writer->failed =
+    fwrite(&writer->header, sizeof(CVLImageFileHeader), 1, writer->file) != 1 ||
+    !cvl_image_file_write_zeros(writer->file, writer->header.data_offset - sizeof(CVLImageFileHeader));
+    return !writer->failed;
+}
+
+
+
+/** Append frame of writer layout (height, width and pixel size). @return false on write failure. */
+static inline bool cvl_image_file_writer_append(CVLImageFileWriter * const writer, const CVLImageBuffer * const frame) {
+    const CVLImageFileHeader * const header = &writer->header;
+    assert(cvl_image_is_good(frame, header->pixel_size));
+    assert(frame->height == header->height && frame->width == header->width);
+    if (writer->failed) {
+        return false;
+    }
+    const uint64_t data_bytes = header->width * header->pixel_size;
+    const uint64_t padding = header->row_bytes - data_bytes;
+    for (CVLImagePixelCount y = 0; y < frame->height && !writer->failed; ++y) {
+        writer->failed =
+        fwrite(CVL_GET_LINE(CVLPixel_8, frame, y), 1, (size_t)data_bytes, writer->file) != data_bytes ||
+        !cvl_image_file_write_zeros(writer->file, padding);
+    }
+    writer->failed = writer->failed ||
+    !cvl_image_file_write_zeros(writer->file, header->frame_stride - header->row_bytes * header->height);
+    if (!writer->failed) {
+        ++writer->header.frame_count;
+    }
+    return !writer->failed;
+}
+
+
+
+/**
+ * Write final header and close file.
+ * @return false if any write failed, file is then incomplete.
+ */
+static inline bool cvl_image_file_writer_close(CVLImageFileWriter * const writer) {
+    if (!writer->file) {
+        return false;
+    }
+    bool ok = !writer->failed &&
+    fseek(writer->file, 0, SEEK_SET) == 0 &&
+    fwrite(&writer->header, sizeof(CVLImageFileHeader), 1, writer->file) == 1;
+    ok = fclose(writer->file) == 0 && ok;
+    writer->file = NULL;
+    return ok;
+}
+
+
+
+/** Write frames of equal layout into new file. @return false on failure. */
+static inline bool cvl_image_file_write(const char * const path,
+                                        const CVLImageBuffer * const frames,
+                                        const size_t count,
+                                        const CVLPixelType pixel_type,
+                                        const CVLImageBytesCount pixel_size)
+{
+    assert(count > 0);
+    CVLImageFileWriter writer;
+    if (!cvl_image_file_writer_open(&writer, path, frames[0].height, frames[0].width, pixel_type, pixel_size, 0)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        cvl_image_file_writer_append(&writer, &frames[i]);
+    }
+    return cvl_image_file_writer_close(&writer);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_FILE_H
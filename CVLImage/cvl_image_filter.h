@@ -0,0 +1,510 @@
+#ifndef CVL_IMAGE_FILTER_H
+#define CVL_IMAGE_FILTER_H
+
+
+#include "cvl_image_convert.h"
+
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Working set size (in bytes) of vertical filter pass.
+ *
+ * Images are processed in vertical strips narrow enough for the ring of intermediate rows to fit
+ * into L2 cache, so the vertical pass does not thrash on tall images.
+ */
+#ifndef CVL_FILTER_BLOCK_BYTES
+#define CVL_FILTER_BLOCK_BYTES ((size_t)192 * 1024)
+#endif
+
+/** Number of box passes used by fast Gaussian blur approximation. */
+#define CVL_FILTER_GAUSSIAN_BOX_PASSES 3
+
+
+
+/*
+ * Row helpers.
+ *
+ * All filters work on float intermediate rows, Pixel_8 images are converted on load and rounded
+ * with saturation on store.
+ */
+
+/** Accumulate row: acc[x] += weight * src[x]. */
+static inline void cvl_filter_row_accumulate(float * CVL_RESTRICT const acc,
+                                             const float * CVL_RESTRICT const src,
+                                             const float weight,
+                                             const size_t n)
+{
+    size_t x = 0;
+#if CVL_CONVERT_SSE2
+    const __m128 vweight = _mm_set1_ps(weight);
+    for (; x + 8 <= n; x += 8) {
+        _mm_storeu_ps(acc + x,     _mm_add_ps(_mm_loadu_ps(acc + x),     _mm_mul_ps(_mm_loadu_ps(src + x),     vweight)));
+        _mm_storeu_ps(acc + x + 4, _mm_add_ps(_mm_loadu_ps(acc + x + 4), _mm_mul_ps(_mm_loadu_ps(src + x + 4), vweight)));
+    }
+#endif
+    for (; x < n; ++x) {
+        acc[x] += weight * src[x];
+    }
+}
+
+
+
+/**
+ * Load pixels [x0 - pad, x1 + pad) of row @a y of planar image into float buffer.
+ *
+ * Coordinates outside image are mapped according to @a border. Row @a y may be outside image too.
+ */
+static inline void cvl_filter_load_row(const CVLImageBuffer * const image,
+                                       const bool is_8,
+                                       const int y,
+                                       const int x0,
+                                       const int x1,
+                                       const int pad,
+                                       const CVLBorderMode border,
+                                       const float border_value,
+                                       float * const out)
+{
+    const int width = (int)image->width;
+    const int n = x1 - x0 + 2 * pad;
+    const int sy = cvl_border_index(y, (int)image->height, border);
+    if (sy < 0) {
+        for (int i = 0; i < n; ++i) {
+            out[i] = border_value;
+        }
+        return;
+    }
+    const int inner_begin = x0 - pad < 0 ? 0 : x0 - pad;
+    const int inner_end = x1 + pad > width ? width : x1 + pad;
+    if (is_8) {
+        cvl_convert_row_8_to_F(CVL_GET_LINE(const CVLPixel_8, image, sy) + inner_begin,
+                               out + (inner_begin - (x0 - pad)), (size_t)(inner_end - inner_begin), 1.0f, 0.0f);
+    }
+    else {
+        memcpy(out + (inner_begin - (x0 - pad)), CVL_GET_LINE(const CVLPixel_F, image, sy) + inner_begin,
+               (size_t)(inner_end - inner_begin) * sizeof(float));
+    }
+    // Border pixels only, inner part is already loaded.
+    for (int i = 0; i < n; ++i) {
+        const int x = x0 - pad + i;
+        if (x == inner_begin) {
+            i += inner_end - inner_begin - 1;
+            continue;
+        }
+        const int sx = cvl_border_index(x, width, border);
+        if (sx < 0) {
+            out[i] = border_value;
+        }
+        else if (is_8) {
+            out[i] = CVL_GET_PIXEL(const CVLPixel_8, image, sy, sx);
+        }
+        else {
+            out[i] = CVL_GET_PIXEL(const CVLPixel_F, image, sy, sx);
+        }
+    }
+}
+
+
+
+/** Store float row into row @a y, columns [x0, x0 + n) of planar image. */
+static inline void cvl_filter_store_row(const CVLImageBuffer * const image,
+                                        const bool is_8,
+                                        const int y,
+                                        const int x0,
+                                        const float * const row,
+                                        const size_t n)
+{
+    if (is_8) {
+        cvl_convert_row_F_to_8(row, CVL_GET_LINE(CVLPixel_8, image, y) + x0, n, 1.0f, 0.0f);
+    }
+    else {
+        memcpy(CVL_GET_LINE(CVLPixel_F, image, y) + x0, row, n * sizeof(float));
+    }
+}
+
+
+
+/** Return width of vertical strip for ring of @a ring_rows float rows. */
+static inline int cvl_filter_strip_width(const int width, const int ring_rows) {
+    int strip = (int)(CVL_FILTER_BLOCK_BYTES / ((size_t)ring_rows * sizeof(float)));
+    strip = strip < 64 ? 64 : (strip & ~15);
+    return strip < width ? strip : width;
+}
+
+
+
+/** Separable convolution of planar Pixel_8 or Pixel_F images. */
+static inline bool cvl_filter_separable(const CVLImageBuffer * const source_image,
+                                        const bool source_is_8,
+                                        const CVLImageBuffer * const dest_image,
+                                        const bool dest_is_8,
+                                        const float * const kernel_x,
+                                        const int kernel_x_size,
+                                        const float * const kernel_y,
+                                        const int kernel_y_size,
+                                        const CVLBorderMode border,
+                                        const float border_value)
+{
+    assert(cvl_image_is_good(source_image, source_is_8 ? CVLPixel_8_sz : CVLPixel_F_sz));
+    assert(cvl_image_is_good(dest_image, dest_is_8 ? CVLPixel_8_sz : CVLPixel_F_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    assert(kernel_x_size > 0 && kernel_x_size % 2 == 1 && kernel_y_size > 0 && kernel_y_size % 2 == 1);
+
+    const int width = (int)source_image->width;
+    const int height = (int)source_image->height;
+    const int rx = kernel_x_size / 2;
+    const int ry = kernel_y_size / 2;
+    const int strip = cvl_filter_strip_width(width, kernel_y_size);
+
+    const size_t line_size = (size_t)strip + 2 * (size_t)rx;
+    float * const buffer = (float *)cvl_image_data_alloc(((size_t)kernel_y_size * strip + line_size + strip) * sizeof(float),
+                                                         CVL_IMAGE_DEFAULT_ALIGNMENT);
+    if (!buffer) {
+        return false;
+    }
+    float * const ring = buffer;
+    float * const line = ring + (size_t)kernel_y_size * strip;
+    float * const acc = line + line_size;
+
+    for (int x0 = 0; x0 < width; x0 += strip) {
+        const int x1 = x0 + strip < width ? x0 + strip : width;
+        const size_t n = (size_t)(x1 - x0);
+        for (int v = -ry; v < height + ry; ++v) {
+            // Horizontal pass of virtual row v into its ring slot.
+            float * const slot = ring + (size_t)((v + ry) % kernel_y_size) * strip;
+            cvl_filter_load_row(source_image, source_is_8, v, x0, x1, rx, border, border_value, line);
+            memset(slot, 0, n * sizeof(float));
+            for (int k = 0; k < kernel_x_size; ++k) {
+                cvl_filter_row_accumulate(slot, line + k, kernel_x[k], n);
+            }
+
+            // Vertical pass as soon as all rows of output row y are ready.
+            const int y = v - ry;
+            if (y < 0) {
+                continue;
+            }
+            memset(acc, 0, n * sizeof(float));
+            for (int k = 0; k < kernel_y_size; ++k) {
+                cvl_filter_row_accumulate(acc, ring + (size_t)((y + k) % kernel_y_size) * strip, kernel_y[k], n);
+            }
+            cvl_filter_store_row(dest_image, dest_is_8, y, x0, acc, n);
+        }
+    }
+    cvl_image_data_free(buffer);
+    return true;
+}
+
+
+
+/** Box blur of planar Pixel_8 or Pixel_F images using running sums. */
+static inline bool cvl_filter_box(const CVLImageBuffer * const source_image,
+                                  const bool source_is_8,
+                                  const CVLImageBuffer * const dest_image,
+                                  const bool dest_is_8,
+                                  const int radius_x,
+                                  const int radius_y,
+                                  const CVLBorderMode border,
+                                  const float border_value)
+{
+    assert(cvl_image_is_good(source_image, source_is_8 ? CVLPixel_8_sz : CVLPixel_F_sz));
+    assert(cvl_image_is_good(dest_image, dest_is_8 ? CVLPixel_8_sz : CVLPixel_F_sz));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+    assert(radius_x >= 0 && radius_y >= 0);
+
+    const int width = (int)source_image->width;
+    const int height = (int)source_image->height;
+    const int size_y = 2 * radius_y + 1;
+    const float scale = 1.0f / (float)((2 * radius_x + 1) * size_y);
+    const int strip = cvl_filter_strip_width(width, size_y);
+
+    const size_t line_size = (size_t)strip + 2 * (size_t)radius_x;
+    float * const buffer = (float *)cvl_image_data_alloc(((size_t)size_y * strip + line_size + 2 * (size_t)strip) * sizeof(float),
+                                                         CVL_IMAGE_DEFAULT_ALIGNMENT);
+    if (!buffer) {
+        return false;
+    }
+    float * const ring = buffer;
+    float * const line = ring + (size_t)size_y * strip;
+    float * const column_sum = line + line_size;
+    float * const out = column_sum + strip;
+
+    for (int x0 = 0; x0 < width; x0 += strip) {
+        const int x1 = x0 + strip < width ? x0 + strip : width;
+        const int n = x1 - x0;
+        memset(column_sum, 0, (size_t)n * sizeof(float));
+        for (int v = -radius_y; v < height + radius_y; ++v) {
+            float * const slot = ring + (size_t)((v + radius_y) % size_y) * strip;
+
+            // Leaving row occupies the slot of the entering one.
+            if (v - size_y >= -radius_y) {
+                for (int x = 0; x < n; ++x) {
+                    column_sum[x] -= slot[x];
+                }
+            }
+
+            cvl_filter_load_row(source_image, source_is_8, v, x0, x1, radius_x, border, border_value, line);
+            float sum = 0.0f;
+            for (int k = 0; k < 2 * radius_x; ++k) {
+                sum += line[k];
+            }
+            for (int x = 0; x < n; ++x) {
+                sum += line[x + 2 * radius_x];
+                slot[x] = sum;
+                sum -= line[x];
+            }
+            for (int x = 0; x < n; ++x) {
+                column_sum[x] += slot[x];
+            }
+
+            const int y = v - radius_y;
+            if (y < 0) {
+                continue;
+            }
+            for (int x = 0; x < n; ++x) {
+                out[x] = column_sum[x] * scale;
+            }
+            cvl_filter_store_row(dest_image, dest_is_8, y, x0, out, (size_t)n);
+        }
+    }
+    cvl_image_data_free(buffer);
+    return true;
+}
+
+
+
+/*
+ * Public filters.
+ *
+ * Source and destination must have the same size and must not overlap, both may be strided.
+ * Functions return false if scratch memory could not be allocated.
+ */
+
+/**
+ * Separable convolution of Pixel_8 image, result is rounded and saturated.
+ *
+ * @param kernel_x Horizontal kernel of odd size @a kernel_x_size, centered at its middle element.
+ * @param kernel_y Vertical kernel of odd size @a kernel_y_size, centered at its middle element.
+ * @param border Border mode, @a border_value is used for CVL_BORDER_CONSTANT.
+ */
+static inline bool cvl_image_filter_separable_8(const CVLImageBuffer * const source_image,
+                                                const CVLImageBuffer * const dest_image,
+                                                const float * const kernel_x,
+                                                const int kernel_x_size,
+                                                const float * const kernel_y,
+                                                const int kernel_y_size,
+                                                const CVLBorderMode border,
+                                                const CVLPixel_8 border_value)
+{
+    return cvl_filter_separable(source_image, true, dest_image, true, kernel_x, kernel_x_size,
+                                kernel_y, kernel_y_size, border, border_value);
+}
+
+
+
+/** Separable convolution of Pixel_F image. @see cvl_image_filter_separable_8 */
+static inline bool cvl_image_filter_separable_F(const CVLImageBuffer * const source_image,
+                                                const CVLImageBuffer * const dest_image,
+                                                const float * const kernel_x,
+                                                const int kernel_x_size,
+                                                const float * const kernel_y,
+                                                const int kernel_y_size,
+                                                const CVLBorderMode border,
+                                                const CVLPixel_F border_value)
+{
+    return cvl_filter_separable(source_image, false, dest_image, false, kernel_x, kernel_x_size,
+                                kernel_y, kernel_y_size, border, border_value);
+}
+
+
+
+/**
+ * Box blur of Pixel_8 image with (2 * radius_x + 1) x (2 * radius_y + 1) window.
+ * Cost per pixel does not depend on radius.
+ */
+static inline bool cvl_image_box_blur_8(const CVLImageBuffer * const source_image,
+                                        const CVLImageBuffer * const dest_image,
+                                        const int radius_x,
+                                        const int radius_y,
+                                        const CVLBorderMode border,
+                                        const CVLPixel_8 border_value)
+{
+    return cvl_filter_box(source_image, true, dest_image, true, radius_x, radius_y, border, border_value);
+}
+
+
+
+/** Box blur of Pixel_F image. @see cvl_image_box_blur_8 */
+static inline bool cvl_image_box_blur_F(const CVLImageBuffer * const source_image,
+                                        const CVLImageBuffer * const dest_image,
+                                        const int radius_x,
+                                        const int radius_y,
+                                        const CVLBorderMode border,
+                                        const CVLPixel_F border_value)
+{
+    return cvl_filter_box(source_image, false, dest_image, false, radius_x, radius_y, border, border_value);
+}
+
+
+
+/** Return radius of Gaussian kernel covering three standard deviations. */
+static inline int cvl_gaussian_kernel_radius(const float sigma) {
+    const int radius = (int)ceilf(3.0f * sigma);
+    return radius > 0 ? radius : 1;
+}
+
+
+
+/** Fill normalized Gaussian kernel of size 2 * radius + 1. */
+static inline void cvl_gaussian_kernel(const float sigma, const int radius, float * const kernel) {
+    assert(sigma > 0.0f && radius >= 0);
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; ++i) {
+        kernel[i + radius] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+        sum += kernel[i + radius];
+    }
+    for (int i = 0; i <= 2 * radius; ++i) {
+        kernel[i] /= sum;
+    }
+}
+
+
+
+static inline bool cvl_filter_gaussian(const CVLImageBuffer * const source_image,
+                                       const CVLImageBuffer * const dest_image,
+                                       const bool is_8,
+                                       const float sigma,
+                                       const CVLBorderMode border,
+                                       const float border_value)
+{
+    const int radius = cvl_gaussian_kernel_radius(sigma);
+    float * const kernel = (float *)malloc((size_t)(2 * radius + 1) * sizeof(float));
+    if (!kernel) {
+        return false;
+    }
+    cvl_gaussian_kernel(sigma, radius, kernel);
+    const bool result = cvl_filter_separable(source_image, is_8, dest_image, is_8, kernel, 2 * radius + 1,
+                                             kernel, 2 * radius + 1, border, border_value);
+    free(kernel);
+    return result;
+}
+
+
+
+/** Gaussian blur of Pixel_8 image with kernel radius cvl_gaussian_kernel_radius(sigma). */
+static inline bool cvl_image_gaussian_blur_8(const CVLImageBuffer * const source_image,
+                                             const CVLImageBuffer * const dest_image,
+                                             const float sigma,
+                                             const CVLBorderMode border,
+                                             const CVLPixel_8 border_value)
+{
+    return cvl_filter_gaussian(source_image, dest_image, true, sigma, border, border_value);
+}
+
+
+
+/** Gaussian blur of Pixel_F image. @see cvl_image_gaussian_blur_8 */
+static inline bool cvl_image_gaussian_blur_F(const CVLImageBuffer * const source_image,
+                                             const CVLImageBuffer * const dest_image,
+                                             const float sigma,
+                                             const CVLBorderMode border,
+                                             const CVLPixel_F border_value)
+{
+    return cvl_filter_gaussian(source_image, dest_image, false, sigma, border, border_value);
+}
+
+
+
+/**
+ * Compute box radii whose successive application approximates Gaussian with @a sigma.
+ *
+ * Uses box sizes of two neighbour odd widths chosen to match Gaussian variance.
+ */
+static inline void cvl_gaussian_box_radii(const float sigma, int radii[CVL_FILTER_GAUSSIAN_BOX_PASSES]) {
+    const int passes = CVL_FILTER_GAUSSIAN_BOX_PASSES;
+    const float ideal = sqrtf(12.0f * sigma * sigma / passes + 1.0f);
+    int lower = (int)floorf(ideal);
+    if (lower % 2 == 0) {
+        lower -= 1;
+    }
+    const int upper = lower + 2;
+    const float lower_count = (12.0f * sigma * sigma - passes * lower * lower - 4.0f * passes * lower - 3.0f * passes) /
+                              (-4.0f * lower - 4.0f);
+    const int m = (int)roundf(lower_count);
+    for (int i = 0; i < passes; ++i) {
+        radii[i] = ((i < m ? lower : upper) - 1) / 2;
+    }
+}
+
+
+
+static inline bool cvl_filter_gaussian_fast(const CVLImageBuffer * const source_image,
+                                            const CVLImageBuffer * const dest_image,
+                                            const bool is_8,
+                                            const float sigma,
+                                            const CVLBorderMode border,
+                                            const float border_value)
+{
+    int radii[CVL_FILTER_GAUSSIAN_BOX_PASSES];
+    cvl_gaussian_box_radii(sigma, radii);
+    CVLImageBuffer temp = cvl_image_create(source_image->height, source_image->width, CVLPixel_F_sz);
+    if (!temp.data) {
+        return false;
+    }
+    // Intermediate passes stay in float to avoid repeated rounding: src -> temp -> dst -> temp -> dst.
+    bool result = cvl_filter_box(source_image, is_8, &temp, false, radii[0], radii[0], border, border_value);
+    if (is_8) {
+        CVLImageBuffer temp2 = cvl_image_create(source_image->height, source_image->width, CVLPixel_F_sz);
+        result = result && temp2.data &&
+                 cvl_filter_box(&temp, false, &temp2, false, radii[1], radii[1], border, border_value) &&
+                 cvl_filter_box(&temp2, false, dest_image, true, radii[2], radii[2], border, border_value);
+        cvl_image_release(&temp2);
+    }
+    else {
+        result = result &&
+                 cvl_filter_box(&temp, false, dest_image, false, radii[1], radii[1], border, border_value) &&
+                 cvl_filter_box(dest_image, false, &temp, false, radii[2], radii[2], border, border_value);
+        if (result) {
+            cvl_image_copy(&temp, (CVLImageBuffer *)dest_image, CVLPixel_F_sz);
+        }
+    }
+    cvl_image_release(&temp);
+    return result;
+}
+
+
+
+/**
+ * Fast approximation of Gaussian blur of Pixel_8 image by CVL_FILTER_GAUSSIAN_BOX_PASSES box blurs.
+ * Cost per pixel does not depend on sigma.
+ */
+static inline bool cvl_image_gaussian_blur_fast_8(const CVLImageBuffer * const source_image,
+                                                  const CVLImageBuffer * const dest_image,
+                                                  const float sigma,
+                                                  const CVLBorderMode border,
+                                                  const CVLPixel_8 border_value)
+{
+    return cvl_filter_gaussian_fast(source_image, dest_image, true, sigma, border, border_value);
+}
+
+
+
+/** Fast approximation of Gaussian blur of Pixel_F image. @see cvl_image_gaussian_blur_fast_8 */
+static inline bool cvl_image_gaussian_blur_fast_F(const CVLImageBuffer * const source_image,
+                                                  const CVLImageBuffer * const dest_image,
+                                                  const float sigma,
+                                                  const CVLBorderMode border,
+                                                  const CVLPixel_F border_value)
+{
+    return cvl_filter_gaussian_fast(source_image, dest_image, false, sigma, border, border_value);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_FILTER_H
@@ -0,0 +1,450 @@
+#ifndef CVL_IMAGE_GRAPH_H
+#define CVL_IMAGE_GRAPH_H
+
+
+#include "cvl_image_convert.h"
+#include "cvl_image_parallel.h"
+
+/*
+ * Lazy image operation graph.
+ *
+ * Pointwise stages (type conversion, scale/offset, clear, clear border, channel swizzle, gray) and
+ * subimage selection are recorded into a graph instead of being executed. Execution makes one pass
+ * over the output: each row band is processed by a pool thread, rows are processed in chunks of
+ * CVL_IMAGE_GRAPH_CHUNK_PIXELS pixels which go through all stages in two small scratch buffers,
+ * so intermediate images are never allocated and every source pixel is read from memory once.
+ *
+ * While recording, adjacent linear stages are folded together (scale/offset into conversions and
+ * into each other), stages before a clear are dropped, and subimages are turned into source
+ * offsets, so the recorded graph executes as the minimal chain of row kernels. Folding changes
+ * float rounding order, results may differ from separate passes in the last bit.
+ *
+ * Usage:
+ * CVLImageGraph graph;
+ * cvl_image_graph_init(&graph, &frame, CVL_PIXEL_TYPE_8);
+ * cvl_image_graph_convert_8_to_F(&graph, 1.0f / 255.0f, 0.0f);
+ * cvl_image_graph_scale_offset(&graph, 2.0f, -1.0f);
+ * cvl_image_graph_clear_border(&graph, 4);
+ * cvl_image_graph_subimage(&graph, roi);
+ * CVLImageBuffer result = cvl_image_graph_execute_create(&graph, pool);
+ */
+
+/** Maximal number of stages of one graph. */
+#define CVL_IMAGE_GRAPH_MAX_NODES 32
+
+/** Number of pixels of row chunk passed through all stages at once. */
+#define CVL_IMAGE_GRAPH_CHUNK_PIXELS 256
+
+/** Maximal pixel size of graph images (CVLPixel_DDDD). */
+#define CVL_IMAGE_GRAPH_MAX_PIXEL_SIZE 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Graph stage operation. */
+typedef enum {
+    CVL_IMAGE_GRAPH_CONVERT_8_TO_F = 0, ///< Pixel_8 to Pixel_F, dst = src * scale + offset.
+    CVL_IMAGE_GRAPH_CONVERT_F_TO_8,     ///< Pixel_F to Pixel_8, dst = saturate(round(src * scale + offset)).
+    CVL_IMAGE_GRAPH_SCALE_OFFSET,       ///< Pixel_F or Pixel_FFFF channels, dst = src * scale + offset.
+    CVL_IMAGE_GRAPH_SWIZZLE_8888,       ///< Pixel_8888 channel reorder, dst[c] = src[order[c]].
+    CVL_IMAGE_GRAPH_CONVERT_8888_TO_8,  ///< Pixel_8888 to Pixel_8 weighted channel sum.
+    CVL_IMAGE_GRAPH_CLEAR,              ///< Fill with zeroes, any pixel type.
+    CVL_IMAGE_GRAPH_CLEAR_BORDER        ///< Fill pixels closer than border to frame edges with zeroes.
+} CVLImageGraphOp;
+
+/** Recorded stage. */
+typedef struct {
+    CVLImageGraphOp op;
+    CVLPixelType input_type;
+    CVLPixelType output_type;
+    float scale;
+    float offset;
+    uint8_t order[4];
+    uint16_t weights[4];
+    CVLImagePixelCount border;
+    CVLImagePixelCount frame_height;  ///< Height of stage input frame.
+    CVLImagePixelCount frame_width;   ///< Width of stage input frame.
+    CVLImagePixelCount offset_y;      ///< Stage frame row of output row 0.
+    CVLImagePixelCount offset_x;      ///< Stage frame column of output column 0.
+} CVLImageGraphNode;
+
+/** Lazy chain of operations over source image. */
+typedef struct {
+    CVLImageBuffer source;            ///< Source view, must stay valid until execution.
+    CVLPixelType source_type;
+    CVLImagePixelCount source_y;      ///< Source row of output row 0.
+    CVLImagePixelCount source_x;      ///< Source column of output column 0.
+    CVLPixelType type;                ///< Pixel type of graph output.
+    CVLImagePixelCount height;        ///< Height of graph output.
+    CVLImagePixelCount width;         ///< Width of graph output.
+    CVLImageGraphNode nodes[CVL_IMAGE_GRAPH_MAX_NODES];
+    size_t node_count;
+    bool failed;                      ///< Invalid stage was recorded, graph cannot be executed.
+} CVLImageGraph;
+
+
+
+/**
+ * Start graph over source image of @a type.
+ * Pixel type must be known, source must stay valid until execution.
+ */
+static inline void cvl_image_graph_init(CVLImageGraph * const graph,
+                                        const CVLImageBuffer * const source,
+                                        const CVLPixelType type)
+{
+    memset(graph, 0, sizeof(*graph));
+    graph->source = *source;
+    graph->source_type = type;
+    graph->type = type;
+    graph->height = source->height;
+    graph->width = source->width;
+    graph->failed = !cvl_pixel_type_size(type) || !cvl_image_is_good(source, cvl_pixel_type_size(type));
+}
+
+
+
+/** Return last stage if it is @a op, otherwise NULL. */
+static inline CVLImageGraphNode *cvl_image_graph_last(CVLImageGraph * const graph, const CVLImageGraphOp op) {
+    return graph->node_count && graph->nodes[graph->node_count - 1].op == op ?
+           &graph->nodes[graph->node_count - 1] : NULL;
+}
+
+
+
+/**
+ * Append stage of @a op reading current output type @a input_type.
+ * @return New stage or NULL if graph failed or has wrong type.
+ */
+static inline CVLImageGraphNode *cvl_image_graph_append(CVLImageGraph * const graph,
+                                                        const CVLImageGraphOp op,
+                                                        const CVLPixelType input_type,
+                                                        const CVLPixelType output_type)
+{
+    if (graph->failed || (input_type != CVL_PIXEL_TYPE_UNKNOWN && graph->type != input_type) ||
+        graph->node_count == CVL_IMAGE_GRAPH_MAX_NODES)
+    {
+        graph->failed = true;
+        return NULL;
+    }
+    CVLImageGraphNode * const node = &graph->nodes[graph->node_count++];
+    memset(node, 0, sizeof(*node));
+    node->op = op;
+    node->input_type = graph->type;
+    node->output_type = output_type != CVL_PIXEL_TYPE_UNKNOWN ? output_type : graph->type;
+    node->frame_height = graph->height;
+    node->frame_width = graph->width;
+    graph->type = node->output_type;
+    return node;
+}
+
+
+
+/** Record Pixel_8 to Pixel_F conversion: dst = src * scale + offset. @return false on type mismatch. */
+static inline bool cvl_image_graph_convert_8_to_F(CVLImageGraph * const graph, const float scale, const float offset) {
+    CVLImageGraphNode * const node =
+    cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_CONVERT_8_TO_F, CVL_PIXEL_TYPE_8, CVL_PIXEL_TYPE_F);
+    if (node) {
+        node->scale = scale;
+        node->offset = offset;
+    }
+    return node != NULL;
+}
+
+
+
+/**
+ * Record Pixel_F to Pixel_8 conversion: dst = saturate(round(src * scale + offset)).
+ * @return false on type mismatch.
+ */
+static inline bool cvl_image_graph_convert_F_to_8(CVLImageGraph * const graph, const float scale, const float offset) {
+    float fused_scale = scale;
+    float fused_offset = offset;
+    // scale * (a * x + b) + offset
+    const CVLImageGraphNode * const previous = cvl_image_graph_last(graph, CVL_IMAGE_GRAPH_SCALE_OFFSET);
+    if (previous && previous->input_type == CVL_PIXEL_TYPE_F) {
+        fused_scale = scale * previous->scale;
+        fused_offset = scale * previous->offset + offset;
+        --graph->node_count;
+    }
+    CVLImageGraphNode * const node =
+    cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_CONVERT_F_TO_8, CVL_PIXEL_TYPE_F, CVL_PIXEL_TYPE_8);
+    if (node) {
+        node->scale = fused_scale;
+        node->offset = fused_offset;
+    }
+    return node != NULL;
+}
+
+
+
+/**
+ * Record dst = src * scale + offset of every channel of Pixel_F or Pixel_FFFF image.
+ * @return false on type mismatch.
+ */
+static inline bool cvl_image_graph_scale_offset(CVLImageGraph * const graph, const float scale, const float offset) {
+    if (graph->failed || (graph->type != CVL_PIXEL_TYPE_F && graph->type != CVL_PIXEL_TYPE_FFFF)) {
+        graph->failed = true;
+        return false;
+    }
+    // a * (scale * x + offset) + b
+    CVLImageGraphNode *previous = cvl_image_graph_last(graph, CVL_IMAGE_GRAPH_SCALE_OFFSET);
+    previous = previous ? previous : cvl_image_graph_last(graph, CVL_IMAGE_GRAPH_CONVERT_8_TO_F);
+    if (previous) {
+        previous->offset = previous->offset * scale + offset;
+        previous->scale = previous->scale * scale;
+        return true;
+    }
+    CVLImageGraphNode * const node =
+    cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_SCALE_OFFSET, CVL_PIXEL_TYPE_UNKNOWN, CVL_PIXEL_TYPE_UNKNOWN);
+    if (node) {
+        node->scale = scale;
+        node->offset = offset;
+    }
+    return node != NULL;
+}
+
+
+
+/** Record channel reorder of Pixel_8888 image: dst[c] = src[order[c]]. @return false on type mismatch. */
+static inline bool cvl_image_graph_swizzle_8888(CVLImageGraph * const graph, const uint8_t order[4]) {
+    CVLImageGraphNode * const node =
+    cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_SWIZZLE_8888, CVL_PIXEL_TYPE_8888, CVL_PIXEL_TYPE_8888);
+    if (node) {
+        memcpy(node->order, order, sizeof(node->order));
+    }
+    return node != NULL;
+}
+
+
+
+/**
+ * Record Pixel_8888 to Pixel_8 conversion as weighted sum of channels.
+ * @param weights Fixed point channel weights with 8 fractional bits, their sum must not exceed 256.
+ * @return false on type mismatch.
+ */
+static inline bool cvl_image_graph_convert_8888_to_8(CVLImageGraph * const graph, const uint16_t weights[4]) {
+    CVLImageGraphNode * const node =
+    cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_CONVERT_8888_TO_8, CVL_PIXEL_TYPE_8888, CVL_PIXEL_TYPE_8);
+    if (node) {
+        memcpy(node->weights, weights, sizeof(node->weights));
+    }
+    return node != NULL;
+}
+
+
+
+/** Record conversion of RGBA Pixel_8888 image to BT.601 gray Pixel_8 image. */
+static inline bool cvl_image_graph_rgba_to_gray(CVLImageGraph * const graph) {
+    const uint16_t weights[4] = {CVL_GRAY_WEIGHT_R, CVL_GRAY_WEIGHT_G, CVL_GRAY_WEIGHT_B, 0};
+    return cvl_image_graph_convert_8888_to_8(graph, weights);
+}
+
+
+
+/** Record filling image with zeroes, see cvl_image_clear. Earlier stages are dropped. */
+static inline bool cvl_image_graph_clear(CVLImageGraph * const graph) {
+    if (!graph->failed) {
+        graph->node_count = 0;
+    }
+    return cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_CLEAR, CVL_PIXEL_TYPE_UNKNOWN, CVL_PIXEL_TYPE_UNKNOWN) != NULL;
+}
+
+
+
+/** Record filling pixels closer than @a border pixels to image edges with zeroes. */
+static inline bool cvl_image_graph_clear_border(CVLImageGraph * const graph, const CVLImagePixelCount border) {
+    CVLImageGraphNode * const node =
+    cvl_image_graph_append(graph, CVL_IMAGE_GRAPH_CLEAR_BORDER, CVL_PIXEL_TYPE_UNKNOWN, CVL_PIXEL_TYPE_UNKNOWN);
+    if (node) {
+        node->border = border;
+    }
+    return node != NULL;
+}
+
+
+
+/**
+ * Record selection of subimage at @a roi of current image, see cvl_image_subimage.
+ * Graph output becomes roi sized. @return false if roi is outside of current image.
+ */
+static inline bool cvl_image_graph_subimage(CVLImageGraph * const graph, const CVLRect roi) {
+    if (graph->failed || roi.x < 0 || roi.y < 0 || roi.width <= 0 || roi.height <= 0 ||
+        (CVLImagePixelCount)roi.x + (CVLImagePixelCount)roi.width > graph->width ||
+        (CVLImagePixelCount)roi.y + (CVLImagePixelCount)roi.height > graph->height)
+    {
+        graph->failed = true;
+        return false;
+    }
+    for (size_t i = 0; i < graph->node_count; ++i) {
+        graph->nodes[i].offset_y += (CVLImagePixelCount)roi.y;
+        graph->nodes[i].offset_x += (CVLImagePixelCount)roi.x;
+    }
+    graph->source_y += (CVLImagePixelCount)roi.y;
+    graph->source_x += (CVLImagePixelCount)roi.x;
+    graph->height = (CVLImagePixelCount)roi.height;
+    graph->width = (CVLImagePixelCount)roi.width;
+    return true;
+}
+
+
+
+/** Run stage over chunk of @a n pixels starting at output (@a y, @a x). */
+static inline void cvl_image_graph_run_node(const CVLImageGraphNode * const node,
+                                            const CVLPixel_8 * const src,
+                                            CVLPixel_8 * const dst,
+                                            const size_t n,
+                                            const CVLImagePixelCount y,
+                                            const CVLImagePixelCount x)
+{
+    switch (node->op) {
+        case CVL_IMAGE_GRAPH_CONVERT_8_TO_F:
+            cvl_convert_row_8_to_F(src, (CVLPixel_F *)dst, n, node->scale, node->offset);
+            break;
+        case CVL_IMAGE_GRAPH_CONVERT_F_TO_8:
+            cvl_convert_row_F_to_8((const CVLPixel_F *)src, dst, n, node->scale, node->offset);
+            break;
+        case CVL_IMAGE_GRAPH_SCALE_OFFSET: {
+            const float * const in = (const float *)src;
+            float * const out = (float *)dst;
+            const size_t count = n * (node->input_type == CVL_PIXEL_TYPE_FFFF ? 4 : 1);
+            const float scale = node->scale;
+            const float offset = node->offset;
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = in[i] * scale + offset;
+            }
+            break;
+        }
+        case CVL_IMAGE_GRAPH_SWIZZLE_8888:
+            cvl_convert_row_swizzle_8888(src, dst, n, node->order);
+            break;
+        case CVL_IMAGE_GRAPH_CONVERT_8888_TO_8:
+            cvl_convert_row_8888_to_8(src, dst, n, node->weights);
+            break;
+        case CVL_IMAGE_GRAPH_CLEAR:
+            memset(dst, 0, n * cvl_pixel_type_size(node->output_type));
+            break;
+        case CVL_IMAGE_GRAPH_CLEAR_BORDER: {
+            const size_t pixel_size = cvl_pixel_type_size(node->output_type);
+            const CVLImagePixelCount border = node->border;
+            const CVLImagePixelCount fy = y + node->offset_y;
+            const CVLImagePixelCount fx = x + node->offset_x;
+            if (fy < border || fy + border >= node->frame_height) {
+                memset(dst, 0, n * pixel_size);
+                break;
+            }
+            memcpy(dst, src, n * pixel_size);
+            // Zero [fx, fx + n) intersected with [0, border) and [frame_width - border, frame_width).
+            const CVLImagePixelCount left = border > fx ? border - fx : 0;
+            if (left) {
+                memset(dst, 0, (left < n ? left : n) * pixel_size);
+            }
+            const CVLImagePixelCount right = node->frame_width > border ? node->frame_width - border : 0;
+            if (fx + n > right) {
+                const CVLImagePixelCount first = right > fx ? right - fx : 0;
+                memset(dst + first * pixel_size, 0, (n - first) * pixel_size);
+            }
+            break;
+        }
+    }
+}
+
+
+
+/** Context of graph band tasks. */
+typedef struct {
+    const CVLImageGraph *graph;
+    const CVLImageBuffer *dest;
+} CVLImageGraphBands;
+
+
+
+static inline void cvl_image_graph_band(void * const context, const size_t begin, const size_t end) {
+    const CVLImageGraphBands * const bands = (const CVLImageGraphBands *)context;
+    const CVLImageGraph * const graph = bands->graph;
+    const CVLImageBuffer * const dest = bands->dest;
+    const size_t source_pixel_size = cvl_pixel_type_size(graph->source_type);
+    const size_t dest_pixel_size = cvl_pixel_type_size(graph->type);
+    const size_t last = graph->node_count - 1;
+    CVLPixel_8 scratch[2][CVL_IMAGE_GRAPH_CHUNK_PIXELS * CVL_IMAGE_GRAPH_MAX_PIXEL_SIZE];
+
+    for (size_t y = begin; y < end; ++y) {
+        const CVLPixel_8 * const source_row =
+        CVL_GET_LINE(const CVLPixel_8, &graph->source, graph->source_y + y) + graph->source_x * source_pixel_size;
+        CVLPixel_8 * const dest_row = CVL_GET_LINE(CVLPixel_8, dest, y);
+        for (CVLImagePixelCount x = 0; x < graph->width; x += CVL_IMAGE_GRAPH_CHUNK_PIXELS) {
+            const size_t n = graph->width - x < CVL_IMAGE_GRAPH_CHUNK_PIXELS ? graph->width - x : CVL_IMAGE_GRAPH_CHUNK_PIXELS;
+            CVLPixel_8 * const out = dest_row + x * dest_pixel_size;
+            const CVLPixel_8 *in = source_row + x * source_pixel_size;
+            if (!graph->node_count) {
+                memcpy(out, in, n * dest_pixel_size);
+                continue;
+            }
+            for (size_t i = 0; i < graph->node_count; ++i) {
+                CVLPixel_8 * const stage_out = i == last ? out : scratch[i & 1];
+                cvl_image_graph_run_node(&graph->nodes[i], in, stage_out, n, (CVLImagePixelCount)y, x);
+                in = stage_out;
+            }
+        }
+    }
+}
+
+
+
+/** Return false if graph failed or @a dest does not match graph output. */
+static inline bool cvl_image_graph_can_execute(const CVLImageGraph * const graph, const CVLImageBuffer * const dest) {
+    return !graph->failed && cvl_image_is_good(dest, cvl_pixel_type_size(graph->type)) &&
+           dest->height == graph->height && dest->width == graph->width;
+}
+
+
+
+/**
+ * Execute graph writing output into @a dest of graph output size and type.
+ *
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ * @param dest Destination image, must not overlap source.
+ * @return false if graph failed or destination does not match graph output.
+ */
+static inline bool cvl_image_graph_execute(const CVLImageGraph * const graph,
+                                           CVLThreadPool * const pool,
+                                           const CVLImageBuffer * const dest)
+{
+    if (!cvl_image_graph_can_execute(graph, dest)) {
+        return false;
+    }
+    CVLImageGraphBands bands;
+    bands.graph = graph;
+    bands.dest = dest;
+    const size_t row_bytes = graph->width * (cvl_pixel_type_size(graph->source_type) + cvl_pixel_type_size(graph->type));
+    cvl_image_parallel_for_rows(pool, graph->height, row_bytes, cvl_image_graph_band, &bands);
+    return true;
+}
+
+
+
+/**
+ * Execute graph into new image of graph output size and type.
+ * @return Empty image if graph failed or on allocation failure.
+ */
+static inline CVLImageBuffer cvl_image_graph_execute_create(const CVLImageGraph * const graph,
+                                                            CVLThreadPool * const pool)
+{
+    if (graph->failed) {
+        return cvl_image_make_empty();
+    }
+    CVLImageBuffer dest = cvl_image_create(graph->height, graph->width, cvl_pixel_type_size(graph->type));
+    if (dest.data && !cvl_image_graph_execute(graph, pool, &dest)) {
+        cvl_image_release(&dest);
+    }
+    return dest;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_GRAPH_H
@@ -0,0 +1,515 @@
+#ifndef CVL_IMAGE_INTEGRAL_H
+#define CVL_IMAGE_INTEGRAL_H
+
+
+#include "cvl_image_parallel.h"
+#include "cvl_simd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Accumulator type of integral image.
+ *
+ * Integer sums use modular arithmetic, so a rect sum is exact as long as the sum over that rect
+ * fits into the accumulator, even if the total image sum overflows. Squared sums of integer
+ * integral images are always 64 bit.
+ */
+typedef enum {
+    CVL_INTEGRAL_U32 = 0, ///< uint32_t sums, Pixel_8 only, rect sums up to 2^32 - 1 (16.8M pixels).
+    CVL_INTEGRAL_U64,     ///< uint64_t sums, Pixel_8 only.
+    CVL_INTEGRAL_D        ///< double sums, Pixel_8 or Pixel_F.
+} CVLIntegralType;
+
+/**
+ * Integral image (summed area table) with optional squared sums.
+ *
+ * Tables have (height + 1) x (width + 1) elements, element (y, x) is the sum of source pixels
+ * above and left of it, first row and column are zero.
+ *
+ * @see cvl_integral_init
+ */
+typedef struct {
+    CVLIntegralType type;  ///< Accumulator type of sum table.
+    CVLImageBuffer sum;    ///< Sum table.
+    CVLImageBuffer sqsum;  ///< Squared sum table, empty if not requested.
+} CVLIntegralImage;
+
+
+
+/** Return element size of sum table of specified type. */
+static inline CVLImageBytesCount cvl_integral_sum_size(const CVLIntegralType type) {
+    return type == CVL_INTEGRAL_U32 ? sizeof(uint32_t) : (type == CVL_INTEGRAL_U64 ? sizeof(uint64_t) : sizeof(double));
+}
+
+
+
+/** Return element size of squared sum table of specified type. */
+static inline CVLImageBytesCount cvl_integral_sqsum_size(const CVLIntegralType type) {
+    return type == CVL_INTEGRAL_D ? sizeof(double) : sizeof(uint64_t);
+}
+
+
+
+/** Release integral image tables. */
+static inline void cvl_integral_release(CVLIntegralImage * const integral) {
+    cvl_image_release_aligned(&integral->sum);
+    cvl_image_release_aligned(&integral->sqsum);
+}
+
+
+
+/**
+ * Allocate integral image for source of specified size.
+ *
+ * @param with_squares Allocate squared sum table, needed for variance queries.
+ * @return false on allocation failure.
+ * @see cvl_integral_release
+ */
+static inline bool cvl_integral_init(CVLIntegralImage * const integral,
+                                     const CVLImagePixelCount height,
+                                     const CVLImagePixelCount width,
+                                     const CVLIntegralType type,
+                                     const bool with_squares)
+{
+    integral->type = type;
+    integral->sum = cvl_image_create_aligned(height + 1, width + 1, cvl_integral_sum_size(type),
+                                             CVL_IMAGE_DEFAULT_ALIGNMENT, CVL_IMAGE_ROW_PADDING_AVOID_ALIASING);
+    integral->sqsum = with_squares ?
+                      cvl_image_create_aligned(height + 1, width + 1, cvl_integral_sqsum_size(type),
+                                               CVL_IMAGE_DEFAULT_ALIGNMENT, CVL_IMAGE_ROW_PADDING_AVOID_ALIASING) :
+                      cvl_image_make_empty();
+    if (!integral->sum.data || (with_squares && !integral->sqsum.data)) {
+        cvl_integral_release(integral);
+        return false;
+    }
+    memset(integral->sum.data, 0, integral->sum.rowBytes);
+    if (with_squares) {
+        memset(integral->sqsum.data, 0, integral->sqsum.rowBytes);
+    }
+    return true;
+}
+
+
+
+/*
+ * Row kernels: out[x + 1] = above[x + 1] + sum(src[0..x]), out[0] = 0.
+ * @a above may be NULL for the first row of a band.
+ */
+
+static inline void cvl_integral_row_8_u32(const CVLPixel_8 * const src,
+                                          const uint32_t * const above,
+                                          uint32_t * const out,
+                                          const size_t n)
+{
+    out[0] = 0;
+    size_t x = 0;
+    uint32_t carry = 0;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vcarry = _mm_setzero_si128();
+    for (; x + 4 <= n; x += 4) {
+        uint32_t bytes;
+        memcpy(&bytes, src + x, 4);
+        __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)bytes), zero), zero);
+        // In-register prefix sum of 4 lanes.
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, vcarry);
+        vcarry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i result = above ? _mm_add_epi32(v, _mm_loadu_si128((const __m128i *)(above + x + 1))) : v;
+        _mm_storeu_si128((__m128i *)(out + x + 1), result);
+    }
+    carry = (uint32_t)_mm_cvtsi128_si32(vcarry);
+#endif
+    for (; x < n; ++x) {
+        carry += src[x];
+        out[x + 1] = carry + (above ? above[x + 1] : 0);
+    }
+}
+
+
+
+static inline void cvl_integral_row_8_u64(const CVLPixel_8 * const src,
+                                          const uint64_t * const above,
+                                          uint64_t * const out,
+                                          const size_t n)
+{
+    out[0] = 0;
+    uint64_t carry = 0;
+    for (size_t x = 0; x < n; ++x) {
+        carry += src[x];
+        out[x + 1] = carry;
+    }
+    if (above) {
+        for (size_t x = 1; x <= n; ++x) {
+            out[x] += above[x];
+        }
+    }
+}
+
+
+
+static inline void cvl_integral_row_8_sq_u64(const CVLPixel_8 * const src,
+                                             const uint64_t * const above,
+                                             uint64_t * const out,
+                                             const size_t n)
+{
+    out[0] = 0;
+    uint64_t carry = 0;
+    for (size_t x = 0; x < n; ++x) {
+        carry += (uint32_t)src[x] * src[x];
+        out[x + 1] = carry;
+    }
+    if (above) {
+        for (size_t x = 1; x <= n; ++x) {
+            out[x] += above[x];
+        }
+    }
+}
+
+
+
+static inline void cvl_integral_row_d(const void * const src,
+                                      const bool source_is_8,
+                                      const bool squares,
+                                      const double * const above,
+                                      double * const out,
+                                      const size_t n)
+{
+    out[0] = 0.0;
+    double carry = 0.0;
+    for (size_t x = 0; x < n; ++x) {
+        const double v = source_is_8 ? ((const CVLPixel_8 *)src)[x] : ((const CVLPixel_F *)src)[x];
+        carry += squares ? v * v : v;
+        out[x + 1] = carry;
+    }
+    if (above) {
+        for (size_t x = 1; x <= n; ++x) {
+            out[x] += above[x];
+        }
+    }
+}
+
+
+
+/** Add carry row to table row: out[x] += carry[x]. */
+static inline void cvl_integral_row_add(void * const out,
+                                        const void * const carry,
+                                        const size_t n,
+                                        const CVLImageBytesCount element_size,
+                                        const bool is_double)
+{
+    if (is_double) {
+        for (size_t x = 0; x < n; ++x) {
+            ((double *)out)[x] += ((const double *)carry)[x];
+        }
+    }
+    else if (element_size == sizeof(uint32_t)) {
+        for (size_t x = 0; x < n; ++x) {
+            ((uint32_t *)out)[x] += ((const uint32_t *)carry)[x];
+        }
+    }
+    else {
+        for (size_t x = 0; x < n; ++x) {
+            ((uint64_t *)out)[x] += ((const uint64_t *)carry)[x];
+        }
+    }
+}
+
+
+
+/** Context of integral image construction bands. */
+typedef struct {
+    const CVLImageBuffer *source;
+    bool source_is_8;
+    CVLIntegralImage *integral;
+    size_t band_rows;
+    void *sum_carry;   ///< Carry row per band for sum table.
+    void *sqsum_carry; ///< Carry row per band for squared sum table.
+} CVLIntegralBands;
+
+
+
+/** Compute band-local integral rows: band starts from zero instead of the row above it. */
+static inline void cvl_integral_local_band(void * const context, const size_t begin, const size_t end) {
+    const CVLIntegralBands * const bands = (const CVLIntegralBands *)context;
+    const CVLImageBuffer * const src = bands->source;
+    CVLIntegralImage * const integral = bands->integral;
+    const bool squares = integral->sqsum.data != NULL;
+    const size_t n = src->width;
+    for (size_t y = begin; y < end; ++y) {
+        const CVLPixel_8 * const row = CVL_GET_LINE(const CVLPixel_8, src, y);
+        const bool first = (y % bands->band_rows) == 0;
+        switch (integral->type) {
+            case CVL_INTEGRAL_U32:
+                cvl_integral_row_8_u32(row, first ? NULL : CVL_GET_LINE(const uint32_t, &integral->sum, y),
+                                       CVL_GET_LINE(uint32_t, &integral->sum, y + 1), n);
+                break;
+            case CVL_INTEGRAL_U64:
+                cvl_integral_row_8_u64(row, first ? NULL : CVL_GET_LINE(const uint64_t, &integral->sum, y),
+                                       CVL_GET_LINE(uint64_t, &integral->sum, y + 1), n);
+                break;
+            case CVL_INTEGRAL_D:
+                cvl_integral_row_d(row, bands->source_is_8, false,
+                                   first ? NULL : CVL_GET_LINE(const double, &integral->sum, y),
+                                   CVL_GET_LINE(double, &integral->sum, y + 1), n);
+                break;
+        }
+        if (!squares) {
+            continue;
+        }
+        if (integral->type == CVL_INTEGRAL_D) {
+            cvl_integral_row_d(row, bands->source_is_8, true,
+                               first ? NULL : CVL_GET_LINE(const double, &integral->sqsum, y),
+                               CVL_GET_LINE(double, &integral->sqsum, y + 1), n);
+        }
+        else {
+            cvl_integral_row_8_sq_u64(row, first ? NULL : CVL_GET_LINE(const uint64_t, &integral->sqsum, y),
+                                      CVL_GET_LINE(uint64_t, &integral->sqsum, y + 1), n);
+        }
+    }
+}
+
+
+
+/** Add carry rows of preceding bands to all rows of bands. */
+static inline void cvl_integral_fixup_band(void * const context, const size_t begin, const size_t end) {
+    const CVLIntegralBands * const bands = (const CVLIntegralBands *)context;
+    CVLIntegralImage * const integral = bands->integral;
+    const bool is_double = integral->type == CVL_INTEGRAL_D;
+    const size_t n = integral->sum.width;
+    const CVLImageBytesCount sum_size = cvl_integral_sum_size(integral->type);
+    const CVLImageBytesCount sqsum_size = cvl_integral_sqsum_size(integral->type);
+    for (size_t y = begin; y < end; ++y) {
+        const size_t band = y / bands->band_rows;
+        if (band == 0) {
+            continue;
+        }
+        cvl_integral_row_add(CVL_GET_LINE(CVLPixel_8, &integral->sum, y + 1),
+                             (const CVLPixel_8 *)bands->sum_carry + band * n * sum_size, n, sum_size, is_double);
+        if (integral->sqsum.data) {
+            cvl_integral_row_add(CVL_GET_LINE(CVLPixel_8, &integral->sqsum, y + 1),
+                                 (const CVLPixel_8 *)bands->sqsum_carry + band * n * sqsum_size, n, sqsum_size, is_double);
+        }
+    }
+}
+
+
+
+static inline bool cvl_integral_compute(CVLThreadPool * const pool,
+                                        const CVLImageBuffer * const source_image,
+                                        const bool source_is_8,
+                                        CVLIntegralImage * const integral)
+{
+    assert(cvl_image_is_good(source_image, source_is_8 ? CVLPixel_8_sz : CVLPixel_F_sz));
+    assert(integral->sum.height == source_image->height + 1 && integral->sum.width == source_image->width + 1);
+    assert(source_is_8 || integral->type == CVL_INTEGRAL_D);
+
+    const size_t height = source_image->height;
+    const size_t n = integral->sum.width;
+    if (height == 0) {
+        return true;
+    }
+    const CVLImageBytesCount sum_size = cvl_integral_sum_size(integral->type);
+    const CVLImageBytesCount sqsum_size = cvl_integral_sqsum_size(integral->type);
+
+    CVLIntegralBands bands;
+    bands.source = source_image;
+    bands.source_is_8 = source_is_8;
+    bands.integral = integral;
+    bands.band_rows = cvl_thread_pool_thread_count(pool) > 1 ?
+                      cvl_image_parallel_band_rows(pool, height, n * sum_size) : height;
+    bands.sum_carry = NULL;
+    bands.sqsum_carry = NULL;
+    const size_t band_count = (height + bands.band_rows - 1) / bands.band_rows;
+
+    // Single band: rows are computed from the row above directly, no fix-up pass.
+    if (band_count == 1) {
+        cvl_integral_local_band(&bands, 0, height);
+        return true;
+    }
+
+    bands.sum_carry = calloc(band_count * n, sum_size);
+    bands.sqsum_carry = integral->sqsum.data ? calloc(band_count * n, sqsum_size) : NULL;
+    if (!bands.sum_carry || (integral->sqsum.data && !bands.sqsum_carry)) {
+        free(bands.sum_carry);
+        free(bands.sqsum_carry);
+        return false;
+    }
+
+    cvl_parallel_for(pool, height, bands.band_rows, cvl_integral_local_band, &bands);
+
+    // Carry of band b is the final last row of band b - 1.
+    const bool is_double = integral->type == CVL_INTEGRAL_D;
+    for (size_t band = 1; band < band_count; ++band) {
+        const size_t last_row = band * bands.band_rows;
+        CVLPixel_8 * const sum_carry = (CVLPixel_8 *)bands.sum_carry + band * n * sum_size;
+        memcpy(sum_carry, CVL_GET_LINE(const CVLPixel_8, &integral->sum, last_row), n * sum_size);
+        cvl_integral_row_add(sum_carry, sum_carry - n * sum_size, n, sum_size, is_double);
+        if (integral->sqsum.data) {
+            CVLPixel_8 * const sqsum_carry = (CVLPixel_8 *)bands.sqsum_carry + band * n * sqsum_size;
+            memcpy(sqsum_carry, CVL_GET_LINE(const CVLPixel_8, &integral->sqsum, last_row), n * sqsum_size);
+            cvl_integral_row_add(sqsum_carry, sqsum_carry - n * sqsum_size, n, sqsum_size, is_double);
+        }
+    }
+
+    cvl_parallel_for(pool, height, bands.band_rows, cvl_integral_fixup_band, &bands);
+
+    free(bands.sum_carry);
+    free(bands.sqsum_carry);
+    return true;
+}
+
+
+
+/**
+ * Compute integral image of Pixel_8 image.
+ *
+ * Rows are split into bands computed in parallel, followed by a parallel fix-up pass adding sums
+ * of preceding bands.
+ * @param pool Thread pool or NULL to compute on the calling thread in one pass.
+ * @param integral Integral image initialized for source size.
+ * @return false on allocation failure.
+ */
+static inline bool cvl_integral_compute_8(CVLThreadPool * const pool,
+                                          const CVLImageBuffer * const source_image,
+                                          CVLIntegralImage * const integral)
+{
+    return cvl_integral_compute(pool, source_image, true, integral);
+}
+
+
+
+/** Compute integral image of Pixel_F image, integral must be of CVL_INTEGRAL_D type. */
+static inline bool cvl_integral_compute_F(CVLThreadPool * const pool,
+                                          const CVLImageBuffer * const source_image,
+                                          CVLIntegralImage * const integral)
+{
+    return cvl_integral_compute(pool, source_image, false, integral);
+}
+
+
+
+/** Return sum of table over rect using four corner lookups. */
+static inline double cvl_integral_table_rect(const CVLImageBuffer * const table,
+                                             const CVLIntegralType type,
+                                             const bool squares,
+                                             const CVLRect rect)
+{
+    const int x0 = rect.x, y0 = rect.y, x1 = rect.x + rect.width, y1 = rect.y + rect.height;
+    if (type == CVL_INTEGRAL_D) {
+        return CVL_GET_PIXEL(const double, table, y1, x1) - CVL_GET_PIXEL(const double, table, y0, x1) -
+               CVL_GET_PIXEL(const double, table, y1, x0) + CVL_GET_PIXEL(const double, table, y0, x0);
+    }
+    if (type == CVL_INTEGRAL_U32 && !squares) {
+        return (double)(uint32_t)(CVL_GET_PIXEL(const uint32_t, table, y1, x1) - CVL_GET_PIXEL(const uint32_t, table, y0, x1) -
+                                  CVL_GET_PIXEL(const uint32_t, table, y1, x0) + CVL_GET_PIXEL(const uint32_t, table, y0, x0));
+    }
+    return (double)(uint64_t)(CVL_GET_PIXEL(const uint64_t, table, y1, x1) - CVL_GET_PIXEL(const uint64_t, table, y0, x1) -
+                              CVL_GET_PIXEL(const uint64_t, table, y1, x0) + CVL_GET_PIXEL(const uint64_t, table, y0, x0));
+}
+
+
+
+/** Check that rect is non-empty and inside source image of integral. */
+static inline bool cvl_integral_is_good_rect(const CVLIntegralImage * const integral, const CVLRect rect) {
+    return rect.width > 0 && rect.height > 0 && rect.x >= 0 && rect.y >= 0 &&
+           rect.x + rect.width < (int)integral->sum.width && rect.y + rect.height < (int)integral->sum.height;
+}
+
+
+
+/** Return sum of source pixels inside rect in O(1). */
+static inline double cvl_integral_sum(const CVLIntegralImage * const integral, const CVLRect rect) {
+    assert(cvl_integral_is_good_rect(integral, rect));
+    return cvl_integral_table_rect(&integral->sum, integral->type, false, rect);
+}
+
+
+
+/** Return sum of squared source pixels inside rect in O(1). Integral must have squared sums. */
+static inline double cvl_integral_sqsum(const CVLIntegralImage * const integral, const CVLRect rect) {
+    assert(cvl_integral_is_good_rect(integral, rect));
+    assert(integral->sqsum.data);
+    return cvl_integral_table_rect(&integral->sqsum, integral->type, true, rect);
+}
+
+
+
+/** Compute mean and variance of source pixels inside rect in O(1). Integral must have squared sums. */
+static inline void cvl_integral_mean_variance(const CVLIntegralImage * const integral,
+                                              const CVLRect rect,
+                                              double * const mean,
+                                              double * const variance)
+{
+    const double area = (double)rect.width * rect.height;
+    const double m = cvl_integral_sum(integral, rect) / area;
+    const double v = cvl_integral_sqsum(integral, rect) / area - m * m;
+    *mean = m;
+    *variance = v > 0.0 ? v : 0.0;
+}
+
+
+
+/** Compute sums over @a count rects. Type dispatch is done once for the whole batch. */
+static inline void cvl_integral_sum_batch(const CVLIntegralImage * const integral,
+                                          const CVLRect * const rects,
+                                          const size_t count,
+                                          double * const sums)
+{
+    const CVLImageBuffer * const table = &integral->sum;
+    switch (integral->type) {
+        case CVL_INTEGRAL_U32:
+            for (size_t i = 0; i < count; ++i) {
+                assert(cvl_integral_is_good_rect(integral, rects[i]));
+                sums[i] = cvl_integral_table_rect(table, CVL_INTEGRAL_U32, false, rects[i]);
+            }
+            break;
+        case CVL_INTEGRAL_U64:
+            for (size_t i = 0; i < count; ++i) {
+                assert(cvl_integral_is_good_rect(integral, rects[i]));
+                sums[i] = cvl_integral_table_rect(table, CVL_INTEGRAL_U64, false, rects[i]);
+            }
+            break;
+        case CVL_INTEGRAL_D:
+            for (size_t i = 0; i < count; ++i) {
+                assert(cvl_integral_is_good_rect(integral, rects[i]));
+                sums[i] = cvl_integral_table_rect(table, CVL_INTEGRAL_D, false, rects[i]);
+            }
+            break;
+    }
+}
+
+
+
+/**
+ * Compute mean and variance over @a count rects.
+ * Integral must have squared sums. @a variances may be NULL.
+ */
+static inline void cvl_integral_mean_variance_batch(const CVLIntegralImage * const integral,
+                                                    const CVLRect * const rects,
+                                                    const size_t count,
+                                                    double * const means,
+                                                    double * const variances)
+{
+    cvl_integral_sum_batch(integral, rects, count, means);
+    for (size_t i = 0; i < count; ++i) {
+        const double area = (double)rects[i].width * rects[i].height;
+        means[i] /= area;
+        if (variances) {
+            const double v = cvl_integral_table_rect(&integral->sqsum, integral->type, true, rects[i]) / area -
+                             means[i] * means[i];
+            variances[i] = v > 0.0 ? v : 0.0;
+        }
+    }
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_INTEGRAL_H
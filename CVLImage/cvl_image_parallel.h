@@ -0,0 +1,366 @@
+#ifndef CVL_IMAGE_PARALLEL_H
+#define CVL_IMAGE_PARALLEL_H
+
+
+#include "cvl_image_utils.h"
+#include "cvl_threading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Target size (in bytes) of one row band processed by a single task.
+ * Bands of this size fit into per-core L2 cache together with their source.
+ */
+#ifndef CVL_PARALLEL_BAND_BYTES
+#define CVL_PARALLEL_BAND_BYTES ((size_t)128 * 1024)
+#endif
+
+/** Minimal number of bands per thread, keeps threads balanced when band costs differ. */
+#ifndef CVL_PARALLEL_BANDS_PER_THREAD
+#define CVL_PARALLEL_BANDS_PER_THREAD 4
+#endif
+
+/** Images smaller than this size (in bytes) are processed by the calling thread only. */
+#ifndef CVL_PARALLEL_MIN_IMAGE_BYTES
+#define CVL_PARALLEL_MIN_IMAGE_BYTES ((size_t)256 * 1024)
+#endif
+
+
+
+/**
+ * Task function of parallel loop.
+ *
+ * @param context User context passed to parallel loop.
+ * @param begin First item (e.g. image row) of range to process.
+ * @param end Item after the last one of range to process.
+ */
+typedef void (*CVLParallelFunction)(void *context, size_t begin, size_t end);
+
+/**
+ * Pool of worker threads executing parallel loops.
+ *
+ * Loop items are split into chunks which workers and the calling thread grab from a shared atomic
+ * counter, so faster threads take more chunks and the load stays balanced.
+ *
+ * @see cvl_thread_pool_create
+ * @see cvl_parallel_for
+ */
+typedef struct {
+    CVLThread *threads;          ///< Worker threads.
+    size_t worker_count;         ///< Number of worker threads (calling thread is not counted).
+    CVLAtomicSize busy;          ///< 1 while a loop runs on pool, serializes submitted loops.
+    CVLMutex mutex;              ///< Guards job fields below.
+    CVLCondition job_ready;      ///< Signalled when new job is published or pool stops.
+    CVLCondition job_done;       ///< Signalled when the last worker finishes job.
+    CVLParallelFunction function;///< Job function.
+    void *context;               ///< Job context.
+    size_t count;                ///< Number of job items.
+    size_t grain;                ///< Number of items per chunk.
+    CVLAtomicSize next;          ///< First item of the next chunk to process.
+    size_t generation;           ///< Job counter, workers wait for it to change.
+    size_t pending;              ///< Number of workers still running current job.
+    bool stop;                   ///< Workers should exit.
+} CVLThreadPool;
+
+
+
+/** Execute chunks of current job until none left. */
+static inline void cvl_thread_pool_run_chunks(CVLThreadPool * const pool) {
+    for (;;) {
+        const size_t begin = cvl_atomic_fetch_add(&pool->next, pool->grain);
+        if (begin >= pool->count) {
+            break;
+        }
+        const size_t end = pool->count - begin > pool->grain ? begin + pool->grain : pool->count;
+        pool->function(pool->context, begin, end);
+    }
+}
+
+
+
+static inline void cvl_thread_pool_worker(void * const argument) {
+    CVLThreadPool * const pool = (CVLThreadPool *)argument;
+    size_t seen_generation = 0;
+    cvl_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen_generation) {
+            cvl_condition_wait(&pool->job_ready, &pool->mutex);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen_generation = pool->generation;
+        cvl_mutex_unlock(&pool->mutex);
+
+        cvl_thread_pool_run_chunks(pool);
+
+        cvl_mutex_lock(&pool->mutex);
+        pool->pending -= 1;
+        if (pool->pending == 0) {
+            cvl_condition_signal(&pool->job_done);
+        }
+    }
+    cvl_mutex_unlock(&pool->mutex);
+}
+
+
+
+/**
+ * Create thread pool.
+ *
+ * @param thread_count Total number of threads executing loops, including the calling thread.
+ * Pass 0 to use cvl_hardware_concurrency.
+ * @return Thread pool or NULL on failure.
+ * @see cvl_thread_pool_destroy
+ */
+static inline CVLThreadPool *cvl_thread_pool_create(const size_t thread_count) {
+    const size_t total = thread_count ? thread_count : cvl_hardware_concurrency();
+    CVLThreadPool * const pool = (CVLThreadPool *)calloc(1, sizeof(CVLThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->threads = total > 1 ? (CVLThread *)calloc(total - 1, sizeof(CVLThread)) : NULL;
+    if ((total > 1 && !pool->threads) ||
+        !cvl_mutex_init(&pool->mutex) ||
+        !cvl_condition_init(&pool->job_ready) ||
+        !cvl_condition_init(&pool->job_done))
+    {
+        free(pool->threads);
+        free(pool);
+        return NULL;
+    }
+    for (size_t i = 0; i + 1 < total; ++i) {
+        if (!cvl_thread_create(&pool->threads[i], cvl_thread_pool_worker, pool)) {
+            break;
+        }
+        pool->worker_count += 1;
+    }
+    return pool;
+}
+
+
+
+/** Stop worker threads and free thread pool. Passing NULL does nothing. */
+static inline void cvl_thread_pool_destroy(CVLThreadPool * const pool) {
+    if (!pool) {
+        return;
+    }
+    cvl_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    cvl_condition_broadcast(&pool->job_ready);
+    cvl_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->worker_count; ++i) {
+        cvl_thread_join(&pool->threads[i]);
+    }
+    cvl_condition_destroy(&pool->job_done);
+    cvl_condition_destroy(&pool->job_ready);
+    cvl_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    free(pool);
+}
+
+
+
+/** Return total number of threads executing loops of pool, including the calling thread. */
+static inline size_t cvl_thread_pool_thread_count(const CVLThreadPool * const pool) {
+    return pool ? pool->worker_count + 1 : 1;
+}
+
+
+
+/**
+ * Execute @a function over items [0, count) split into chunks of @a grain items.
+ *
+ * Calling thread takes part in execution and returns when all chunks are done.
+ * Loop runs on the calling thread only if @a pool is NULL or if pool is busy with another loop
+ * (e.g. when called from inside a task), so nested loops are safe. Busy flag is not recursive, so
+ * this holds for tasks run by the submitting thread as well.
+ */
+static inline void cvl_parallel_for(CVLThreadPool * const pool,
+                                    const size_t count,
+                                    const size_t grain,
+                                    const CVLParallelFunction function,
+                                    void * const context)
+{
+    const size_t chunk = grain ? grain : 1;
+    if (count == 0) {
+        return;
+    }
+    size_t idle = 0;
+    if (!pool || pool->worker_count == 0 || count <= chunk ||
+        !cvl_atomic_compare_exchange(&pool->busy, &idle, 1))
+    {
+        for (size_t begin = 0; begin < count; begin += chunk) {
+            function(context, begin, count - begin > chunk ? begin + chunk : count);
+        }
+        return;
+    }
+
+    cvl_mutex_lock(&pool->mutex);
+    pool->function = function;
+    pool->context = context;
+    pool->count = count;
+    pool->grain = chunk;
+    cvl_atomic_store(&pool->next, 0);
+    pool->pending = pool->worker_count;
+    pool->generation += 1;
+    cvl_condition_broadcast(&pool->job_ready);
+    cvl_mutex_unlock(&pool->mutex);
+
+    cvl_thread_pool_run_chunks(pool);
+
+    cvl_mutex_lock(&pool->mutex);
+    while (pool->pending > 0) {
+        cvl_condition_wait(&pool->job_done, &pool->mutex);
+    }
+    cvl_mutex_unlock(&pool->mutex);
+    cvl_atomic_store(&pool->busy, 0);
+}
+
+
+
+/**
+ * Return number of rows of one band for image of @a height rows of @a row_bytes bytes.
+ *
+ * Bands are about CVL_PARALLEL_BAND_BYTES large, but at least CVL_PARALLEL_BANDS_PER_THREAD bands
+ * are produced for each thread of @a pool.
+ */
+static inline size_t cvl_image_parallel_band_rows(const CVLThreadPool * const pool,
+                                                  const size_t height,
+                                                  const size_t row_bytes)
+{
+    size_t band_rows = row_bytes ? CVL_PARALLEL_BAND_BYTES / row_bytes : height;
+    const size_t bands = cvl_thread_pool_thread_count(pool) * CVL_PARALLEL_BANDS_PER_THREAD;
+    const size_t balanced_rows = (height + bands - 1) / bands;
+    if (band_rows > balanced_rows) {
+        band_rows = balanced_rows;
+    }
+    return band_rows ? band_rows : 1;
+}
+
+
+
+/**
+ * Execute @a function over image rows [0, height) split into cache sized horizontal bands.
+ *
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ * @param height Number of image rows.
+ * @param row_bytes Number of bytes touched per row, used to choose band size.
+ * @param function Band function receiving [begin, end) row range.
+ * @param context User context passed to @a function.
+ */
+static inline void cvl_image_parallel_for_rows(CVLThreadPool * const pool,
+                                               const size_t height,
+                                               const size_t row_bytes,
+                                               const CVLParallelFunction function,
+                                               void * const context)
+{
+    if (height * row_bytes < CVL_PARALLEL_MIN_IMAGE_BYTES) {
+        function(context, 0, height);
+        return;
+    }
+    cvl_parallel_for(pool, height, cvl_image_parallel_band_rows(pool, height, row_bytes), function, context);
+}
+
+
+
+/** Context of cvl_image_copy_parallel band tasks. */
+typedef struct {
+    const CVLImageBuffer *source_image;
+    const CVLImageBuffer *dest_image;
+    CVLImageBytesCount row_bytes;
+    bool streaming;
+} CVLImageCopyBands;
+
+
+
+static inline void cvl_image_copy_band(void * const context, const size_t begin, const size_t end) {
+    const CVLImageCopyBands * const bands = (const CVLImageCopyBands *)context;
+    cvl_simd_copy_rows_ex(CVL_GET_LINE(CVLPixel_8, bands->dest_image, begin), bands->dest_image->rowBytes,
+                          CVL_GET_LINE(const CVLPixel_8, bands->source_image, begin), bands->source_image->rowBytes,
+                          bands->row_bytes, end - begin, bands->streaming);
+}
+
+
+
+/**
+ * Copy image data using thread pool.
+ *
+ * Parallel version of cvl_image_copy, rows are split into bands processed by pool threads.
+ * @param pool Thread pool or NULL to copy on the calling thread.
+ */
+static inline void cvl_image_copy_parallel(CVLThreadPool * const pool,
+                                           const CVLImageBuffer * const source_image,
+                                           CVLImageBuffer * const dest_image,
+                                           const CVLImageBytesCount pixel_size)
+{
+    assert(cvl_image_is_good(source_image, pixel_size));
+    assert(cvl_image_is_good(dest_image,   pixel_size));
+    assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
+
+    CVLImageCopyBands bands;
+    bands.source_image = source_image;
+    bands.dest_image = dest_image;
+    bands.row_bytes = source_image->width * pixel_size;
+    bands.streaming = bands.row_bytes * source_image->height >= CVL_SIMD_STREAMING_THRESHOLD;
+    cvl_image_parallel_for_rows(pool, source_image->height, bands.row_bytes, cvl_image_copy_band, &bands);
+}
+
+
+
+/** Context of cvl_image_clear_parallel band tasks. */
+typedef struct {
+    const CVLImageBuffer *image;
+    CVLImageBytesCount row_bytes;
+    bool streaming;
+} CVLImageClearBands;
+
+
+
+static inline void cvl_image_clear_band(void * const context, const size_t begin, const size_t end) {
+    const CVLImageClearBands * const bands = (const CVLImageClearBands *)context;
+    cvl_simd_clear_rows_ex(CVL_GET_LINE(CVLPixel_8, bands->image, begin), bands->image->rowBytes,
+                           bands->row_bytes, end - begin, bands->streaming);
+}
+
+
+
+/**
+ * Fill image with zeroes using thread pool.
+ *
+ * Parallel version of cvl_image_clear, rows are split into bands processed by pool threads.
+ * @param pool Thread pool or NULL to clear on the calling thread.
+ */
+static inline void cvl_image_clear_parallel(CVLThreadPool * const pool,
+                                            const CVLImageBuffer * const image,
+                                            const CVLImageBytesCount pixel_size)
+{
+    CVLImageClearBands bands;
+    bands.image = image;
+    bands.row_bytes = image->width * pixel_size;
+    bands.streaming = bands.row_bytes * image->height >= CVL_SIMD_STREAMING_THRESHOLD;
+    cvl_image_parallel_for_rows(pool, image->height, bands.row_bytes, cvl_image_clear_band, &bands);
+}
+
+
+
+/** Create new image and copy source image data using thread pool. */
+static inline CVLImageBuffer cvl_image_create_copy_parallel(CVLThreadPool * const pool,
+                                                            const CVLImageBuffer * const source_image,
+                                                            const CVLImageBytesCount pixel_size)
+{
+    assert(cvl_image_is_good(source_image, pixel_size));
+    CVLImageBuffer dest_image = cvl_image_create(source_image->height, source_image->width, pixel_size);
+    cvl_image_copy_parallel(pool, source_image, &dest_image, pixel_size);
+    return dest_image;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_PARALLEL_H
@@ -0,0 +1,510 @@
+#ifndef CVL_IMAGE_PLANAR_H
+#define CVL_IMAGE_PLANAR_H
+
+
+#include "cvl_image_convert.h"
+#include "cvl_image_parallel.h"
+
+/*
+ * Planar (multi-plane) images.
+ *
+ * CVLPlanarImage groups up to CVL_PLANAR_MAX_PLANES planes sharing one geometry. Generic images
+ * hold one full size plane per channel (planar counterpart of Pixel_8888 and Pixel_FFFF, NCHW
+ * layout of one image), YUV formats hold camera frames as they come:
+ * - CVL_PLANAR_YUV420 (I420): Y plane and U, V planes of half width and height, all Pixel_8;
+ * - CVL_PLANAR_NV12: Y plane and half size plane of interleaved U, V pairs (2 bytes per pixel).
+ * Chroma planes of odd sized images are rounded up.
+ *
+ * Planes are ordinary CVLImageBuffer views, so every single plane routine of the library works on
+ * them. Owned planes are either allocated separately or carved from one allocation, each plane
+ * and row aligned to CVL_IMAGE_DEFAULT_ALIGNMENT.
+ */
+
+/** Maximal number of planes. */
+#define CVL_PLANAR_MAX_PLANES 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Layout of planes. */
+typedef enum {
+    CVL_PLANAR_GENERIC = 0,  ///< Full size planes of the same pixel size.
+    CVL_PLANAR_YUV420,       ///< I420: Y, U, V planes, chroma planes subsampled 2x2.
+    CVL_PLANAR_NV12          ///< Y plane and interleaved UV plane subsampled 2x2.
+} CVLPlanarFormat;
+
+/** Image of several planes with shared geometry. */
+typedef struct {
+    CVLPlanarFormat format;
+    CVLImagePixelCount height;      ///< Height of full size planes.
+    CVLImagePixelCount width;       ///< Width of full size planes.
+    int plane_count;
+    CVLImageBytesCount pixel_sizes[CVL_PLANAR_MAX_PLANES];
+    CVLImageBuffer planes[CVL_PLANAR_MAX_PLANES];
+    void *data;                     ///< Single allocation backing all planes or NULL.
+    bool owns_planes;               ///< Planes are freed by cvl_planar_image_release.
+} CVLPlanarImage;
+
+
+
+/** Return true if plane of format is subsampled 2x2. */
+static inline bool cvl_planar_is_subsampled(const CVLPlanarFormat format, const int plane) {
+    return format != CVL_PLANAR_GENERIC && plane > 0;
+}
+
+
+
+/** Return height of plane for image of @a height rows. */
+static inline CVLImagePixelCount cvl_planar_plane_height(const CVLPlanarFormat format,
+                                                         const int plane,
+                                                         const CVLImagePixelCount height)
+{
+    return cvl_planar_is_subsampled(format, plane) ? (height + 1) / 2 : height;
+}
+
+
+
+/** Return width of plane for image of @a width columns. */
+static inline CVLImagePixelCount cvl_planar_plane_width(const CVLPlanarFormat format,
+                                                        const int plane,
+                                                        const CVLImagePixelCount width)
+{
+    return cvl_planar_is_subsampled(format, plane) ? (width + 1) / 2 : width;
+}
+
+
+
+/** Return empty planar image. */
+static inline CVLPlanarImage cvl_planar_image_make_empty(void) {
+    CVLPlanarImage image;
+    memset(&image, 0, sizeof(image));
+    return image;
+}
+
+
+
+/** Set format, geometry and pixel sizes, planes are left empty. */
+static inline void cvl_planar_image_init_layout(CVLPlanarImage * const image,
+                                                const CVLPlanarFormat format,
+                                                const CVLImagePixelCount height,
+                                                const CVLImagePixelCount width,
+                                                const int plane_count,
+                                                const CVLImageBytesCount pixel_size)
+{
+    *image = cvl_planar_image_make_empty();
+    image->format = format;
+    image->height = height;
+    image->width = width;
+    switch (format) {
+        case CVL_PLANAR_YUV420:
+            image->plane_count = 3;
+            image->pixel_sizes[0] = image->pixel_sizes[1] = image->pixel_sizes[2] = CVLPixel_8_sz;
+            break;
+        case CVL_PLANAR_NV12:
+            image->plane_count = 2;
+            image->pixel_sizes[0] = CVLPixel_8_sz;
+            image->pixel_sizes[1] = 2 * CVLPixel_8_sz;
+            break;
+        default:
+            assert(plane_count > 0 && plane_count <= CVL_PLANAR_MAX_PLANES);
+            image->plane_count = plane_count;
+            for (int p = 0; p < plane_count; ++p) {
+                image->pixel_sizes[p] = pixel_size;
+            }
+            break;
+    }
+}
+
+
+
+/** Release planes owned by image. Views are only reset. */
+static inline void cvl_planar_image_release(CVLPlanarImage * const image) {
+    if (image->owns_planes) {
+        if (image->data) {
+            cvl_image_data_free(image->data);
+        }
+        else {
+            for (int p = 0; p < image->plane_count; ++p) {
+                cvl_image_release_aligned(&image->planes[p]);
+            }
+        }
+    }
+    *image = cvl_planar_image_make_empty();
+}
+
+
+
+/** Allocate planes of image with initialized layout, image is released on failure. */
+static inline void cvl_planar_image_allocate(CVLPlanarImage * const image, const bool single_allocation) {
+    image->owns_planes = true;
+    if (!single_allocation) {
+        for (int p = 0; p < image->plane_count; ++p) {
+            image->planes[p] = cvl_image_create_aligned(cvl_planar_plane_height(image->format, p, image->height),
+                                                        cvl_planar_plane_width(image->format, p, image->width),
+                                                        image->pixel_sizes[p], CVL_IMAGE_DEFAULT_ALIGNMENT,
+                                                        CVL_IMAGE_ROW_PADDING_ALIGN);
+            if (!image->planes[p].data) {
+                cvl_planar_image_release(image);
+                return;
+            }
+        }
+        return;
+    }
+
+    size_t offsets[CVL_PLANAR_MAX_PLANES];
+    CVLImageBytesCount row_bytes[CVL_PLANAR_MAX_PLANES];
+    size_t size = 0;
+    for (int p = 0; p < image->plane_count; ++p) {
+        row_bytes[p] = cvl_image_aligned_row_bytes(cvl_planar_plane_width(image->format, p, image->width),
+                                                   image->pixel_sizes[p], CVL_IMAGE_DEFAULT_ALIGNMENT,
+                                                   CVL_IMAGE_ROW_PADDING_ALIGN);
+        offsets[p] = size;
+        size += row_bytes[p] * cvl_planar_plane_height(image->format, p, image->height);
+        size = (size + CVL_IMAGE_DEFAULT_ALIGNMENT - 1) & ~(size_t)(CVL_IMAGE_DEFAULT_ALIGNMENT - 1);
+    }
+    image->data = cvl_image_data_alloc(size, CVL_IMAGE_DEFAULT_ALIGNMENT);
+    if (!image->data) {
+        cvl_planar_image_release(image);
+        return;
+    }
+    for (int p = 0; p < image->plane_count; ++p) {
+        CVLImageBuffer * const plane = &image->planes[p];
+        plane->data = (CVLPixel_8 *)image->data + offsets[p];
+        plane->height = cvl_planar_plane_height(image->format, p, image->height);
+        plane->width = cvl_planar_plane_width(image->format, p, image->width);
+        plane->rowBytes = row_bytes[p];
+    }
+}
+
+
+
+/**
+ * Create generic planar image of @a plane_count planes.
+ * This function does memory allocation for image data.
+ *
+ * @param single_allocation Back all planes by one allocation.
+ * @return Image or empty image (plane_count 0) on allocation failure.
+ * @see cvl_planar_image_release
+ */
+static inline CVLPlanarImage cvl_planar_image_create(const CVLImagePixelCount height,
+                                                     const CVLImagePixelCount width,
+                                                     const int plane_count,
+                                                     const CVLImageBytesCount pixel_size,
+                                                     const bool single_allocation)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    CVLPlanarImage image;
+    cvl_planar_image_init_layout(&image, CVL_PLANAR_GENERIC, height, width, plane_count, pixel_size);
+    cvl_planar_image_allocate(&image, single_allocation);
+    return image;
+}
+
+
+
+/**
+ * Create YUV image of CVL_PLANAR_YUV420 or CVL_PLANAR_NV12 format.
+ * This function does memory allocation for image data.
+ *
+ * @return Image or empty image (plane_count 0) on allocation failure.
+ * @see cvl_planar_image_release
+ */
+static inline CVLPlanarImage cvl_planar_image_create_yuv(const CVLPlanarFormat format,
+                                                         const CVLImagePixelCount height,
+                                                         const CVLImagePixelCount width,
+                                                         const bool single_allocation)
+{
+    assert(height > 0 && width > 0 && format != CVL_PLANAR_GENERIC);
+    CVLPlanarImage image;
+    cvl_planar_image_init_layout(&image, format, height, width, 0, 0);
+    cvl_planar_image_allocate(&image, single_allocation);
+    return image;
+}
+
+
+
+/** Return generic planar image viewing existing planes, planes are not copied nor owned. */
+static inline CVLPlanarImage cvl_planar_image_make(const CVLImageBuffer * const planes,
+                                                   const int plane_count,
+                                                   const CVLImageBytesCount pixel_size)
+{
+    CVLPlanarImage image;
+    cvl_planar_image_init_layout(&image, CVL_PLANAR_GENERIC, planes[0].height, planes[0].width, plane_count, pixel_size);
+    for (int p = 0; p < plane_count; ++p) {
+        assert(planes[p].height == image.height && planes[p].width == image.width);
+        image.planes[p] = planes[p];
+    }
+    return image;
+}
+
+
+
+/**
+ * Return YUV image viewing existing planes (Y, U, V or Y, UV), planes are not copied nor owned.
+ * Chroma planes must have size given by cvl_planar_plane_height and cvl_planar_plane_width.
+ */
+static inline CVLPlanarImage cvl_planar_image_make_yuv(const CVLPlanarFormat format,
+                                                       const CVLImagePixelCount height,
+                                                       const CVLImagePixelCount width,
+                                                       const CVLImageBuffer * const planes)
+{
+    assert(format != CVL_PLANAR_GENERIC);
+    CVLPlanarImage image;
+    cvl_planar_image_init_layout(&image, format, height, width, 0, 0);
+    for (int p = 0; p < image.plane_count; ++p) {
+        assert(planes[p].height == cvl_planar_plane_height(format, p, height) &&
+               planes[p].width == cvl_planar_plane_width(format, p, width));
+        image.planes[p] = planes[p];
+    }
+    return image;
+}
+
+
+
+/**
+ * Return YUV image viewing continuous camera frame buffer, data is not copied nor owned.
+ *
+ * Frame starts with @a height luma rows of @a row_bytes bytes. NV12 chroma rows of @a row_bytes
+ * bytes follow, widened to 2 * ((width + 1) / 2) bytes for odd width frames without row padding.
+ * YUV420 has U rows followed by V rows, both of (@a row_bytes + 1) / 2 bytes.
+ */
+static inline CVLPlanarImage cvl_planar_image_make_yuv_frame(const CVLPlanarFormat format,
+                                                             void * const data,
+                                                             const CVLImagePixelCount height,
+                                                             const CVLImagePixelCount width,
+                                                             const CVLImageBytesCount row_bytes)
+{
+    assert(format != CVL_PLANAR_GENERIC && row_bytes >= width);
+    CVLPlanarImage image;
+    cvl_planar_image_init_layout(&image, format, height, width, 0, 0);
+    const CVLImageBytesCount uv_row_bytes = 2 * ((width + 1) / 2);
+    const CVLImageBytesCount chroma_row_bytes = format == CVL_PLANAR_YUV420 ? (row_bytes + 1) / 2 :
+                                                row_bytes > uv_row_bytes ? row_bytes : uv_row_bytes;
+    CVLPixel_8 *plane_data = (CVLPixel_8 *)data;
+    for (int p = 0; p < image.plane_count; ++p) {
+        CVLImageBuffer * const plane = &image.planes[p];
+        plane->data = plane_data;
+        plane->height = cvl_planar_plane_height(format, p, height);
+        plane->width = cvl_planar_plane_width(format, p, width);
+        plane->rowBytes = p > 0 ? chroma_row_bytes : row_bytes;
+        assert(plane->rowBytes >= plane->width * image.pixel_sizes[p]);
+        plane_data += plane->rowBytes * plane->height;
+    }
+    return image;
+}
+
+
+
+/** Return true if image has all planes of proper geometry. */
+static inline bool cvl_planar_image_is_good(const CVLPlanarImage * const image) {
+    if (image->plane_count <= 0 || image->plane_count > CVL_PLANAR_MAX_PLANES) {
+        return false;
+    }
+    for (int p = 0; p < image->plane_count; ++p) {
+        const CVLImageBuffer * const plane = &image->planes[p];
+        if (!cvl_image_is_good(plane, image->pixel_sizes[p]) ||
+            plane->height != cvl_planar_plane_height(image->format, p, image->height) ||
+            plane->width != cvl_planar_plane_width(image->format, p, image->width))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+/** Return true if images have the same format, geometry and pixel sizes. */
+static inline bool cvl_planar_image_same_layout(const CVLPlanarImage * const a, const CVLPlanarImage * const b) {
+    if (a->format != b->format || a->height != b->height || a->width != b->width || a->plane_count != b->plane_count) {
+        return false;
+    }
+    for (int p = 0; p < a->plane_count; ++p) {
+        if (a->pixel_sizes[p] != b->pixel_sizes[p]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+/**
+ * Return view of all planes at @a roi given in full size plane coordinates.
+ * ROI of YUV image must start at even column and row, chroma ROI covers all subsampled pixels.
+ */
+static inline CVLPlanarImage cvl_planar_image_subimage(const CVLPlanarImage * const image, const CVLRect roi) {
+    assert(cvl_planar_image_is_good(image));
+    assert(image->format == CVL_PLANAR_GENERIC || (roi.x % 2 == 0 && roi.y % 2 == 0));
+    CVLPlanarImage subimage = *image;
+    subimage.height = (CVLImagePixelCount)roi.height;
+    subimage.width = (CVLImagePixelCount)roi.width;
+    subimage.data = NULL;
+    subimage.owns_planes = false;
+    for (int p = 0; p < image->plane_count; ++p) {
+        CVLRect plane_roi = roi;
+        if (cvl_planar_is_subsampled(image->format, p)) {
+            plane_roi.x = roi.x / 2;
+            plane_roi.y = roi.y / 2;
+            plane_roi.width = (roi.x + roi.width + 1) / 2 - plane_roi.x;
+            plane_roi.height = (roi.y + roi.height + 1) / 2 - plane_roi.y;
+        }
+        subimage.planes[p] = cvl_image_subimage(&image->planes[p], plane_roi, image->pixel_sizes[p]);
+    }
+    return subimage;
+}
+
+
+
+/**
+ * Copy all planes.
+ * @param pool Thread pool or NULL to copy on the calling thread.
+ */
+static inline void cvl_planar_image_copy(CVLThreadPool * const pool,
+                                         const CVLPlanarImage * const source_image,
+                                         CVLPlanarImage * const dest_image)
+{
+    assert(cvl_planar_image_is_good(source_image) && cvl_planar_image_is_good(dest_image));
+    assert(cvl_planar_image_same_layout(source_image, dest_image));
+    for (int p = 0; p < source_image->plane_count; ++p) {
+        cvl_image_copy_parallel(pool, &source_image->planes[p], &dest_image->planes[p], source_image->pixel_sizes[p]);
+    }
+}
+
+
+
+/**
+ * Fill all planes with zeroes.
+ * @param pool Thread pool or NULL to clear on the calling thread.
+ */
+static inline void cvl_planar_image_clear(CVLThreadPool * const pool, const CVLPlanarImage * const image) {
+    assert(cvl_planar_image_is_good(image));
+    for (int p = 0; p < image->plane_count; ++p) {
+        cvl_image_clear_parallel(pool, &image->planes[p], image->pixel_sizes[p]);
+    }
+}
+
+
+
+/**
+ * Create new planar image of source layout and copy source planes.
+ * @return Copy or empty image on allocation failure.
+ */
+static inline CVLPlanarImage cvl_planar_image_create_copy(CVLThreadPool * const pool,
+                                                          const CVLPlanarImage * const source_image,
+                                                          const bool single_allocation)
+{
+    assert(cvl_planar_image_is_good(source_image));
+    CVLPlanarImage image;
+    cvl_planar_image_init_layout(&image, source_image->format, source_image->height, source_image->width,
+                                 source_image->plane_count, source_image->pixel_sizes[0]);
+    cvl_planar_image_allocate(&image, single_allocation);
+    if (image.plane_count) {
+        cvl_planar_image_copy(pool, source_image, &image);
+    }
+    return image;
+}
+
+
+
+/** Context of interleave and deinterleave band tasks. */
+typedef struct {
+    const CVLImageBuffer *interleaved;
+    const CVLPlanarImage *planar;
+    CVLPixelType type;
+    bool split;                     ///< Deinterleave, otherwise interleave.
+} CVLPlanarInterleaveBands;
+
+
+
+static inline void cvl_planar_interleave_band(void * const context, const size_t begin, const size_t end) {
+    const CVLPlanarInterleaveBands * const bands = (const CVLPlanarInterleaveBands *)context;
+    const CVLImageBuffer * const interleaved = bands->interleaved;
+    const CVLImageBuffer * const planes = bands->planar->planes;
+    for (size_t y = begin; y < end; ++y) {
+        if (bands->type == CVL_PIXEL_TYPE_8888 && bands->split) {
+            cvl_convert_row_split_8888(CVL_GET_LINE(const CVLPixel_8, interleaved, y),
+                                       CVL_GET_LINE(CVLPixel_8, &planes[0], y), CVL_GET_LINE(CVLPixel_8, &planes[1], y),
+                                       CVL_GET_LINE(CVLPixel_8, &planes[2], y), CVL_GET_LINE(CVLPixel_8, &planes[3], y),
+                                       interleaved->width);
+        }
+        else if (bands->type == CVL_PIXEL_TYPE_8888) {
+            cvl_convert_row_merge_8888(CVL_GET_LINE(const CVLPixel_8, &planes[0], y), CVL_GET_LINE(const CVLPixel_8, &planes[1], y),
+                                       CVL_GET_LINE(const CVLPixel_8, &planes[2], y), CVL_GET_LINE(const CVLPixel_8, &planes[3], y),
+                                       CVL_GET_LINE(CVLPixel_8, interleaved, y),
+                                       interleaved->width);
+        }
+        else if (bands->split) {
+            cvl_convert_row_split_FFFF(CVL_GET_LINE(const CVLPixel_F, interleaved, y),
+                                       CVL_GET_LINE(CVLPixel_F, &planes[0], y), CVL_GET_LINE(CVLPixel_F, &planes[1], y),
+                                       CVL_GET_LINE(CVLPixel_F, &planes[2], y), CVL_GET_LINE(CVLPixel_F, &planes[3], y),
+                                       interleaved->width);
+        }
+        else {
+            cvl_convert_row_merge_FFFF(CVL_GET_LINE(const CVLPixel_F, &planes[0], y), CVL_GET_LINE(const CVLPixel_F, &planes[1], y),
+                                       CVL_GET_LINE(const CVLPixel_F, &planes[2], y), CVL_GET_LINE(const CVLPixel_F, &planes[3], y),
+                                       CVL_GET_LINE(CVLPixel_F, interleaved, y),
+                                       interleaved->width);
+        }
+    }
+}
+
+
+
+/** Run interleave bands after checking that images match. */
+static inline void cvl_planar_interleave(CVLThreadPool * const pool,
+                                         const CVLImageBuffer * const interleaved,
+                                         const CVLPlanarImage * const planar,
+                                         const CVLPixelType type,
+                                         const bool split)
+{
+    assert(type == CVL_PIXEL_TYPE_8888 || type == CVL_PIXEL_TYPE_FFFF);
+    assert(cvl_image_is_good(interleaved, cvl_pixel_type_size(type)));
+    assert(cvl_planar_image_is_good(planar) && planar->format == CVL_PLANAR_GENERIC && planar->plane_count == 4);
+    assert(planar->pixel_sizes[0] * 4 == cvl_pixel_type_size(type));
+    assert(planar->height == interleaved->height && planar->width == interleaved->width);
+    CVLPlanarInterleaveBands bands;
+    bands.interleaved = interleaved;
+    bands.planar = planar;
+    bands.type = type;
+    bands.split = split;
+    cvl_image_parallel_for_rows(pool, interleaved->height, 2 * interleaved->width * cvl_pixel_type_size(type),
+                                cvl_planar_interleave_band, &bands);
+}
+
+
+
+/**
+ * Deinterleave Pixel_8888 or Pixel_FFFF image into 4 planes of Pixel_8 or Pixel_F.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_planar_image_from_interleaved(CVLThreadPool * const pool,
+                                                     const CVLImageBuffer * const source_image,
+                                                     const CVLPixelType type,
+                                                     const CVLPlanarImage * const dest_image)
+{
+    cvl_planar_interleave(pool, source_image, dest_image, type, true);
+}
+
+
+
+/**
+ * Interleave 4 planes of Pixel_8 or Pixel_F into Pixel_8888 or Pixel_FFFF image.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_planar_image_to_interleaved(CVLThreadPool * const pool,
+                                                   const CVLPlanarImage * const source_image,
+                                                   const CVLPixelType type,
+                                                   const CVLImageBuffer * const dest_image)
+{
+    cvl_planar_interleave(pool, dest_image, source_image, type, false);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_PLANAR_H
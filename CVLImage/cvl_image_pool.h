@@ -0,0 +1,276 @@
+#ifndef CVL_IMAGE_POOL_H
+#define CVL_IMAGE_POOL_H
+
+
+#include "cvl_image_utils.h"
+#include "cvl_threading.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Size of block header placed before image data of pooled images.
+ * Keeps image data aligned to CVL_IMAGE_DEFAULT_ALIGNMENT.
+ */
+#define CVL_IMAGE_POOL_HEADER_SIZE CVL_IMAGE_DEFAULT_ALIGNMENT
+
+/** Magic value stored in pooled block header, used to catch foreign images. */
+#define CVL_IMAGE_POOL_BLOCK_MAGIC 0x43564C50u
+
+/** Default maximal number of cached images per size class. */
+#define CVL_IMAGE_POOL_DEFAULT_MAX_CACHED 8
+
+
+
+struct CVLImagePoolClass;
+
+/** Header of pooled memory block, located right before image data. */
+typedef struct CVLImagePoolBlock {
+    struct CVLImagePoolBlock *next;  ///< Next cached block of the same size class.
+    struct CVLImagePoolClass *owner; ///< Size class of block.
+    unsigned int magic;              ///< CVL_IMAGE_POOL_BLOCK_MAGIC.
+} CVLImagePoolBlock;
+
+/** Size class of pooled images, cached blocks of the same geometry. */
+typedef struct CVLImagePoolClass {
+    struct CVLImagePoolClass *next;  ///< Next size class of pool.
+    CVLImagePixelCount height;       ///< Height of images.
+    CVLImagePixelCount width;        ///< Width of images.
+    CVLImageBytesCount pixel_size;   ///< Pixel size of images.
+    CVLImagePoolBlock *cached;       ///< List of released blocks ready for reuse.
+    size_t cached_count;             ///< Number of blocks in cached list.
+} CVLImagePoolClass;
+
+/** Pool usage counters. */
+typedef struct {
+    size_t hits;          ///< Number of images created from cached blocks.
+    size_t misses;        ///< Number of images which required system allocation.
+    size_t releases;      ///< Number of images returned to pool.
+    size_t cached_images; ///< Number of images currently cached.
+    size_t cached_bytes;  ///< Memory currently held by cached images.
+} CVLImagePoolStats;
+
+/**
+ * Thread-safe image pool which recycles released images of matching (height, width, pixel_size).
+ *
+ * Images created by pool are continuous, their data is aligned to CVL_IMAGE_DEFAULT_ALIGNMENT.
+ * Pooled images must be released with cvl_image_pool_release (or through allocator returned by
+ * cvl_image_pool_allocator), never with cvl_image_release.
+ */
+typedef struct {
+    CVLMutex mutex;             ///< Guards all pool fields.
+    CVLImagePoolClass *classes; ///< List of known size classes.
+    size_t max_cached;          ///< Maximal number of cached blocks per size class.
+    CVLImagePoolStats stats;    ///< Usage counters.
+} CVLImagePool;
+
+
+
+/**
+ * Initialize image pool.
+ *
+ * @param max_cached Maximal number of released images kept per size class, images released above
+ * this limit are returned to the system. Pass 0 to use CVL_IMAGE_POOL_DEFAULT_MAX_CACHED.
+ * @return false if pool could not be initialized.
+ * @see cvl_image_pool_destroy
+ */
+static inline bool cvl_image_pool_init(CVLImagePool * const pool, const size_t max_cached) {
+    memset(pool, 0, sizeof(*pool));
+    pool->max_cached = max_cached ? max_cached : CVL_IMAGE_POOL_DEFAULT_MAX_CACHED;
+    return cvl_mutex_init(&pool->mutex);
+}
+
+
+
+/** Return memory of all cached images to the system. Size classes are kept. */
+static inline void cvl_image_pool_trim(CVLImagePool * const pool) {
+    cvl_mutex_lock(&pool->mutex);
+    for (CVLImagePoolClass *cls = pool->classes; cls; cls = cls->next) {
+        while (cls->cached) {
+            CVLImagePoolBlock * const block = cls->cached;
+            cls->cached = block->next;
+            cvl_image_data_free(block);
+        }
+        cls->cached_count = 0;
+    }
+    pool->stats.cached_images = 0;
+    pool->stats.cached_bytes = 0;
+    cvl_mutex_unlock(&pool->mutex);
+}
+
+
+
+/**
+ * Destroy image pool and free all cached images.
+ *
+ * All images created by pool must be released before this call.
+ */
+static inline void cvl_image_pool_destroy(CVLImagePool * const pool) {
+    cvl_image_pool_trim(pool);
+    while (pool->classes) {
+        CVLImagePoolClass * const cls = pool->classes;
+        pool->classes = cls->next;
+        free(cls);
+    }
+    cvl_mutex_destroy(&pool->mutex);
+}
+
+
+
+/** Return pooled block header of image created by pool. */
+static inline CVLImagePoolBlock *cvl_image_pool_block(const CVLImageBuffer * const image) {
+    return (CVLImagePoolBlock *)((CVLPixel_8 *)image->data - CVL_IMAGE_POOL_HEADER_SIZE);
+}
+
+
+
+/**
+ * Create image using pool.
+ *
+ * Cached image of the same geometry is returned when available, otherwise new image is allocated.
+ * Image content is undefined.
+ * @return Empty image on allocation failure.
+ * @see cvl_image_pool_release
+ */
+static inline CVLImageBuffer cvl_image_pool_create(CVLImagePool * const pool,
+                                                   const CVLImagePixelCount height,
+                                                   const CVLImagePixelCount width,
+                                                   const CVLImageBytesCount pixel_size)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    CVLImageBuffer image = cvl_image_make_empty();
+    const CVLImageBytesCount data_size = height * width * pixel_size;
+
+    cvl_mutex_lock(&pool->mutex);
+    CVLImagePoolClass *cls = pool->classes;
+    while (cls && !(cls->height == height && cls->width == width && cls->pixel_size == pixel_size)) {
+        cls = cls->next;
+    }
+    if (!cls) {
+        cls = (CVLImagePoolClass *)calloc(1, sizeof(CVLImagePoolClass));
+        if (!cls) {
+            cvl_mutex_unlock(&pool->mutex);
+            return image;
+        }
+        cls->height = height;
+        cls->width = width;
+        cls->pixel_size = pixel_size;
+        cls->next = pool->classes;
+        pool->classes = cls;
+    }
+
+    CVLImagePoolBlock *block = cls->cached;
+    if (block) {
+        cls->cached = block->next;
+        cls->cached_count -= 1;
+        pool->stats.hits += 1;
+        pool->stats.cached_images -= 1;
+        pool->stats.cached_bytes -= data_size;
+    }
+    else {
+        pool->stats.misses += 1;
+    }
+    cvl_mutex_unlock(&pool->mutex);
+
+    if (!block) {
+        block = (CVLImagePoolBlock *)cvl_image_data_alloc(CVL_IMAGE_POOL_HEADER_SIZE + data_size,
+                                                          CVL_IMAGE_DEFAULT_ALIGNMENT);
+        if (!block) {
+            return image;
+        }
+        block->owner = cls;
+        block->magic = CVL_IMAGE_POOL_BLOCK_MAGIC;
+    }
+    block->next = NULL;
+
+    image.data = (CVLPixel_8 *)block + CVL_IMAGE_POOL_HEADER_SIZE;
+    image.height = height;
+    image.width = width;
+    image.rowBytes = width * pixel_size;
+    return image;
+}
+
+
+
+/**
+ * Return image created by cvl_image_pool_create to pool.
+ *
+ * Image fields are reset to empty image. Releasing empty image does nothing.
+ */
+static inline void cvl_image_pool_release(CVLImagePool * const pool, CVLImageBuffer * const image) {
+    if (!image->data) {
+        return;
+    }
+    CVLImagePoolBlock * const block = cvl_image_pool_block(image);
+    assert(block->magic == CVL_IMAGE_POOL_BLOCK_MAGIC);
+    CVLImagePoolClass * const cls = block->owner;
+    assert(cls->height == image->height && cls->width == image->width);
+
+    cvl_mutex_lock(&pool->mutex);
+    pool->stats.releases += 1;
+    const bool keep = cls->cached_count < pool->max_cached;
+    if (keep) {
+        block->next = cls->cached;
+        cls->cached = block;
+        cls->cached_count += 1;
+        pool->stats.cached_images += 1;
+        pool->stats.cached_bytes += cls->height * cls->width * cls->pixel_size;
+    }
+    cvl_mutex_unlock(&pool->mutex);
+
+    if (!keep) {
+        cvl_image_data_free(block);
+    }
+    *image = cvl_image_make_empty();
+}
+
+
+
+/** Return snapshot of pool usage counters. */
+static inline CVLImagePoolStats cvl_image_pool_get_stats(CVLImagePool * const pool) {
+    cvl_mutex_lock(&pool->mutex);
+    const CVLImagePoolStats stats = pool->stats;
+    cvl_mutex_unlock(&pool->mutex);
+    return stats;
+}
+
+
+
+static inline CVLImageBuffer cvl_image_pool_allocator_create(void * const context,
+                                                             const CVLImagePixelCount height,
+                                                             const CVLImagePixelCount width,
+                                                             const CVLImageBytesCount pixel_size)
+{
+    return cvl_image_pool_create((CVLImagePool *)context, height, width, pixel_size);
+}
+
+
+
+static inline void cvl_image_pool_allocator_release(void * const context, CVLImageBuffer * const image) {
+    cvl_image_pool_release((CVLImagePool *)context, image);
+}
+
+
+
+/**
+ * Return allocator backed by pool.
+ *
+ * Use it with cvl_image_create_with_allocator, cvl_image_release_with_allocator and
+ * cvl_image_reuse_with_allocator.
+ */
+static inline CVLImageAllocator cvl_image_pool_allocator(CVLImagePool * const pool) {
+    CVLImageAllocator allocator;
+    allocator.create = cvl_image_pool_allocator_create;
+    allocator.release = cvl_image_pool_allocator_release;
+    allocator.context = pool;
+    return allocator;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_POOL_H
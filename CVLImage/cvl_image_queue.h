@@ -0,0 +1,455 @@
+#ifndef CVL_IMAGE_QUEUE_H
+#define CVL_IMAGE_QUEUE_H
+
+
+#include "cvl_image_pool.h"
+#include "cvl_threading.h"
+
+#include <stdint.h>
+
+/*
+ * Lock-free bounded image queue for passing frames between pipeline stages.
+ *
+ * Queue is a ring of cells with sequence numbers (Vyukov bounded MPMC queue). Each side claims
+ * positions with compare-and-swap when it may have several threads, and with a plain store in
+ * single producer or single consumer mode, so SPSC queues take no read-modify-write operation
+ * per frame. Queue owns frames between push and pop; a popped frame is owned by the consumer
+ * until it gives it back with cvl_image_queue_release_frame, which returns it to the pool of the
+ * queue. Frames are typically created with cvl_image_queue_acquire_frame from the same pool.
+ *
+ * In drop oldest mode a push into full queue removes the oldest frame and returns it to the pool,
+ * so producers of real-time feeds do not wait for slow consumers; since the producer then dequeues
+ * as well, the consumer side always uses compare-and-swap in this mode.
+ *
+ * Blocking push and pop yield a bounded number of times and then park on a condition variable.
+ * Every successful push or pop checks the count of parked threads after a memory fence and takes
+ * the mutex only when somebody waits, so busy queues never lock.
+ *
+ * Usage:
+ * CVLImagePool pool;
+ * CVLImageQueue queue;
+ * cvl_image_pool_init(&pool, 0);
+ * cvl_image_queue_init(&queue, 8, CVL_IMAGE_QUEUE_SPSC | CVL_IMAGE_QUEUE_DROP_OLDEST, &pool);
+ * Producer:
+ * CVLImageBuffer frame = cvl_image_queue_acquire_frame(&queue, height, width, CVLPixel_8888_sz);
+ * ...fill frame...
+ * cvl_image_queue_push(&queue, &frame);
+ * Consumer:
+ * CVLImageBuffer frame;
+ * while (cvl_image_queue_pop(&queue, &frame)) {
+ *     ...
+ *     cvl_image_queue_release_frame(&queue, &frame);
+ * }
+ */
+
+/** Cache line size used to separate producer and consumer positions. */
+#define CVL_IMAGE_QUEUE_CACHE_LINE 64
+
+/** Number of yields of blocking push and pop before they park on the condition variable. */
+#ifndef CVL_IMAGE_QUEUE_SPIN_COUNT
+#define CVL_IMAGE_QUEUE_SPIN_COUNT 64
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Queue mode flags. */
+typedef enum {
+    CVL_IMAGE_QUEUE_SPSC = 0,           ///< Single producer and single consumer thread.
+    CVL_IMAGE_QUEUE_MULTI_PRODUCER = 1, ///< Several threads may push.
+    CVL_IMAGE_QUEUE_MULTI_CONSUMER = 2, ///< Several threads may pop.
+    CVL_IMAGE_QUEUE_MPMC = 3,           ///< Several producer and consumer threads.
+    CVL_IMAGE_QUEUE_DROP_OLDEST = 4     ///< Push into full queue drops the oldest frame.
+} CVLImageQueueMode;
+
+/** Queue cell. */
+typedef struct {
+    CVLAtomicSize sequence;  ///< Position the cell is ready for: pos when free, pos + 1 when filled.
+    CVLImageBuffer image;
+} CVLImageQueueCell;
+
+/** Queue counters. */
+typedef struct {
+    size_t pushed;        ///< Frames pushed.
+    size_t popped;        ///< Frames popped by consumers.
+    size_t dropped;       ///< Frames dropped in drop oldest mode.
+    size_t depth;         ///< Frames currently in queue.
+    size_t max_depth;     ///< Maximal observed depth.
+    size_t push_stalls;   ///< Pushes which found queue full and failed or waited.
+    size_t pop_stalls;    ///< Pops which found queue empty and failed or waited.
+} CVLImageQueueStats;
+
+/** Lock-free bounded queue of images. */
+typedef struct {
+    CVLAtomicSize enqueue_position;
+    char enqueue_padding[CVL_IMAGE_QUEUE_CACHE_LINE - sizeof(CVLAtomicSize)];
+    CVLAtomicSize dequeue_position;
+    char dequeue_padding[CVL_IMAGE_QUEUE_CACHE_LINE - sizeof(CVLAtomicSize)];
+    CVLImageQueueCell *cells;
+    size_t mask;                   ///< Capacity - 1, capacity is power of two.
+    unsigned int mode;             ///< CVLImageQueueMode flags.
+    CVLImagePool *pool;            ///< Pool of frames or NULL for cvl_image_create images.
+    CVLAtomicSize closed;          ///< Queue was closed, pops fail when it is empty.
+    CVLAtomicSize dropped;
+    CVLAtomicSize max_depth;
+    CVLAtomicSize push_stalls;
+    CVLAtomicSize pop_stalls;
+    CVLAtomicSize waiters;         ///< Number of threads parked in push or pop.
+    CVLMutex wait_mutex;           ///< Guards parking on wait_condition.
+    CVLCondition wait_condition;   ///< Broadcast after push, pop and close while threads are parked.
+} CVLImageQueue;
+
+
+
+/**
+ * Initialize queue.
+ *
+ * @param capacity Maximal number of queued frames, rounded up to power of two, at least 2.
+ * @param mode CVLImageQueueMode flags.
+ * @param pool Pool receiving released and dropped frames, or NULL if frames are created with
+ * cvl_image_create. Pool must outlive queue.
+ * @return false on allocation failure.
+ * @see cvl_image_queue_destroy
+ */
+static inline bool cvl_image_queue_init(CVLImageQueue * const queue,
+                                        const size_t capacity,
+                                        const unsigned int mode,
+                                        CVLImagePool * const pool)
+{
+    memset(queue, 0, sizeof(*queue));
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+    queue->cells = (CVLImageQueueCell *)calloc(size, sizeof(CVLImageQueueCell));
+    if (!queue->cells) {
+        return false;
+    }
+    if (!cvl_mutex_init(&queue->wait_mutex)) {
+        free(queue->cells);
+        return false;
+    }
+    if (!cvl_condition_init(&queue->wait_condition)) {
+        cvl_mutex_destroy(&queue->wait_mutex);
+        free(queue->cells);
+        return false;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        queue->cells[i].sequence = i;
+    }
+    queue->mask = size - 1;
+    queue->mode = mode;
+    queue->pool = pool;
+    return true;
+}
+
+
+
+/** Return frame to queue pool. Frame fields are reset to empty image. */
+static inline void cvl_image_queue_release_frame(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    if (queue->pool) {
+        cvl_image_pool_release(queue->pool, frame);
+    }
+    else {
+        cvl_image_release(frame);
+    }
+}
+
+
+
+/** Create frame from queue pool. @return Empty image on allocation failure. */
+static inline CVLImageBuffer cvl_image_queue_acquire_frame(CVLImageQueue * const queue,
+                                                           const CVLImagePixelCount height,
+                                                           const CVLImagePixelCount width,
+                                                           const CVLImageBytesCount pixel_size)
+{
+    return queue->pool ? cvl_image_pool_create(queue->pool, height, width, pixel_size) :
+                         cvl_image_create(height, width, pixel_size);
+}
+
+
+
+/** Claim position of @a counter for cell state @a offset; single thread sides store without CAS. */
+static inline bool cvl_image_queue_claim(CVLImageQueue * const queue,
+                                         CVLAtomicSize * const counter,
+                                         const size_t offset,
+                                         const bool shared,
+                                         size_t * const position)
+{
+    size_t pos = cvl_atomic_load(counter);
+    for (;;) {
+        CVLImageQueueCell * const cell = &queue->cells[pos & queue->mask];
+        const intptr_t difference = (intptr_t)cvl_atomic_load(&cell->sequence) - (intptr_t)(pos + offset);
+        if (difference == 0) {
+            if (!shared) {
+                cvl_atomic_store(counter, pos + 1);
+                break;
+            }
+            if (cvl_atomic_compare_exchange(counter, &pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (difference < 0) {
+            return false;
+        }
+        else {
+            pos = cvl_atomic_load(counter);
+        }
+    }
+    *position = pos;
+    return true;
+}
+
+
+
+/** Take the oldest frame, used by consumers and by dropping producers. @return false if queue is empty. */
+static inline bool cvl_image_queue_dequeue(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    const bool shared = (queue->mode & (CVL_IMAGE_QUEUE_MULTI_CONSUMER | CVL_IMAGE_QUEUE_DROP_OLDEST)) != 0;
+    size_t pos;
+    if (!cvl_image_queue_claim(queue, &queue->dequeue_position, 1, shared, &pos)) {
+        return false;
+    }
+    CVLImageQueueCell * const cell = &queue->cells[pos & queue->mask];
+    *frame = cell->image;
+    cvl_atomic_store(&cell->sequence, pos + queue->mask + 1);
+    return true;
+}
+
+
+
+/**
+ * Put frame into queue. In drop oldest mode a full queue loses at most one frame per call: a
+ * consumer preempted between claiming a cell and freeing it keeps the queue full, and evicting
+ * until the claim succeeds would drain every frame behind it.
+ * @return false if queue is full.
+ */
+static inline bool cvl_image_queue_enqueue(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    const bool shared = (queue->mode & CVL_IMAGE_QUEUE_MULTI_PRODUCER) != 0;
+    size_t pos;
+    if (!cvl_image_queue_claim(queue, &queue->enqueue_position, 0, shared, &pos)) {
+        CVLImageBuffer oldest;
+        if (!(queue->mode & CVL_IMAGE_QUEUE_DROP_OLDEST)) {
+            return false;
+        }
+        if (cvl_image_queue_dequeue(queue, &oldest)) {
+            cvl_atomic_fetch_add(&queue->dropped, 1);
+            cvl_image_queue_release_frame(queue, &oldest);
+        }
+        if (!cvl_image_queue_claim(queue, &queue->enqueue_position, 0, shared, &pos)) {
+            return false;
+        }
+    }
+    CVLImageQueueCell * const cell = &queue->cells[pos & queue->mask];
+    cell->image = *frame;
+    cvl_atomic_store(&cell->sequence, pos + 1);
+    *frame = cvl_image_make_empty();
+
+    // Depth high-water mark, exact for SPSC and approximate under contention.
+    const size_t depth = pos + 1 - cvl_atomic_load(&queue->dequeue_position);
+    size_t max_depth = cvl_atomic_load(&queue->max_depth);
+    while (depth <= queue->mask + 1 && depth > max_depth &&
+           !cvl_atomic_compare_exchange(&queue->max_depth, &max_depth, depth))
+    {
+    }
+    return true;
+}
+
+
+
+/** Wake threads parked in push or pop after the queue changed. */
+static inline void cvl_image_queue_wake(CVLImageQueue * const queue) {
+    // Pairs with the fence of a parking thread: either it sees the change or we see it waiting.
+    cvl_atomic_fence();
+    if (cvl_atomic_load(&queue->waiters)) {
+        cvl_mutex_lock(&queue->wait_mutex);
+        cvl_condition_broadcast(&queue->wait_condition);
+        cvl_mutex_unlock(&queue->wait_mutex);
+    }
+}
+
+
+
+/** Start parking: lock wait mutex and register as waiter. */
+static inline void cvl_image_queue_park_begin(CVLImageQueue * const queue) {
+    cvl_mutex_lock(&queue->wait_mutex);
+    cvl_atomic_fetch_add(&queue->waiters, 1);
+    cvl_atomic_fence();
+}
+
+
+
+/** Finish parking started with cvl_image_queue_park_begin. */
+static inline void cvl_image_queue_park_end(CVLImageQueue * const queue) {
+    cvl_atomic_fetch_add(&queue->waiters, (size_t)-1);
+    cvl_mutex_unlock(&queue->wait_mutex);
+}
+
+
+
+/**
+ * Push frame without waiting. Queue takes ownership and @a frame is reset to empty image.
+ *
+ * In drop oldest mode push into full queue drops the oldest frame instead of failing, it fails
+ * only while the cell of that frame is still being taken by a consumer.
+ * @return false if queue is full or closed, @a frame is then left to the caller.
+ */
+static inline bool cvl_image_queue_try_push(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    if (cvl_atomic_load(&queue->closed)) {
+        return false;
+    }
+    if (!cvl_image_queue_enqueue(queue, frame)) {
+        cvl_atomic_fetch_add(&queue->push_stalls, 1);
+        return false;
+    }
+    cvl_image_queue_wake(queue);
+    return true;
+}
+
+
+
+/**
+ * Pop the oldest frame without waiting. Caller owns the frame and returns it with
+ * cvl_image_queue_release_frame.
+ * @return false if queue is empty.
+ */
+static inline bool cvl_image_queue_try_pop(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    if (!cvl_image_queue_dequeue(queue, frame)) {
+        cvl_atomic_fetch_add(&queue->pop_stalls, 1);
+        return false;
+    }
+    cvl_image_queue_wake(queue);
+    return true;
+}
+
+
+
+/**
+ * Push frame, waiting while queue is full: yields CVL_IMAGE_QUEUE_SPIN_COUNT times, then parks
+ * until a pop or close. Drop oldest queues wait only for a consumer which is taking the oldest
+ * frame, dropping at most one frame per attempt.
+ * @return false if queue was closed, @a frame is then left to the caller.
+ */
+static inline bool cvl_image_queue_push(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    if (cvl_image_queue_try_push(queue, frame)) {
+        return true;
+    }
+    bool pushed = false;
+    for (int spin = 0; spin < CVL_IMAGE_QUEUE_SPIN_COUNT && !pushed; ++spin) {
+        if (cvl_atomic_load(&queue->closed)) {
+            return false;
+        }
+        cvl_thread_yield();
+        pushed = cvl_image_queue_enqueue(queue, frame);
+    }
+    if (!pushed) {
+        cvl_image_queue_park_begin(queue);
+        while (!cvl_atomic_load(&queue->closed)) {
+            if (cvl_image_queue_enqueue(queue, frame)) {
+                pushed = true;
+                break;
+            }
+            cvl_condition_wait(&queue->wait_condition, &queue->wait_mutex);
+        }
+        cvl_image_queue_park_end(queue);
+    }
+    if (pushed) {
+        cvl_image_queue_wake(queue);
+    }
+    return pushed;
+}
+
+
+
+/**
+ * Pop the oldest frame, waiting while queue is empty: yields CVL_IMAGE_QUEUE_SPIN_COUNT times,
+ * then parks until a push or close.
+ * @return false if queue is closed and empty.
+ */
+static inline bool cvl_image_queue_pop(CVLImageQueue * const queue, CVLImageBuffer * const frame) {
+    if (cvl_image_queue_dequeue(queue, frame)) {
+        cvl_image_queue_wake(queue);
+        return true;
+    }
+    cvl_atomic_fetch_add(&queue->pop_stalls, 1);
+    bool popped = false;
+    bool closed = false;
+    for (int spin = 0; spin < CVL_IMAGE_QUEUE_SPIN_COUNT && !popped && !closed; ++spin) {
+        cvl_thread_yield();
+        // Closed flag is read before the attempt, so frames pushed before close are not lost.
+        closed = cvl_atomic_load(&queue->closed) != 0;
+        popped = cvl_image_queue_dequeue(queue, frame);
+    }
+    if (!popped && !closed) {
+        cvl_image_queue_park_begin(queue);
+        for (;;) {
+            closed = cvl_atomic_load(&queue->closed) != 0;
+            popped = cvl_image_queue_dequeue(queue, frame);
+            if (popped || closed) {
+                break;
+            }
+            cvl_condition_wait(&queue->wait_condition, &queue->wait_mutex);
+        }
+        cvl_image_queue_park_end(queue);
+    }
+    if (popped) {
+        cvl_image_queue_wake(queue);
+    }
+    return popped;
+}
+
+
+
+/** Close queue: pushes fail, pops fail once queue is empty. Used to stop consumers. */
+static inline void cvl_image_queue_close(CVLImageQueue * const queue) {
+    cvl_atomic_store(&queue->closed, 1);
+    cvl_image_queue_wake(queue);
+}
+
+
+
+/** Return number of queued frames, approximate while queue is used. */
+static inline size_t cvl_image_queue_depth(CVLImageQueue * const queue) {
+    const size_t dequeued = cvl_atomic_load(&queue->dequeue_position);
+    const size_t enqueued = cvl_atomic_load(&queue->enqueue_position);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+
+
+/** Return snapshot of queue counters, approximate while queue is used. */
+static inline CVLImageQueueStats cvl_image_queue_get_stats(CVLImageQueue * const queue) {
+    CVLImageQueueStats stats;
+    const size_t dequeued = cvl_atomic_load(&queue->dequeue_position);
+    stats.pushed = cvl_atomic_load(&queue->enqueue_position);
+    stats.dropped = cvl_atomic_load(&queue->dropped);
+    stats.popped = dequeued > stats.dropped ? dequeued - stats.dropped : 0;
+    stats.depth = stats.pushed > dequeued ? stats.pushed - dequeued : 0;
+    stats.max_depth = cvl_atomic_load(&queue->max_depth);
+    stats.push_stalls = cvl_atomic_load(&queue->push_stalls);
+    stats.pop_stalls = cvl_atomic_load(&queue->pop_stalls);
+    return stats;
+}
+
+
+
+/** Destroy queue, frames left in queue are returned to pool. No thread may use queue. */
+static inline void cvl_image_queue_destroy(CVLImageQueue * const queue) {
+    CVLImageBuffer frame;
+    while (cvl_image_queue_dequeue(queue, &frame)) {
+        cvl_image_queue_release_frame(queue, &frame);
+    }
+    free(queue->cells);
+    cvl_condition_destroy(&queue->wait_condition);
+    cvl_mutex_destroy(&queue->wait_mutex);
+    memset(queue, 0, sizeof(*queue));
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_QUEUE_H
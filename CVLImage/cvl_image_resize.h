@@ -0,0 +1,608 @@
+#ifndef CVL_IMAGE_RESIZE_H
+#define CVL_IMAGE_RESIZE_H
+
+
+#include "cvl_image_filter.h"
+#include "cvl_simd.h"
+
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Lanczos filter order (number of lobes). */
+#define CVL_RESIZE_LANCZOS_ORDER 3
+
+/** Maximal number of channels supported by resize plan. */
+#define CVL_RESIZE_MAX_CHANNELS 4
+
+/** Interpolation mode of resize. */
+typedef enum {
+    CVL_RESIZE_NEAREST = 0, ///< Nearest neighbour.
+    CVL_RESIZE_BILINEAR,    ///< Bilinear interpolation of 2x2 neighbourhood.
+    CVL_RESIZE_AREA,        ///< Pixel area averaging (bilinear when upscaling).
+    CVL_RESIZE_LANCZOS      ///< Lanczos windowed sinc, stretched when downscaling.
+} CVLResizeMode;
+
+/** Precomputed coefficients of one resize axis. */
+typedef struct {
+    int size;       ///< Destination size.
+    int taps;       ///< Number of source samples per destination sample.
+    int *start;     ///< First (not clamped) source index per destination sample.
+    int *index;     ///< Source indices clamped to source size, size * taps values.
+    float *weights; ///< Normalized weights, size * taps values.
+} CVLResizeAxis;
+
+/**
+ * Resize plan for fixed source and destination geometry.
+ *
+ * Plan keeps coefficient tables and scratch rows, so repeated resizes of the same geometry do no
+ * allocation and no coefficient computation. Plan must not be used by several threads at once.
+ *
+ * @see cvl_resize_plan_init
+ */
+typedef struct {
+    CVLResizeMode mode;            ///< Interpolation mode.
+    CVLImagePixelCount src_height; ///< Source height.
+    CVLImagePixelCount src_width;  ///< Source width.
+    CVLResizeAxis x;               ///< Horizontal coefficients.
+    CVLResizeAxis y;               ///< Vertical coefficients.
+    float *ring;                   ///< Ring of y.taps horizontally resized rows.
+    int *ring_rows;                ///< Source row stored in each ring slot.
+    float *acc;                    ///< Vertical accumulator row.
+} CVLResizePlan;
+
+
+
+static inline float cvl_resize_sinc(const float x) {
+    if (fabsf(x) < 1e-6f) {
+        return 1.0f;
+    }
+    const float px = 3.14159265358979f * x;
+    return sinf(px) / px;
+}
+
+
+
+/** Compute axis coefficients for resize of @a src_size samples to @a dst_size samples. */
+static inline bool cvl_resize_axis_init(CVLResizeAxis * const axis,
+                                        const int src_size,
+                                        const int dst_size,
+                                        CVLResizeMode mode)
+{
+    const float scale = (float)src_size / (float)dst_size;
+    if (mode == CVL_RESIZE_AREA && scale <= 1.0f) {
+        mode = CVL_RESIZE_BILINEAR;
+    }
+    float support = 0.0f;
+    switch (mode) {
+        case CVL_RESIZE_NEAREST:  axis->taps = 1; break;
+        case CVL_RESIZE_BILINEAR: axis->taps = 2; break;
+        case CVL_RESIZE_AREA:     axis->taps = (int)ceilf(scale) + 1; break;
+        case CVL_RESIZE_LANCZOS:
+            support = CVL_RESIZE_LANCZOS_ORDER * (scale > 1.0f ? scale : 1.0f);
+            axis->taps = (int)ceilf(2.0f * support) + 1;
+            break;
+    }
+    axis->size = dst_size;
+    axis->start = (int *)malloc((size_t)dst_size * sizeof(int));
+    axis->index = (int *)malloc((size_t)dst_size * axis->taps * sizeof(int));
+    axis->weights = (float *)malloc((size_t)dst_size * axis->taps * sizeof(float));
+    if (!axis->start || !axis->index || !axis->weights) {
+        return false;
+    }
+
+    for (int i = 0; i < dst_size; ++i) {
+        float * const w = axis->weights + (size_t)i * axis->taps;
+        const float center = (i + 0.5f) * scale;
+        int start = 0;
+        switch (mode) {
+            case CVL_RESIZE_NEAREST:
+                start = (int)floorf(center);
+                w[0] = 1.0f;
+                break;
+            case CVL_RESIZE_BILINEAR: {
+                const float pos = center - 0.5f;
+                start = (int)floorf(pos);
+                w[1] = pos - start;
+                w[0] = 1.0f - w[1];
+                break;
+            }
+            case CVL_RESIZE_AREA: {
+                const float begin = i * scale;
+                const float end = begin + scale;
+                start = (int)floorf(begin);
+                for (int t = 0; t < axis->taps; ++t) {
+                    const float lo = (float)(start + t) > begin ? (float)(start + t) : begin;
+                    const float hi = (float)(start + t + 1) < end ? (float)(start + t + 1) : end;
+                    w[t] = hi > lo ? (hi - lo) / scale : 0.0f;
+                }
+                break;
+            }
+            case CVL_RESIZE_LANCZOS: {
+                const float stretch = scale > 1.0f ? scale : 1.0f;
+                start = (int)floorf(center - support);
+                float sum = 0.0f;
+                for (int t = 0; t < axis->taps; ++t) {
+                    const float d = (start + t + 0.5f - center) / stretch;
+                    w[t] = fabsf(d) < CVL_RESIZE_LANCZOS_ORDER ?
+                           cvl_resize_sinc(d) * cvl_resize_sinc(d / CVL_RESIZE_LANCZOS_ORDER) : 0.0f;
+                    sum += w[t];
+                }
+                for (int t = 0; t < axis->taps; ++t) {
+                    w[t] /= sum;
+                }
+                break;
+            }
+        }
+        axis->start[i] = start;
+        for (int t = 0; t < axis->taps; ++t) {
+            const int s = start + t;
+            axis->index[(size_t)i * axis->taps + t] = s < 0 ? 0 : (s >= src_size ? src_size - 1 : s);
+        }
+    }
+    return true;
+}
+
+
+
+static inline void cvl_resize_axis_release(CVLResizeAxis * const axis) {
+    free(axis->start);
+    free(axis->index);
+    free(axis->weights);
+    axis->start = NULL;
+    axis->index = NULL;
+    axis->weights = NULL;
+}
+
+
+
+/** Release resize plan memory. */
+static inline void cvl_resize_plan_release(CVLResizePlan * const plan) {
+    cvl_resize_axis_release(&plan->x);
+    cvl_resize_axis_release(&plan->y);
+    cvl_image_data_free(plan->ring);
+    free(plan->ring_rows);
+    plan->ring = NULL;
+    plan->ring_rows = NULL;
+    plan->acc = NULL;
+}
+
+
+
+/**
+ * Initialize resize plan for source and destination geometry.
+ *
+ * @return false on allocation failure.
+ * @see cvl_resize_plan_release
+ */
+static inline bool cvl_resize_plan_init(CVLResizePlan * const plan,
+                                        const CVLImagePixelCount src_height,
+                                        const CVLImagePixelCount src_width,
+                                        const CVLImagePixelCount dst_height,
+                                        const CVLImagePixelCount dst_width,
+                                        const CVLResizeMode mode)
+{
+    assert(src_height > 0 && src_width > 0 && dst_height > 0 && dst_width > 0);
+    memset(plan, 0, sizeof(*plan));
+    plan->mode = mode;
+    plan->src_height = src_height;
+    plan->src_width = src_width;
+    if (!cvl_resize_axis_init(&plan->x, (int)src_width, (int)dst_width, mode) ||
+        !cvl_resize_axis_init(&plan->y, (int)src_height, (int)dst_height, mode))
+    {
+        cvl_resize_plan_release(plan);
+        return false;
+    }
+    const size_t row_size = (size_t)dst_width * CVL_RESIZE_MAX_CHANNELS;
+    plan->ring = (float *)cvl_image_data_alloc(((size_t)plan->y.taps + 1) * row_size * sizeof(float),
+                                               CVL_IMAGE_DEFAULT_ALIGNMENT);
+    plan->ring_rows = (int *)malloc((size_t)plan->y.taps * sizeof(int));
+    if (!plan->ring || !plan->ring_rows) {
+        cvl_resize_plan_release(plan);
+        return false;
+    }
+    plan->acc = plan->ring + (size_t)plan->y.taps * row_size;
+    return true;
+}
+
+
+
+#if CVL_SIMD_SSE2
+
+/** Horizontal bilinear (two taps) resampling of Pixel_8 row, four destination samples per step. */
+static inline void cvl_resize_row_bilinear_8_sse2(const CVLResizeAxis * const axis,
+                                                  const CVLPixel_8 * CVL_RESTRICT const src,
+                                                  float * CVL_RESTRICT const dst)
+{
+    const int * const index = axis->index;
+    const float * const weights = axis->weights;
+    int x = 0;
+    for (; x + 4 <= axis->size; x += 4) {
+        const int * const i = index + 2 * x;
+        const __m128i p0 = _mm_setr_epi32(src[i[0]], src[i[2]], src[i[4]], src[i[6]]);
+        const __m128i p1 = _mm_setr_epi32(src[i[1]], src[i[3]], src[i[5]], src[i[7]]);
+        // Weights are stored as (w0, w1) pairs, split them into per tap vectors.
+        const __m128 wa = _mm_loadu_ps(weights + 2 * x);
+        const __m128 wb = _mm_loadu_ps(weights + 2 * x + 4);
+        const __m128 w0 = _mm_shuffle_ps(wa, wb, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 w1 = _mm_shuffle_ps(wa, wb, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(dst + x, _mm_add_ps(_mm_mul_ps(w0, _mm_cvtepi32_ps(p0)),
+                                          _mm_mul_ps(w1, _mm_cvtepi32_ps(p1))));
+    }
+    for (; x < axis->size; ++x) {
+        const int * const i = index + 2 * x;
+        const float * const w = weights + 2 * x;
+        dst[x] = w[0] * src[i[0]] + w[1] * src[i[1]];
+    }
+}
+
+
+
+/** Horizontal bilinear (two taps) resampling of Pixel_8888 row, one pixel of four channels per step. */
+static inline void cvl_resize_row_bilinear_8888_sse2(const CVLResizeAxis * const axis,
+                                                     const CVLPixel_8 * CVL_RESTRICT const src,
+                                                     float * CVL_RESTRICT const dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < axis->size; ++x) {
+        const int * const i = axis->index + 2 * (size_t)x;
+        const float * const w = axis->weights + 2 * (size_t)x;
+        uint32_t pixel0, pixel1;
+        memcpy(&pixel0, src + 4 * (size_t)i[0], 4);
+        memcpy(&pixel1, src + 4 * (size_t)i[1], 4);
+        const __m128i p0 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pixel0), zero), zero);
+        const __m128i p1 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)pixel1), zero), zero);
+        _mm_storeu_ps(dst + 4 * (size_t)x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(w[0]), _mm_cvtepi32_ps(p0)),
+                                                      _mm_mul_ps(_mm_set1_ps(w[1]), _mm_cvtepi32_ps(p1))));
+    }
+}
+
+#endif
+
+
+
+/** Horizontally resample source row of @a channels interleaved channels into float row. */
+static inline void cvl_resize_row_horizontal(const CVLResizeAxis * const axis,
+                                             const void * const src,
+                                             const bool is_8,
+                                             const int channels,
+                                             float * CVL_RESTRICT const dst)
+{
+    const int taps = axis->taps;
+#if CVL_SIMD_SSE2
+    if (is_8 && taps == 2 && channels == 1) {
+        cvl_resize_row_bilinear_8_sse2(axis, (const CVLPixel_8 *)src, dst);
+        return;
+    }
+    if (is_8 && taps == 2 && channels == 4) {
+        cvl_resize_row_bilinear_8888_sse2(axis, (const CVLPixel_8 *)src, dst);
+        return;
+    }
+#endif
+    for (int x = 0; x < axis->size; ++x) {
+        const int * const index = axis->index + (size_t)x * taps;
+        const float * const w = axis->weights + (size_t)x * taps;
+        float sum[CVL_RESIZE_MAX_CHANNELS] = {0.0f, 0.0f, 0.0f, 0.0f};
+        if (is_8) {
+            const CVLPixel_8 * const row = (const CVLPixel_8 *)src;
+            for (int t = 0; t < taps; ++t) {
+                const CVLPixel_8 * const p = row + (size_t)index[t] * channels;
+                for (int c = 0; c < channels; ++c) {
+                    sum[c] += w[t] * p[c];
+                }
+            }
+        }
+        else {
+            const CVLPixel_F * const row = (const CVLPixel_F *)src;
+            for (int t = 0; t < taps; ++t) {
+                const CVLPixel_F * const p = row + (size_t)index[t] * channels;
+                for (int c = 0; c < channels; ++c) {
+                    sum[c] += w[t] * p[c];
+                }
+            }
+        }
+        for (int c = 0; c < channels; ++c) {
+            dst[x * channels + c] = sum[c];
+        }
+    }
+}
+
+
+
+/** Nearest neighbour resize, pure gather without arithmetic. */
+static inline void cvl_resize_nearest(const CVLResizePlan * const plan,
+                                      const CVLImageBuffer * const source_image,
+                                      const CVLImageBuffer * const dest_image,
+                                      const CVLImageBytesCount pixel_size)
+{
+    for (CVLImagePixelCount y = 0; y < dest_image->height; ++y) {
+        const CVLPixel_8 * const src = CVL_GET_LINE(const CVLPixel_8, source_image, plan->y.index[y]);
+        CVLPixel_8 * const dst = CVL_GET_LINE(CVLPixel_8, dest_image, y);
+        switch (pixel_size) {
+            case 1:
+                for (CVLImagePixelCount x = 0; x < dest_image->width; ++x) {
+                    dst[x] = src[plan->x.index[x]];
+                }
+                break;
+            case 4:
+                for (CVLImagePixelCount x = 0; x < dest_image->width; ++x) {
+                    memcpy(dst + 4 * x, src + 4 * (size_t)plan->x.index[x], 4);
+                }
+                break;
+            default:
+                for (CVLImagePixelCount x = 0; x < dest_image->width; ++x) {
+                    memcpy(dst + pixel_size * x, src + pixel_size * (size_t)plan->x.index[x], pixel_size);
+                }
+                break;
+        }
+    }
+}
+
+
+
+/** Resize image of @a channels interleaved Pixel_8 or Pixel_F channels using plan. */
+static inline void cvl_resize_with_plan(CVLResizePlan * const plan,
+                                        const CVLImageBuffer * const source_image,
+                                        const CVLImageBuffer * const dest_image,
+                                        const bool is_8,
+                                        const int channels)
+{
+    const CVLImageBytesCount pixel_size = (is_8 ? CVLPixel_8_sz : CVLPixel_F_sz) * channels;
+    assert(cvl_image_is_good(source_image, pixel_size));
+    assert(cvl_image_is_good(dest_image, pixel_size));
+    assert(source_image->height == plan->src_height && source_image->width == plan->src_width);
+    assert((int)dest_image->height == plan->y.size && (int)dest_image->width == plan->x.size);
+    assert(channels > 0 && channels <= CVL_RESIZE_MAX_CHANNELS);
+
+    if (plan->mode == CVL_RESIZE_NEAREST) {
+        cvl_resize_nearest(plan, source_image, dest_image, pixel_size);
+        return;
+    }
+
+    const int taps = plan->y.taps;
+    const size_t row_size = (size_t)plan->x.size * channels;
+    const size_t ring_stride = (size_t)plan->x.size * CVL_RESIZE_MAX_CHANNELS;
+    for (int t = 0; t < taps; ++t) {
+        plan->ring_rows[t] = INT32_MIN;
+    }
+
+    for (int y = 0; y < plan->y.size; ++y) {
+        const int start = plan->y.start[y];
+        const float * const w = plan->y.weights + (size_t)y * taps;
+        memset(plan->acc, 0, row_size * sizeof(float));
+        for (int t = 0; t < taps; ++t) {
+            // Source rows window slides monotonically, so each row is resampled horizontally once.
+            const int row = start + t;
+            const int slot = ((row % taps) + taps) % taps;
+            float * const resampled = plan->ring + (size_t)slot * ring_stride;
+            if (plan->ring_rows[slot] != row) {
+                const int sy = plan->y.index[(size_t)y * taps + t];
+                cvl_resize_row_horizontal(&plan->x, CVL_GET_LINE(const CVLPixel_8, source_image, sy), is_8,
+                                          channels, resampled);
+                plan->ring_rows[slot] = row;
+            }
+            if (w[t] != 0.0f) {
+                cvl_filter_row_accumulate(plan->acc, resampled, w[t], row_size);
+            }
+        }
+        if (is_8) {
+            cvl_convert_row_F_to_8(plan->acc, CVL_GET_LINE(CVLPixel_8, dest_image, y), row_size, 1.0f, 0.0f);
+        }
+        else {
+            memcpy(CVL_GET_LINE(CVLPixel_F, dest_image, y), plan->acc, row_size * sizeof(float));
+        }
+    }
+}
+
+
+
+/** Resize Pixel_8 image using plan created for its geometry. */
+static inline void cvl_image_resize_8(CVLResizePlan * const plan,
+                                      const CVLImageBuffer * const source_image,
+                                      const CVLImageBuffer * const dest_image)
+{
+    cvl_resize_with_plan(plan, source_image, dest_image, true, 1);
+}
+
+
+
+/** Resize Pixel_8888 image using plan created for its geometry. */
+static inline void cvl_image_resize_8888(CVLResizePlan * const plan,
+                                         const CVLImageBuffer * const source_image,
+                                         const CVLImageBuffer * const dest_image)
+{
+    cvl_resize_with_plan(plan, source_image, dest_image, true, 4);
+}
+
+
+
+/** Resize Pixel_F image using plan created for its geometry. */
+static inline void cvl_image_resize_F(CVLResizePlan * const plan,
+                                      const CVLImageBuffer * const source_image,
+                                      const CVLImageBuffer * const dest_image)
+{
+    cvl_resize_with_plan(plan, source_image, dest_image, false, 1);
+}
+
+
+
+/** Return size of pyramid level, each level is half of the previous one rounded up. */
+static inline CVLImagePixelCount cvl_image_pyramid_level_size(CVLImagePixelCount size, const int level) {
+    for (int i = 0; i <= level; ++i) {
+        size = (size + 1) / 2;
+    }
+    return size;
+}
+
+
+
+/** Pyramid state: level rows waiting for their pair. */
+typedef struct {
+    const CVLImageBuffer *levels; ///< Destination levels.
+    int level_count;              ///< Number of levels.
+    int channels;                 ///< Number of interleaved channels.
+    bool is_8;                    ///< Pixel_8 channels if true, Pixel_F otherwise.
+    const void **pending;         ///< Row of level input waiting for its pair, per level.
+    CVLImagePixelCount *produced; ///< Number of rows written, per level.
+} CVLPyramidState;
+
+
+
+/** Average 2x2 blocks of two input rows into one row of half width (rounded up). */
+static inline void cvl_pyramid_row_down(const CVLPyramidState * const state,
+                                        const void * const row0,
+                                        const void * const row1,
+                                        const CVLImagePixelCount input_width,
+                                        void * const out,
+                                        const CVLImagePixelCount out_width)
+{
+    const int ch = state->channels;
+    if (state->is_8) {
+        const CVLPixel_8 * const a = (const CVLPixel_8 *)row0;
+        const CVLPixel_8 * const b = (const CVLPixel_8 *)row1;
+        CVLPixel_8 * const o = (CVLPixel_8 *)out;
+        for (CVLImagePixelCount x = 0; x < out_width; ++x) {
+            const size_t i0 = 2 * x * ch;
+            const size_t i1 = (2 * x + 1 < input_width ? 2 * x + 1 : 2 * x) * ch;
+            for (int c = 0; c < ch; ++c) {
+                o[x * ch + c] = (CVLPixel_8)((a[i0 + c] + a[i1 + c] + b[i0 + c] + b[i1 + c] + 2) >> 2);
+            }
+        }
+    }
+    else {
+        const CVLPixel_F * const a = (const CVLPixel_F *)row0;
+        const CVLPixel_F * const b = (const CVLPixel_F *)row1;
+        CVLPixel_F * const o = (CVLPixel_F *)out;
+        for (CVLImagePixelCount x = 0; x < out_width; ++x) {
+            const size_t i0 = 2 * x * ch;
+            const size_t i1 = (2 * x + 1 < input_width ? 2 * x + 1 : 2 * x) * ch;
+            for (int c = 0; c < ch; ++c) {
+                o[x * ch + c] = 0.25f * (a[i0 + c] + a[i1 + c] + b[i0 + c] + b[i1 + c]);
+            }
+        }
+    }
+}
+
+
+
+/** Feed input row of @a level (source for level 0), producing rows of this and next levels. */
+static inline void cvl_pyramid_feed(CVLPyramidState * const state,
+                                    const int level,
+                                    const void * const row,
+                                    const CVLImagePixelCount input_width)
+{
+    if (!state->pending[level]) {
+        state->pending[level] = row;
+        return;
+    }
+    const CVLImageBuffer * const dest = &state->levels[level];
+    void * const out = CVL_GET_LINE(CVLPixel_8, dest, state->produced[level]);
+    cvl_pyramid_row_down(state, state->pending[level], row, input_width, out, dest->width);
+    state->pending[level] = NULL;
+    state->produced[level] += 1;
+    if (level + 1 < state->level_count) {
+        cvl_pyramid_feed(state, level + 1, out, dest->width);
+    }
+}
+
+
+
+/**
+ * Build 2x downscaled pyramid of @a channels interleaved Pixel_8 or Pixel_F channels in a single
+ * pass over the source.
+ *
+ * Each source row is read once, every level row is produced right after its two input rows and
+ * is consumed by the next level while it is still in cache.
+ */
+static inline bool cvl_pyramid_down(const CVLImageBuffer * const source_image,
+                                    const CVLImageBuffer * const levels,
+                                    const int level_count,
+                                    const bool is_8,
+                                    const int channels)
+{
+    const CVLImageBytesCount pixel_size = (is_8 ? CVLPixel_8_sz : CVLPixel_F_sz) * channels;
+    assert(cvl_image_is_good(source_image, pixel_size));
+    for (int i = 0; i < level_count; ++i) {
+        assert(cvl_image_is_good(&levels[i], pixel_size));
+        assert(levels[i].width == cvl_image_pyramid_level_size(source_image->width, i));
+        assert(levels[i].height == cvl_image_pyramid_level_size(source_image->height, i));
+    }
+    CVL_UNUSED(pixel_size);
+    if (level_count <= 0) {
+        return true;
+    }
+
+    CVLPyramidState state;
+    state.levels = levels;
+    state.level_count = level_count;
+    state.is_8 = is_8;
+    state.channels = channels;
+    state.pending = (const void **)calloc((size_t)level_count, sizeof(void *));
+    state.produced = (CVLImagePixelCount *)calloc((size_t)level_count, sizeof(CVLImagePixelCount));
+    if (!state.pending || !state.produced) {
+        free((void *)state.pending);
+        free(state.produced);
+        return false;
+    }
+
+    for (CVLImagePixelCount y = 0; y < source_image->height; ++y) {
+        cvl_pyramid_feed(&state, 0, CVL_GET_LINE(const CVLPixel_8, source_image, y), source_image->width);
+    }
+    // Odd row counts: the last row is paired with itself.
+    for (int level = 0; level < level_count; ++level) {
+        if (state.pending[level]) {
+            const CVLImagePixelCount input_width = level ? levels[level - 1].width : source_image->width;
+            cvl_pyramid_feed(&state, level, state.pending[level], input_width);
+        }
+    }
+
+    free((void *)state.pending);
+    free(state.produced);
+    return true;
+}
+
+
+
+/**
+ * Build pyramid of Pixel_8 image by 2x2 averaging in a single pass over the source.
+ *
+ * @param levels Preallocated destination levels, level i has size
+ * cvl_image_pyramid_level_size(source size, i).
+ * @return false on allocation failure.
+ */
+static inline bool cvl_image_pyramid_down_8(const CVLImageBuffer * const source_image,
+                                            const CVLImageBuffer * const levels,
+                                            const int level_count)
+{
+    return cvl_pyramid_down(source_image, levels, level_count, true, 1);
+}
+
+
+
+/** Build pyramid of Pixel_8888 image. @see cvl_image_pyramid_down_8 */
+static inline bool cvl_image_pyramid_down_8888(const CVLImageBuffer * const source_image,
+                                               const CVLImageBuffer * const levels,
+                                               const int level_count)
+{
+    return cvl_pyramid_down(source_image, levels, level_count, true, 4);
+}
+
+
+
+/** Build pyramid of Pixel_F image. @see cvl_image_pyramid_down_8 */
+static inline bool cvl_image_pyramid_down_F(const CVLImageBuffer * const source_image,
+                                            const CVLImageBuffer * const levels,
+                                            const int level_count)
+{
+    return cvl_pyramid_down(source_image, levels, level_count, false, 1);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_RESIZE_H
@@ -0,0 +1,647 @@
+#ifndef CVL_IMAGE_ROTATE_H
+#define CVL_IMAGE_ROTATE_H
+
+
+#include "cvl_image_tiled.h"
+#include "cvl_simd.h"
+
+/*
+ * Flips, transpose and rotations by multiples of 90 degrees for all pixel types.
+ *
+ * Transposing kernels walk the image in square tiles small enough for source and destination
+ * tiles to stay in L1 cache even when row strides map many rows to the same cache sets, so every
+ * destination cache line is filled completely before it is evicted. Tiles are visited down source
+ * column strips, which fills bands of destination rows left to right. Inside a tile pixels are
+ * moved in blocks transposed in registers: 8 x 8 for Pixel_8, 4 x 4 for 32 bit pixels, 2 x 2 for
+ * 64 bit pixels. Rotations by 90 and 270 degrees are transposes with source or destination rows
+ * walked backwards, so they cost the same as a transpose.
+ *
+ * All functions accept dest == source (same data and rowBytes) where the geometry allows:
+ * flips and 180 degree rotation for any size, transpose and 90/270 degree rotations for square
+ * images. Other overlaps of source and destination are not supported.
+ */
+
+/** Maximal size in bytes of the tile processed at once by transposing kernels. */
+#ifndef CVL_IMAGE_TRANSPOSE_TILE_BYTES
+#define CVL_IMAGE_TRANSPOSE_TILE_BYTES ((size_t)8 * 1024)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Clockwise rotation. */
+typedef enum {
+    CVL_IMAGE_ROTATE_0 = 0,
+    CVL_IMAGE_ROTATE_90,
+    CVL_IMAGE_ROTATE_180,
+    CVL_IMAGE_ROTATE_270
+} CVLImageRotation;
+
+
+
+/** Copy one pixel, constant sizes let the compiler inline the copy. */
+static inline void cvl_image_copy_pixel(void * const dst, const void * const src, const CVLImageBytesCount pixel_size) {
+    switch (pixel_size) {
+        case 1:  memcpy(dst, src, 1); break;
+        case 2:  memcpy(dst, src, 2); break;
+        case 4:  memcpy(dst, src, 4); break;
+        case 8:  memcpy(dst, src, 8); break;
+        case 16: memcpy(dst, src, 16); break;
+        case 32: memcpy(dst, src, 32); break;
+        default: memcpy(dst, src, pixel_size); break;
+    }
+}
+
+
+
+#if CVL_SIMD_SSE2
+
+/** Reverse order of bytes of vector. */
+static inline __m128i cvl_rotate_reverse_8(__m128i v) {
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+
+
+/** Reverse order of pixels of @a pixel_size (1, 4 or 8) bytes in vector. */
+static inline __m128i cvl_rotate_reverse(const __m128i v, const CVLImageBytesCount pixel_size) {
+    switch (pixel_size) {
+        case 1:  return cvl_rotate_reverse_8(v);
+        case 4:  return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        default: return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    }
+}
+
+#endif
+
+
+
+/**
+ * Mirror pixels of two rows of @a width pixels: dst0[i] = src1[width - 1 - i] and
+ * dst1[width - 1 - i] = src0[i] for i in [0, count).
+ *
+ * Both source pixels are read before destination pixels are written, so the kernel reverses a
+ * row in place (dst0 = src0 = dst1 = src1, count = width / 2) or swaps two rows reversing both
+ * (dst0 = src0, dst1 = src1, count = width).
+ */
+static inline void cvl_image_mirror_pixels(CVLPixel_8 * const dst0,
+                                           const CVLPixel_8 * const src0,
+                                           CVLPixel_8 * const dst1,
+                                           const CVLPixel_8 * const src1,
+                                           const size_t width,
+                                           const size_t count,
+                                           const CVLImageBytesCount pixel_size)
+{
+    const size_t ps = pixel_size;
+    const size_t last = (width - 1) * ps;
+    size_t i = 0;
+#if CVL_SIMD_SSE2
+    if (ps == 1 || ps == 4 || ps == 8) {
+        const size_t block = 16 / ps;
+        for (; i + block <= count; i += block) {
+            // Vector of pixels [i, i + block) of row 0 and its mirror
+            // [width - i - block, width - i) of row 1.
+            const size_t mirror = (width - i - block) * ps;
+            const __m128i left = _mm_loadu_si128((const __m128i *)(src0 + i * ps));
+            const __m128i right = _mm_loadu_si128((const __m128i *)(src1 + mirror));
+            _mm_storeu_si128((__m128i *)(dst0 + i * ps), cvl_rotate_reverse(right, pixel_size));
+            _mm_storeu_si128((__m128i *)(dst1 + mirror), cvl_rotate_reverse(left, pixel_size));
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        CVLPixel_8 left[32];
+        CVLPixel_8 right[32];
+        assert(ps <= sizeof(left));
+        cvl_image_copy_pixel(left, src0 + i * ps, pixel_size);
+        cvl_image_copy_pixel(right, src1 + last - i * ps, pixel_size);
+        cvl_image_copy_pixel(dst0 + i * ps, right, pixel_size);
+        cvl_image_copy_pixel(dst1 + last - i * ps, left, pixel_size);
+    }
+}
+
+
+
+/** Write reversed row @a src of @a width pixels to @a dst, which may be @a src. */
+static inline void cvl_image_reverse_row(CVLPixel_8 * const dst,
+                                         const CVLPixel_8 * const src,
+                                         const size_t width,
+                                         const CVLImageBytesCount pixel_size)
+{
+    cvl_image_mirror_pixels(dst, src, dst, src, width, width / 2, pixel_size);
+    if (width % 2 && dst != src) {
+        cvl_image_copy_pixel(dst + width / 2 * pixel_size, src + width / 2 * pixel_size, pixel_size);
+    }
+}
+
+
+
+/*
+ * Transpose kernels.
+ */
+
+#if CVL_SIMD_SSE2
+
+static inline void cvl_rotate_transpose_8x8_8(const CVLPixel_8 * const src, const ptrdiff_t src_stride,
+                                              CVLPixel_8 * const dst, const ptrdiff_t dst_stride)
+{
+    const __m128i a0 = _mm_loadl_epi64((const __m128i *)(src));
+    const __m128i a1 = _mm_loadl_epi64((const __m128i *)(src + src_stride));
+    const __m128i a2 = _mm_loadl_epi64((const __m128i *)(src + 2 * src_stride));
+    const __m128i a3 = _mm_loadl_epi64((const __m128i *)(src + 3 * src_stride));
+    const __m128i a4 = _mm_loadl_epi64((const __m128i *)(src + 4 * src_stride));
+    const __m128i a5 = _mm_loadl_epi64((const __m128i *)(src + 5 * src_stride));
+    const __m128i a6 = _mm_loadl_epi64((const __m128i *)(src + 6 * src_stride));
+    const __m128i a7 = _mm_loadl_epi64((const __m128i *)(src + 7 * src_stride));
+    // Interleave rows pairwise: bytes, then 2 byte groups, then 4 byte groups.
+    const __m128i b0 = _mm_unpacklo_epi8(a0, a1);
+    const __m128i b1 = _mm_unpacklo_epi8(a2, a3);
+    const __m128i b2 = _mm_unpacklo_epi8(a4, a5);
+    const __m128i b3 = _mm_unpacklo_epi8(a6, a7);
+    const __m128i c0 = _mm_unpacklo_epi16(b0, b1);
+    const __m128i c1 = _mm_unpackhi_epi16(b0, b1);
+    const __m128i c2 = _mm_unpacklo_epi16(b2, b3);
+    const __m128i c3 = _mm_unpackhi_epi16(b2, b3);
+    const __m128i d0 = _mm_unpacklo_epi32(c0, c2);
+    const __m128i d1 = _mm_unpackhi_epi32(c0, c2);
+    const __m128i d2 = _mm_unpacklo_epi32(c1, c3);
+    const __m128i d3 = _mm_unpackhi_epi32(c1, c3);
+    _mm_storel_epi64((__m128i *)(dst), d0);
+    _mm_storel_epi64((__m128i *)(dst + dst_stride), _mm_unpackhi_epi64(d0, d0));
+    _mm_storel_epi64((__m128i *)(dst + 2 * dst_stride), d1);
+    _mm_storel_epi64((__m128i *)(dst + 3 * dst_stride), _mm_unpackhi_epi64(d1, d1));
+    _mm_storel_epi64((__m128i *)(dst + 4 * dst_stride), d2);
+    _mm_storel_epi64((__m128i *)(dst + 5 * dst_stride), _mm_unpackhi_epi64(d2, d2));
+    _mm_storel_epi64((__m128i *)(dst + 6 * dst_stride), d3);
+    _mm_storel_epi64((__m128i *)(dst + 7 * dst_stride), _mm_unpackhi_epi64(d3, d3));
+}
+
+
+
+static inline void cvl_rotate_transpose_4x4_32(const CVLPixel_8 * const src, const ptrdiff_t src_stride,
+                                               CVLPixel_8 * const dst, const ptrdiff_t dst_stride)
+{
+    const __m128i a0 = _mm_loadu_si128((const __m128i *)(src));
+    const __m128i a1 = _mm_loadu_si128((const __m128i *)(src + src_stride));
+    const __m128i a2 = _mm_loadu_si128((const __m128i *)(src + 2 * src_stride));
+    const __m128i a3 = _mm_loadu_si128((const __m128i *)(src + 3 * src_stride));
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a1);
+    const __m128i b1 = _mm_unpacklo_epi32(a2, a3);
+    const __m128i b2 = _mm_unpackhi_epi32(a0, a1);
+    const __m128i b3 = _mm_unpackhi_epi32(a2, a3);
+    _mm_storeu_si128((__m128i *)(dst), _mm_unpacklo_epi64(b0, b1));
+    _mm_storeu_si128((__m128i *)(dst + dst_stride), _mm_unpackhi_epi64(b0, b1));
+    _mm_storeu_si128((__m128i *)(dst + 2 * dst_stride), _mm_unpacklo_epi64(b2, b3));
+    _mm_storeu_si128((__m128i *)(dst + 3 * dst_stride), _mm_unpackhi_epi64(b2, b3));
+}
+
+
+
+static inline void cvl_rotate_transpose_2x2_64(const CVLPixel_8 * const src, const ptrdiff_t src_stride,
+                                               CVLPixel_8 * const dst, const ptrdiff_t dst_stride)
+{
+    const __m128i a0 = _mm_loadu_si128((const __m128i *)(src));
+    const __m128i a1 = _mm_loadu_si128((const __m128i *)(src + src_stride));
+    _mm_storeu_si128((__m128i *)(dst), _mm_unpacklo_epi64(a0, a1));
+    _mm_storeu_si128((__m128i *)(dst + dst_stride), _mm_unpackhi_epi64(a0, a1));
+}
+
+#endif
+
+
+
+/** Transpose pixel by pixel, see cvl_image_transpose_block. */
+static inline void cvl_image_transpose_pixels(const CVLPixel_8 * const src,
+                                              const ptrdiff_t src_stride,
+                                              CVLPixel_8 * const dst,
+                                              const ptrdiff_t dst_stride,
+                                              const size_t rows,
+                                              const size_t cols,
+                                              const CVLImageBytesCount pixel_size)
+{
+    for (size_t j = 0; j < cols; ++j) {
+        const CVLPixel_8 *s = src + (ptrdiff_t)(j * pixel_size);
+        CVLPixel_8 * const d = dst + (ptrdiff_t)j * dst_stride;
+        for (size_t i = 0; i < rows; ++i, s += src_stride) {
+            cvl_image_copy_pixel(d + i * pixel_size, s, pixel_size);
+        }
+    }
+}
+
+
+
+#if CVL_SIMD_SSE2
+
+/** Transpose with @a block x @a block register transposes and pixel by pixel edges. */
+static inline void cvl_image_transpose_blocks(const CVLPixel_8 * const src,
+                                              const ptrdiff_t src_stride,
+                                              CVLPixel_8 * const dst,
+                                              const ptrdiff_t dst_stride,
+                                              const size_t rows,
+                                              const size_t cols,
+                                              const CVLImageBytesCount pixel_size,
+                                              const size_t block)
+{
+    const size_t block_rows = rows - rows % block;
+    const size_t block_cols = cols - cols % block;
+    for (size_t i = 0; i < block_rows; i += block) {
+        const CVLPixel_8 * const src_row = src + (ptrdiff_t)i * src_stride;
+        CVLPixel_8 * const dst_col = dst + i * pixel_size;
+        for (size_t j = 0; j < block_cols; j += block) {
+            const CVLPixel_8 * const s = src_row + (ptrdiff_t)(j * pixel_size);
+            CVLPixel_8 * const d = dst_col + (ptrdiff_t)j * dst_stride;
+            switch (block) {
+                case 8:  cvl_rotate_transpose_8x8_8(s, src_stride, d, dst_stride); break;
+                case 4:  cvl_rotate_transpose_4x4_32(s, src_stride, d, dst_stride); break;
+                default: cvl_rotate_transpose_2x2_64(s, src_stride, d, dst_stride); break;
+            }
+        }
+    }
+    // Bottom edge of source lower than a block, then right edge narrower than a block.
+    cvl_image_transpose_pixels(src + (ptrdiff_t)block_rows * src_stride, src_stride,
+                               dst + block_rows * pixel_size, dst_stride, rows - block_rows, block_cols, pixel_size);
+    cvl_image_transpose_pixels(src + (ptrdiff_t)(block_cols * pixel_size), src_stride,
+                               dst + (ptrdiff_t)block_cols * dst_stride, dst_stride, rows, cols - block_cols, pixel_size);
+}
+
+#endif
+
+
+
+/**
+ * Transpose block of @a rows x @a cols pixels: dst row j, column i = src row i, column j.
+ *
+ * Strides are in bytes and may be negative, which turns transpose into a rotation.
+ * Source and destination must not overlap.
+ */
+static inline void cvl_image_transpose_block(const CVLPixel_8 * const src,
+                                             const ptrdiff_t src_stride,
+                                             CVLPixel_8 * const dst,
+                                             const ptrdiff_t dst_stride,
+                                             const size_t rows,
+                                             const size_t cols,
+                                             const CVLImageBytesCount pixel_size)
+{
+    // Constant pixel sizes let the compiler specialize the loops.
+    switch (pixel_size) {
+#if CVL_SIMD_SSE2
+        case 1:  cvl_image_transpose_blocks(src, src_stride, dst, dst_stride, rows, cols, 1, 8); break;
+        case 4:  cvl_image_transpose_blocks(src, src_stride, dst, dst_stride, rows, cols, 4, 4); break;
+        case 8:  cvl_image_transpose_blocks(src, src_stride, dst, dst_stride, rows, cols, 8, 2); break;
+#else
+        case 1:  cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, 1); break;
+        case 4:  cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, 4); break;
+        case 8:  cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, 8); break;
+#endif
+        case 2:  cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, 2); break;
+        case 16: cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, 16); break;
+        case 32: cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, 32); break;
+        default: cvl_image_transpose_pixels(src, src_stride, dst, dst_stride, rows, cols, pixel_size); break;
+    }
+}
+
+
+
+/** Return side in pixels of square tiles of transposing kernels, a multiple of 8. */
+static inline CVLImagePixelCount cvl_image_transpose_tile_size(const CVLImageBytesCount pixel_size) {
+    CVLImagePixelCount side = 128;
+    while (side > 8 && side * side * pixel_size > CVL_IMAGE_TRANSPOSE_TILE_BYTES) {
+        side /= 2;
+    }
+    return side;
+}
+
+
+
+/** Context of transposing tile tasks. */
+typedef struct {
+    const CVLImageBuffer *source_image;
+    const CVLImageBuffer *dest_image;
+    CVLImageBytesCount pixel_size;
+    CVLImageRotation rotation;  ///< CVL_IMAGE_ROTATE_0 stands for transpose.
+    CVLImagePixelCount tile_size;
+} CVLImageTransposeTasks;
+
+
+
+/** Transpose or rotate source tile @a rect into destination. */
+static inline void cvl_image_transpose_tile(void * const context, const CVLRect rect) {
+    const CVLImageTransposeTasks * const tasks = (const CVLImageTransposeTasks *)context;
+    const CVLImageBuffer * const source = tasks->source_image;
+    const CVLImageBuffer * const dest = tasks->dest_image;
+    const CVLImageBytesCount ps = tasks->pixel_size;
+    const ptrdiff_t src_stride = (ptrdiff_t)source->rowBytes;
+    const ptrdiff_t dst_stride = (ptrdiff_t)dest->rowBytes;
+    const CVLPixel_8 * const src = CVL_GET_LINE(const CVLPixel_8, source, rect.y) + (size_t)rect.x * ps;
+    switch (tasks->rotation) {
+        case CVL_IMAGE_ROTATE_90: {
+            // Dest (y, x) = source (height - 1 - x, y): transpose source rows bottom up.
+            const CVLPixel_8 * const bottom = src + (ptrdiff_t)(rect.height - 1) * src_stride;
+            CVLPixel_8 * const dst = CVL_GET_LINE(CVLPixel_8, dest, rect.x) +
+                                     (source->height - (size_t)rect.y - (size_t)rect.height) * ps;
+            cvl_image_transpose_block(bottom, -src_stride, dst, dst_stride, (size_t)rect.height, (size_t)rect.width, ps);
+            break;
+        }
+        case CVL_IMAGE_ROTATE_270: {
+            // Dest (y, x) = source (x, width - 1 - y): transpose into destination rows bottom up.
+            CVLPixel_8 * const dst = CVL_GET_LINE(CVLPixel_8, dest, source->width - 1 - (size_t)rect.x) + (size_t)rect.y * ps;
+            cvl_image_transpose_block(src, src_stride, dst, -dst_stride, (size_t)rect.height, (size_t)rect.width, ps);
+            break;
+        }
+        default: {
+            CVLPixel_8 * const dst = CVL_GET_LINE(CVLPixel_8, dest, rect.x) + (size_t)rect.y * ps;
+            cvl_image_transpose_block(src, src_stride, dst, dst_stride, (size_t)rect.height, (size_t)rect.width, ps);
+            break;
+        }
+    }
+}
+
+
+
+/**
+ * Transpose source column strips [begin, end) of tile width.
+ *
+ * Strip tiles are visited top down, so each strip fills a band of destination rows left to right
+ * and destination lines are written sequentially.
+ */
+static inline void cvl_image_transpose_strips(void * const context, const size_t begin, const size_t end) {
+    const CVLImageTransposeTasks * const tasks = (const CVLImageTransposeTasks *)context;
+    const CVLImagePixelCount side = tasks->tile_size;
+    const CVLImagePixelCount height = tasks->source_image->height;
+    const CVLImagePixelCount width = tasks->source_image->width;
+    for (size_t strip = begin; strip < end; ++strip) {
+        const CVLImagePixelCount x = (CVLImagePixelCount)strip * side;
+        const CVLImagePixelCount cols = width - x < side ? width - x : side;
+        for (CVLImagePixelCount y = 0; y < height; y += side) {
+            const CVLImagePixelCount rows = height - y < side ? height - y : side;
+            cvl_image_transpose_tile(context, cvl_rect_make((int)x, (int)y, (int)cols, (int)rows));
+        }
+    }
+}
+
+
+
+/**
+ * Transpose tile row @a ty of square image in place: every tile (ty, tx) with tx >= ty is swapped
+ * with tile (tx, ty), both transposed, through a stack buffer.
+ */
+static inline void cvl_image_transpose_in_place_tiles(void * const context, const size_t begin, const size_t end) {
+    const CVLImageTransposeTasks * const tasks = (const CVLImageTransposeTasks *)context;
+    const CVLImageBuffer * const image = tasks->dest_image;
+    const CVLImageBytesCount ps = tasks->pixel_size;
+    const size_t side = tasks->tile_size;
+    const size_t size = image->height;
+    const ptrdiff_t stride = (ptrdiff_t)image->rowBytes;
+    CVLPixel_8 buffer[CVL_IMAGE_TRANSPOSE_TILE_BYTES];
+    assert(side * side * ps <= sizeof(buffer));
+    for (size_t ty = begin; ty < end; ++ty) {
+        const size_t y = ty * side;
+        const size_t rows = size - y < side ? size - y : side;
+        for (size_t x = y; x < size; x += side) {
+            const size_t cols = size - x < side ? size - x : side;
+            CVLPixel_8 * const a = CVL_GET_LINE(CVLPixel_8, image, y) + x * ps;
+            CVLPixel_8 * const b = CVL_GET_LINE(CVLPixel_8, image, x) + y * ps;
+            const ptrdiff_t buffer_stride = (ptrdiff_t)(rows * ps);
+            cvl_image_transpose_block(a, stride, buffer, buffer_stride, rows, cols, ps);
+            if (a != b) {
+                cvl_image_transpose_block(b, stride, a, stride, cols, rows, ps);
+            }
+            cvl_simd_copy_rows(b, image->rowBytes, buffer, (size_t)buffer_stride, (size_t)buffer_stride, cols);
+        }
+    }
+}
+
+
+
+/** Context of row flipping band tasks. */
+typedef struct {
+    const CVLImageBuffer *source_image;
+    const CVLImageBuffer *dest_image;
+    CVLImageBytesCount pixel_size;
+    bool reverse_rows;    ///< Mirror rows horizontally.
+    bool reverse_order;   ///< Mirror order of rows vertically.
+} CVLImageFlipBands;
+
+
+
+/**
+ * Out of place flip of destination rows [begin, end), or in place flip of row pairs
+ * [begin, end).
+ */
+static inline void cvl_image_flip_band(void * const context, const size_t begin, const size_t end) {
+    const CVLImageFlipBands * const bands = (const CVLImageFlipBands *)context;
+    const CVLImageBuffer * const source = bands->source_image;
+    const CVLImageBuffer * const dest = bands->dest_image;
+    const CVLImageBytesCount ps = bands->pixel_size;
+    const size_t width = dest->width;
+    const size_t height = dest->height;
+    const size_t row_bytes = width * ps;
+    if (source->data != dest->data) {
+        for (size_t y = begin; y < end; ++y) {
+            const CVLPixel_8 * const src = CVL_GET_LINE(const CVLPixel_8, source, bands->reverse_order ? height - 1 - y : y);
+            CVLPixel_8 * const dst = CVL_GET_LINE(CVLPixel_8, dest, y);
+            if (bands->reverse_rows) {
+                cvl_image_reverse_row(dst, src, width, ps);
+            }
+            else {
+                memcpy(dst, src, row_bytes);
+            }
+        }
+        return;
+    }
+
+    if (!bands->reverse_order) {
+        for (size_t y = begin; y < end; ++y) {
+            CVLPixel_8 * const row = CVL_GET_LINE(CVLPixel_8, dest, y);
+            cvl_image_reverse_row(row, row, width, ps);
+        }
+        return;
+    }
+    for (size_t y = begin; y < end; ++y) {
+        CVLPixel_8 * const top = CVL_GET_LINE(CVLPixel_8, dest, y);
+        CVLPixel_8 * const bottom = CVL_GET_LINE(CVLPixel_8, dest, height - 1 - y);
+        if (top == bottom) {
+            // Middle row of odd height.
+            if (bands->reverse_rows) {
+                cvl_image_reverse_row(top, top, width, ps);
+            }
+        }
+        else if (bands->reverse_rows) {
+            cvl_image_mirror_pixels(top, top, bottom, bottom, width, width, ps);
+        }
+        else {
+            CVLPixel_8 buffer[4096];
+            for (size_t offset = 0; offset < row_bytes; offset += sizeof(buffer)) {
+                const size_t bytes = row_bytes - offset < sizeof(buffer) ? row_bytes - offset : sizeof(buffer);
+                memcpy(buffer, top + offset, bytes);
+                memcpy(top + offset, bottom + offset, bytes);
+                memcpy(bottom + offset, buffer, bytes);
+            }
+        }
+    }
+}
+
+
+
+static inline void cvl_image_flip(CVLThreadPool * const pool,
+                                  const CVLImageBuffer * const source_image,
+                                  CVLImageBuffer * const dest_image,
+                                  const CVLImageBytesCount pixel_size,
+                                  const bool reverse_rows,
+                                  const bool reverse_order)
+{
+    assert(cvl_image_is_good(source_image, pixel_size));
+    assert(cvl_image_is_good(dest_image,   pixel_size));
+    assert(source_image->height == dest_image->height && source_image->width == dest_image->width);
+    assert(source_image->data != dest_image->data || source_image->rowBytes == dest_image->rowBytes);
+    CVLImageFlipBands bands;
+    bands.source_image = source_image;
+    bands.dest_image = dest_image;
+    bands.pixel_size = pixel_size;
+    bands.reverse_rows = reverse_rows;
+    bands.reverse_order = reverse_order;
+    const bool in_place = source_image->data == dest_image->data;
+    // In place vertical flips process pairs of rows.
+    const size_t count = in_place && reverse_order ? (dest_image->height + 1) / 2 : dest_image->height;
+    const size_t row_bytes = dest_image->width * pixel_size * (in_place && reverse_order ? 2 : 1);
+    cvl_image_parallel_for_rows(pool, count, row_bytes, cvl_image_flip_band, &bands);
+}
+
+
+
+/**
+ * Mirror image horizontally (left to right) into @a dest_image of the same size.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_image_flip_horizontal(CVLThreadPool * const pool,
+                                             const CVLImageBuffer * const source_image,
+                                             CVLImageBuffer * const dest_image,
+                                             const CVLImageBytesCount pixel_size)
+{
+    cvl_image_flip(pool, source_image, dest_image, pixel_size, true, false);
+}
+
+
+
+/**
+ * Mirror image vertically (top to bottom) into @a dest_image of the same size.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_image_flip_vertical(CVLThreadPool * const pool,
+                                           const CVLImageBuffer * const source_image,
+                                           CVLImageBuffer * const dest_image,
+                                           const CVLImageBytesCount pixel_size)
+{
+    cvl_image_flip(pool, source_image, dest_image, pixel_size, false, true);
+}
+
+
+
+static inline void cvl_image_transpose_tiles(CVLThreadPool * const pool,
+                                             const CVLImageBuffer * const source_image,
+                                             CVLImageBuffer * const dest_image,
+                                             const CVLImageBytesCount pixel_size,
+                                             const CVLImageRotation rotation)
+{
+    assert(cvl_image_is_good(source_image, pixel_size));
+    assert(cvl_image_is_good(dest_image,   pixel_size));
+    assert(source_image->height == dest_image->width && source_image->width == dest_image->height);
+    CVLImageTransposeTasks tasks;
+    tasks.source_image = source_image;
+    tasks.dest_image = dest_image;
+    tasks.pixel_size = pixel_size;
+    tasks.rotation = rotation;
+    tasks.tile_size = cvl_image_transpose_tile_size(pixel_size);
+    if (source_image->data != dest_image->data) {
+        const size_t strips = (source_image->width + tasks.tile_size - 1) / tasks.tile_size;
+        cvl_parallel_for(pool, strips, cvl_tiled_parallel_grain(pool, strips), cvl_image_transpose_strips, &tasks);
+        return;
+    }
+
+    assert(source_image->height == source_image->width && source_image->rowBytes == dest_image->rowBytes);
+    const size_t tile_rows = (source_image->height + tasks.tile_size - 1) / tasks.tile_size;
+    cvl_parallel_for(pool, tile_rows, 1, cvl_image_transpose_in_place_tiles, &tasks);
+    // Rotations in place are transposes followed by a flip.
+    if (rotation == CVL_IMAGE_ROTATE_90) {
+        cvl_image_flip_horizontal(pool, dest_image, dest_image, pixel_size);
+    }
+    else if (rotation == CVL_IMAGE_ROTATE_270) {
+        cvl_image_flip_vertical(pool, dest_image, dest_image, pixel_size);
+    }
+}
+
+
+
+/**
+ * Transpose image into @a dest_image of swapped height and width.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_image_transpose(CVLThreadPool * const pool,
+                                       const CVLImageBuffer * const source_image,
+                                       CVLImageBuffer * const dest_image,
+                                       const CVLImageBytesCount pixel_size)
+{
+    cvl_image_transpose_tiles(pool, source_image, dest_image, pixel_size, CVL_IMAGE_ROTATE_0);
+}
+
+
+
+/**
+ * Rotate image clockwise into @a dest_image.
+ *
+ * Destination of 90 and 270 degree rotations has swapped height and width.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_image_rotate(CVLThreadPool * const pool,
+                                    const CVLImageBuffer * const source_image,
+                                    CVLImageBuffer * const dest_image,
+                                    const CVLImageRotation rotation,
+                                    const CVLImageBytesCount pixel_size)
+{
+    switch (rotation) {
+        case CVL_IMAGE_ROTATE_0:
+            if (source_image->data != dest_image->data) {
+                cvl_image_copy_parallel(pool, source_image, dest_image, pixel_size);
+            }
+            break;
+        case CVL_IMAGE_ROTATE_180:
+            cvl_image_flip(pool, source_image, dest_image, pixel_size, true, true);
+            break;
+        default:
+            cvl_image_transpose_tiles(pool, source_image, dest_image, pixel_size, rotation);
+            break;
+    }
+}
+
+
+
+/**
+ * Create rotated copy of image.
+ * @return Empty image on allocation failure.
+ * @see cvl_image_rotate
+ */
+static inline CVLImageBuffer cvl_image_create_rotated(CVLThreadPool * const pool,
+                                                      const CVLImageBuffer * const source_image,
+                                                      const CVLImageRotation rotation,
+                                                      const CVLImageBytesCount pixel_size)
+{
+    const bool swap = rotation == CVL_IMAGE_ROTATE_90 || rotation == CVL_IMAGE_ROTATE_270;
+    CVLImageBuffer image = cvl_image_create(swap ? source_image->width : source_image->height,
+                                            swap ? source_image->height : source_image->width, pixel_size);
+    if (image.data) {
+        cvl_image_rotate(pool, source_image, &image, rotation, pixel_size);
+    }
+    return image;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_ROTATE_H
@@ -0,0 +1,317 @@
+#ifndef CVL_IMAGE_SEQUENCE_H
+#define CVL_IMAGE_SEQUENCE_H
+
+
+#include "cvl_image_file.h"
+#include "cvl_threading.h"
+
+/*
+ * Sequence reader.
+ *
+ * Frames of a sequence are loaded in order by a background thread into a ring of reusable slot
+ * images while the caller processes earlier frames, so throughput is bounded by the slower of
+ * loading and processing rather than by their sum. The loader runs at most prefetch_count frames
+ * ahead of the caller and blocks when all slots are full; memory is bounded by
+ * prefetch_count + 1 frames. Slot images are recycled with cvl_image_reuse, so sequences of equal
+ * frame layout allocate only on the first pass over the ring.
+ *
+ * Frames are produced by CVLSequenceLoadFunction; cvl_sequence_files_load reads frames of a list of
+ * raw image files (see cvl_image_file.h).
+ *
+ * Usage:
+ * CVLSequenceFiles files;
+ * cvl_sequence_files_init(&files, paths, path_count);
+ * CVLSequenceReader reader;
+ * if (cvl_sequence_reader_open(&reader, 4, cvl_sequence_files_load, &files)) {
+ *     const CVLImageBuffer *frame;
+ *     while ((frame = cvl_sequence_reader_next(&reader))) {
+ *         ...
+ *     }
+ *     cvl_sequence_reader_close(&reader);
+ * }
+ * cvl_sequence_files_close(&files);
+ */
+
+/** Default number of frames loaded ahead of the caller. */
+#define CVL_SEQUENCE_DEFAULT_PREFETCH 4
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Result of frame loading. */
+typedef enum {
+    CVL_SEQUENCE_FRAME = 0, ///< Frame was loaded.
+    CVL_SEQUENCE_END,       ///< Sequence has no more frames.
+    CVL_SEQUENCE_ERROR      ///< Frame could not be loaded, sequence is stopped.
+} CVLSequenceStatus;
+
+/**
+ * Load frame @a index of sequence into @a frame.
+ *
+ * @a frame holds image of some earlier frame (or empty image) created by cvl_image_create; loader
+ * adapts it with cvl_image_reuse and fills it. Loader is called from reader thread only, with
+ * increasing indices starting from 0.
+ */
+typedef CVLSequenceStatus (*CVLSequenceLoadFunction)(void *context, uint64_t index, CVLImageBuffer *frame);
+
+/** Reader counters. */
+typedef struct {
+    uint64_t frames;          ///< Frames delivered to the caller.
+    uint64_t caller_waits;    ///< Times the caller waited for loading (loading is the bottleneck).
+    uint64_t loader_waits;    ///< Times the loader waited for free slot (processing is the bottleneck).
+} CVLSequenceStats;
+
+/** Sequence reader with background prefetch. */
+typedef struct {
+    CVLMutex mutex;                 ///< Guards counters and flags.
+    CVLCondition condition;         ///< Signaled on any counter or flag change.
+    CVLThread thread;               ///< Loader thread.
+    CVLSequenceLoadFunction load;
+    void *context;
+    CVLImageBuffer *slots;          ///< Ring of slot_count frame images.
+    size_t slot_count;
+    uint64_t loaded;                ///< Frames loaded, slot of frame i is i % slot_count.
+    uint64_t delivered;             ///< Frames returned to the caller.
+    uint64_t released;              ///< Slots returned by the caller.
+    bool finished;                  ///< Loader reached end of sequence or failed.
+    bool failed;                    ///< Loader failed.
+    bool stop;                      ///< Reader is closing.
+    CVLSequenceStats stats;
+} CVLSequenceReader;
+
+
+
+/** Loader thread body. */
+static inline void cvl_sequence_reader_thread(void * const argument) {
+    CVLSequenceReader * const reader = (CVLSequenceReader *)argument;
+    cvl_mutex_lock(&reader->mutex);
+    while (!reader->stop) {
+        if (reader->loaded - reader->released == reader->slot_count) {
+            ++reader->stats.loader_waits;
+            while (!reader->stop && reader->loaded - reader->released == reader->slot_count) {
+                cvl_condition_wait(&reader->condition, &reader->mutex);
+            }
+            continue;
+        }
+        // Slot is free: the caller holds only slots of frames in [released, delivered).
+        const uint64_t index = reader->loaded;
+        CVLImageBuffer * const slot = &reader->slots[index % reader->slot_count];
+        cvl_mutex_unlock(&reader->mutex);
+
+        const CVLSequenceStatus status = reader->load(reader->context, index, slot);
+
+        cvl_mutex_lock(&reader->mutex);
+        if (status == CVL_SEQUENCE_FRAME) {
+            ++reader->loaded;
+        }
+        else {
+            reader->finished = true;
+            reader->failed = status == CVL_SEQUENCE_ERROR;
+        }
+        cvl_condition_broadcast(&reader->condition);
+        if (reader->finished) {
+            break;
+        }
+    }
+    cvl_mutex_unlock(&reader->mutex);
+}
+
+
+
+/**
+ * Open reader and start loading frames in background.
+ *
+ * @param prefetch_count Number of frames loaded ahead of the caller, 0 for
+ * CVL_SEQUENCE_DEFAULT_PREFETCH.
+ * @param context Loader context, must outlive reader.
+ * @return false if reader could not be started.
+ * @see cvl_sequence_reader_close
+ */
+static inline bool cvl_sequence_reader_open(CVLSequenceReader * const reader,
+                                            const size_t prefetch_count,
+                                            const CVLSequenceLoadFunction load,
+                                            void * const context)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->load = load;
+    reader->context = context;
+    // One more slot for the frame held by the caller.
+    reader->slot_count = (prefetch_count ? prefetch_count : CVL_SEQUENCE_DEFAULT_PREFETCH) + 1;
+    reader->slots = (CVLImageBuffer *)calloc(reader->slot_count, sizeof(CVLImageBuffer));
+    if (!reader->slots) {
+        return false;
+    }
+    if (!cvl_mutex_init(&reader->mutex)) {
+        free(reader->slots);
+        return false;
+    }
+    if (!cvl_condition_init(&reader->condition)) {
+        cvl_mutex_destroy(&reader->mutex);
+        free(reader->slots);
+        return false;
+    }
+    if (!cvl_thread_create(&reader->thread, cvl_sequence_reader_thread, reader)) {
+        cvl_condition_destroy(&reader->condition);
+        cvl_mutex_destroy(&reader->mutex);
+        free(reader->slots);
+        return false;
+    }
+    return true;
+}
+
+
+
+/**
+ * Return next frame of sequence, waiting for it if it is not loaded yet.
+ *
+ * Frame stays valid and may be modified until the next call of cvl_sequence_reader_next or
+ * cvl_sequence_reader_close; then its slot is reused for loading.
+ * @return NULL at end of sequence or if loader failed, see cvl_sequence_reader_failed.
+ */
+static inline CVLImageBuffer *cvl_sequence_reader_next(CVLSequenceReader * const reader) {
+    cvl_mutex_lock(&reader->mutex);
+    if (reader->released < reader->delivered) {
+        ++reader->released;
+        cvl_condition_broadcast(&reader->condition);
+    }
+    if (reader->delivered == reader->loaded && !reader->finished) {
+        ++reader->stats.caller_waits;
+        while (reader->delivered == reader->loaded && !reader->finished) {
+            cvl_condition_wait(&reader->condition, &reader->mutex);
+        }
+    }
+    CVLImageBuffer *frame = NULL;
+    if (reader->delivered < reader->loaded) {
+        frame = &reader->slots[reader->delivered % reader->slot_count];
+        ++reader->delivered;
+        ++reader->stats.frames;
+    }
+    cvl_mutex_unlock(&reader->mutex);
+    return frame;
+}
+
+
+
+/** Return true if reading stopped because loader failed. */
+static inline bool cvl_sequence_reader_failed(CVLSequenceReader * const reader) {
+    cvl_mutex_lock(&reader->mutex);
+    const bool failed = reader->failed;
+    cvl_mutex_unlock(&reader->mutex);
+    return failed;
+}
+
+
+
+/** Return reader counters. */
+static inline CVLSequenceStats cvl_sequence_reader_get_stats(CVLSequenceReader * const reader) {
+    cvl_mutex_lock(&reader->mutex);
+    const CVLSequenceStats stats = reader->stats;
+    cvl_mutex_unlock(&reader->mutex);
+    return stats;
+}
+
+
+
+/** Stop loader, possibly before end of sequence, and release all frames. */
+static inline void cvl_sequence_reader_close(CVLSequenceReader * const reader) {
+    cvl_mutex_lock(&reader->mutex);
+    reader->stop = true;
+    cvl_condition_broadcast(&reader->condition);
+    cvl_mutex_unlock(&reader->mutex);
+    cvl_thread_join(&reader->thread);
+    for (size_t i = 0; i < reader->slot_count; ++i) {
+        cvl_image_release(&reader->slots[i]);
+    }
+    free(reader->slots);
+    cvl_condition_destroy(&reader->condition);
+    cvl_mutex_destroy(&reader->mutex);
+    memset(reader, 0, sizeof(*reader));
+}
+
+
+
+/** Sequence of frames stored in raw image files, loader context of cvl_sequence_files_load. */
+typedef struct {
+    const char * const *paths;  ///< File paths, must outlive loading.
+    size_t path_count;
+    size_t path_index;          ///< Index of currently open file.
+    uint64_t frame_index;       ///< Index of next frame in open file.
+    bool is_open;
+    CVLImageFile file;          ///< Currently open file.
+} CVLSequenceFiles;
+
+
+
+/** Initialize sequence of frames of files @a paths, in order of paths and frames in file. */
+static inline void cvl_sequence_files_init(CVLSequenceFiles * const files,
+                                           const char * const * const paths,
+                                           const size_t path_count)
+{
+    memset(files, 0, sizeof(*files));
+    files->file = cvl_image_file_make_empty();
+    files->paths = paths;
+    files->path_count = path_count;
+}
+
+
+
+/** Close currently open file. */
+static inline void cvl_sequence_files_close(CVLSequenceFiles * const files) {
+    if (files->is_open) {
+        cvl_image_file_close(&files->file);
+        files->is_open = false;
+    }
+}
+
+
+
+/**
+ * CVLSequenceLoadFunction reading frames of CVLSequenceFiles context.
+ *
+ * Frames are copied out of file mapping, so page faults happen on loader thread. Files are opened
+ * one at a time with sequential access advice, copied frames are evicted from page cache mapping.
+ * Files which cannot be opened fail the sequence.
+ */
+static inline CVLSequenceStatus cvl_sequence_files_load(void * const context,
+                                                        const uint64_t index,
+                                                        CVLImageBuffer * const frame)
+{
+    CVL_UNUSED(index);
+    CVLSequenceFiles * const files = (CVLSequenceFiles *)context;
+    while (!files->is_open || files->frame_index == cvl_image_file_frame_count(&files->file)) {
+        if (files->is_open) {
+            cvl_sequence_files_close(files);
+            ++files->path_index;
+        }
+        if (files->path_index == files->path_count) {
+            return CVL_SEQUENCE_END;
+        }
+        if (!cvl_image_file_open(&files->file, files->paths[files->path_index], false)) {
+            return CVL_SEQUENCE_ERROR;
+        }
+        files->is_open = true;
+        files->frame_index = 0;
+        cvl_image_file_advise(&files->file, CVL_IMAGE_FILE_ADVICE_SEQUENTIAL);
+    }
+
+    const CVLImageBuffer source = cvl_image_file_frame(&files->file, files->frame_index);
+    const CVLImageBytesCount pixel_size = files->file.header.pixel_size;
+    cvl_image_reuse(frame, source.height, source.width, pixel_size);
+    if (!frame->data) {
+        return CVL_SEQUENCE_ERROR;
+    }
+    cvl_image_copy(&source, frame, pixel_size);
+    cvl_image_file_evict_frames(&files->file, files->frame_index, 1);
+    ++files->frame_index;
+    return CVL_SEQUENCE_FRAME;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_SEQUENCE_H
@@ -0,0 +1,548 @@
+#ifndef CVL_IMAGE_STATS_H
+#define CVL_IMAGE_STATS_H
+
+
+#include "cvl_image_parallel.h"
+#include "cvl_simd.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/*
+ * Image statistics.
+ *
+ * cvl_image_stats computes count, min, max, sum and sum of squares of every channel, and optionally
+ * the histogram of 8 bit channels, in a single pass over the image. Source may be any ROI, for
+ * example a view from cvl_image_subimage, and an optional Pixel_8 mask selects counted pixels.
+ *
+ * Rows are split into balanced bands, each band accumulates its own partial statistics which are
+ * merged in band order, so results do not depend on the number of threads.
+ *
+ * Histograms of Pixel_8 are counted into 8 interleaved sub-histograms, so runs of equal pixels do
+ * not serialize on increments of one counter. With histogram requested, min, max, sum and sum of
+ * squares of 8 bit channels are derived from the merged histogram instead of being accumulated.
+ */
+
+/** Maximal number of channels of statistics. */
+#define CVL_STATS_MAX_CHANNELS 4
+
+/** Number of histogram bins of 8 bit channels. */
+#define CVL_STATS_HISTOGRAM_BINS 256
+
+/** Number of pixels counted by 32 bit band histograms before they are flushed into the partial. */
+#define CVL_STATS_HISTOGRAM_FLUSH_PIXELS ((uint64_t)1 << 30)
+
+/** Number of SSE2 vectors accumulated into 32 bit sums of squares before they are widened. */
+#define CVL_STATS_SQUARES_FLUSH_VECTORS 4096
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Statistics of image channels. */
+typedef struct {
+    int channels;                   ///< Number of channels: 4 for Pixel_8888, otherwise 1.
+    uint64_t count;                 ///< Number of counted pixels.
+    double min[CVL_STATS_MAX_CHANNELS];          ///< Minimum, 0 if no pixel was counted.
+    double max[CVL_STATS_MAX_CHANNELS];          ///< Maximum, 0 if no pixel was counted.
+    double sum[CVL_STATS_MAX_CHANNELS];
+    double sum_squares[CVL_STATS_MAX_CHANNELS];
+    bool has_histogram;
+    uint64_t histogram[CVL_STATS_MAX_CHANNELS][CVL_STATS_HISTOGRAM_BINS];  ///< Valid if has_histogram.
+} CVLImageStats;
+
+
+
+/** Return mean of channel. */
+static inline double cvl_image_stats_mean(const CVLImageStats * const stats, const int channel) {
+    return stats->count ? stats->sum[channel] / (double)stats->count : 0.0;
+}
+
+
+
+/** Return population variance of channel. */
+static inline double cvl_image_stats_variance(const CVLImageStats * const stats, const int channel) {
+    if (!stats->count) {
+        return 0.0;
+    }
+    const double mean = cvl_image_stats_mean(stats, channel);
+    const double variance = stats->sum_squares[channel] / (double)stats->count - mean * mean;
+    return variance > 0.0 ? variance : 0.0;
+}
+
+
+
+/** Return population standard deviation of channel. */
+static inline double cvl_image_stats_stddev(const CVLImageStats * const stats, const int channel) {
+    return sqrt(cvl_image_stats_variance(stats, channel));
+}
+
+
+
+/**
+ * Return smallest value v of channel such that at least @a fraction of counted pixels are <= v.
+ * Statistics must have histogram.
+ */
+static inline int cvl_image_stats_percentile(const CVLImageStats * const stats, const int channel, const double fraction) {
+    assert(stats->has_histogram);
+    const double target = fraction * (double)stats->count;
+    uint64_t cumulative = 0;
+    for (int v = 0; v < CVL_STATS_HISTOGRAM_BINS; ++v) {
+        cumulative += stats->histogram[channel][v];
+        if ((double)cumulative >= target && cumulative) {
+            return v;
+        }
+    }
+    return CVL_STATS_HISTOGRAM_BINS - 1;
+}
+
+
+
+/*
+ * Row kernels.
+ */
+
+/** Integer accumulators of 8 bit pixels. */
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t sum_squares;
+    int min;
+    int max;
+} CVLStatsSums8;
+
+/** Accumulators of float pixels. */
+typedef struct {
+    uint64_t count;
+    double sum;
+    double sum_squares;
+    float min;
+    float max;
+} CVLStatsSumsF;
+
+
+
+/** Accumulate row of Pixel_8, @a mask may be NULL. */
+static inline void cvl_stats_row_8(const CVLPixel_8 * const CVL_RESTRICT pixels,
+                                   const CVLPixel_8 * const CVL_RESTRICT mask,
+                                   const size_t width,
+                                   CVLStatsSums8 * const sums)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i vmin = _mm_set1_epi8((char)0xFF);
+    __m128i vmax = zero;
+    __m128i vsum = zero;
+    __m128i vsquares = zero;
+    __m128i squares32 = zero;
+    __m128i excluded_count = zero;
+    size_t pending = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(pixels + x));
+        __m128i v_min = v;
+        if (mask) {
+            // Excluded pixels become 255 for minimum and 0 for everything else.
+            const __m128i excluded = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(mask + x)), zero);
+            excluded_count = _mm_add_epi64(excluded_count, _mm_sad_epu8(_mm_and_si128(excluded, _mm_set1_epi8(1)), zero));
+            v_min = _mm_or_si128(v, excluded);
+            v = _mm_andnot_si128(excluded, v);
+        }
+        vmin = _mm_min_epu8(vmin, v_min);
+        vmax = _mm_max_epu8(vmax, v);
+        vsum = _mm_add_epi64(vsum, _mm_sad_epu8(v, zero));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero);
+        const __m128i hi = _mm_unpackhi_epi8(v, zero);
+        squares32 = _mm_add_epi32(squares32, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        if (++pending == CVL_STATS_SQUARES_FLUSH_VECTORS) {
+            vsquares = _mm_add_epi64(vsquares, _mm_add_epi64(_mm_unpacklo_epi32(squares32, zero),
+                                                             _mm_unpackhi_epi32(squares32, zero)));
+            squares32 = zero;
+            pending = 0;
+        }
+    }
+    if (x) {
+        vsquares = _mm_add_epi64(vsquares, _mm_add_epi64(_mm_unpacklo_epi32(squares32, zero),
+                                                         _mm_unpackhi_epi32(squares32, zero)));
+        uint8_t bytes_min[16];
+        uint8_t bytes_max[16];
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)bytes_min, vmin);
+        _mm_storeu_si128((__m128i *)bytes_max, vmax);
+        for (int i = 0; i < 16; ++i) {
+            sums->min = bytes_min[i] < sums->min ? bytes_min[i] : sums->min;
+            sums->max = bytes_max[i] > sums->max ? bytes_max[i] : sums->max;
+        }
+        _mm_storeu_si128((__m128i *)lanes, vsum);
+        sums->sum += lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i *)lanes, vsquares);
+        sums->sum_squares += lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i *)lanes, excluded_count);
+        sums->count += x - (lanes[0] + lanes[1]);
+    }
+#endif
+    for (; x < width; ++x) {
+        if (mask && !mask[x]) {
+            continue;
+        }
+        const int v = pixels[x];
+        sums->min = v < sums->min ? v : sums->min;
+        sums->max = v > sums->max ? v : sums->max;
+        sums->sum += (uint64_t)v;
+        sums->sum_squares += (uint64_t)(v * v);
+        ++sums->count;
+    }
+}
+
+
+
+/** Accumulate row of Pixel_F, @a mask may be NULL. */
+static inline void cvl_stats_row_F(const CVLPixel_F * const CVL_RESTRICT pixels,
+                                   const CVLPixel_8 * const CVL_RESTRICT mask,
+                                   const size_t width,
+                                   CVLStatsSumsF * const sums)
+{
+    size_t x = 0;
+#if CVL_SIMD_SSE2
+    const __m128 infinity = _mm_set1_ps(HUGE_VALF);
+    const __m128 minus_infinity = _mm_set1_ps(-HUGE_VALF);
+    __m128 vmin = infinity;
+    __m128 vmax = minus_infinity;
+    __m128d vsum = _mm_setzero_pd();
+    __m128d vsquares = _mm_setzero_pd();
+    __m128i excluded_count = _mm_setzero_si128();  // Excluded lanes are -1, counted by subtraction.
+    for (; x + 4 <= width; x += 4) {
+        __m128 v = _mm_loadu_ps(pixels + x);
+        __m128 v_min = v;
+        __m128 v_max = v;
+        if (mask) {
+            int32_t mask_bytes;
+            memcpy(&mask_bytes, mask + x, sizeof(mask_bytes));
+            const __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(mask_bytes), _mm_setzero_si128()),
+                                                    _mm_setzero_si128());
+            const __m128 excluded = _mm_castsi128_ps(_mm_cmpeq_epi32(wide, _mm_setzero_si128()));
+            excluded_count = _mm_sub_epi32(excluded_count, _mm_castps_si128(excluded));
+            v = _mm_andnot_ps(excluded, v);
+            v_min = _mm_or_ps(_mm_and_ps(excluded, infinity), v);
+            v_max = _mm_or_ps(_mm_and_ps(excluded, minus_infinity), v);
+        }
+        vmin = _mm_min_ps(vmin, v_min);
+        vmax = _mm_max_ps(vmax, v_max);
+        const __m128d lo = _mm_cvtps_pd(v);
+        const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+        vsum = _mm_add_pd(vsum, _mm_add_pd(lo, hi));
+        vsquares = _mm_add_pd(vsquares, _mm_add_pd(_mm_mul_pd(lo, lo), _mm_mul_pd(hi, hi)));
+    }
+    if (x) {
+        float lanes_min[4];
+        float lanes_max[4];
+        double lanes[2];
+        uint32_t excluded_lanes[4];
+        _mm_storeu_ps(lanes_min, vmin);
+        _mm_storeu_ps(lanes_max, vmax);
+        for (int i = 0; i < 4; ++i) {
+            sums->min = lanes_min[i] < sums->min ? lanes_min[i] : sums->min;
+            sums->max = lanes_max[i] > sums->max ? lanes_max[i] : sums->max;
+        }
+        _mm_storeu_pd(lanes, vsum);
+        sums->sum += lanes[0] + lanes[1];
+        _mm_storeu_pd(lanes, vsquares);
+        sums->sum_squares += lanes[0] + lanes[1];
+        _mm_storeu_si128((__m128i *)excluded_lanes, excluded_count);
+        sums->count += x - ((size_t)excluded_lanes[0] + excluded_lanes[1] + excluded_lanes[2] + excluded_lanes[3]);
+    }
+#endif
+    for (; x < width; ++x) {
+        if (mask && !mask[x]) {
+            continue;
+        }
+        const float v = pixels[x];
+        sums->min = v < sums->min ? v : sums->min;
+        sums->max = v > sums->max ? v : sums->max;
+        sums->sum += (double)v;
+        sums->sum_squares += (double)v * (double)v;
+        ++sums->count;
+    }
+}
+
+
+
+/** Count row of Pixel_8 into 8 sub-histograms, @a mask may be NULL. */
+static inline void cvl_stats_histogram_row_8(const CVLPixel_8 * const CVL_RESTRICT pixels,
+                                             const CVLPixel_8 * const CVL_RESTRICT mask,
+                                             const size_t width,
+                                             uint32_t (* const CVL_RESTRICT histograms)[CVL_STATS_HISTOGRAM_BINS])
+{
+    size_t x = 0;
+    if (mask) {
+        for (; x + 4 <= width; x += 4) {
+            histograms[0][pixels[x]] += mask[x] != 0;
+            histograms[1][pixels[x + 1]] += mask[x + 1] != 0;
+            histograms[2][pixels[x + 2]] += mask[x + 2] != 0;
+            histograms[3][pixels[x + 3]] += mask[x + 3] != 0;
+        }
+        for (; x < width; ++x) {
+            histograms[0][pixels[x]] += mask[x] != 0;
+        }
+        return;
+    }
+    for (; x + 8 <= width; x += 8) {
+        uint32_t quads[2];
+        memcpy(quads, pixels + x, sizeof(quads));
+        ++histograms[0][quads[0] & 0xFF];
+        ++histograms[1][(quads[0] >> 8) & 0xFF];
+        ++histograms[2][(quads[0] >> 16) & 0xFF];
+        ++histograms[3][quads[0] >> 24];
+        ++histograms[4][quads[1] & 0xFF];
+        ++histograms[5][(quads[1] >> 8) & 0xFF];
+        ++histograms[6][(quads[1] >> 16) & 0xFF];
+        ++histograms[7][quads[1] >> 24];
+    }
+    for (; x < width; ++x) {
+        ++histograms[0][pixels[x]];
+    }
+}
+
+
+
+/**
+ * Count row of Pixel_8888 into per channel histograms, @a mask may be NULL.
+ * Channel c of even pixels goes to histograms[c], of odd pixels to histograms[4 + c].
+ */
+static inline void cvl_stats_histogram_row_8888(const CVLPixel_8 * const CVL_RESTRICT pixels,
+                                                const CVLPixel_8 * const CVL_RESTRICT mask,
+                                                const size_t width,
+                                                uint32_t (* const CVL_RESTRICT histograms)[CVL_STATS_HISTOGRAM_BINS])
+{
+    for (size_t x = 0; x < width; ++x) {
+        const CVLPixel_8 * const p = pixels + 4 * x;
+        uint32_t (* const h)[CVL_STATS_HISTOGRAM_BINS] = histograms + 4 * (x & 1);
+        const uint32_t weight = mask ? mask[x] != 0 : 1;
+        h[0][p[0]] += weight;
+        h[1][p[1]] += weight;
+        h[2][p[2]] += weight;
+        h[3][p[3]] += weight;
+    }
+}
+
+
+
+/*
+ * Bands.
+ */
+
+/** Context of statistics band tasks. */
+typedef struct {
+    const CVLImageBuffer *source;
+    const CVLImageBuffer *mask;
+    CVLPixelType type;
+    bool histogram;
+    size_t grain;                   ///< Rows per band.
+    CVLImageStats *partials;        ///< One per band.
+} CVLImageStatsBands;
+
+
+
+/** Add 32 bit band histograms into partial and clear them. */
+static inline void cvl_stats_flush_histograms(const CVLImageStatsBands * const bands,
+                                              uint32_t (* const histograms)[CVL_STATS_HISTOGRAM_BINS],
+                                              CVLImageStats * const partial)
+{
+    for (int h = 0; h < 8; ++h) {
+        // Pixel_8 counts into 8 sub-histograms of channel 0, Pixel_8888 into 2 of every channel.
+        const int channel = bands->type == CVL_PIXEL_TYPE_8 ? 0 : h & 3;
+        for (int v = 0; v < CVL_STATS_HISTOGRAM_BINS; ++v) {
+            partial->histogram[channel][v] += histograms[h][v];
+        }
+    }
+    memset(histograms, 0, 8 * CVL_STATS_HISTOGRAM_BINS * sizeof(uint32_t));
+}
+
+
+
+static inline void cvl_stats_band(void * const context, const size_t begin, const size_t end) {
+    const CVLImageStatsBands * const bands = (const CVLImageStatsBands *)context;
+    const CVLImageBuffer * const source = bands->source;
+    const CVLImageBuffer * const mask = bands->mask;
+    CVLImageStats * const partial = bands->partials + begin / bands->grain;
+    const size_t width = source->width;
+
+    if (bands->type == CVL_PIXEL_TYPE_F) {
+        CVLStatsSumsF sums = {0, 0.0, 0.0, HUGE_VALF, -HUGE_VALF};
+        for (size_t y = begin; y < end; ++y) {
+            cvl_stats_row_F(CVL_GET_LINE(const CVLPixel_F, source, y), mask ? CVL_GET_LINE(const CVLPixel_8, mask, y) : NULL,
+                            width, &sums);
+        }
+        partial->count = sums.count;
+        partial->min[0] = sums.min;
+        partial->max[0] = sums.max;
+        partial->sum[0] = sums.sum;
+        partial->sum_squares[0] = sums.sum_squares;
+        return;
+    }
+
+    if (!bands->histogram && bands->type == CVL_PIXEL_TYPE_8) {
+        CVLStatsSums8 sums = {0, 0, 0, 255, 0};
+        for (size_t y = begin; y < end; ++y) {
+            cvl_stats_row_8(CVL_GET_LINE(const CVLPixel_8, source, y), mask ? CVL_GET_LINE(const CVLPixel_8, mask, y) : NULL,
+                            width, &sums);
+        }
+        partial->count = sums.count;
+        partial->min[0] = sums.min;
+        partial->max[0] = sums.max;
+        partial->sum[0] = (double)sums.sum;
+        partial->sum_squares[0] = (double)sums.sum_squares;
+        return;
+    }
+
+    // 8 bit histograms, moments are derived after merge.
+    uint32_t histograms[8][CVL_STATS_HISTOGRAM_BINS];
+    memset(histograms, 0, sizeof(histograms));
+    uint64_t pending = 0;
+    for (size_t y = begin; y < end; ++y) {
+        const CVLPixel_8 * const row = CVL_GET_LINE(const CVLPixel_8, source, y);
+        const CVLPixel_8 * const mask_row = mask ? CVL_GET_LINE(const CVLPixel_8, mask, y) : NULL;
+        if (bands->type == CVL_PIXEL_TYPE_8) {
+            cvl_stats_histogram_row_8(row, mask_row, width, histograms);
+        }
+        else {
+            cvl_stats_histogram_row_8888(row, mask_row, width, histograms);
+        }
+        pending += width;
+        if (pending >= CVL_STATS_HISTOGRAM_FLUSH_PIXELS) {
+            cvl_stats_flush_histograms(bands, histograms, partial);
+            pending = 0;
+        }
+    }
+    cvl_stats_flush_histograms(bands, histograms, partial);
+}
+
+
+
+/** Derive count and moments of 8 bit channels from histogram. */
+static inline void cvl_stats_from_histogram(CVLImageStats * const stats) {
+    for (int c = 0; c < stats->channels; ++c) {
+        uint64_t count = 0;
+        double sum = 0.0;
+        double sum_squares = 0.0;
+        int min = -1;
+        int max = 0;
+        for (int v = 0; v < CVL_STATS_HISTOGRAM_BINS; ++v) {
+            const uint64_t n = stats->histogram[c][v];
+            if (n) {
+                min = min < 0 ? v : min;
+                max = v;
+                count += n;
+                sum += (double)n * v;
+                sum_squares += (double)n * (v * v);
+            }
+        }
+        stats->count = count;
+        stats->min[c] = min < 0 ? 0 : min;
+        stats->max[c] = max;
+        stats->sum[c] = sum;
+        stats->sum_squares[c] = sum_squares;
+    }
+}
+
+
+
+/**
+ * Compute statistics of image in one pass.
+ *
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ * @param source Pixel_8, Pixel_8888 or Pixel_F image.
+ * @param mask Pixel_8 image of source size or NULL, pixels with zero mask are not counted.
+ * @param histogram Compute histograms, 8 bit types only.
+ * @return false for unsupported type, histogram of Pixel_F or allocation failure.
+ */
+static inline bool cvl_image_stats(CVLThreadPool * const pool,
+                                   const CVLImageBuffer * const source,
+                                   const CVLImageBuffer * const mask,
+                                   const CVLPixelType type,
+                                   const bool histogram,
+                                   CVLImageStats * const stats)
+{
+    if ((type != CVL_PIXEL_TYPE_8 && type != CVL_PIXEL_TYPE_8888 && type != CVL_PIXEL_TYPE_F) ||
+        (histogram && type == CVL_PIXEL_TYPE_F))
+    {
+        return false;
+    }
+    assert(cvl_image_is_good(source, cvl_pixel_type_size(type)));
+    assert(!mask || (cvl_image_is_good(mask, CVLPixel_8_sz) &&
+                     mask->height == source->height && mask->width == source->width));
+
+    CVLImageStatsBands bands;
+    bands.source = source;
+    bands.mask = mask;
+    bands.type = type;
+    // Pixel_8888 statistics always come from histograms.
+    bands.histogram = histogram || type == CVL_PIXEL_TYPE_8888;
+    const size_t height = source->height;
+    const size_t image_bytes = height * source->width * cvl_pixel_type_size(type);
+    size_t band_count = image_bytes < CVL_PARALLEL_MIN_IMAGE_BYTES ? 1 :
+                        cvl_thread_pool_thread_count(pool) * CVL_PARALLEL_BANDS_PER_THREAD;
+    band_count = band_count < height ? band_count : (height ? height : 1);
+    bands.grain = height ? (height + band_count - 1) / band_count : 1;
+    band_count = height ? (height + bands.grain - 1) / bands.grain : 1;
+
+    CVLImageStats * const partials = band_count > 1 ? (CVLImageStats *)calloc(band_count, sizeof(CVLImageStats)) : stats;
+    if (!partials) {
+        return false;
+    }
+    if (partials == stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    bands.partials = partials;
+    if (height) {
+        cvl_parallel_for(pool, height, bands.grain, cvl_stats_band, &bands);
+    }
+
+    // Merge partials in band order.
+    if (partials != stats) {
+        memset(stats, 0, sizeof(*stats));
+        stats->min[0] = HUGE_VAL;
+        stats->max[0] = -HUGE_VAL;
+        for (size_t i = 0; i < band_count; ++i) {
+            const CVLImageStats * const partial = partials + i;
+            if (bands.histogram) {
+                for (int c = 0; c < CVL_STATS_MAX_CHANNELS; ++c) {
+                    for (int v = 0; v < CVL_STATS_HISTOGRAM_BINS; ++v) {
+                        stats->histogram[c][v] += partial->histogram[c][v];
+                    }
+                }
+            }
+            else if (partial->count) {
+                stats->count += partial->count;
+                stats->min[0] = partial->min[0] < stats->min[0] ? partial->min[0] : stats->min[0];
+                stats->max[0] = partial->max[0] > stats->max[0] ? partial->max[0] : stats->max[0];
+                stats->sum[0] += partial->sum[0];
+                stats->sum_squares[0] += partial->sum_squares[0];
+            }
+        }
+        free(partials);
+    }
+
+    stats->channels = type == CVL_PIXEL_TYPE_8888 ? 4 : 1;
+    stats->has_histogram = histogram;
+    if (bands.histogram) {
+        cvl_stats_from_histogram(stats);
+        if (!histogram) {
+            memset(stats->histogram, 0, sizeof(stats->histogram));
+        }
+    }
+    if (!stats->count) {
+        stats->min[0] = 0.0;
+        stats->max[0] = 0.0;
+    }
+    return true;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_STATS_H
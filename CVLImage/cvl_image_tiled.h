@@ -0,0 +1,389 @@
+#ifndef CVL_IMAGE_TILED_H
+#define CVL_IMAGE_TILED_H
+
+
+#include "cvl_image_parallel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Default tile height and width in pixels. */
+#define CVL_TILED_DEFAULT_TILE_SIZE 64
+
+/**
+ * Image stored as a grid of tiles, each tile occupies one contiguous aligned memory block.
+ *
+ * Tiles are stored in row-major tile order. Every tile has full tile size in memory, tiles on the
+ * right and bottom edges only have part of it inside the image. A tile is accessed as a regular
+ * CVLImageBuffer with rowBytes equal to tile_row_bytes, so all image routines and
+ * cvl_image_subimage work on tiles directly.
+ *
+ * @see cvl_tiled_image_create
+ */
+typedef struct {
+    void *data;                       ///< First tile.
+    CVLImagePixelCount height;        ///< Image height.
+    CVLImagePixelCount width;         ///< Image width.
+    CVLImageBytesCount pixel_size;    ///< Pixel memory size.
+    CVLImagePixelCount tile_height;   ///< Tile height.
+    CVLImagePixelCount tile_width;    ///< Tile width.
+    CVLImagePixelCount tiles_y;       ///< Number of tile rows.
+    CVLImagePixelCount tiles_x;       ///< Number of tile columns.
+    CVLImageBytesCount tile_row_bytes; ///< Bytes per tile row.
+    CVLImageBytesCount tile_bytes;    ///< Bytes between consecutive tiles.
+} CVLTiledImage;
+
+/** Tile visited by CVLTileIterator. */
+typedef struct {
+    const CVLTiledImage *image;
+    CVLImagePixelCount index;  ///< Row-major tile index, tiles_x * tiles_y after the last tile.
+    CVLImagePixelCount tx;     ///< Tile column.
+    CVLImagePixelCount ty;     ///< Tile row.
+    CVLRect rect;              ///< Tile area in image coordinates.
+    CVLImageBuffer tile;       ///< Tile view.
+} CVLTileIterator;
+
+/** Function processing one tile of tiled image, used with cvl_tiled_image_parallel_for. */
+typedef void (*CVLTileFunction)(void *context,
+                                const CVLTiledImage *image,
+                                CVLImagePixelCount tx,
+                                CVLImagePixelCount ty,
+                                const CVLImageBuffer *tile);
+
+/** Function processing rect of a regular image, used with cvl_image_parallel_for_tiles. */
+typedef void (*CVLRectFunction)(void *context, CVLRect rect);
+
+
+
+/** Return empty tiled image. */
+static inline CVLTiledImage cvl_tiled_image_make_empty(void) {
+    CVLTiledImage image;
+    memset(&image, 0, sizeof(image));
+    return image;
+}
+
+
+
+/**
+ * Create tiled image.
+ *
+ * @param tile_height Tile height, 0 for CVL_TILED_DEFAULT_TILE_SIZE.
+ * @param tile_width Tile width, 0 for CVL_TILED_DEFAULT_TILE_SIZE.
+ * @return Image with NULL data on allocation failure.
+ * @see cvl_tiled_image_release
+ */
+static inline CVLTiledImage cvl_tiled_image_create(const CVLImagePixelCount height,
+                                                   const CVLImagePixelCount width,
+                                                   const CVLImageBytesCount pixel_size,
+                                                   const CVLImagePixelCount tile_height,
+                                                   const CVLImagePixelCount tile_width)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    CVLTiledImage image;
+    image.height = height;
+    image.width = width;
+    image.pixel_size = pixel_size;
+    image.tile_height = tile_height ? tile_height : CVL_TILED_DEFAULT_TILE_SIZE;
+    image.tile_width = tile_width ? tile_width : CVL_TILED_DEFAULT_TILE_SIZE;
+    image.tiles_y = (height + image.tile_height - 1) / image.tile_height;
+    image.tiles_x = (width + image.tile_width - 1) / image.tile_width;
+    image.tile_row_bytes = image.tile_width * pixel_size;
+    image.tile_bytes = (image.tile_row_bytes * image.tile_height + CVL_IMAGE_DEFAULT_ALIGNMENT - 1) &
+                       ~(CVLImageBytesCount)(CVL_IMAGE_DEFAULT_ALIGNMENT - 1);
+    image.data = cvl_image_data_alloc((size_t)image.tile_bytes * image.tiles_x * image.tiles_y,
+                                      CVL_IMAGE_DEFAULT_ALIGNMENT);
+    return image;
+}
+
+
+
+/** Release tiled image memory. */
+static inline void cvl_tiled_image_release(CVLTiledImage * const image) {
+    cvl_image_data_free(image->data);
+    *image = cvl_tiled_image_make_empty();
+}
+
+
+
+/** Return number of tiles. */
+static inline CVLImagePixelCount cvl_tiled_image_tile_count(const CVLTiledImage * const image) {
+    return image->tiles_x * image->tiles_y;
+}
+
+
+
+/** Return area of tile in image coordinates, clipped to image size. */
+static inline CVLRect cvl_tiled_image_tile_rect(const CVLTiledImage * const image,
+                                                const CVLImagePixelCount tx,
+                                                const CVLImagePixelCount ty)
+{
+    assert(tx < image->tiles_x && ty < image->tiles_y);
+    const CVLImagePixelCount x = tx * image->tile_width;
+    const CVLImagePixelCount y = ty * image->tile_height;
+    const CVLImagePixelCount width = image->width - x < image->tile_width ? image->width - x : image->tile_width;
+    const CVLImagePixelCount height = image->height - y < image->tile_height ? image->height - y : image->tile_height;
+    return cvl_rect_make((int)x, (int)y, (int)width, (int)height);
+}
+
+
+
+/** Return view of tile, clipped to image size. */
+static inline CVLImageBuffer cvl_tiled_image_tile(const CVLTiledImage * const image,
+                                                  const CVLImagePixelCount tx,
+                                                  const CVLImagePixelCount ty)
+{
+    const CVLRect rect = cvl_tiled_image_tile_rect(image, tx, ty);
+    CVLImageBuffer tile;
+    tile.data = (CVLPixel_8 *)image->data + (size_t)image->tile_bytes * (ty * image->tiles_x + tx);
+    tile.height = (CVLImagePixelCount)rect.height;
+    tile.width = (CVLImagePixelCount)rect.width;
+    tile.rowBytes = image->tile_row_bytes;
+    return tile;
+}
+
+
+
+/** Return subimage of regular image covering the same area as tile of tiled image. */
+static inline CVLImageBuffer cvl_tiled_image_tile_subimage(const CVLTiledImage * const tiled_image,
+                                                           const CVLImageBuffer * const image,
+                                                           const CVLImagePixelCount tx,
+                                                           const CVLImagePixelCount ty)
+{
+    assert(image->height == tiled_image->height && image->width == tiled_image->width);
+    return cvl_image_subimage(image, cvl_tiled_image_tile_rect(tiled_image, tx, ty), tiled_image->pixel_size);
+}
+
+
+
+/**
+ * Initialize tile iterator.
+ *
+ * Usage.
+ * CVLTileIterator it;
+ * for (cvl_tile_iterator_init(&it, &image); cvl_tile_iterator_next(&it);) {
+ *     ...it.tile, it.rect...
+ * }
+ */
+static inline void cvl_tile_iterator_init(CVLTileIterator * const iterator, const CVLTiledImage * const image) {
+    memset(iterator, 0, sizeof(*iterator));
+    iterator->image = image;
+    iterator->index = (CVLImagePixelCount)-1;
+}
+
+
+
+/** Advance iterator to the next tile in row-major order. @return false after the last tile. */
+static inline bool cvl_tile_iterator_next(CVLTileIterator * const iterator) {
+    const CVLTiledImage * const image = iterator->image;
+    iterator->index += 1;
+    if (iterator->index >= cvl_tiled_image_tile_count(image)) {
+        iterator->index = cvl_tiled_image_tile_count(image);
+        return false;
+    }
+    iterator->tx = iterator->index % image->tiles_x;
+    iterator->ty = iterator->index / image->tiles_x;
+    iterator->rect = cvl_tiled_image_tile_rect(image, iterator->tx, iterator->ty);
+    iterator->tile = cvl_tiled_image_tile(image, iterator->tx, iterator->ty);
+    return true;
+}
+
+
+
+/** Return number of items per parallel chunk giving each pool thread several chunks. */
+static inline size_t cvl_tiled_parallel_grain(const CVLThreadPool * const pool, const size_t count) {
+    const size_t chunks = cvl_thread_pool_thread_count(pool) * CVL_PARALLEL_BANDS_PER_THREAD;
+    const size_t grain = count / chunks;
+    return grain ? grain : 1;
+}
+
+
+
+/** Context of cvl_tiled_image_parallel_for chunks. */
+typedef struct {
+    const CVLTiledImage *image;
+    CVLTileFunction function;
+    void *context;
+} CVLTiledImageTasks;
+
+
+
+static inline void cvl_tiled_image_task(void * const context, const size_t begin, const size_t end) {
+    const CVLTiledImageTasks * const tasks = (const CVLTiledImageTasks *)context;
+    const CVLTiledImage * const image = tasks->image;
+    for (size_t index = begin; index < end; ++index) {
+        const CVLImagePixelCount tx = (CVLImagePixelCount)(index % image->tiles_x);
+        const CVLImagePixelCount ty = (CVLImagePixelCount)(index / image->tiles_x);
+        const CVLImageBuffer tile = cvl_tiled_image_tile(image, tx, ty);
+        tasks->function(tasks->context, image, tx, ty, &tile);
+    }
+}
+
+
+
+/**
+ * Execute @a function for every tile of tiled image, each thread receives whole tiles.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ */
+static inline void cvl_tiled_image_parallel_for(CVLThreadPool * const pool,
+                                                const CVLTiledImage * const image,
+                                                const CVLTileFunction function,
+                                                void * const context)
+{
+    CVLTiledImageTasks tasks;
+    tasks.image = image;
+    tasks.function = function;
+    tasks.context = context;
+    const size_t count = cvl_tiled_image_tile_count(image);
+    cvl_parallel_for(pool, count, cvl_tiled_parallel_grain(pool, count), cvl_tiled_image_task, &tasks);
+}
+
+
+
+/** Context of cvl_image_parallel_for_tiles chunks. */
+typedef struct {
+    CVLImagePixelCount height;
+    CVLImagePixelCount width;
+    CVLImagePixelCount tile_height;
+    CVLImagePixelCount tile_width;
+    CVLImagePixelCount tiles_x;
+    CVLRectFunction function;
+    void *context;
+} CVLImageTileTasks;
+
+
+
+static inline void cvl_image_tile_task(void * const context, const size_t begin, const size_t end) {
+    const CVLImageTileTasks * const tasks = (const CVLImageTileTasks *)context;
+    for (size_t index = begin; index < end; ++index) {
+        const CVLImagePixelCount x = (CVLImagePixelCount)(index % tasks->tiles_x) * tasks->tile_width;
+        const CVLImagePixelCount y = (CVLImagePixelCount)(index / tasks->tiles_x) * tasks->tile_height;
+        const CVLImagePixelCount width = tasks->width - x < tasks->tile_width ? tasks->width - x : tasks->tile_width;
+        const CVLImagePixelCount height = tasks->height - y < tasks->tile_height ? tasks->height - y : tasks->tile_height;
+        tasks->function(tasks->context, cvl_rect_make((int)x, (int)y, (int)width, (int)height));
+    }
+}
+
+
+
+/**
+ * Execute @a function for every tile sized rect of a regular height x width image.
+ *
+ * Each thread receives whole tiles, which suits column oriented processing (transposes, rotations,
+ * vertical filters) better than row bands.
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ * @param tile_height Tile height, 0 for CVL_TILED_DEFAULT_TILE_SIZE.
+ * @param tile_width Tile width, 0 for CVL_TILED_DEFAULT_TILE_SIZE.
+ */
+static inline void cvl_image_parallel_for_tiles(CVLThreadPool * const pool,
+                                                const CVLImagePixelCount height,
+                                                const CVLImagePixelCount width,
+                                                const CVLImagePixelCount tile_height,
+                                                const CVLImagePixelCount tile_width,
+                                                const CVLRectFunction function,
+                                                void * const context)
+{
+    CVLImageTileTasks tasks;
+    tasks.height = height;
+    tasks.width = width;
+    tasks.tile_height = tile_height ? tile_height : CVL_TILED_DEFAULT_TILE_SIZE;
+    tasks.tile_width = tile_width ? tile_width : CVL_TILED_DEFAULT_TILE_SIZE;
+    tasks.tiles_x = (width + tasks.tile_width - 1) / tasks.tile_width;
+    tasks.function = function;
+    tasks.context = context;
+    const size_t count = (size_t)tasks.tiles_x * ((height + tasks.tile_height - 1) / tasks.tile_height);
+    cvl_parallel_for(pool, count, cvl_tiled_parallel_grain(pool, count), cvl_image_tile_task, &tasks);
+}
+
+
+
+/** Context of tiled image conversions. */
+typedef struct {
+    const CVLImageBuffer *image;
+    bool to_tiled;
+} CVLTiledImageConversion;
+
+
+
+static inline void cvl_tiled_image_convert_tile(void * const context,
+                                                const CVLTiledImage * const tiled_image,
+                                                const CVLImagePixelCount tx,
+                                                const CVLImagePixelCount ty,
+                                                const CVLImageBuffer * const tile)
+{
+    const CVLTiledImageConversion * const conversion = (const CVLTiledImageConversion *)context;
+    const CVLImageBuffer region = cvl_tiled_image_tile_subimage(tiled_image, conversion->image, tx, ty);
+    const size_t row_bytes = tile->width * tiled_image->pixel_size;
+    if (conversion->to_tiled) {
+        cvl_simd_copy_rows((CVLPixel_8 *)tile->data, tile->rowBytes,
+                           (const CVLPixel_8 *)region.data, region.rowBytes, row_bytes, tile->height);
+    }
+    else {
+        cvl_simd_copy_rows((CVLPixel_8 *)region.data, region.rowBytes,
+                           (const CVLPixel_8 *)tile->data, tile->rowBytes, row_bytes, tile->height);
+    }
+}
+
+
+
+/**
+ * Copy regular image into tiled image of the same size and pixel size.
+ * @param pool Thread pool or NULL to copy on the calling thread.
+ */
+static inline void cvl_tiled_image_from_image(CVLThreadPool * const pool,
+                                              const CVLImageBuffer * const source_image,
+                                              const CVLTiledImage * const dest_image)
+{
+    assert(cvl_image_is_good(source_image, dest_image->pixel_size));
+    assert(source_image->height == dest_image->height && source_image->width == dest_image->width);
+    CVLTiledImageConversion conversion;
+    conversion.image = source_image;
+    conversion.to_tiled = true;
+    cvl_tiled_image_parallel_for(pool, dest_image, cvl_tiled_image_convert_tile, &conversion);
+}
+
+
+
+/**
+ * Copy tiled image into regular image of the same size and pixel size.
+ * @param pool Thread pool or NULL to copy on the calling thread.
+ */
+static inline void cvl_tiled_image_to_image(CVLThreadPool * const pool,
+                                            const CVLTiledImage * const source_image,
+                                            const CVLImageBuffer * const dest_image)
+{
+    assert(cvl_image_is_good(dest_image, source_image->pixel_size));
+    assert(source_image->height == dest_image->height && source_image->width == dest_image->width);
+    CVLTiledImageConversion conversion;
+    conversion.image = dest_image;
+    conversion.to_tiled = false;
+    cvl_tiled_image_parallel_for(pool, source_image, cvl_tiled_image_convert_tile, &conversion);
+}
+
+
+
+/**
+ * Create tiled copy of regular image.
+ * @return Image with NULL data on allocation failure.
+ */
+static inline CVLTiledImage cvl_tiled_image_create_from_image(CVLThreadPool * const pool,
+                                                              const CVLImageBuffer * const source_image,
+                                                              const CVLImageBytesCount pixel_size,
+                                                              const CVLImagePixelCount tile_height,
+                                                              const CVLImagePixelCount tile_width)
+{
+    CVLTiledImage image = cvl_tiled_image_create(source_image->height, source_image->width, pixel_size,
+                                                 tile_height, tile_width);
+    if (image.data) {
+        cvl_tiled_image_from_image(pool, source_image, &image);
+    }
+    return image;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_TILED_H
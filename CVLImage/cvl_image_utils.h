@@ -3,6 +3,7 @@
 
 
 #include "cvl_image.h"
+#include "cvl_simd.h"
 
 #include <assert.h>
 #include <string.h>
@@ -176,6 +177,198 @@ static inline CVLRect cvl_rect_union(const CVLRect a, const CVLRect b) {
 
 
 
+/** Minimal alignment (in bytes) of image data allocated by this library. */
+#define CVL_IMAGE_MIN_ALIGNMENT 16
+
+/** Default alignment (in bytes) of image rows, enough for AVX-512 and cache line sized loads. */
+#define CVL_IMAGE_DEFAULT_ALIGNMENT 64
+
+/**
+ * Row stride which makes consecutive rows map to the same cache sets.
+ *
+ * Rows with stride multiple of this value are padded by one extra alignment unit when
+ * CVL_IMAGE_ROW_PADDING_AVOID_ALIASING policy is used.
+ */
+#define CVL_IMAGE_ALIASING_STRIDE 1024
+
+/** Maximal alignment reported by cvl_image_alignment. */
+#define CVL_IMAGE_MAX_REPORTED_ALIGNMENT 4096
+
+/** Pixel type tag, used where image pixel type is stored or checked at run time. */
+typedef enum {
+    CVL_PIXEL_TYPE_UNKNOWN = 0, ///< Pixel of pixel_size bytes with unspecified meaning.
+    CVL_PIXEL_TYPE_8 = 1,       ///< CVLPixel_8.
+    CVL_PIXEL_TYPE_F = 2,       ///< CVLPixel_F.
+    CVL_PIXEL_TYPE_8888 = 3,    ///< CVLPixel_8888.
+    CVL_PIXEL_TYPE_FFFF = 4,    ///< CVLPixel_FFFF.
+    CVL_PIXEL_TYPE_D = 5,       ///< CVLPixel_D.
+    CVL_PIXEL_TYPE_DDDD = 6     ///< CVLPixel_DDDD.
+} CVLPixelType;
+
+
+
+/** Return memory size of pixel type, 0 for CVL_PIXEL_TYPE_UNKNOWN. */
+static inline CVLImageBytesCount cvl_pixel_type_size(const CVLPixelType type) {
+    switch (type) {
+        case CVL_PIXEL_TYPE_8:    return CVLPixel_8_sz;
+        case CVL_PIXEL_TYPE_F:    return CVLPixel_F_sz;
+        case CVL_PIXEL_TYPE_8888: return CVLPixel_8888_sz;
+        case CVL_PIXEL_TYPE_FFFF: return CVLPixel_FFFF_sz;
+        case CVL_PIXEL_TYPE_D:    return CVLPixel_D_sz;
+        case CVL_PIXEL_TYPE_DDDD: return CVLPixel_DDDD_sz;
+        default:                  return 0;
+    }
+}
+
+
+
+/** Row padding policy of aligned images. */
+typedef enum {
+    CVL_IMAGE_ROW_PADDING_NONE = 0,       ///< No padding, only the first row is aligned (image is continuous).
+    CVL_IMAGE_ROW_PADDING_ALIGN,          ///< Every row start is aligned.
+    CVL_IMAGE_ROW_PADDING_AVOID_ALIASING  ///< Every row start is aligned and stride avoids cache set aliasing.
+} CVLImageRowPadding;
+
+
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+
+/**
+ * Header stored just before data of blocks allocated on Windows.
+ *
+ * Windows has no aligned allocation which can be released by free, so blocks are carved from
+ * malloc blocks and the header tells cvl_image_data_free where the malloc block starts.
+ */
+typedef struct {
+    size_t offset;  ///< Distance from malloc block start to data.
+    size_t magic;   ///< CVL_IMAGE_ALIGNED_MAGIC xor data address, catches foreign pointers in debug.
+} CVLImageAlignedHeader;
+
+/** Marks headers of aligned blocks, mixed with data address so stale values do not match. */
+#define CVL_IMAGE_ALIGNED_MAGIC ((size_t)0x5A17C0DE9E3779B9ull)
+
+#elif !defined(_POSIX_C_SOURCE) || _POSIX_C_SOURCE < 200112L
+int posix_memalign(void **memptr, size_t alignment, size_t size);
+#endif
+
+
+
+/**
+ * Allocate memory for image data.
+ *
+ * @param size Size of memory block in bytes.
+ * @param alignment Power of two alignment of memory block or 0 for default malloc alignment.
+ * @return Pointer to allocated memory or NULL on failure.
+ * @see cvl_image_data_free
+ */
+static inline void *cvl_image_data_alloc(const size_t size, const size_t alignment) {
+    assert(alignment == 0 || (alignment & (alignment - 1)) == 0);
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    const size_t block_alignment = alignment > CVL_IMAGE_MIN_ALIGNMENT ? alignment : CVL_IMAGE_MIN_ALIGNMENT;
+    char * const block = (char *)malloc(sizeof(CVLImageAlignedHeader) + block_alignment + size);
+    if (!block) {
+        return NULL;
+    }
+    const uintptr_t start = (uintptr_t)(block + sizeof(CVLImageAlignedHeader));
+    const uintptr_t aligned = (start + block_alignment - 1) & ~(uintptr_t)(block_alignment - 1);
+    char * const data = block + (aligned - (uintptr_t)block);
+    CVLImageAlignedHeader * const header = (CVLImageAlignedHeader *)data - 1;
+    header->offset = (size_t)(data - block);
+    header->magic = CVL_IMAGE_ALIGNED_MAGIC ^ (size_t)aligned;
+    return data;
+#else
+    if (alignment <= CVL_IMAGE_MIN_ALIGNMENT) {
+        return malloc(size);
+    }
+    void *data = NULL;
+    const size_t posix_alignment = alignment < sizeof(void *) ? sizeof(void *) : alignment;
+    return posix_memalign(&data, posix_alignment, size) == 0 ? data : NULL;
+#endif
+}
+
+
+
+/**
+ * Free memory allocated by cvl_image_data_alloc. Passing NULL does nothing.
+ *
+ * Only blocks of cvl_image_data_alloc may be passed: on Windows they are not malloc blocks.
+ */
+static inline void cvl_image_data_free(void * const data) {
+#if defined(_MSC_VER) || defined(__MINGW32__)
+    if (!data) {
+        return;
+    }
+    CVLImageAlignedHeader * const header = (CVLImageAlignedHeader *)data - 1;
+    assert(header->magic == (CVL_IMAGE_ALIGNED_MAGIC ^ (size_t)(uintptr_t)data));
+    header->magic = 0;
+    free((char *)data - header->offset);
+#else
+    free(data);
+#endif
+}
+
+
+
+/**
+ * Return row size in bytes of image with specified width, pixel size and row padding policy.
+ *
+ * @param alignment Power of two alignment of image rows.
+ */
+static inline CVLImageBytesCount cvl_image_aligned_row_bytes(const CVLImagePixelCount width,
+                                                             const CVLImageBytesCount pixel_size,
+                                                             const CVLImageBytesCount alignment,
+                                                             const CVLImageRowPadding padding)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    CVLImageBytesCount row_bytes = width * pixel_size;
+    if (padding == CVL_IMAGE_ROW_PADDING_NONE) {
+        return row_bytes;
+    }
+    row_bytes = (row_bytes + alignment - 1) & ~(alignment - 1);
+    if (padding == CVL_IMAGE_ROW_PADDING_AVOID_ALIASING && row_bytes % CVL_IMAGE_ALIASING_STRIDE == 0) {
+        row_bytes += alignment;
+    }
+    return row_bytes;
+}
+
+
+
+/** Border extrapolation mode used by filtering and geometric routines. */
+typedef enum {
+    CVL_BORDER_REPLICATE = 0, ///< Repeat edge pixel: aaa|abcd|ddd.
+    CVL_BORDER_REFLECT,       ///< Mirror around edge pixel: cb|abcd|cb.
+    CVL_BORDER_CONSTANT       ///< Pixels outside image have constant value.
+} CVLBorderMode;
+
+
+
+/**
+ * Map coordinate @a i to range [0, n) according to border mode.
+ *
+ * @return Mapped coordinate or -1 if coordinate is outside and border mode is CVL_BORDER_CONSTANT.
+ */
+static inline int cvl_border_index(int i, const int n, const CVLBorderMode border) {
+    if (i >= 0 && i < n) {
+        return i;
+    }
+    switch (border) {
+        case CVL_BORDER_REPLICATE:
+            return i < 0 ? 0 : n - 1;
+        case CVL_BORDER_REFLECT:
+            if (n == 1) {
+                return 0;
+            }
+            while (i < 0 || i >= n) {
+                i = i < 0 ? -i : 2 * (n - 1) - i;
+            }
+            return i;
+        default:
+            return -1;
+    }
+}
+
+
+
 /**
  * Create image by given height, width and pixel size.
  * This function does memory allocation for image data.
@@ -202,6 +395,40 @@ static inline CVLImageBuffer cvl_image_create(const CVLImagePixelCount height,
 
 
 
+/**
+ * Create image with aligned data and padded rows.
+ * This function does memory allocation for image data.
+ *
+ * Image data start is aligned to @a alignment bytes. Row starts are aligned as well unless
+ * @a padding is CVL_IMAGE_ROW_PADDING_NONE. Padded image is not continuous.
+ *
+ * @param alignment Power of two alignment, e.g. CVL_IMAGE_DEFAULT_ALIGNMENT.
+ * @param padding Row padding policy.
+ * @see cvl_image_release_aligned
+ */
+static inline CVLImageBuffer cvl_image_create_aligned(const CVLImagePixelCount height,
+                                                      const CVLImagePixelCount width,
+                                                      const CVLImageBytesCount pixel_size,
+                                                      const CVLImageBytesCount alignment,
+                                                      const CVLImageRowPadding padding)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    const CVLImageBytesCount row_bytes = cvl_image_aligned_row_bytes(width, pixel_size, alignment, padding);
+    void * const data = cvl_image_data_alloc(row_bytes * height, alignment);
+#ifdef _MSC_VER
+    CVLImageBuffer image;
+    image.data = data;
+    image.height = height;
+    image.width = width;
+    image.rowBytes = row_bytes;
+    return image;
+#else
+    return (CVLImageBuffer){data, height, width, row_bytes};
+#endif
+}
+
+
+
 /** Return empty image. */
 static inline CVLImageBuffer cvl_image_make_empty() {
 #ifdef _MSC_VER
@@ -218,7 +445,12 @@ static inline CVLImageBuffer cvl_image_make_empty() {
 
 
 
-/** Release image memory. */
+/**
+ * Release image memory.
+ *
+ * Image data must be allocated by cvl_image_create or by malloc. Images of cvl_image_create_aligned
+ * are released with cvl_image_release_aligned.
+ */
 static inline void cvl_image_release(CVLImageBuffer * const image) {
     if (!image->data) {
         return;
@@ -232,6 +464,14 @@ static inline void cvl_image_release(CVLImageBuffer * const image) {
 
 
 
+/** Release image created with cvl_image_create_aligned or cvl_image_reuse_aligned. */
+static inline void cvl_image_release_aligned(CVLImageBuffer * const image) {
+    cvl_image_data_free(image->data);
+    *image = cvl_image_make_empty();
+}
+
+
+
 /** Check whether image is continuous. */
 static inline bool cvl_image_is_continuous(const CVLImageBuffer * const image,
                                            const CVLImageBytesCount pixel_size)
@@ -241,6 +481,28 @@ static inline bool cvl_image_is_continuous(const CVLImageBuffer * const image,
 
 
 
+/**
+ * Return guaranteed alignment of image rows.
+ *
+ * Result is the largest power of two (up to CVL_IMAGE_MAX_REPORTED_ALIGNMENT) which divides both
+ * data address and rowBytes, so every row start of the image is aligned to it.
+ */
+static inline CVLImageBytesCount cvl_image_alignment(const CVLImageBuffer * const image) {
+    const uintptr_t bits = (uintptr_t)image->data | (uintptr_t)image->rowBytes | CVL_IMAGE_MAX_REPORTED_ALIGNMENT;
+    return (CVLImageBytesCount)(bits & (~bits + 1));
+}
+
+
+
+/** Check whether every row start of image is aligned to @a alignment bytes. */
+static inline bool cvl_image_is_aligned(const CVLImageBuffer * const image,
+                                        const CVLImageBytesCount alignment)
+{
+    return cvl_image_alignment(image) >= alignment;
+}
+
+
+
 /** Check that image is not empty and has good format. */
 static inline bool cvl_image_is_good(const CVLImageBuffer * const image,
                                      const CVLImageBytesCount pixel_size)
@@ -309,7 +571,125 @@ static inline void cvl_image_reuse(CVLImageBuffer * image,
 
 
 
-/** Copy image data. */
+/**
+ * Check if image memory layout is compatible with passed aligned image properties
+ * and reallocate image if it is incompatible.
+ *
+ * Image considered compatible only if it has the same height, width, rowBytes equal to
+ * cvl_image_aligned_row_bytes result and data aligned to @a alignment. Image must be empty or
+ * created by cvl_image_create_aligned, incompatible image is released with cvl_image_release_aligned.
+ * @see cvl_image_create_aligned
+ */
+static inline void cvl_image_reuse_aligned(CVLImageBuffer * image,
+                                           const CVLImagePixelCount height,
+                                           const CVLImagePixelCount width,
+                                           const CVLImageBytesCount pixel_size,
+                                           const CVLImageBytesCount alignment,
+                                           const CVLImageRowPadding padding)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    if (cvl_image_is_good(image, pixel_size) && (image->height == height) && (image->width == width) &&
+        (image->rowBytes == cvl_image_aligned_row_bytes(width, pixel_size, alignment, padding)) &&
+        ((uintptr_t)image->data & (alignment - 1)) == 0)
+        return;
+    cvl_image_release_aligned(image);
+    *image = cvl_image_create_aligned(height, width, pixel_size, alignment, padding);
+}
+
+
+
+/**
+ * Pluggable image allocator.
+ *
+ * Allocator creates images of requested geometry and releases images created by it. Images created
+ * by an allocator must be released by the same allocator.
+ *
+ * @see cvl_image_create_with_allocator
+ * @see cvl_image_release_with_allocator
+ */
+typedef struct {
+    /** Create image of specified geometry. Return empty image on failure. */
+    CVLImageBuffer (*create)(void *context,
+                             CVLImagePixelCount height,
+                             CVLImagePixelCount width,
+                             CVLImageBytesCount pixel_size);
+    /** Release image memory. */
+    void (*release)(void *context, CVLImageBuffer *image);
+    /** Allocator state passed to create and release callbacks. */
+    void *context;
+} CVLImageAllocator;
+
+
+
+/**
+ * Create image using allocator.
+ *
+ * @param allocator Image allocator or NULL to use cvl_image_create.
+ * @see cvl_image_release_with_allocator
+ */
+static inline CVLImageBuffer cvl_image_create_with_allocator(const CVLImageAllocator * const allocator,
+                                                             const CVLImagePixelCount height,
+                                                             const CVLImagePixelCount width,
+                                                             const CVLImageBytesCount pixel_size)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    if (!allocator) {
+        return cvl_image_create(height, width, pixel_size);
+    }
+    return allocator->create(allocator->context, height, width, pixel_size);
+}
+
+
+
+/**
+ * Release image created with allocator.
+ *
+ * @param allocator Image allocator or NULL to use cvl_image_release.
+ */
+static inline void cvl_image_release_with_allocator(const CVLImageAllocator * const allocator,
+                                                    CVLImageBuffer * const image)
+{
+    if (!image->data) {
+        return;
+    }
+    if (!allocator) {
+        cvl_image_release(image);
+        return;
+    }
+    allocator->release(allocator->context, image);
+    *image = cvl_image_make_empty();
+}
+
+
+
+/**
+ * Allocator version of cvl_image_reuse.
+ *
+ * Incompatible image is released and recreated with @a allocator, so @a image must be either empty
+ * or created by the same allocator.
+ */
+static inline void cvl_image_reuse_with_allocator(const CVLImageAllocator * const allocator,
+                                                  CVLImageBuffer * image,
+                                                  const CVLImagePixelCount height,
+                                                  const CVLImagePixelCount width,
+                                                  const CVLImageBytesCount pixel_size)
+{
+    assert(height > 0 && width > 0 && pixel_size > 0);
+    if (cvl_image_is_good(image, pixel_size) && (image->height == height) &&
+        (image->width == width) && (image->rowBytes == width * pixel_size))
+        return;
+    cvl_image_release_with_allocator(allocator, image);
+    *image = cvl_image_create_with_allocator(allocator, height, width, pixel_size);
+}
+
+
+
+/**
+ * Copy image data.
+ *
+ * Narrow strided rows are copied with vector kernels selected at runtime, large destinations are
+ * written with non-temporal stores (see CVL_SIMD_STREAMING_THRESHOLD).
+ */
 static inline void cvl_image_copy(const CVLImageBuffer * const source_image,
                                   CVLImageBuffer * const dest_image,
                                   const CVLImageBytesCount pixel_size)
@@ -319,13 +699,14 @@ static inline void cvl_image_copy(const CVLImageBuffer * const source_image,
     assert(source_image->width == dest_image->width && source_image->height == dest_image->height);
 
     if (cvl_image_is_continuous(source_image, pixel_size) && cvl_image_is_continuous(dest_image, pixel_size)) {
-        memcpy(dest_image->data, source_image->data, source_image->rowBytes * source_image->height);
+        cvl_simd_copy_rows((CVLPixel_8 *)dest_image->data, 0,
+                           (const CVLPixel_8 *)source_image->data, 0,
+                           source_image->rowBytes * source_image->height, 1);
     }
     else {
-        for (CVLImagePixelCount y = 0; y < source_image->height; ++y)
-            memcpy(CVL_GET_LINE(CVLPixel_8, dest_image, y),
-                   CVL_GET_LINE(const CVLPixel_8, source_image, y),
-                   source_image->width * pixel_size);
+        cvl_simd_copy_rows((CVLPixel_8 *)dest_image->data, dest_image->rowBytes,
+                           (const CVLPixel_8 *)source_image->data, source_image->rowBytes,
+                           source_image->width * pixel_size, source_image->height);
     }
 }
 
@@ -343,17 +724,19 @@ static inline CVLImageBuffer cvl_image_create_copy(const CVLImageBuffer * const
 
 
     
-/** Fill image with zeroes. */
+/**
+ * Fill image with zeroes.
+ *
+ * Uses the same row kernels as cvl_image_copy.
+ */
 static inline void cvl_image_clear(const CVLImageBuffer * const image,
                                    const CVLImageBytesCount pixel_size)
 {
     if (cvl_image_is_continuous(image, pixel_size)) {
-        memset(image->data, 0, image->height * image->rowBytes);
+        cvl_simd_clear_rows((CVLPixel_8 *)image->data, 0, image->height * image->rowBytes, 1);
     }
     else {
-        for (CVLImagePixelCount y = 0; y < image->height; ++y) {
-            memset(CVL_GET_LINE(CVLPixel_8, image, y), 0, image->width * pixel_size);
-        }
+        cvl_simd_clear_rows((CVLPixel_8 *)image->data, image->rowBytes, image->width * pixel_size, image->height);
     }
 }
 
@@ -0,0 +1,287 @@
+#ifndef CVL_IMAGE_VIEW_HPP
+#define CVL_IMAGE_VIEW_HPP
+
+#include "cvl_image_utils.h"
+
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+
+
+namespace cvl {
+
+/**
+ * Compile time properties of pixel type.
+ *
+ * Planar pixel types (CVLPixel_8, CVLPixel_F, CVLPixel_D) have one channel, interleaved types
+ * (CVLPixel_8888, CVLPixel_FFFF, CVLPixel_DDDD) are arrays of channels.
+ */
+template <typename PixelT>
+struct PixelTraits {
+    typedef typename std::remove_cv<PixelT>::type Pixel;
+    typedef typename std::remove_all_extents<Pixel>::type Channel; ///< Channel value type.
+
+    static constexpr CVLImageBytesCount pixel_size = sizeof(Pixel);          ///< Pixel memory size.
+    static constexpr size_t channels = sizeof(Pixel) / sizeof(Channel);     ///< Number of channels.
+    static constexpr bool is_interleaved = std::is_array<Pixel>::value;     ///< Pixel is channel array.
+
+    static_assert(std::is_arithmetic<Channel>::value, "pixel channels must be arithmetic values");
+    static_assert(std::rank<Pixel>::value <= 1, "pixel must be a value or one dimensional array");
+};
+
+
+
+/** Row of typed image view, a contiguous range of pixels. */
+template <typename PixelT>
+class ImageRow {
+public:
+    typedef PixelT *iterator;
+
+    ImageRow(PixelT * const data, const CVLImagePixelCount width) : data_(data), width_(width) {}
+
+    PixelT *begin() const { return data_; }
+    PixelT *end() const { return data_ + width_; }
+    CVLImagePixelCount size() const { return width_; }
+
+    /** Return pixel, reference to channel array for interleaved pixels. */
+    PixelT &operator[](const CVLImagePixelCount x) const { return data_[x]; }
+
+private:
+    PixelT *data_;
+    CVLImagePixelCount width_;
+};
+
+
+
+/**
+ * Typed view of CVLImageBuffer.
+ *
+ * Pixel size is known at compile time, so per pixel loops in for_each_pixel and transform are
+ * specialized for each pixel type and auto-vectorized by the compiler. View does not own memory.
+ * Use const pixel type (ImageView<const CVLPixel_F>) for read-only views.
+ *
+ * Interleaved pixels are accessed by reference to channel array:
+ * ImageView<CVLPixel_8888> view(buffer);
+ * CVLPixel_8888 &pixel = view(y, x);
+ * pixel[3] = 255;
+ */
+template <typename PixelT>
+class ImageView {
+public:
+    typedef PixelTraits<PixelT> Traits;
+    typedef PixelT Pixel;
+
+    static constexpr CVLImageBytesCount pixel_size = Traits::pixel_size;
+    static constexpr size_t channels = Traits::channels;
+
+    /** Row iterator. */
+    class RowIterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef ImageRow<PixelT> value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const ImageRow<PixelT> *pointer;
+        typedef ImageRow<PixelT> reference;
+
+        RowIterator(const ImageView * const view, const CVLImagePixelCount y) : view_(view), y_(y) {}
+        ImageRow<PixelT> operator*() const { return ImageRow<PixelT>(view_->row(y_), view_->width()); }
+        RowIterator &operator++() { ++y_; return *this; }
+        RowIterator operator++(int) { RowIterator previous(*this); ++y_; return previous; }
+        bool operator==(const RowIterator &other) const { return y_ == other.y_; }
+        bool operator!=(const RowIterator &other) const { return y_ != other.y_; }
+
+    private:
+        const ImageView *view_;
+        CVLImagePixelCount y_;
+    };
+
+    /** Range of view rows, usable in range-based for. */
+    class RowRange {
+    public:
+        explicit RowRange(const ImageView * const view) : view_(view) {}
+        RowIterator begin() const { return RowIterator(view_, 0); }
+        RowIterator end() const { return RowIterator(view_, view_->height()); }
+
+    private:
+        const ImageView *view_;
+    };
+
+    /** Pixel iterator visiting pixels in row-major order and skipping row padding. */
+    class PixelIterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename Traits::Pixel value_type;
+        typedef ptrdiff_t difference_type;
+        typedef PixelT *pointer;
+        typedef PixelT &reference;
+
+        PixelIterator(const ImageView * const view, const CVLImagePixelCount y)
+            : view_(view), pixel_(y < view->height() ? view->row(y) : NULL), y_(y), x_(0) {}
+        PixelT &operator*() const { return pixel_[x_]; }
+        PixelIterator &operator++() {
+            if (++x_ == view_->width()) {
+                x_ = 0;
+                pixel_ = ++y_ < view_->height() ? view_->row(y_) : NULL;
+            }
+            return *this;
+        }
+        PixelIterator operator++(int) { PixelIterator previous(*this); ++*this; return previous; }
+        bool operator==(const PixelIterator &other) const { return y_ == other.y_ && x_ == other.x_; }
+        bool operator!=(const PixelIterator &other) const { return !(*this == other); }
+
+    private:
+        const ImageView *view_;
+        PixelT *pixel_;
+        CVLImagePixelCount y_;
+        CVLImagePixelCount x_;
+    };
+
+    ImageView() : buffer_(cvl_image_make_empty()) {}
+
+    explicit ImageView(const CVLImageBuffer &buffer) : buffer_(buffer) {
+        assert(!buffer.data || cvl_image_is_good(&buffer, pixel_size));
+    }
+
+    /** Return underlying C image, usable with all cvl_image routines. */
+    const CVLImageBuffer &buffer() const { return buffer_; }
+
+    CVLImagePixelCount height() const { return buffer_.height; }
+    CVLImagePixelCount width() const { return buffer_.width; }
+    CVLImageBytesCount row_bytes() const { return buffer_.rowBytes; }
+    bool empty() const { return buffer_.data == NULL; }
+
+    /** Return true if rows follow each other without padding. */
+    bool is_continuous() const { return buffer_.rowBytes == buffer_.width * pixel_size; }
+
+    /** Return pointer to the first pixel of row @a y. */
+    PixelT *row(const CVLImagePixelCount y) const { return CVL_GET_LINE(PixelT, &buffer_, y); }
+
+    /** Return pixel, reference to channel array for interleaved pixels. */
+    PixelT &operator()(const CVLImagePixelCount y, const CVLImagePixelCount x) const { return row(y)[x]; }
+
+    /** Return view of rect, shares memory with this view. */
+    ImageView subview(const CVLRect roi) const {
+        return ImageView(cvl_image_subimage(&buffer_, roi, pixel_size));
+    }
+
+    /** Return rows for range-based for. */
+    RowRange rows() const { return RowRange(this); }
+
+    PixelIterator begin() const { return PixelIterator(this, 0); }
+    PixelIterator end() const { return PixelIterator(this, height()); }
+
+private:
+    CVLImageBuffer buffer_;
+};
+
+template <typename PixelT> constexpr CVLImageBytesCount PixelTraits<PixelT>::pixel_size;
+template <typename PixelT> constexpr size_t PixelTraits<PixelT>::channels;
+template <typename PixelT> constexpr bool PixelTraits<PixelT>::is_interleaved;
+template <typename PixelT> constexpr CVLImageBytesCount ImageView<PixelT>::pixel_size;
+template <typename PixelT> constexpr size_t ImageView<PixelT>::channels;
+
+
+
+/** Return typed view of C image. */
+template <typename PixelT>
+ImageView<PixelT> make_view(const CVLImageBuffer &buffer) {
+    return ImageView<PixelT>(buffer);
+}
+
+
+
+/**
+ * Call @a function(pixel) for every pixel of view.
+ *
+ * Pixels are passed by reference (references to channel arrays for interleaved pixels). Rows are
+ * processed with plain indexed loops, which compilers vectorize for simple functions.
+ */
+template <typename PixelT, typename Function>
+void for_each_pixel(const ImageView<PixelT> &view, Function function) {
+    const CVLImagePixelCount height = view.height();
+    const CVLImagePixelCount width = view.width();
+    for (CVLImagePixelCount y = 0; y < height; ++y) {
+        PixelT * const row = view.row(y);
+        for (CVLImagePixelCount x = 0; x < width; ++x) {
+            function(row[x]);
+        }
+    }
+}
+
+
+
+/** Call @a function(x, y, pixel) for every pixel of view. */
+template <typename PixelT, typename Function>
+void for_each_pixel_indexed(const ImageView<PixelT> &view, Function function) {
+    const CVLImagePixelCount height = view.height();
+    const CVLImagePixelCount width = view.width();
+    for (CVLImagePixelCount y = 0; y < height; ++y) {
+        PixelT * const row = view.row(y);
+        for (CVLImagePixelCount x = 0; x < width; ++x) {
+            function(x, y, row[x]);
+        }
+    }
+}
+
+
+
+namespace detail {
+
+/** Planar destination: dst = function(src). */
+template <typename SrcT, typename DstT, typename Function>
+inline void transform_row(SrcT * const src, DstT * const dst, const CVLImagePixelCount width, Function &function,
+                          std::false_type)
+{
+    for (CVLImagePixelCount x = 0; x < width; ++x) {
+        dst[x] = function(src[x]);
+    }
+}
+
+/** Interleaved destination: function(src, dst), arrays cannot be returned by value. */
+template <typename SrcT, typename DstT, typename Function>
+inline void transform_row(SrcT * const src, DstT * const dst, const CVLImagePixelCount width, Function &function,
+                          std::true_type)
+{
+    for (CVLImagePixelCount x = 0; x < width; ++x) {
+        function(src[x], dst[x]);
+    }
+}
+
+}  // namespace detail
+
+
+
+/**
+ * Transform pixels of @a source into @a dest of the same size, in place if views are equal.
+ *
+ * For planar destination pixels @a function(src) returns destination pixel value. For interleaved
+ * destination pixels @a function(src, dst) receives destination pixel by reference.
+ */
+template <typename SrcT, typename DstT, typename Function>
+void transform(const ImageView<SrcT> &source, const ImageView<DstT> &dest, Function function) {
+    assert(source.height() == dest.height() && source.width() == dest.width());
+    const CVLImagePixelCount height = source.height();
+    const CVLImagePixelCount width = source.width();
+    for (CVLImagePixelCount y = 0; y < height; ++y) {
+        detail::transform_row(source.row(y), dest.row(y), width, function,
+                              std::integral_constant<bool, PixelTraits<DstT>::is_interleaved>());
+    }
+}
+
+
+
+/** Set every pixel of view to @a value. */
+template <typename PixelT>
+void fill(const ImageView<PixelT> &view, const typename PixelTraits<PixelT>::Pixel &value) {
+    for_each_pixel(view, [&value](PixelT &pixel) {
+        memcpy(&pixel, &value, sizeof(pixel));
+    });
+}
+
+}  // namespace cvl
+
+
+
+#endif //CVL_IMAGE_VIEW_HPP
@@ -0,0 +1,777 @@
+#ifndef CVL_IMAGE_WARP_H
+#define CVL_IMAGE_WARP_H
+
+
+#include "cvl_image_parallel.h"
+
+#include <math.h>
+
+/*
+ * Affine and perspective warps.
+ *
+ * Warps map every destination pixel through a transform to a source position and sample source
+ * there. Transform maps destination pixel coordinates to source pixel coordinates (inverse
+ * mapping), integer coordinates are pixel centers. Use cvl_warp_transform_invert for transforms
+ * given in source to destination direction.
+ *
+ * Source positions are rounded to fixed point with CVL_WARP_FRACTION_BITS fractional bits, then
+ * pixels are sampled with integer arithmetic (float for Pixel_F). Sampling is the same for two
+ * evaluation paths:
+ * - cvl_image_warp computes positions of a tile of destination pixels on the fly;
+ * - cvl_image_remap reads positions from CVLWarpMap compiled once for a static transform, so each
+ *   frame costs only the sampling.
+ * Both paths give identical results. Destination is processed in tiles, which keeps the source
+ * neighbourhood of rotated or sheared tiles in cache, inside row bands executed on thread pool.
+ * AVX2 gathers sample 8 pixels at once when all of their neighbourhoods are inside source.
+ *
+ * Supported pixel types are CVL_PIXEL_TYPE_8, CVL_PIXEL_TYPE_8888 and CVL_PIXEL_TYPE_F.
+ */
+
+/** Number of fractional bits of fixed point source positions. */
+#define CVL_WARP_FRACTION_BITS 7
+#define CVL_WARP_FRACTION_ONE (1 << CVL_WARP_FRACTION_BITS)
+#define CVL_WARP_FRACTION_MASK (CVL_WARP_FRACTION_ONE - 1)
+
+/** Destination tile processed at once. */
+#define CVL_WARP_TILE_WIDTH 128
+#define CVL_WARP_TILE_HEIGHT 16
+
+/** Limit of fixed point positions, farther positions are clamped (they are outside of any image). */
+#define CVL_WARP_POSITION_LIMIT ((double)(1 << 29))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Sampling of source. */
+typedef enum {
+    CVL_WARP_NEAREST = 0, ///< Nearest pixel.
+    CVL_WARP_BILINEAR     ///< Bilinear interpolation of 2x2 neighbourhood.
+} CVLWarpInterpolation;
+
+/**
+ * Projective transform of destination pixel coordinates (x, y) to source coordinates:
+ * source x = (m[0] x + m[1] y + m[2]) / w, source y = (m[3] x + m[4] y + m[5]) / w,
+ * w = m[6] x + m[7] y + m[8].
+ */
+typedef struct {
+    double m[9];
+} CVLWarpTransform;
+
+
+
+/** Return affine transform of 2x3 matrix @a m (row major). */
+static inline CVLWarpTransform cvl_warp_transform_affine(const double m[6]) {
+    CVLWarpTransform transform;
+    memcpy(transform.m, m, 6 * sizeof(double));
+    transform.m[6] = 0.0;
+    transform.m[7] = 0.0;
+    transform.m[8] = 1.0;
+    return transform;
+}
+
+
+
+/** Return perspective transform of 3x3 homography matrix @a m (row major). */
+static inline CVLWarpTransform cvl_warp_transform_perspective(const double m[9]) {
+    CVLWarpTransform transform;
+    memcpy(transform.m, m, 9 * sizeof(double));
+    return transform;
+}
+
+
+
+/** Return true if transform is affine. */
+static inline bool cvl_warp_transform_is_affine(const CVLWarpTransform * const transform) {
+    return transform->m[6] == 0.0 && transform->m[7] == 0.0 && transform->m[8] == 1.0;
+}
+
+
+
+/**
+ * Invert transform.
+ * @return false if transform is singular.
+ */
+static inline bool cvl_warp_transform_invert(const CVLWarpTransform * const transform, CVLWarpTransform * const inverse) {
+    const double * const m = transform->m;
+    const double c0 = m[4] * m[8] - m[5] * m[7];
+    const double c1 = m[5] * m[6] - m[3] * m[8];
+    const double c2 = m[3] * m[7] - m[4] * m[6];
+    const double det = m[0] * c0 + m[1] * c1 + m[2] * c2;
+    if (det == 0.0 || !isfinite(det)) {
+        return false;
+    }
+    const double s = 1.0 / det;
+    double * const r = inverse->m;
+    r[0] = c0 * s;
+    r[1] = (m[2] * m[7] - m[1] * m[8]) * s;
+    r[2] = (m[1] * m[5] - m[2] * m[4]) * s;
+    r[3] = c1 * s;
+    r[4] = (m[0] * m[8] - m[2] * m[6]) * s;
+    r[5] = (m[2] * m[3] - m[0] * m[5]) * s;
+    r[6] = c2 * s;
+    r[7] = (m[1] * m[6] - m[0] * m[7]) * s;
+    r[8] = (m[0] * m[4] - m[1] * m[3]) * s;
+    if (cvl_warp_transform_is_affine(transform)) {
+        // Keep inverse of affine transform exactly affine.
+        r[6] = 0.0;
+        r[7] = 0.0;
+        r[8] = 1.0;
+    }
+    return true;
+}
+
+
+
+/** Round source coordinate to fixed point (or to integer pixel for nearest sampling). */
+static inline int32_t cvl_warp_fixed(double v, const double scale) {
+    v = v * scale + 0.5;
+    // Comparisons are false for NaN, so NaN ends up at the limit.
+    if (!(v > -CVL_WARP_POSITION_LIMIT)) {
+        v = -CVL_WARP_POSITION_LIMIT;
+    }
+    if (v > CVL_WARP_POSITION_LIMIT) {
+        v = CVL_WARP_POSITION_LIMIT;
+    }
+    // Floor without libm call: truncation rounds negative values up.
+    const int32_t t = (int32_t)v;
+    return t - ((double)t > v);
+}
+
+
+
+#if CVL_SIMD_X86
+
+/** Vector cvl_warp_fixed of 4 coordinates, max and min pick the limit for NaN the same way. */
+CVL_SIMD_TARGET("avx2")
+static inline __m128i cvl_warp_fixed_avx2(const __m256d v, const __m256d scale) {
+    const __m256d limit = _mm256_set1_pd(CVL_WARP_POSITION_LIMIT);
+    const __m256d biased = _mm256_add_pd(_mm256_mul_pd(v, scale), _mm256_set1_pd(0.5));
+    const __m256d clamped = _mm256_min_pd(_mm256_max_pd(biased, _mm256_sub_pd(_mm256_setzero_pd(), limit)), limit);
+    return _mm256_cvttpd_epi32(_mm256_floor_pd(clamped));
+}
+
+
+
+/**
+ * Vector part of cvl_warp_positions, 8 pixels at once.
+ * @return Number of processed pixels, a multiple of 8.
+ */
+CVL_SIMD_TARGET("avx2")
+static inline size_t cvl_warp_positions_avx2(const double * const m,
+                                             const double row_x,
+                                             const double row_y,
+                                             const double row_w,
+                                             const bool affine,
+                                             const bool bilinear,
+                                             const CVLImagePixelCount x,
+                                             const size_t count,
+                                             int32_t * const CVL_RESTRICT xs,
+                                             int32_t * const CVL_RESTRICT ys,
+                                             uint16_t * const CVL_RESTRICT fractions)
+{
+    const __m256d scale = _mm256_set1_pd(bilinear ? (double)CVL_WARP_FRACTION_ONE : 1.0);
+    const __m256d step = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    const __m256i mask = _mm256_set1_epi32(CVL_WARP_FRACTION_MASK);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i fixed_x[2], fixed_y[2];
+        for (int h = 0; h < 2; ++h) {
+            const __m256d dx = _mm256_add_pd(_mm256_set1_pd((double)(x + i + 4 * h)), step);
+            __m256d sx = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(m[0]), dx), _mm256_set1_pd(row_x));
+            __m256d sy = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(m[3]), dx), _mm256_set1_pd(row_y));
+            if (!affine) {
+                const __m256d w = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(m[6]), dx), _mm256_set1_pd(row_w));
+                sx = _mm256_div_pd(sx, w);
+                sy = _mm256_div_pd(sy, w);
+            }
+            fixed_x[h] = cvl_warp_fixed_avx2(sx, scale);
+            fixed_y[h] = cvl_warp_fixed_avx2(sy, scale);
+        }
+        const __m256i fx = _mm256_set_m128i(fixed_x[1], fixed_x[0]);
+        const __m256i fy = _mm256_set_m128i(fixed_y[1], fixed_y[0]);
+        if (bilinear) {
+            _mm256_storeu_si256((__m256i *)(xs + i), _mm256_srai_epi32(fx, CVL_WARP_FRACTION_BITS));
+            _mm256_storeu_si256((__m256i *)(ys + i), _mm256_srai_epi32(fy, CVL_WARP_FRACTION_BITS));
+            const __m256i fraction = _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(fy, mask), CVL_WARP_FRACTION_BITS),
+                                                     _mm256_and_si256(fx, mask));
+            _mm_storeu_si128((__m128i *)(fractions + i), _mm_packus_epi32(_mm256_castsi256_si128(fraction),
+                                                                          _mm256_extracti128_si256(fraction, 1)));
+        }
+        else {
+            _mm256_storeu_si256((__m256i *)(xs + i), fx);
+            _mm256_storeu_si256((__m256i *)(ys + i), fy);
+        }
+    }
+    return i;
+}
+
+#endif
+
+
+
+/**
+ * Compute source positions of @a count destination pixels starting at (@a x, @a y).
+ *
+ * For bilinear sampling xs, ys receive top left pixel of 2x2 neighbourhood and fractions receive
+ * fixed point offsets (fy << CVL_WARP_FRACTION_BITS) | fx; for nearest sampling xs, ys receive
+ * the nearest pixel and fractions are not written.
+ */
+static inline void cvl_warp_positions(const CVLWarpTransform * const transform,
+                                      const CVLWarpInterpolation interpolation,
+                                      const CVLImagePixelCount y,
+                                      const CVLImagePixelCount x,
+                                      const size_t count,
+                                      int32_t * const CVL_RESTRICT xs,
+                                      int32_t * const CVL_RESTRICT ys,
+                                      uint16_t * const CVL_RESTRICT fractions)
+{
+    const double * const m = transform->m;
+    const double dy = (double)y;
+    const double row_x = m[1] * dy + m[2];
+    const double row_y = m[4] * dy + m[5];
+    const double row_w = m[7] * dy + m[8];
+    const bool affine = cvl_warp_transform_is_affine(transform);
+    const bool bilinear = interpolation == CVL_WARP_BILINEAR;
+    const double scale = bilinear ? (double)CVL_WARP_FRACTION_ONE : 1.0;
+    size_t i = 0;
+#if CVL_SIMD_X86
+    if (cvl_simd_level() >= CVL_SIMD_LEVEL_AVX2) {
+        i = cvl_warp_positions_avx2(m, row_x, row_y, row_w, affine, bilinear, x, count, xs, ys, fractions);
+    }
+#endif
+    for (; i < count; ++i) {
+        const double dx = (double)(x + i);
+        double sx = m[0] * dx + row_x;
+        double sy = m[3] * dx + row_y;
+        if (!affine) {
+            const double w = m[6] * dx + row_w;
+            sx /= w;
+            sy /= w;
+        }
+        const int32_t fx = cvl_warp_fixed(sx, scale);
+        const int32_t fy = cvl_warp_fixed(sy, scale);
+        if (bilinear) {
+            // Arithmetic shift rounds toward negative infinity.
+            xs[i] = fx >> CVL_WARP_FRACTION_BITS;
+            ys[i] = fy >> CVL_WARP_FRACTION_BITS;
+            fractions[i] = (uint16_t)(((fy & CVL_WARP_FRACTION_MASK) << CVL_WARP_FRACTION_BITS) |
+                                      (fx & CVL_WARP_FRACTION_MASK));
+        }
+        else {
+            xs[i] = fx;
+            ys[i] = fy;
+        }
+    }
+}
+
+
+
+/**
+ * Precomputed source positions of all destination pixels.
+ * @see cvl_warp_map_init
+ */
+typedef struct {
+    CVLImagePixelCount height;          ///< Destination height.
+    CVLImagePixelCount width;           ///< Destination width.
+    CVLWarpInterpolation interpolation;
+    int32_t *x;                         ///< Source columns, height * width values.
+    int32_t *y;                         ///< Source rows, height * width values.
+    uint16_t *fractions;                ///< Fixed point fractions of bilinear sampling, or NULL.
+} CVLWarpMap;
+
+
+
+/** Release map memory. */
+static inline void cvl_warp_map_release(CVLWarpMap * const map) {
+    cvl_image_data_free(map->x);
+    cvl_image_data_free(map->y);
+    cvl_image_data_free(map->fractions);
+    memset(map, 0, sizeof(*map));
+}
+
+
+
+/**
+ * Compile map of transform for destination of @a height x @a width pixels.
+ *
+ * @return false on allocation failure.
+ * @see cvl_image_remap
+ * @see cvl_warp_map_release
+ */
+static inline bool cvl_warp_map_init(CVLWarpMap * const map,
+                                     const CVLImagePixelCount height,
+                                     const CVLImagePixelCount width,
+                                     const CVLWarpTransform * const transform,
+                                     const CVLWarpInterpolation interpolation)
+{
+    memset(map, 0, sizeof(*map));
+    const size_t count = (size_t)height * width;
+    map->height = height;
+    map->width = width;
+    map->interpolation = interpolation;
+    map->x = (int32_t *)cvl_image_data_alloc(count * sizeof(int32_t), CVL_IMAGE_DEFAULT_ALIGNMENT);
+    map->y = (int32_t *)cvl_image_data_alloc(count * sizeof(int32_t), CVL_IMAGE_DEFAULT_ALIGNMENT);
+    if (interpolation == CVL_WARP_BILINEAR) {
+        map->fractions = (uint16_t *)cvl_image_data_alloc(count * sizeof(uint16_t), CVL_IMAGE_DEFAULT_ALIGNMENT);
+    }
+    if ((count && (!map->x || !map->y)) || (count && interpolation == CVL_WARP_BILINEAR && !map->fractions)) {
+        cvl_warp_map_release(map);
+        return false;
+    }
+    for (CVLImagePixelCount y = 0; y < height; ++y) {
+        const size_t row = (size_t)y * width;
+        cvl_warp_positions(transform, interpolation, y, 0, width, map->x + row, map->y + row,
+                           map->fractions ? map->fractions + row : NULL);
+    }
+    return true;
+}
+
+
+
+/*
+ * Sampling.
+ */
+
+/** Source and border of sampling. */
+typedef struct {
+    const CVLImageBuffer *source;
+    CVLPixelType type;
+    CVLImageBytesCount pixel_size;
+    CVLWarpInterpolation interpolation;
+    CVLBorderMode border;
+    CVLPixel_8 border_pixel[4];    ///< Value of pixels outside of source for CVL_BORDER_CONSTANT.
+    int height;
+    int width;
+    bool can_gather;               ///< Byte offsets of source pixels fit into int32.
+} CVLWarpSampler;
+
+
+
+static inline void cvl_warp_sampler_init(CVLWarpSampler * const sampler,
+                                         const CVLImageBuffer * const source,
+                                         const CVLPixelType type,
+                                         const CVLWarpInterpolation interpolation,
+                                         const CVLBorderMode border,
+                                         const void * const border_value)
+{
+    assert(type == CVL_PIXEL_TYPE_8 || type == CVL_PIXEL_TYPE_8888 || type == CVL_PIXEL_TYPE_F);
+    sampler->source = source;
+    sampler->type = type;
+    sampler->pixel_size = cvl_pixel_type_size(type);
+    sampler->interpolation = interpolation;
+    sampler->border = border;
+    memset(sampler->border_pixel, 0, sizeof(sampler->border_pixel));
+    if (border_value) {
+        memcpy(sampler->border_pixel, border_value, sampler->pixel_size);
+    }
+    sampler->height = (int)source->height;
+    sampler->width = (int)source->width;
+    sampler->can_gather = (uint64_t)source->rowBytes * source->height < (uint64_t)INT32_MAX - 2 * source->rowBytes;
+}
+
+
+
+/** Return source pixel (x, y) or, outside of source, pixel given by border mode. */
+static inline const CVLPixel_8 *cvl_warp_border_pixel(const CVLWarpSampler * const sampler, int x, int y) {
+    if (x < 0 || x >= sampler->width || y < 0 || y >= sampler->height) {
+        if (sampler->border == CVL_BORDER_CONSTANT) {
+            return sampler->border_pixel;
+        }
+        if (sampler->border == CVL_BORDER_REFLECT) {
+            // Reflection is periodic, reduce far coordinates first.
+            const int x_period = 2 * (sampler->width - 1);
+            const int y_period = 2 * (sampler->height - 1);
+            x = x_period ? x % x_period : 0;
+            y = y_period ? y % y_period : 0;
+        }
+        x = cvl_border_index(x, sampler->width, sampler->border);
+        y = cvl_border_index(y, sampler->height, sampler->border);
+    }
+    return CVL_GET_LINE(const CVLPixel_8, sampler->source, y) + (size_t)x * sampler->pixel_size;
+}
+
+
+
+/** Bilinear blend of @a channels 8 bit channels, rounding after each direction. */
+static inline void cvl_warp_blend_8(const CVLPixel_8 * const p00, const CVLPixel_8 * const p01,
+                                    const CVLPixel_8 * const p10, const CVLPixel_8 * const p11,
+                                    const int fx, const int fy, const int channels,
+                                    CVLPixel_8 * const dst)
+{
+    const int half = CVL_WARP_FRACTION_ONE / 2;
+    for (int c = 0; c < channels; ++c) {
+        const int top = (p00[c] * (CVL_WARP_FRACTION_ONE - fx) + p01[c] * fx + half) >> CVL_WARP_FRACTION_BITS;
+        const int bottom = (p10[c] * (CVL_WARP_FRACTION_ONE - fx) + p11[c] * fx + half) >> CVL_WARP_FRACTION_BITS;
+        dst[c] = (CVLPixel_8)((top * (CVL_WARP_FRACTION_ONE - fy) + bottom * fy + half) >> CVL_WARP_FRACTION_BITS);
+    }
+}
+
+
+
+static inline void cvl_warp_blend_F(const CVLPixel_8 * const p00, const CVLPixel_8 * const p01,
+                                    const CVLPixel_8 * const p10, const CVLPixel_8 * const p11,
+                                    const int fx, const int fy,
+                                    CVLPixel_8 * const dst)
+{
+    CVLPixel_F v00, v01, v10, v11;
+    memcpy(&v00, p00, sizeof(v00));
+    memcpy(&v01, p01, sizeof(v01));
+    memcpy(&v10, p10, sizeof(v10));
+    memcpy(&v11, p11, sizeof(v11));
+    const float wx = (float)fx * (1.0f / CVL_WARP_FRACTION_ONE);
+    const float wy = (float)fy * (1.0f / CVL_WARP_FRACTION_ONE);
+    const float top = v00 * (1.0f - wx) + v01 * wx;
+    const float bottom = v10 * (1.0f - wx) + v11 * wx;
+    const CVLPixel_F value = top * (1.0f - wy) + bottom * wy;
+    memcpy(dst, &value, sizeof(value));
+}
+
+
+
+/** Sample @a count pixels one by one. */
+static inline void cvl_warp_sample_pixels(const CVLWarpSampler * const sampler,
+                                          const int32_t * const xs,
+                                          const int32_t * const ys,
+                                          const uint16_t * const fractions,
+                                          const size_t count,
+                                          CVLPixel_8 * const dst)
+{
+    const CVLImageBuffer * const source = sampler->source;
+    const CVLImageBytesCount ps = sampler->pixel_size;
+    if (sampler->interpolation == CVL_WARP_NEAREST) {
+        for (size_t i = 0; i < count; ++i) {
+            const int x = xs[i];
+            const int y = ys[i];
+            const CVLPixel_8 * const p = (unsigned)x < (unsigned)sampler->width && (unsigned)y < (unsigned)sampler->height ?
+                                         CVL_GET_LINE(const CVLPixel_8, source, y) + (size_t)x * ps :
+                                         cvl_warp_border_pixel(sampler, x, y);
+            if (ps == 1) {
+                dst[i] = *p;
+            }
+            else {
+                memcpy(dst + i * 4, p, 4);
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const int x = xs[i];
+        const int y = ys[i];
+        const int fx = fractions[i] & CVL_WARP_FRACTION_MASK;
+        const int fy = fractions[i] >> CVL_WARP_FRACTION_BITS;
+        const CVLPixel_8 *p00, *p01, *p10, *p11;
+        if ((unsigned)x < (unsigned)(sampler->width - 1) && (unsigned)y < (unsigned)(sampler->height - 1)) {
+            p00 = CVL_GET_LINE(const CVLPixel_8, source, y) + (size_t)x * ps;
+            p01 = p00 + ps;
+            p10 = p00 + source->rowBytes;
+            p11 = p10 + ps;
+        }
+        else {
+            p00 = cvl_warp_border_pixel(sampler, x, y);
+            p01 = cvl_warp_border_pixel(sampler, x + 1, y);
+            p10 = cvl_warp_border_pixel(sampler, x, y + 1);
+            p11 = cvl_warp_border_pixel(sampler, x + 1, y + 1);
+        }
+        switch (sampler->type) {
+            case CVL_PIXEL_TYPE_8:    cvl_warp_blend_8(p00, p01, p10, p11, fx, fy, 1, dst + i); break;
+            case CVL_PIXEL_TYPE_8888: cvl_warp_blend_8(p00, p01, p10, p11, fx, fy, 4, dst + 4 * i); break;
+            default:                  cvl_warp_blend_F(p00, p01, p10, p11, fx, fy, dst + 4 * i); break;
+        }
+    }
+}
+
+
+
+#if CVL_SIMD_X86
+
+/** Return mask of lanes with x in [0, x_end) and y in [0, y_end). */
+CVL_SIMD_TARGET("avx2")
+static inline int cvl_warp_inside_avx2(const __m256i x, const __m256i y, const int x_end, const int y_end) {
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i inside = _mm256_and_si256(_mm256_and_si256(_mm256_cmpgt_epi32(x, minus_one),
+                                                             _mm256_cmpgt_epi32(_mm256_set1_epi32(x_end), x)),
+                                            _mm256_and_si256(_mm256_cmpgt_epi32(y, minus_one),
+                                                             _mm256_cmpgt_epi32(_mm256_set1_epi32(y_end), y)));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(inside));
+}
+
+
+
+/** Pack low bytes of 8 32 bit lanes into 8 bytes at @a dst. */
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_warp_store_bytes_avx2(CVLPixel_8 * const dst, const __m256i v) {
+    const __m256i words = _mm256_packs_epi32(v, v);
+    const __m256i bytes = _mm256_packus_epi16(words, words);
+    _mm_storel_epi64((__m128i *)dst, _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes),
+                                                        _mm256_extracti128_si256(bytes, 1)));
+}
+
+
+
+/**
+ * Sample pixels with AVX2 gathers, 8 pixels at once.
+ *
+ * Groups with any neighbourhood outside of source are sampled one by one.
+ * @return Number of processed pixels, a multiple of 8.
+ */
+CVL_SIMD_TARGET("avx2")
+static inline size_t cvl_warp_sample_pixels_avx2(const CVLWarpSampler * const sampler,
+                                                 const int32_t * const xs,
+                                                 const int32_t * const ys,
+                                                 const uint16_t * const fractions,
+                                                 const size_t count,
+                                                 CVLPixel_8 * const dst)
+{
+    const CVLImageBytesCount ps = sampler->pixel_size;
+    const int row_bytes = (int)sampler->source->rowBytes;
+    const char * const base = (const char *)sampler->source->data;
+    const bool bilinear = sampler->interpolation == CVL_WARP_BILINEAR;
+    // Pixel_8 gathers read 4 bytes, so the last columns are left to the scalar path.
+    const int x_end = ps == 1 ? sampler->width - 3 : sampler->width - (bilinear ? 1 : 0);
+    const int y_end = sampler->height - (bilinear ? 1 : 0);
+    const __m256i vrow_bytes = _mm256_set1_epi32(row_bytes);
+    const __m256i vps = _mm256_set1_epi32((int)ps);
+    const __m256i one = _mm256_set1_epi32(CVL_WARP_FRACTION_ONE);
+    const __m256i half32 = _mm256_set1_epi32(CVL_WARP_FRACTION_ONE / 2);
+    const __m256i half16 = _mm256_set1_epi16(CVL_WARP_FRACTION_ONE / 2);
+    const __m256i mask = _mm256_set1_epi32(CVL_WARP_FRACTION_MASK);
+    const __m256i byte = _mm256_set1_epi32(0xFF);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i x = _mm256_loadu_si256((const __m256i *)(xs + i));
+        const __m256i y = _mm256_loadu_si256((const __m256i *)(ys + i));
+        CVLPixel_8 * const out = dst + i * ps;
+        if (cvl_warp_inside_avx2(x, y, x_end, y_end) != 0xFF) {
+            cvl_warp_sample_pixels(sampler, xs + i, ys + i, fractions ? fractions + i : NULL, 8, out);
+            continue;
+        }
+        const __m256i offset = _mm256_add_epi32(_mm256_mullo_epi32(y, vrow_bytes), _mm256_mullo_epi32(x, vps));
+        if (!bilinear) {
+            const __m256i p = _mm256_i32gather_epi32((const int *)base, offset, 1);
+            if (ps == 1) {
+                cvl_warp_store_bytes_avx2(out, _mm256_and_si256(p, byte));
+            }
+            else {
+                _mm256_storeu_si256((__m256i *)out, p);
+            }
+            continue;
+        }
+
+        const __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(fractions + i)));
+        const __m256i fx1 = _mm256_and_si256(f, mask);
+        const __m256i fy1 = _mm256_srli_epi32(f, CVL_WARP_FRACTION_BITS);
+        const __m256i fx0 = _mm256_sub_epi32(one, fx1);
+        const __m256i fy0 = _mm256_sub_epi32(one, fy1);
+        const __m256i offset_below = _mm256_add_epi32(offset, vrow_bytes);
+        switch (sampler->type) {
+            case CVL_PIXEL_TYPE_8: {
+                // Lanes hold (p0, p1) byte pairs, spread them into 16 bit pairs for madd with weights.
+                const __m256i g0 = _mm256_i32gather_epi32((const int *)base, offset, 1);
+                const __m256i g1 = _mm256_i32gather_epi32((const int *)base, offset_below, 1);
+                const __m256i byte1 = _mm256_set1_epi32(0xFF00);
+                const __m256i pair0 = _mm256_or_si256(_mm256_and_si256(g0, byte), _mm256_slli_epi32(_mm256_and_si256(g0, byte1), 8));
+                const __m256i pair1 = _mm256_or_si256(_mm256_and_si256(g1, byte), _mm256_slli_epi32(_mm256_and_si256(g1, byte1), 8));
+                const __m256i wx = _mm256_or_si256(fx0, _mm256_slli_epi32(fx1, 16));
+                const __m256i wy = _mm256_or_si256(fy0, _mm256_slli_epi32(fy1, 16));
+                const __m256i top = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(pair0, wx), half32), CVL_WARP_FRACTION_BITS);
+                const __m256i bottom = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(pair1, wx), half32), CVL_WARP_FRACTION_BITS);
+                const __m256i vertical = _mm256_or_si256(top, _mm256_slli_epi32(bottom, 16));
+                const __m256i value = _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(vertical, wy), half32), CVL_WARP_FRACTION_BITS);
+                cvl_warp_store_bytes_avx2(out, value);
+                break;
+            }
+            case CVL_PIXEL_TYPE_8888: {
+                const __m256i zero = _mm256_setzero_si256();
+                const __m256i g00 = _mm256_i32gather_epi32((const int *)base, offset, 1);
+                const __m256i g01 = _mm256_i32gather_epi32((const int *)base, _mm256_add_epi32(offset, vps), 1);
+                const __m256i g10 = _mm256_i32gather_epi32((const int *)base, offset_below, 1);
+                const __m256i g11 = _mm256_i32gather_epi32((const int *)base, _mm256_add_epi32(offset_below, vps), 1);
+                // Weights repeated in all four 16 bit channels of a pixel, in unpack order of pixels.
+                const __m256i wx0 = _mm256_or_si256(fx0, _mm256_slli_epi32(fx0, 16));
+                const __m256i wx1 = _mm256_or_si256(fx1, _mm256_slli_epi32(fx1, 16));
+                const __m256i wy0 = _mm256_or_si256(fy0, _mm256_slli_epi32(fy0, 16));
+                const __m256i wy1 = _mm256_or_si256(fy1, _mm256_slli_epi32(fy1, 16));
+                __m256i halves[2];
+                for (int h = 0; h < 2; ++h) {
+                    const __m256i p00 = h ? _mm256_unpackhi_epi8(g00, zero) : _mm256_unpacklo_epi8(g00, zero);
+                    const __m256i p01 = h ? _mm256_unpackhi_epi8(g01, zero) : _mm256_unpacklo_epi8(g01, zero);
+                    const __m256i p10 = h ? _mm256_unpackhi_epi8(g10, zero) : _mm256_unpacklo_epi8(g10, zero);
+                    const __m256i p11 = h ? _mm256_unpackhi_epi8(g11, zero) : _mm256_unpacklo_epi8(g11, zero);
+                    const __m256i x0 = h ? _mm256_unpackhi_epi32(wx0, wx0) : _mm256_unpacklo_epi32(wx0, wx0);
+                    const __m256i x1 = h ? _mm256_unpackhi_epi32(wx1, wx1) : _mm256_unpacklo_epi32(wx1, wx1);
+                    const __m256i y0 = h ? _mm256_unpackhi_epi32(wy0, wy0) : _mm256_unpacklo_epi32(wy0, wy0);
+                    const __m256i y1 = h ? _mm256_unpackhi_epi32(wy1, wy1) : _mm256_unpacklo_epi32(wy1, wy1);
+                    const __m256i top = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(p00, x0),
+                                                                                            _mm256_mullo_epi16(p01, x1)), half16),
+                                                          CVL_WARP_FRACTION_BITS);
+                    const __m256i bottom = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(p10, x0),
+                                                                                               _mm256_mullo_epi16(p11, x1)), half16),
+                                                             CVL_WARP_FRACTION_BITS);
+                    halves[h] = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(_mm256_mullo_epi16(top, y0),
+                                                                                    _mm256_mullo_epi16(bottom, y1)), half16),
+                                                  CVL_WARP_FRACTION_BITS);
+                }
+                _mm256_storeu_si256((__m256i *)out, _mm256_packus_epi16(halves[0], halves[1]));
+                break;
+            }
+            default: {
+                const __m256 scale = _mm256_set1_ps(1.0f / CVL_WARP_FRACTION_ONE);
+                const __m256 fone = _mm256_set1_ps(1.0f);
+                const __m256 wx = _mm256_mul_ps(_mm256_cvtepi32_ps(fx1), scale);
+                const __m256 wy = _mm256_mul_ps(_mm256_cvtepi32_ps(fy1), scale);
+                const __m256 wx0f = _mm256_sub_ps(fone, wx);
+                const __m256 v00 = _mm256_i32gather_ps((const float *)base, offset, 1);
+                const __m256 v01 = _mm256_i32gather_ps((const float *)base, _mm256_add_epi32(offset, vps), 1);
+                const __m256 v10 = _mm256_i32gather_ps((const float *)base, offset_below, 1);
+                const __m256 v11 = _mm256_i32gather_ps((const float *)base, _mm256_add_epi32(offset_below, vps), 1);
+                const __m256 top = _mm256_add_ps(_mm256_mul_ps(v00, wx0f), _mm256_mul_ps(v01, wx));
+                const __m256 bottom = _mm256_add_ps(_mm256_mul_ps(v10, wx0f), _mm256_mul_ps(v11, wx));
+                _mm256_storeu_ps((float *)out, _mm256_add_ps(_mm256_mul_ps(top, _mm256_sub_ps(fone, wy)),
+                                                             _mm256_mul_ps(bottom, wy)));
+                break;
+            }
+        }
+    }
+    return i;
+}
+
+#endif
+
+
+
+/** Sample @a count pixels at given source positions into @a dst. */
+static inline void cvl_warp_sample(const CVLWarpSampler * const sampler,
+                                   const int32_t * const xs,
+                                   const int32_t * const ys,
+                                   const uint16_t * const fractions,
+                                   const size_t count,
+                                   CVLPixel_8 * const dst)
+{
+    size_t i = 0;
+#if CVL_SIMD_X86
+    if (sampler->can_gather && cvl_simd_level() >= CVL_SIMD_LEVEL_AVX2) {
+        i = cvl_warp_sample_pixels_avx2(sampler, xs, ys, fractions, count, dst);
+    }
+#endif
+    cvl_warp_sample_pixels(sampler, xs + i, ys + i, fractions ? fractions + i : NULL, count - i,
+                           dst + i * sampler->pixel_size);
+}
+
+
+
+/*
+ * Evaluation.
+ */
+
+/** Context of warp band tasks. */
+typedef struct {
+    CVLWarpSampler sampler;
+    const CVLImageBuffer *dest;
+    const CVLWarpTransform *transform;  ///< Transform of direct path.
+    const CVLWarpMap *map;              ///< Map of compiled path.
+} CVLWarpBands;
+
+
+
+/** Warp destination rows [begin, end) tile by tile. */
+static inline void cvl_warp_band(void * const context, const size_t begin, const size_t end) {
+    const CVLWarpBands * const bands = (const CVLWarpBands *)context;
+    const CVLWarpSampler * const sampler = &bands->sampler;
+    const CVLImageBuffer * const dest = bands->dest;
+    const CVLWarpMap * const map = bands->map;
+    int32_t xs[CVL_WARP_TILE_WIDTH];
+    int32_t ys[CVL_WARP_TILE_WIDTH];
+    uint16_t fractions[CVL_WARP_TILE_WIDTH];
+    for (size_t tile_y = begin; tile_y < end; tile_y += CVL_WARP_TILE_HEIGHT) {
+        const size_t tile_end = end - tile_y < CVL_WARP_TILE_HEIGHT ? end : tile_y + CVL_WARP_TILE_HEIGHT;
+        for (size_t x = 0; x < dest->width; x += CVL_WARP_TILE_WIDTH) {
+            const size_t count = dest->width - x < CVL_WARP_TILE_WIDTH ? dest->width - x : CVL_WARP_TILE_WIDTH;
+            for (size_t y = tile_y; y < tile_end; ++y) {
+                CVLPixel_8 * const dst = CVL_GET_LINE(CVLPixel_8, dest, y) + x * sampler->pixel_size;
+                if (map) {
+                    const size_t index = y * map->width + x;
+                    cvl_warp_sample(sampler, map->x + index, map->y + index,
+                                    map->fractions ? map->fractions + index : NULL, count, dst);
+                }
+                else {
+                    cvl_warp_positions(bands->transform, sampler->interpolation, (CVLImagePixelCount)y,
+                                       (CVLImagePixelCount)x, count, xs, ys, fractions);
+                    cvl_warp_sample(sampler, xs, ys, fractions, count, dst);
+                }
+            }
+        }
+    }
+}
+
+
+
+/**
+ * Warp image by transform.
+ *
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ * @param transform Transform of destination coordinates to source coordinates.
+ * @param border Border mode for source pixels outside of source image.
+ * @param border_value Pixel value of CVL_BORDER_CONSTANT border, NULL for zero.
+ */
+static inline void cvl_image_warp(CVLThreadPool * const pool,
+                                  const CVLImageBuffer * const source_image,
+                                  CVLImageBuffer * const dest_image,
+                                  const CVLPixelType type,
+                                  const CVLWarpTransform * const transform,
+                                  const CVLWarpInterpolation interpolation,
+                                  const CVLBorderMode border,
+                                  const void * const border_value)
+{
+    assert(cvl_image_is_good(source_image, cvl_pixel_type_size(type)));
+    assert(cvl_image_is_good(dest_image,   cvl_pixel_type_size(type)));
+    assert(source_image->data != dest_image->data);
+    CVLWarpBands bands;
+    cvl_warp_sampler_init(&bands.sampler, source_image, type, interpolation, border, border_value);
+    bands.dest = dest_image;
+    bands.transform = transform;
+    bands.map = NULL;
+    cvl_image_parallel_for_rows(pool, dest_image->height, dest_image->width * bands.sampler.pixel_size,
+                                cvl_warp_band, &bands);
+}
+
+
+
+/**
+ * Warp image by compiled map.
+ *
+ * @param pool Thread pool or NULL to execute on the calling thread.
+ * @param map Map compiled for destination size.
+ * @param border Border mode for source pixels outside of source image.
+ * @param border_value Pixel value of CVL_BORDER_CONSTANT border, NULL for zero.
+ */
+static inline void cvl_image_remap(CVLThreadPool * const pool,
+                                   const CVLWarpMap * const map,
+                                   const CVLImageBuffer * const source_image,
+                                   CVLImageBuffer * const dest_image,
+                                   const CVLPixelType type,
+                                   const CVLBorderMode border,
+                                   const void * const border_value)
+{
+    assert(cvl_image_is_good(source_image, cvl_pixel_type_size(type)));
+    assert(cvl_image_is_good(dest_image,   cvl_pixel_type_size(type)));
+    assert(dest_image->height == map->height && dest_image->width == map->width);
+    assert(source_image->data != dest_image->data);
+    CVLWarpBands bands;
+    cvl_warp_sampler_init(&bands.sampler, source_image, type, map->interpolation, border, border_value);
+    bands.dest = dest_image;
+    bands.transform = NULL;
+    bands.map = map;
+    cvl_image_parallel_for_rows(pool, dest_image->height, dest_image->width * bands.sampler.pixel_size,
+                                cvl_warp_band, &bands);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_IMAGE_WARP_H
@@ -2,6 +2,19 @@
 #define CVL_PROFILING_H
 
 
+/*
+ * Profiling is enabled with CVL_PROFILING macro.
+ *
+ * Profiled blocks are timed with monotonic clock (or TSC, see CVL_PROFILING_TSC) and samples are
+ * aggregated per tag into thread local statistics (count, min, max, mean, p50, p99) without locks
+ * or I/O. Statistics are printed with CVL_PROFILING_DUMP(file) and at program exit. With
+ * CVL_PROFILING_PERF on Linux statistics also include hardware counters.
+ *
+ * Statistics are shared by all translation units of a module (executable or shared library), so a
+ * dump reports tags profiled in every source file. Configuration macros (CVL_PROFILING_TSC,
+ * CVL_PROFILING_PERF, CVL_PROFILING_MAX_TAGS) must be the same in all of them.
+ */
+
 #define CVL_TICN_CHOOSER(A,B,FUNC, ...)  FUNC
 /**
  * Profiling macro capable of executing code block several times and calculating average execution
@@ -17,7 +30,8 @@
  * ...code...
  * CVL_TOCN(tag)
  *
- * Two arguments, execute code count times and calculate average execution time.
+ * Two arguments, execute code count times, each iteration is recorded as a sample of average
+ * execution time.
  * CVL_TICN(tag, count);
  * ...code...
  * CVL_TOCN(tag)
@@ -36,7 +50,7 @@
 /**
  * \def CVL_TIC(tag)
  *
- * Measure code execution time.
+ * Measure code execution time and record it into statistics of tag.
  *
  * Marks start of profiled code block.
  *
@@ -53,6 +67,16 @@
  * Companion macro for CVL_TIC(tag)
  */
 
+/**
+ * \def CVL_PROFILING_DUMP(file)
+ * Print statistics of all tags to file, or with LOGP if file is NULL.
+ */
+
+/**
+ * \def CVL_PROFILING_RESET()
+ * Reset statistics of all tags.
+ */
+
 #if CVL_PROFILING
 
 #include <time.h>
@@ -80,73 +104,6 @@ struct timespec {
 #include <Windows.h>
 #endif
 
-/**
- * Windows version of clock_gettime routine.
- *
- * @param tv - pointer to resulting timespec structure
- * @return 0
- */
-static int cvl_windows_clock_get_time(struct timespec *tv) {
-    LARGE_INTEGER t;
-    FILETIME      f;
-
-    double               microseconds;
-    static LARGE_INTEGER offset;
-    static double        freq_to_microseconds;
-    static int           initialized = 0;
-    static BOOL          use_performance_counter = 0;
-
-    // Initialize freq_to_microseconds.
-    if (!initialized) {
-        LARGE_INTEGER performanceFrequency;
-        initialized = 1;
-        use_performance_counter = QueryPerformanceFrequency(&performanceFrequency);
-
-        // If hardware supports a high-resolution performance counter.
-        if (use_performance_counter) {
-            QueryPerformanceCounter(&offset);
-            freq_to_microseconds = performanceFrequency.QuadPart / 1000000.0;
-        } else {
-            SYSTEMTIME s;
-            FILETIME f;
-
-            // UNIX epoch
-            s.wYear = 1970;
-            s.wMonth = 1;
-            s.wDay = 1;
-            s.wHour = 0;
-            s.wMinute = 0;
-            s.wSecond = 0;
-            s.wMilliseconds = 0;
-
-            SystemTimeToFileTime(&s, &f);
-            offset.QuadPart = f.dwHighDateTime;
-            offset.QuadPart <<= 32;
-            offset.QuadPart |= f.dwLowDateTime;
-
-            freq_to_microseconds = 10.0;
-        }
-    }
-
-    if (use_performance_counter) {
-        QueryPerformanceCounter(&t);
-    }
-    else {
-        GetSystemTimeAsFileTime(&f);
-        t.QuadPart = f.dwHighDateTime;
-        t.QuadPart <<= 32;
-        t.QuadPart |= f.dwLowDateTime;
-    }
-
-    t.QuadPart -= offset.QuadPart;
-    microseconds = t.QuadPart / freq_to_microseconds;
-    t.QuadPart = microseconds;
-    tv->tv_sec = t.QuadPart / 1000000;
-    tv->tv_nsec = t.QuadPart % 1000000 * 1000;
-
-    return 0;
-}
-
 #else
 
 #include <sys/time.h>
@@ -165,7 +122,195 @@ static int cvl_windows_clock_get_time(struct timespec *tv) {
 #define LOGP(...) printf(__VA_ARGS__), fflush(stdout)
 #endif
 
-static inline void current_utc_time(struct timespec *ts) {
+#include "cvl_threading.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+/**
+ * Use x86 time stamp counter for profiling timestamps instead of the monotonic clock.
+ *
+ * Reading TSC is several times cheaper than a clock call. Counter frequency is calibrated against
+ * the monotonic clock once, before the first timestamp is taken, so calibration never falls into a
+ * profiled block. This requires invariant TSC (any x86 CPU of the last decade).
+ */
+#ifndef CVL_PROFILING_TSC
+#define CVL_PROFILING_TSC 0
+#endif
+
+#if CVL_PROFILING_TSC && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define CVL_PROFILING_USE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define CVL_PROFILING_USE_TSC 0
+#endif
+
+/**
+ * Collect hardware performance counters (cycles, instructions, LLC misses, branch misses) of
+ * profiled blocks with Linux perf_event_open.
+ *
+ * Counters are opened per thread on first use. When they are not available (non-Linux systems,
+ * kernel.perf_event_paranoid, containers without perf permissions) profiling falls back to timing
+ * only. Reading counters is a system call per block start and end, so keep profiled blocks above
+ * several microseconds. Counter descriptors are closed when the thread exits.
+ */
+#ifndef CVL_PROFILING_PERF
+#define CVL_PROFILING_PERF 0
+#endif
+
+#if CVL_PROFILING_PERF && defined(__linux__)
+#define CVL_PROFILING_USE_PERF 1
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+// syscall is declared only with _DEFAULT_SOURCE, which strict ISO C modes do not define.
+#if !defined(__cplusplus) && !defined(_DEFAULT_SOURCE) && !defined(_GNU_SOURCE)
+long syscall(long number, ...);
+#endif
+#else
+#define CVL_PROFILING_USE_PERF 0
+#endif
+
+/** Dump statistics when program exits. */
+#ifndef CVL_PROFILING_DUMP_AT_EXIT
+#define CVL_PROFILING_DUMP_AT_EXIT 1
+#endif
+
+/** Maximal number of distinct tags profiled by one thread, power of two. */
+#ifndef CVL_PROFILING_MAX_TAGS
+#define CVL_PROFILING_MAX_TAGS 128
+#endif
+
+/** Histogram bins per power of two, as log2. Two bits give bins about 20% wide. */
+#define CVL_PROFILING_HISTOGRAM_SUB_BITS 2
+
+/** Number of histogram bins covering whole uint64_t nanoseconds range. */
+#define CVL_PROFILING_HISTOGRAM_BINS ((64 - CVL_PROFILING_HISTOGRAM_SUB_BITS + 1) << CVL_PROFILING_HISTOGRAM_SUB_BITS)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Hardware performance counters. */
+typedef enum {
+    CVL_PROFILING_CYCLES = 0,
+    CVL_PROFILING_INSTRUCTIONS,
+    CVL_PROFILING_LLC_MISSES,
+    CVL_PROFILING_BRANCH_MISSES,
+    CVL_PROFILING_COUNTER_COUNT
+} CVLProfileCounter;
+
+/** Snapshot of hardware performance counters of calling thread. */
+typedef struct {
+    bool valid;                                       ///< False if counters are not available.
+    uint64_t time_enabled;                            ///< Time counters were enabled, ns.
+    uint64_t time_running;                            ///< Time counters were scheduled on PMU, ns.
+    uint64_t values[CVL_PROFILING_COUNTER_COUNT];     ///< Counter values, 0 for unsupported ones.
+} CVLProfileCounters;
+
+/** Statistics of one tag collected by one thread. Written only by owning thread. */
+typedef struct {
+    CVLAtomicSize tag;   ///< Tag string pointer, 0 for unused slot.
+    uint64_t count;      ///< Number of samples.
+    uint64_t total_ns;   ///< Sum of samples.
+    uint64_t min_ns;     ///< Shortest sample.
+    uint64_t max_ns;     ///< Longest sample.
+    uint32_t histogram[CVL_PROFILING_HISTOGRAM_BINS]; ///< Log-linear histogram of samples.
+    uint64_t counted;    ///< Number of samples with valid hardware counters.
+    uint64_t counters[CVL_PROFILING_COUNTER_COUNT];  ///< Sums of counter deltas of counted samples.
+} CVLProfileStats;
+
+/**
+ * Per-thread statistics table.
+ *
+ * Tables are linked into a list which is never shrunk. When a thread exits its table is returned
+ * to the list and is claimed by the next new thread, so the list is bounded by the peak number of
+ * concurrent threads and statistics of exited threads are kept.
+ */
+typedef struct CVLProfileThread {
+    struct CVLProfileThread *next;
+    CVLAtomicSize in_use;   ///< Table is owned by a running thread.
+    CVLAtomicSize dropped;  ///< Samples of tags which did not fit into table.
+    int perf_state;         ///< 0 counters not opened yet, 1 opened, -1 not available.
+    int perf_fds[CVL_PROFILING_COUNTER_COUNT];   ///< Counter descriptors, group leader first, -1 if missing.
+    int perf_index[CVL_PROFILING_COUNTER_COUNT]; ///< Position of counter in group read, -1 if missing.
+    CVLProfileStats stats[CVL_PROFILING_MAX_TAGS];
+} CVLProfileThread;
+
+/** Statistics of one tag merged over all threads. */
+typedef struct {
+    const char *tag;
+    uint64_t count;
+    double total_ns;
+    double mean_ns;
+    double min_ns;
+    double max_ns;
+    double p50_ns;  ///< Median, accurate up to histogram bin width.
+    double p99_ns;  ///< 99th percentile, accurate up to histogram bin width.
+    uint64_t counted;               ///< Samples with hardware counters, 0 if counters were not available.
+    double cycles;                  ///< Mean cycles per counted sample.
+    double instructions;            ///< Mean instructions per counted sample.
+    double ipc;                     ///< Instructions per cycle.
+    double llc_misses;              ///< Mean last level cache misses per counted sample.
+    double branch_misses;           ///< Mean branch mispredictions per counted sample.
+} CVLProfileSummary;
+
+/** Process-wide profiling state, one definition shared by all translation units. */
+typedef struct {
+    CVLAtomicSize threads;   ///< Head of list of thread tables.
+    CVLAtomicSize key_once;  ///< cvl_once_begin state of thread key.
+    CVLThreadKey key;        ///< Key holding table of calling thread, returns it at thread exit.
+    bool key_created;        ///< False if no thread key was available.
+    CVLAtomicSize tsc_once;  ///< cvl_once_begin state of TSC calibration.
+    double ns_per_tick;      ///< TSC period in nanoseconds.
+} CVLProfileGlobal;
+
+CVL_SHARED_GLOBAL CVLProfileGlobal cvl_profiling_global = {0, 0, 0, false, 0, 0.0};
+
+
+
+/** Return monotonic clock time in nanoseconds. Not affected by wall clock adjustments. */
+static inline uint64_t cvl_profiling_now_ns(void) {
+#ifdef __APPLE__
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom) {
+        mach_timebase_info(&timebase);
+    }
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32)) && !defined(__CYGWIN__)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000u +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000u / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+
+/**
+ * Fill @a ts with wall clock UTC time since the Unix epoch. It follows clock adjustments, so measure
+ * intervals with current_monotonic_time.
+ */
+static inline void current_utc_time(struct timespec * const ts) {
 #ifdef __APPLE__ // OS X does not have clock_gettime, use clock_get_time
     clock_serv_t cclock;
     mach_timespec_t mts;
@@ -175,50 +320,538 @@ static inline void current_utc_time(struct timespec *ts) {
     ts->tv_sec = mts.tv_sec;
     ts->tv_nsec = mts.tv_nsec;
 #elif (defined(WIN32) || defined(_WIN32) || defined(__WIN32)) && !defined(__CYGWIN__)
-    cvl_windows_clock_get_time(ts);
+    // FILETIME counts 100 ns intervals since 1601-01-01.
+    FILETIME f;
+    GetSystemTimeAsFileTime(&f);
+    const uint64_t intervals = (((uint64_t)f.dwHighDateTime << 32) | f.dwLowDateTime) - 116444736000000000u;
+    ts->tv_sec = (time_t)(intervals / 10000000u);
+    ts->tv_nsec = (long)(intervals % 10000000u * 100u);
 #else
     clock_gettime(CLOCK_REALTIME, ts);
 #endif
 }
 
+
+
+/** Fill @a ts with cvl_profiling_now_ns monotonic time, which has no relation to calendar time. */
+static inline void current_monotonic_time(struct timespec * const ts) {
+    const uint64_t now_ns = cvl_profiling_now_ns();
+    ts->tv_sec = (time_t)(now_ns / 1000000000u);
+    ts->tv_nsec = (long)(now_ns % 1000000000u);
+}
+
+
+
+#if CVL_PROFILING_USE_TSC
+
+/** Return TSC period in nanoseconds, calibrated against monotonic clock over about 10 ms once. */
+static inline double cvl_profiling_ns_per_tick(void) {
+    if (cvl_once_begin(&cvl_profiling_global.tsc_once)) {
+        const uint64_t start_ns = cvl_profiling_now_ns();
+        const uint64_t start_ticks = (uint64_t)__rdtsc();
+        uint64_t now_ns;
+        do {
+            now_ns = cvl_profiling_now_ns();
+        } while (now_ns - start_ns < 10000000u);
+        cvl_profiling_global.ns_per_tick = (double)(now_ns - start_ns) / (double)((uint64_t)__rdtsc() - start_ticks);
+        cvl_once_end(&cvl_profiling_global.tsc_once);
+    }
+    return cvl_profiling_global.ns_per_tick;
+}
+
+#endif
+
+
+
+/** Return raw profiling timestamp: TSC ticks or nanoseconds. @see cvl_profiling_ticks_to_ns */
+static inline uint64_t cvl_profiling_ticks(void) {
+#if CVL_PROFILING_USE_TSC
+    // Calibrate before the first timestamp, not inside the first profiled block.
+    cvl_profiling_ns_per_tick();
+    return (uint64_t)__rdtsc();
+#else
+    return cvl_profiling_now_ns();
+#endif
+}
+
+
+
+/** Convert difference of two cvl_profiling_ticks values to nanoseconds. */
+static inline uint64_t cvl_profiling_ticks_to_ns(const uint64_t ticks) {
+#if CVL_PROFILING_USE_TSC
+    return (uint64_t)((double)ticks * cvl_profiling_ns_per_tick());
+#else
+    return ticks;
+#endif
+}
+
+
+
+/** Return histogram bin of sample. */
+static inline unsigned cvl_profiling_histogram_bin(const uint64_t ns) {
+    const unsigned sub_bins = 1u << CVL_PROFILING_HISTOGRAM_SUB_BITS;
+    if (ns < sub_bins) {
+        return (unsigned)ns;
+    }
+    unsigned msb = 0;
+    for (uint64_t v = ns >> 1; v; v >>= 1) {
+        ++msb;
+    }
+    const unsigned shift = msb - CVL_PROFILING_HISTOGRAM_SUB_BITS;
+    return ((msb - CVL_PROFILING_HISTOGRAM_SUB_BITS + 1) << CVL_PROFILING_HISTOGRAM_SUB_BITS) +
+           (unsigned)((ns >> shift) & (sub_bins - 1));
+}
+
+
+
+/** Return middle value of histogram bin. */
+static inline double cvl_profiling_histogram_value(const unsigned bin) {
+    const unsigned sub_bins = 1u << CVL_PROFILING_HISTOGRAM_SUB_BITS;
+    if (bin < sub_bins) {
+        return (double)bin;
+    }
+    const unsigned shift = (bin >> CVL_PROFILING_HISTOGRAM_SUB_BITS) - 1;
+    const double lower = (double)(sub_bins + (bin & (sub_bins - 1))) * (double)((uint64_t)1 << shift);
+    return lower + 0.5 * (double)((uint64_t)1 << shift);
+}
+
+
+
+/** Return head of list of thread tables. */
+static inline CVLAtomicSize *cvl_profiling_thread_list(void) {
+    return &cvl_profiling_global.threads;
+}
+
+
+
+static inline void cvl_profiling_dump(FILE *file);
+
+static inline void cvl_profiling_dump_at_exit(void) {
+    cvl_profiling_dump(NULL);
+}
+
+
+
+/** Close hardware counters of thread table and return it to the list for reuse. */
+static inline void CVL_THREAD_KEY_DESTRUCTOR_API cvl_profiling_thread_exit(void * const value) {
+    CVLProfileThread * const thread = (CVLProfileThread *)value;
+#if CVL_PROFILING_USE_PERF
+    if (thread->perf_state > 0) {
+        for (int i = CVL_PROFILING_COUNTER_COUNT - 1; i >= 0; --i) {
+            if (thread->perf_fds[i] >= 0) {
+                close(thread->perf_fds[i]);
+            }
+        }
+    }
+#endif
+    thread->perf_state = 0;
+    cvl_atomic_store(&thread->in_use, 0);
+}
+
+
+
+/** Return key releasing thread tables at thread exit, NULL if keys are not available. */
+static inline const CVLThreadKey *cvl_profiling_thread_key(void) {
+    CVLProfileGlobal * const global = &cvl_profiling_global;
+    if (cvl_once_begin(&global->key_once)) {
+        global->key_created = cvl_thread_key_create(&global->key, cvl_profiling_thread_exit);
+        cvl_once_end(&global->key_once);
+    }
+    return global->key_created ? &global->key : NULL;
+}
+
+
+
+/**
+ * Return statistics table of calling thread, claimed from tables of exited threads or created on
+ * first use. Table is kept in the shared thread key, so all translation units use the same table.
+ * @return NULL on allocation failure or if no thread key is available.
+ */
+static inline CVLProfileThread *cvl_profiling_thread(void) {
+    const CVLThreadKey * const key = cvl_profiling_thread_key();
+    if (!key) {
+        return NULL;
+    }
+    CVLProfileThread *thread = (CVLProfileThread *)cvl_thread_key_get(*key);
+    if (thread) {
+        return thread;
+    }
+    CVLAtomicSize * const list = cvl_profiling_thread_list();
+    for (thread = (CVLProfileThread *)cvl_atomic_load(list); thread; thread = thread->next) {
+        size_t expected = 0;
+        if (cvl_atomic_compare_exchange(&thread->in_use, &expected, 1)) {
+            break;
+        }
+    }
+    if (!thread) {
+        thread = (CVLProfileThread *)calloc(1, sizeof(CVLProfileThread));
+        if (!thread) {
+            return NULL;
+        }
+        thread->in_use = 1;
+        size_t head = cvl_atomic_load(list);
+        do {
+            thread->next = (CVLProfileThread *)head;
+        } while (!cvl_atomic_compare_exchange(list, &head, (size_t)thread));
+#if CVL_PROFILING_DUMP_AT_EXIT
+        if (!head) {
+            atexit(cvl_profiling_dump_at_exit);
+        }
+#endif
+    }
+    cvl_thread_key_set(*key, thread);
+    return thread;
+}
+
+
+
+/** Return statistics slot of tag in thread table, NULL if table is full. */
+static inline CVLProfileStats *cvl_profiling_thread_stats(CVLProfileThread * const thread, const char * const tag) {
+    const size_t mask = CVL_PROFILING_MAX_TAGS - 1;
+    size_t slot = ((size_t)tag >> 3) * 0x9E3779B1u;
+    for (size_t probe = 0; probe < CVL_PROFILING_MAX_TAGS; ++probe, ++slot) {
+        CVLProfileStats * const stats = &thread->stats[slot & mask];
+        if (stats->tag == (size_t)tag) {
+            return stats;
+        }
+        if (!stats->tag) {
+            stats->min_ns = UINT64_MAX;
+            cvl_atomic_store(&stats->tag, (size_t)tag);
+            return stats;
+        }
+    }
+    return NULL;
+}
+
+
+
+#if CVL_PROFILING_USE_PERF
+
+/** Open counter of calling thread, in group of @a group_fd or as group leader if it is -1. */
+static inline int cvl_profiling_open_counter(const uint32_t type, const uint64_t config, const int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+
+
+/** Open counter group of calling thread. Missing counters other than cycles are skipped. */
+static inline void cvl_profiling_open_counters(CVLProfileThread * const thread) {
+    static const uint64_t configs[CVL_PROFILING_COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    thread->perf_state = -1;
+    thread->perf_fds[0] = cvl_profiling_open_counter(PERF_TYPE_HARDWARE, configs[0], -1);
+    if (thread->perf_fds[0] < 0) {
+        return;
+    }
+    int members = 1;
+    thread->perf_index[0] = 0;
+    for (int i = 1; i < CVL_PROFILING_COUNTER_COUNT; ++i) {
+        thread->perf_fds[i] = cvl_profiling_open_counter(PERF_TYPE_HARDWARE, configs[i], thread->perf_fds[0]);
+        thread->perf_index[i] = thread->perf_fds[i] < 0 ? -1 : members++;
+    }
+    ioctl(thread->perf_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    thread->perf_state = 1;
+}
+
+#endif // CVL_PROFILING_USE_PERF
+
+
+
+/**
+ * Read hardware counters of calling thread.
+ * @a counters->valid is false if counters are not available or CVL_PROFILING_PERF is disabled.
+ */
+static inline void cvl_profiling_read_counters(CVLProfileCounters * const counters) {
+    counters->valid = false;
+#if CVL_PROFILING_USE_PERF
+    CVLProfileThread * const thread = cvl_profiling_thread();
+    if (!thread) {
+        return;
+    }
+    if (!thread->perf_state) {
+        cvl_profiling_open_counters(thread);
+    }
+    uint64_t data[3 + CVL_PROFILING_COUNTER_COUNT];
+    if (thread->perf_state < 0 || read(thread->perf_fds[0], data, sizeof(data)) < (ssize_t)(4 * sizeof(uint64_t))) {
+        return;
+    }
+    counters->time_enabled = data[1];
+    counters->time_running = data[2];
+    for (int i = 0; i < CVL_PROFILING_COUNTER_COUNT; ++i) {
+        const int index = thread->perf_index[i];
+        counters->values[i] = index >= 0 && (uint64_t)index < data[0] ? data[3 + index] : 0;
+    }
+    counters->valid = true;
+#endif
+}
+
+
+
+/**
+ * Record @a count samples of tag taking @a elapsed_ns nanoseconds in total, with hardware counter
+ * deltas since @a start if it is valid.
+ *
+ * Statistics are accumulated in table of calling thread without locks or I/O.
+ * @param tag Tag string, string literal or other string living until statistics are dumped.
+ * @param start Counters read at block start or NULL.
+ */
+static inline void cvl_profiling_record_with_counters(const char * const tag,
+                                                      const uint64_t elapsed_ns,
+                                                      const unsigned count,
+                                                      const CVLProfileCounters * const start)
+{
+    CVLProfileThread * const thread = cvl_profiling_thread();
+    if (!thread || !count) {
+        return;
+    }
+    CVLProfileStats * const stats = cvl_profiling_thread_stats(thread, tag);
+    if (!stats) {
+        thread->dropped += count;
+        return;
+    }
+    if (start && start->valid) {
+        CVLProfileCounters end;
+        cvl_profiling_read_counters(&end);
+        // Samples during which the group was multiplexed out of PMU are not counted.
+        if (end.valid && end.time_running - start->time_running == end.time_enabled - start->time_enabled) {
+            stats->counted += count;
+            for (int i = 0; i < CVL_PROFILING_COUNTER_COUNT; ++i) {
+                stats->counters[i] += end.values[i] - start->values[i];
+            }
+        }
+    }
+    const uint64_t sample = elapsed_ns / count;
+    stats->count += count;
+    stats->total_ns += elapsed_ns;
+    if (sample < stats->min_ns) {
+        stats->min_ns = sample;
+    }
+    if (sample > stats->max_ns) {
+        stats->max_ns = sample;
+    }
+    stats->histogram[cvl_profiling_histogram_bin(sample)] += count;
+}
+
+
+
+/** Record @a count samples of tag taking @a elapsed_ns nanoseconds in total, without counters. */
+static inline void cvl_profiling_record(const char * const tag, const uint64_t elapsed_ns, const unsigned count) {
+    cvl_profiling_record_with_counters(tag, elapsed_ns, count, NULL);
+}
+
+
+
+/** Merge statistics of tag over all threads into summary. @return false if tag has no samples. */
+static inline bool cvl_profiling_get_summary(const char * const tag, CVLProfileSummary * const summary) {
+    uint64_t histogram[CVL_PROFILING_HISTOGRAM_BINS];
+    memset(histogram, 0, sizeof(histogram));
+    memset(summary, 0, sizeof(*summary));
+    summary->tag = tag;
+    uint64_t min_ns = UINT64_MAX, max_ns = 0;
+    uint64_t counters[CVL_PROFILING_COUNTER_COUNT] = {0};
+    for (const CVLProfileThread *thread = (const CVLProfileThread *)cvl_atomic_load(cvl_profiling_thread_list());
+         thread; thread = thread->next)
+    {
+        for (size_t i = 0; i < CVL_PROFILING_MAX_TAGS; ++i) {
+            const CVLProfileStats * const stats = &thread->stats[i];
+            const char * const stats_tag = (const char *)cvl_atomic_load((CVLAtomicSize *)&stats->tag);
+            if (!stats_tag || strcmp(stats_tag, tag) || !stats->count) {
+                continue;
+            }
+            summary->count += stats->count;
+            summary->total_ns += (double)stats->total_ns;
+            min_ns = stats->min_ns < min_ns ? stats->min_ns : min_ns;
+            max_ns = stats->max_ns > max_ns ? stats->max_ns : max_ns;
+            for (unsigned b = 0; b < CVL_PROFILING_HISTOGRAM_BINS; ++b) {
+                histogram[b] += stats->histogram[b];
+            }
+            summary->counted += stats->counted;
+            for (int c = 0; c < CVL_PROFILING_COUNTER_COUNT; ++c) {
+                counters[c] += stats->counters[c];
+            }
+        }
+    }
+    if (!summary->count) {
+        return false;
+    }
+    summary->mean_ns = summary->total_ns / (double)summary->count;
+    summary->min_ns = (double)min_ns;
+    summary->max_ns = (double)max_ns;
+    if (summary->counted) {
+        const double counted = (double)summary->counted;
+        summary->cycles = (double)counters[CVL_PROFILING_CYCLES] / counted;
+        summary->instructions = (double)counters[CVL_PROFILING_INSTRUCTIONS] / counted;
+        summary->ipc = summary->cycles > 0.0 ? summary->instructions / summary->cycles : 0.0;
+        summary->llc_misses = (double)counters[CVL_PROFILING_LLC_MISSES] / counted;
+        summary->branch_misses = (double)counters[CVL_PROFILING_BRANCH_MISSES] / counted;
+    }
+
+    // Percentiles from cumulative histogram, clamped to exact extremes.
+    const uint64_t p50_rank = (summary->count + 1) / 2;
+    const uint64_t p99_rank = (summary->count * 99 + 99) / 100;
+    uint64_t cumulative = 0;
+    for (unsigned b = 0; b < CVL_PROFILING_HISTOGRAM_BINS; ++b) {
+        const uint64_t previous = cumulative;
+        cumulative += histogram[b];
+        if (previous < p50_rank && cumulative >= p50_rank) {
+            summary->p50_ns = cvl_profiling_histogram_value(b);
+        }
+        if (previous < p99_rank && cumulative >= p99_rank) {
+            summary->p99_ns = cvl_profiling_histogram_value(b);
+            break;
+        }
+    }
+    summary->p50_ns = summary->p50_ns < summary->min_ns ? summary->min_ns : summary->p50_ns;
+    summary->p50_ns = summary->p50_ns > summary->max_ns ? summary->max_ns : summary->p50_ns;
+    summary->p99_ns = summary->p99_ns < summary->min_ns ? summary->min_ns : summary->p99_ns;
+    summary->p99_ns = summary->p99_ns > summary->max_ns ? summary->max_ns : summary->p99_ns;
+    return true;
+}
+
+
+
+/**
+ * Print statistics of all tags.
+ *
+ * Tags of the same name recorded by different threads are merged. Dump may run concurrently with
+ * profiled threads, values of tags updated during dump may be slightly inconsistent.
+ * @param file Output file or NULL to print with LOGP.
+ */
+static inline void cvl_profiling_dump(FILE * const file) {
+    const CVLProfileThread * const head = (const CVLProfileThread *)cvl_atomic_load(cvl_profiling_thread_list());
+    size_t dropped = 0;
+    for (const CVLProfileThread *thread = head; thread; thread = thread->next) {
+        dropped += cvl_atomic_load((CVLAtomicSize *)&thread->dropped);
+        for (size_t i = 0; i < CVL_PROFILING_MAX_TAGS; ++i) {
+            const char * const tag = (const char *)cvl_atomic_load((CVLAtomicSize *)&thread->stats[i].tag);
+            if (!tag) {
+                continue;
+            }
+            // Print each tag name once: skip if it was seen in an earlier slot or thread.
+            bool seen = false;
+            for (const CVLProfileThread *other = head; other && !seen; other = other->next) {
+                const size_t end = other == thread ? i : CVL_PROFILING_MAX_TAGS;
+                for (size_t j = 0; j < end && !seen; ++j) {
+                    const char * const other_tag = (const char *)cvl_atomic_load((CVLAtomicSize *)&other->stats[j].tag);
+                    seen = other_tag && !strcmp(other_tag, tag);
+                }
+                if (other == thread) {
+                    break;
+                }
+            }
+            CVLProfileSummary s;
+            if (seen || !cvl_profiling_get_summary(tag, &s)) {
+                continue;
+            }
+            char line[512];
+            int length = snprintf(line, sizeof(line),
+                                  "%s: count %llu, mean %.3f us, min %.3f us, p50 %.3f us, p99 %.3f us, max %.3f us, total %.6f sec.",
+                                  tag, (unsigned long long)s.count, s.mean_ns * 1e-3, s.min_ns * 1e-3, s.p50_ns * 1e-3,
+                                  s.p99_ns * 1e-3, s.max_ns * 1e-3, s.total_ns * 1e-9);
+            if (s.counted && length > 0 && (size_t)length < sizeof(line)) {
+                snprintf(line + length, sizeof(line) - (size_t)length,
+                         " cycles %.0f, instructions %.0f, IPC %.2f, LLC misses %.0f, branch misses %.0f (%llu counted).",
+                         s.cycles, s.instructions, s.ipc, s.llc_misses, s.branch_misses, (unsigned long long)s.counted);
+            }
+            if (file) {
+                fprintf(file, "%s\n", line);
+            }
+            else {
+                LOGP("%s\n", line);
+            }
+        }
+    }
+    if (dropped) {
+        if (file) {
+            fprintf(file, "profiling: %llu samples dropped, increase CVL_PROFILING_MAX_TAGS.\n", (unsigned long long)dropped);
+        }
+        else {
+            LOGP("profiling: %llu samples dropped, increase CVL_PROFILING_MAX_TAGS.\n", (unsigned long long)dropped);
+        }
+    }
+    if (file) {
+        fflush(file);
+    }
+}
+
+
+
+/** Reset statistics of all threads. Samples recorded concurrently with reset may be lost. */
+static inline void cvl_profiling_reset(void) {
+    for (CVLProfileThread *thread = (CVLProfileThread *)cvl_atomic_load(cvl_profiling_thread_list());
+         thread; thread = thread->next)
+    {
+        cvl_atomic_store(&thread->dropped, 0);
+        for (size_t i = 0; i < CVL_PROFILING_MAX_TAGS; ++i) {
+            CVLProfileStats * const stats = &thread->stats[i];
+            stats->count = 0;
+            stats->total_ns = 0;
+            stats->min_ns = UINT64_MAX;
+            stats->max_ns = 0;
+            memset(stats->histogram, 0, sizeof(stats->histogram));
+            stats->counted = 0;
+            memset(stats->counters, 0, sizeof(stats->counters));
+        }
+    }
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#define CVL_PROFILING_DUMP(file) cvl_profiling_dump(file)
+#define CVL_PROFILING_RESET() cvl_profiling_reset()
+
+#if CVL_PROFILING_USE_PERF
+#define CVL_PROFILING_COUNTERS_BEGIN(tag) \
+CVLProfileCounters tag##_start_counters;\
+cvl_profiling_read_counters(&tag##_start_counters);
+#define CVL_PROFILING_COUNTERS(tag) (&tag##_start_counters)
+#else
+#define CVL_PROFILING_COUNTERS_BEGIN(tag)
+#define CVL_PROFILING_COUNTERS(tag) NULL
+#endif
+
 #define CVL_TICN_ONCE(tag) \
-struct timespec tag##_start_ts;\
+CVL_PROFILING_COUNTERS_BEGIN(tag)\
+const uint64_t tag##_start_ts = cvl_profiling_ticks();\
 const unsigned int tag##_batch_size = 1;\
-current_utc_time(&tag##_start_ts);\
 {
 
 #define CVL_TICN_BATCH(tag, count) \
-struct timespec tag##_start_ts;\
+CVL_PROFILING_COUNTERS_BEGIN(tag)\
+const uint64_t tag##_start_ts = cvl_profiling_ticks();\
 const unsigned int tag##_batch_size = count;\
-current_utc_time(&tag##_start_ts);\
 unsigned int tag##_batch_iteration;\
 for (tag##_batch_iteration = 0; tag##_batch_iteration < tag##_batch_size; tag##_batch_iteration+=1)\
 {
 
 #define CVL_TOCN(tag) \
 }\
-struct timespec tag##_finish_ts;\
-current_utc_time(&tag##_finish_ts);\
-double tag##_elapsed = (tag##_finish_ts.tv_sec - tag##_start_ts.tv_sec);\
-tag##_elapsed += (tag##_finish_ts.tv_nsec - tag##_start_ts.tv_nsec) / 1000000000.0;\
-if (tag##_batch_size > 1) {\
-    LOGP(#tag": %f sec. (over %d iterations)\n", tag##_elapsed / tag##_batch_size , tag##_batch_size);\
-}\
-else {\
-    LOGP(#tag": %f sec.\n", tag##_elapsed);\
-}
+cvl_profiling_record_with_counters(#tag, cvl_profiling_ticks_to_ns(cvl_profiling_ticks() - tag##_start_ts),\
+                                   tag##_batch_size, CVL_PROFILING_COUNTERS(tag));
 
 
 #define CVL_TIC(tag) \
-struct timespec tag##_start_ts;\
-current_utc_time(&tag##_start_ts);
+CVL_PROFILING_COUNTERS_BEGIN(tag)\
+const uint64_t tag##_start_ts = cvl_profiling_ticks();
 
 #define CVL_TOC(tag) \
-struct timespec tag##_finish_ts;\
-current_utc_time(&tag##_finish_ts);\
-double tag##_elapsed = (tag##_finish_ts.tv_sec - tag##_start_ts.tv_sec);\
-tag##_elapsed += (tag##_finish_ts.tv_nsec - tag##_start_ts.tv_nsec) / 1000000000.0;\
-LOGP(#tag": %f sec.\n", tag##_elapsed);
+cvl_profiling_record_with_counters(#tag, cvl_profiling_ticks_to_ns(cvl_profiling_ticks() - tag##_start_ts),\
+                                   1, CVL_PROFILING_COUNTERS(tag));
 
 #else
 
@@ -227,6 +860,8 @@ LOGP(#tag": %f sec.\n", tag##_elapsed);
 #define CVL_TICN_BATCH(tag, count)
 #define CVL_TICN_ONCE(tag)
 #define CVL_TOCN(tag)
+#define CVL_PROFILING_DUMP(file)
+#define CVL_PROFILING_RESET()
 #endif
 
 
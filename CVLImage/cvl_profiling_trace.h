@@ -0,0 +1,397 @@
+#ifndef CVL_PROFILING_TRACE_H
+#define CVL_PROFILING_TRACE_H
+
+
+#include "cvl_profiling.h"
+
+/*
+ * Scoped profiling zones.
+ *
+ * Zones may be nested and repeated with the same name in one scope. Each completed zone is stored
+ * as a span (name, thread, begin, duration, depth) into a lock-free ring buffer of the calling
+ * thread and is also recorded into CVL_TIC statistics of its name. Spans are exported to Chrome
+ * Trace Event JSON, viewable in chrome://tracing or Perfetto UI.
+ *
+ * Usage.
+ * C:
+ * CVL_ZONE_BEGIN("resize");
+ * ...code...
+ * CVL_ZONE_END();
+ *
+ * C++:
+ * {
+ *     CVL_ZONE("resize");
+ *     ...code...
+ * }
+ *
+ * CVL_TRACE_EXPORT("trace.json");
+ *
+ * Zones compile to nothing unless CVL_PROFILING is enabled. Zone names must be string literals
+ * or other strings living until export.
+ */
+
+/**
+ * \def CVL_ZONE_BEGIN(name)
+ * Open zone of calling thread. Companion macro for CVL_ZONE_END().
+ */
+
+/**
+ * \def CVL_ZONE_END()
+ * Close the innermost open zone of calling thread.
+ */
+
+/**
+ * \def CVL_ZONE(name)
+ * C++ only. Open zone closed at the end of enclosing scope.
+ */
+
+/**
+ * \def CVL_TRACE_THREAD_NAME(name)
+ * Set name of calling thread shown in trace viewer.
+ */
+
+/**
+ * \def CVL_TRACE_EXPORT(path)
+ * Write spans of all threads to Chrome Trace Event JSON file, evaluates to false on failure or
+ * when profiling is disabled.
+ */
+
+#if CVL_PROFILING
+
+/** Number of spans kept per thread, power of two. Oldest spans are overwritten. */
+#ifndef CVL_TRACE_RING_SPANS
+#define CVL_TRACE_RING_SPANS 16384
+#endif
+
+/** Maximal nesting depth of zones, deeper zones are counted but not recorded. */
+#ifndef CVL_TRACE_MAX_DEPTH
+#define CVL_TRACE_MAX_DEPTH 64
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Completed zone. */
+typedef struct {
+    const char *name;
+    uint64_t begin;  ///< cvl_profiling_ticks at zone begin.
+    uint64_t end;    ///< cvl_profiling_ticks at zone end.
+    uint32_t depth;  ///< Nesting depth, 0 for top level zones.
+    uint32_t tid;    ///< Trace tid of recording thread, rings of exited threads keep older spans.
+} CVLTraceSpan;
+
+/** Open zone. */
+typedef struct {
+    const char *name;
+    uint64_t begin;
+} CVLTraceOpenZone;
+
+/**
+ * Trace state of one thread.
+ *
+ * Spans are written only by owning thread. The ring is single producer: @a written is published
+ * with release semantics after a span is stored, exporter copies spans and discards the ones which
+ * could have been overwritten during copy.
+ *
+ * When a thread exits its state is returned to the list and is claimed by the next new thread,
+ * which gets a fresh trace tid and appends to the same ring. Spans carry tid of their thread, so
+ * threads sharing a ring are exported as separate timeline rows. Memory is bounded by the peak
+ * number of concurrent threads.
+ */
+typedef struct CVLTraceThread {
+    struct CVLTraceThread *next;
+    CVLAtomicSize in_use;          ///< State is owned by a running thread.
+    size_t id;                     ///< Sequential number of owning thread, used as trace tid.
+    CVLAtomicSize name;            ///< Thread name pointer or 0.
+    size_t depth;                  ///< Number of open zones.
+    CVLTraceOpenZone open[CVL_TRACE_MAX_DEPTH];
+    CVLAtomicSize written;         ///< Number of spans ever written.
+    CVLTraceSpan spans[CVL_TRACE_RING_SPANS];
+} CVLTraceThread;
+
+
+
+/** Process-wide trace state, one definition shared by all translation units. */
+typedef struct {
+    CVLAtomicSize threads;   ///< Head of list of trace thread states.
+    CVLAtomicSize counter;   ///< Number of threads which owned a state, last trace tid.
+    CVLAtomicSize key_once;  ///< cvl_once_begin state of thread key.
+    CVLThreadKey key;        ///< Key holding state of calling thread, returns it at thread exit.
+    bool key_created;        ///< False if no thread key was available.
+} CVLTraceGlobal;
+
+CVL_SHARED_GLOBAL CVLTraceGlobal cvl_trace_global = {0, 0, 0, 0, false};
+
+
+
+/** Return head of list of trace threads. */
+static inline CVLAtomicSize *cvl_trace_thread_list(void) {
+    return &cvl_trace_global.threads;
+}
+
+
+
+/** Drop open zones and name of trace state and return it to the list for reuse. */
+static inline void CVL_THREAD_KEY_DESTRUCTOR_API cvl_trace_thread_exit(void * const value) {
+    CVLTraceThread * const thread = (CVLTraceThread *)value;
+    thread->depth = 0;
+    cvl_atomic_store(&thread->name, 0);
+    cvl_atomic_store(&thread->in_use, 0);
+}
+
+
+
+/** Return key releasing trace states at thread exit, NULL if keys are not available. */
+static inline const CVLThreadKey *cvl_trace_thread_key(void) {
+    CVLTraceGlobal * const global = &cvl_trace_global;
+    if (cvl_once_begin(&global->key_once)) {
+        global->key_created = cvl_thread_key_create(&global->key, cvl_trace_thread_exit);
+        cvl_once_end(&global->key_once);
+    }
+    return global->key_created ? &global->key : NULL;
+}
+
+
+
+/**
+ * Return trace state of calling thread, claimed from states of exited threads or created on first
+ * use. State is kept in the shared thread key, so zones may begin and end in different
+ * translation units.
+ * @return NULL on allocation failure or if no thread key is available.
+ */
+static inline CVLTraceThread *cvl_trace_thread(void) {
+    const CVLThreadKey * const key = cvl_trace_thread_key();
+    if (!key) {
+        return NULL;
+    }
+    CVLTraceThread *thread = (CVLTraceThread *)cvl_thread_key_get(*key);
+    if (thread) {
+        return thread;
+    }
+    CVLAtomicSize * const list = cvl_trace_thread_list();
+    for (thread = (CVLTraceThread *)cvl_atomic_load(list); thread; thread = thread->next) {
+        size_t expected = 0;
+        if (cvl_atomic_compare_exchange(&thread->in_use, &expected, 1)) {
+            break;
+        }
+    }
+    if (!thread) {
+        thread = (CVLTraceThread *)calloc(1, sizeof(CVLTraceThread));
+        if (!thread) {
+            return NULL;
+        }
+        thread->in_use = 1;
+        size_t head = cvl_atomic_load(list);
+        do {
+            thread->next = (CVLTraceThread *)head;
+        } while (!cvl_atomic_compare_exchange(list, &head, (size_t)thread));
+    }
+    thread->id = cvl_atomic_fetch_add(&cvl_trace_global.counter, 1) + 1;
+    cvl_thread_key_set(*key, thread);
+    return thread;
+}
+
+
+
+/** Set name of calling thread shown in trace viewer. Name must live until export. */
+static inline void cvl_trace_set_thread_name(const char * const name) {
+    CVLTraceThread * const thread = cvl_trace_thread();
+    if (thread) {
+        cvl_atomic_store(&thread->name, (size_t)name);
+    }
+}
+
+
+
+/** Open zone of calling thread. */
+static inline void cvl_trace_begin(const char * const name) {
+    CVLTraceThread * const thread = cvl_trace_thread();
+    if (!thread) {
+        return;
+    }
+    if (thread->depth < CVL_TRACE_MAX_DEPTH) {
+        thread->open[thread->depth].name = name;
+        thread->open[thread->depth].begin = cvl_profiling_ticks();
+    }
+    ++thread->depth;
+}
+
+
+
+/** Close the innermost open zone of calling thread. */
+static inline void cvl_trace_end(void) {
+    const uint64_t end = cvl_profiling_ticks();
+    CVLTraceThread * const thread = cvl_trace_thread();
+    if (!thread || !thread->depth) {
+        return;
+    }
+    const size_t depth = --thread->depth;
+    if (depth >= CVL_TRACE_MAX_DEPTH) {
+        return;
+    }
+    const CVLTraceOpenZone * const zone = &thread->open[depth];
+    const size_t written = thread->written;
+    CVLTraceSpan * const span = &thread->spans[written & (CVL_TRACE_RING_SPANS - 1)];
+    span->name = zone->name;
+    span->begin = zone->begin;
+    span->end = end;
+    span->depth = (uint32_t)depth;
+    span->tid = (uint32_t)thread->id;
+    cvl_atomic_store(&thread->written, written + 1);
+    cvl_profiling_record(zone->name, cvl_profiling_ticks_to_ns(end - zone->begin), 1);
+}
+
+
+
+/**
+ * Return index of the oldest span which is safe to read after @a written spans were published.
+ * The slot following the newest span may be being overwritten, so it is never read.
+ */
+static inline size_t cvl_trace_first_retained(const size_t written) {
+    return written >= CVL_TRACE_RING_SPANS ? written - CVL_TRACE_RING_SPANS + 1 : 0;
+}
+
+
+
+/** Write string as JSON string literal. */
+static inline void cvl_trace_write_json_string(FILE * const file, const char *string) {
+    fputc('"', file);
+    for (; *string; ++string) {
+        const unsigned char c = (unsigned char)*string;
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        }
+        else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        }
+        else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+
+
+/**
+ * Write spans of all threads to Chrome Trace Event JSON file.
+ *
+ * Export may run while threads keep recording, spans overwritten during export are skipped.
+ * Timestamps are relative to the earliest exported span.
+ * @return false if file could not be written or spans could not be copied.
+ */
+static inline bool cvl_trace_export_chrome(const char * const path) {
+    const CVLTraceThread * const head = (const CVLTraceThread *)cvl_atomic_load(cvl_trace_thread_list());
+    CVLTraceSpan * const spans = (CVLTraceSpan *)malloc(CVL_TRACE_RING_SPANS * sizeof(CVLTraceSpan));
+    FILE * const file = spans ? fopen(path, "w") : NULL;
+    if (!file) {
+        free(spans);
+        return false;
+    }
+
+    // Earliest span over retained spans of all threads.
+    uint64_t epoch = UINT64_MAX;
+    for (const CVLTraceThread *thread = head; thread; thread = thread->next) {
+        const size_t written = cvl_atomic_load((CVLAtomicSize *)&thread->written);
+        for (size_t i = cvl_trace_first_retained(written); i < written; ++i) {
+            const uint64_t begin = thread->spans[i & (CVL_TRACE_RING_SPANS - 1)].begin;
+            epoch = begin < epoch ? begin : epoch;
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first_event = true;
+    for (const CVLTraceThread *thread = head; thread; thread = thread->next) {
+        const char * const name = (const char *)cvl_atomic_load((CVLAtomicSize *)&thread->name);
+        if (name) {
+            fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ",
+                    first_event ? "" : ",\n", (unsigned)thread->id);
+            cvl_trace_write_json_string(file, name);
+            fprintf(file, "}}");
+            first_event = false;
+        }
+
+        // Copy retained spans, then drop those the owner may have overwritten meanwhile.
+        const size_t written = cvl_atomic_load((CVLAtomicSize *)&thread->written);
+        const size_t first = cvl_trace_first_retained(written);
+        for (size_t i = first; i < written; ++i) {
+            spans[i - first] = thread->spans[i & (CVL_TRACE_RING_SPANS - 1)];
+        }
+        const size_t valid = cvl_trace_first_retained(cvl_atomic_load((CVLAtomicSize *)&thread->written));
+        for (size_t i = valid > first ? valid : first; i < written; ++i) {
+            const CVLTraceSpan * const span = &spans[i - first];
+            const double ts_us = (double)cvl_profiling_ticks_to_ns(span->begin - epoch) * 1e-3;
+            const double dur_us = (double)cvl_profiling_ticks_to_ns(span->end - span->begin) * 1e-3;
+            fprintf(file, "%s{\"name\": ", first_event ? "" : ",\n");
+            cvl_trace_write_json_string(file, span->name);
+            fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"depth\": %u}}",
+                    (unsigned)span->tid, ts_us, dur_us, (unsigned)span->depth);
+            first_event = false;
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    const bool ok = !ferror(file);
+    free(spans);
+    return fclose(file) == 0 && ok;
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#define CVL_ZONE_BEGIN(name) cvl_trace_begin(name)
+#define CVL_ZONE_END() cvl_trace_end()
+#define CVL_TRACE_THREAD_NAME(name) cvl_trace_set_thread_name(name)
+#define CVL_TRACE_EXPORT(path) cvl_trace_export_chrome(path)
+
+#ifdef __cplusplus
+
+namespace cvl {
+
+/** Profiling zone open for the lifetime of object. */
+class ProfileZone {
+public:
+    explicit ProfileZone(const char * const name) {
+        cvl_trace_begin(name);
+    }
+
+    ~ProfileZone() {
+        cvl_trace_end();
+    }
+
+private:
+    ProfileZone(const ProfileZone &);
+    ProfileZone &operator=(const ProfileZone &);
+};
+
+}  // namespace cvl
+
+#define CVL_ZONE_CONCAT_IMPL(A, B) A##B
+#define CVL_ZONE_CONCAT(A, B) CVL_ZONE_CONCAT_IMPL(A, B)
+#ifdef __COUNTER__
+#define CVL_ZONE(name) const cvl::ProfileZone CVL_ZONE_CONCAT(cvl_profile_zone_, __COUNTER__)(name)
+#else
+#define CVL_ZONE(name) const cvl::ProfileZone CVL_ZONE_CONCAT(cvl_profile_zone_, __LINE__)(name)
+#endif
+
+#endif // __cplusplus
+
+#else
+
+#define CVL_ZONE_BEGIN(name)
+#define CVL_ZONE_END()
+#define CVL_TRACE_THREAD_NAME(name)
+#define CVL_TRACE_EXPORT(path) false
+#ifdef __cplusplus
+#define CVL_ZONE(name)
+#endif
+
+#endif // CVL_PROFILING
+
+
+#endif //CVL_PROFILING_TRACE_H
@@ -0,0 +1,716 @@
+#ifndef CVL_RECT_BATCH_H
+#define CVL_RECT_BATCH_H
+
+
+#include "cvl_image_parallel.h"
+#include "cvl_simd.h"
+
+/*
+ * Batches of rects in structure of arrays layout.
+ *
+ * Coordinates of all rects are stored in four aligned arrays (x, y, width, height), so geometry
+ * kernels process several rects per instruction. Kernels follow semantics of the scalar helpers
+ * in cvl_image_utils.h: rects are [x, x + width) x [y, y + height), empty rects have non-positive
+ * width or height.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Rects in structure of arrays layout. */
+typedef struct {
+    int *x;
+    int *y;
+    int *width;
+    int *height;
+    size_t count;     ///< Number of rects.
+    size_t capacity;  ///< Number of allocated rects.
+} CVLRectBatch;
+
+
+
+/** Initialize empty batch. @return false on allocation failure. */
+static inline bool cvl_rect_batch_init(CVLRectBatch * const batch, const size_t capacity) {
+    memset(batch, 0, sizeof(*batch));
+    if (!capacity) {
+        return true;
+    }
+    // Capacity is a multiple of 16 rects, so every array starts at 64 byte boundary.
+    const size_t aligned_capacity = (capacity + 15) & ~(size_t)15;
+    int * const data = (int *)cvl_image_data_alloc(4 * aligned_capacity * sizeof(int), CVL_IMAGE_DEFAULT_ALIGNMENT);
+    if (!data) {
+        return false;
+    }
+    batch->x = data;
+    batch->y = data + aligned_capacity;
+    batch->width = data + 2 * aligned_capacity;
+    batch->height = data + 3 * aligned_capacity;
+    batch->capacity = aligned_capacity;
+    return true;
+}
+
+
+
+/** Release batch memory. */
+static inline void cvl_rect_batch_release(CVLRectBatch * const batch) {
+    cvl_image_data_free(batch->x);
+    memset(batch, 0, sizeof(*batch));
+}
+
+
+
+/** Make room for @a capacity rects keeping existing ones. @return false on allocation failure. */
+static inline bool cvl_rect_batch_reserve(CVLRectBatch * const batch, const size_t capacity) {
+    if (capacity <= batch->capacity) {
+        return true;
+    }
+    CVLRectBatch grown;
+    if (!cvl_rect_batch_init(&grown, capacity > 2 * batch->capacity ? capacity : 2 * batch->capacity)) {
+        return false;
+    }
+    if (batch->count) {
+        memcpy(grown.x, batch->x, batch->count * sizeof(int));
+        memcpy(grown.y, batch->y, batch->count * sizeof(int));
+        memcpy(grown.width, batch->width, batch->count * sizeof(int));
+        memcpy(grown.height, batch->height, batch->count * sizeof(int));
+    }
+    grown.count = batch->count;
+    cvl_rect_batch_release(batch);
+    *batch = grown;
+    return true;
+}
+
+
+
+/** Append rect. @return false on allocation failure. */
+static inline bool cvl_rect_batch_push(CVLRectBatch * const batch, const CVLRect rect) {
+    if (!cvl_rect_batch_reserve(batch, batch->count + 1)) {
+        return false;
+    }
+    const size_t i = batch->count++;
+    batch->x[i] = rect.x;
+    batch->y[i] = rect.y;
+    batch->width[i] = rect.width;
+    batch->height[i] = rect.height;
+    return true;
+}
+
+
+
+/** Replace batch content with @a count rects of array. @return false on allocation failure. */
+static inline bool cvl_rect_batch_assign(CVLRectBatch * const batch, const CVLRect * const rects, const size_t count) {
+    batch->count = 0;
+    if (!cvl_rect_batch_reserve(batch, count)) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        batch->x[i] = rects[i].x;
+        batch->y[i] = rects[i].y;
+        batch->width[i] = rects[i].width;
+        batch->height[i] = rects[i].height;
+    }
+    batch->count = count;
+    return true;
+}
+
+
+
+/** Return rect @a i of batch. */
+static inline CVLRect cvl_rect_batch_get(const CVLRectBatch * const batch, const size_t i) {
+    assert(i < batch->count);
+    return cvl_rect_make(batch->x[i], batch->y[i], batch->width[i], batch->height[i]);
+}
+
+
+
+/** Store all rects of batch into array of batch->count rects. */
+static inline void cvl_rect_batch_store(const CVLRectBatch * const batch, CVLRect * const rects) {
+    for (size_t i = 0; i < batch->count; ++i) {
+        rects[i] = cvl_rect_batch_get(batch, i);
+    }
+}
+
+
+
+/** Move all rects by @a offset, see cvl_rect_move. */
+static inline void cvl_rect_batch_translate(CVLRectBatch * const batch, const CVLPoint offset) {
+    int * const CVL_RESTRICT x = batch->x;
+    int * const CVL_RESTRICT y = batch->y;
+    const size_t n = batch->count;
+    for (size_t i = 0; i < n; ++i) {
+        x[i] += offset.x;
+        y[i] += offset.y;
+    }
+}
+
+
+
+/**
+ * Write mask[i] = 1 if rect i is not empty and completely inside image of @a height x @a width
+ * (see cvl_rect_is_good_roi), otherwise 0.
+ * @return Number of good rects.
+ */
+static inline size_t cvl_rect_batch_good_roi_mask(const CVLRectBatch * const batch,
+                                                  const CVLImagePixelCount height,
+                                                  const CVLImagePixelCount width,
+                                                  uint8_t * const CVL_RESTRICT mask)
+{
+    const int * const CVL_RESTRICT x = batch->x;
+    const int * const CVL_RESTRICT y = batch->y;
+    const int * const CVL_RESTRICT w = batch->width;
+    const int * const CVL_RESTRICT h = batch->height;
+    const int image_width = (int)width;
+    const int image_height = (int)height;
+    const size_t n = batch->count;
+    size_t good = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const int inside = (w[i] > 0) & (h[i] > 0) & (x[i] >= 0) & (y[i] >= 0) &
+                           (x[i] <= image_width - w[i]) & (y[i] <= image_height - h[i]);
+        mask[i] = (uint8_t)inside;
+        good += (size_t)inside;
+    }
+    return good;
+}
+
+
+
+#if CVL_SIMD_SSE2
+
+static inline __m128i cvl_rect_batch_min_epi32(const __m128i a, const __m128i b) {
+    const __m128i a_greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(a_greater, b), _mm_andnot_si128(a_greater, a));
+}
+
+
+
+static inline __m128i cvl_rect_batch_max_epi32(const __m128i a, const __m128i b) {
+    const __m128i a_greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(a_greater, a), _mm_andnot_si128(a_greater, b));
+}
+
+#endif
+
+
+
+/**
+ * Intersect @a count rects of arrays (ax, ay, aw, ah) and (bx, by, bw, bh) pairwise into
+ * (ox, oy, ow, oh). Empty intersections get zero width and height. Output may alias inputs.
+ */
+static inline void cvl_rect_batch_intersect_arrays(const int * const ax, const int * const ay,
+                                                   const int * const aw, const int * const ah,
+                                                   const int * const bx, const int * const by,
+                                                   const int * const bw, const int * const bh,
+                                                   int * const ox, int * const oy,
+                                                   int * const ow, int * const oh,
+                                                   const size_t count)
+{
+    size_t i = 0;
+#if CVL_SIMD_SSE2
+    const __m128i one = _mm_set1_epi32(1);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i vax = _mm_loadu_si128((const __m128i *)(ax + i));
+        const __m128i vay = _mm_loadu_si128((const __m128i *)(ay + i));
+        const __m128i vbx = _mm_loadu_si128((const __m128i *)(bx + i));
+        const __m128i vby = _mm_loadu_si128((const __m128i *)(by + i));
+        const __m128i x1 = cvl_rect_batch_max_epi32(vax, vbx);
+        const __m128i y1 = cvl_rect_batch_max_epi32(vay, vby);
+        const __m128i x2 = cvl_rect_batch_min_epi32(_mm_add_epi32(vax, _mm_loadu_si128((const __m128i *)(aw + i))),
+                                                    _mm_add_epi32(vbx, _mm_loadu_si128((const __m128i *)(bw + i))));
+        const __m128i y2 = cvl_rect_batch_min_epi32(_mm_add_epi32(vay, _mm_loadu_si128((const __m128i *)(ah + i))),
+                                                    _mm_add_epi32(vby, _mm_loadu_si128((const __m128i *)(bh + i))));
+        __m128i w = _mm_sub_epi32(x2, x1);
+        __m128i h = _mm_sub_epi32(y2, y1);
+        const __m128i empty = _mm_or_si128(_mm_cmpgt_epi32(one, w), _mm_cmpgt_epi32(one, h));
+        w = _mm_andnot_si128(empty, w);
+        h = _mm_andnot_si128(empty, h);
+        _mm_storeu_si128((__m128i *)(ox + i), x1);
+        _mm_storeu_si128((__m128i *)(oy + i), y1);
+        _mm_storeu_si128((__m128i *)(ow + i), w);
+        _mm_storeu_si128((__m128i *)(oh + i), h);
+    }
+#endif
+    for (; i < count; ++i) {
+        const int x1 = ax[i] > bx[i] ? ax[i] : bx[i];
+        const int y1 = ay[i] > by[i] ? ay[i] : by[i];
+        const int x2 = ax[i] + aw[i] < bx[i] + bw[i] ? ax[i] + aw[i] : bx[i] + bw[i];
+        const int y2 = ay[i] + ah[i] < by[i] + bh[i] ? ay[i] + ah[i] : by[i] + bh[i];
+        const bool empty = x2 <= x1 || y2 <= y1;
+        ox[i] = x1;
+        oy[i] = y1;
+        ow[i] = empty ? 0 : x2 - x1;
+        oh[i] = empty ? 0 : y2 - y1;
+    }
+}
+
+
+
+/**
+ * Intersect rects of @a a and @a b pairwise into @a out, which may be @a a or @a b.
+ * Batches must have the same count. @return false on allocation failure.
+ */
+static inline bool cvl_rect_batch_intersect(const CVLRectBatch * const a,
+                                            const CVLRectBatch * const b,
+                                            CVLRectBatch * const out)
+{
+    assert(a->count == b->count);
+    const size_t count = a->count;
+    if (!cvl_rect_batch_reserve(out, count)) {
+        return false;
+    }
+    cvl_rect_batch_intersect_arrays(a->x, a->y, a->width, a->height, b->x, b->y, b->width, b->height,
+                                    out->x, out->y, out->width, out->height, count);
+    out->count = count;
+    return true;
+}
+
+
+
+/**
+ * Clip all rects to image of @a height x @a width, see cvl_image_subimage.
+ * Rects outside of image get zero width and height.
+ */
+static inline void cvl_rect_batch_clip(CVLRectBatch * const batch,
+                                       const CVLImagePixelCount height,
+                                       const CVLImagePixelCount width)
+{
+    const int image_width = (int)width;
+    const int image_height = (int)height;
+    size_t i = 0;
+    int * const x = batch->x;
+    int * const y = batch->y;
+    int * const w = batch->width;
+    int * const h = batch->height;
+    const size_t n = batch->count;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i vwidth = _mm_set1_epi32(image_width);
+    const __m128i vheight = _mm_set1_epi32(image_height);
+    for (; i + 4 <= n; i += 4) {
+        const __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+        const __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+        const __m128i x1 = cvl_rect_batch_max_epi32(vx, zero);
+        const __m128i y1 = cvl_rect_batch_max_epi32(vy, zero);
+        const __m128i x2 = cvl_rect_batch_min_epi32(_mm_add_epi32(vx, _mm_loadu_si128((const __m128i *)(w + i))), vwidth);
+        const __m128i y2 = cvl_rect_batch_min_epi32(_mm_add_epi32(vy, _mm_loadu_si128((const __m128i *)(h + i))), vheight);
+        __m128i vw = _mm_sub_epi32(x2, x1);
+        __m128i vh = _mm_sub_epi32(y2, y1);
+        const __m128i empty = _mm_or_si128(_mm_cmpgt_epi32(one, vw), _mm_cmpgt_epi32(one, vh));
+        _mm_storeu_si128((__m128i *)(x + i), x1);
+        _mm_storeu_si128((__m128i *)(y + i), y1);
+        _mm_storeu_si128((__m128i *)(w + i), _mm_andnot_si128(empty, vw));
+        _mm_storeu_si128((__m128i *)(h + i), _mm_andnot_si128(empty, vh));
+    }
+#endif
+    for (; i < n; ++i) {
+        const int x1 = x[i] > 0 ? x[i] : 0;
+        const int y1 = y[i] > 0 ? y[i] : 0;
+        const int x2 = x[i] + w[i] < image_width ? x[i] + w[i] : image_width;
+        const int y2 = y[i] + h[i] < image_height ? y[i] + h[i] : image_height;
+        const bool empty = x2 <= x1 || y2 <= y1;
+        x[i] = x1;
+        y[i] = y1;
+        w[i] = empty ? 0 : x2 - x1;
+        h[i] = empty ? 0 : y2 - y1;
+    }
+}
+
+
+
+/**
+ * Compute bounding rects of @a count rects of arrays (ax, ay, aw, ah) and (bx, by, bw, bh) pairwise
+ * into (ox, oy, ow, oh), see cvl_rect_union. Output may alias inputs.
+ */
+static inline void cvl_rect_batch_union_arrays(const int * const ax, const int * const ay,
+                                               const int * const aw, const int * const ah,
+                                               const int * const bx, const int * const by,
+                                               const int * const bw, const int * const bh,
+                                               int * const ox, int * const oy,
+                                               int * const ow, int * const oh,
+                                               const size_t count)
+{
+    size_t i = 0;
+#if CVL_SIMD_SSE2
+    // All lanes are loaded before any store, so output aliasing an input is safe.
+    for (; i + 4 <= count; i += 4) {
+        const __m128i vax = _mm_loadu_si128((const __m128i *)(ax + i));
+        const __m128i vay = _mm_loadu_si128((const __m128i *)(ay + i));
+        const __m128i vbx = _mm_loadu_si128((const __m128i *)(bx + i));
+        const __m128i vby = _mm_loadu_si128((const __m128i *)(by + i));
+        const __m128i x1 = cvl_rect_batch_min_epi32(vax, vbx);
+        const __m128i y1 = cvl_rect_batch_min_epi32(vay, vby);
+        const __m128i x2 = cvl_rect_batch_max_epi32(_mm_add_epi32(vax, _mm_loadu_si128((const __m128i *)(aw + i))),
+                                                    _mm_add_epi32(vbx, _mm_loadu_si128((const __m128i *)(bw + i))));
+        const __m128i y2 = cvl_rect_batch_max_epi32(_mm_add_epi32(vay, _mm_loadu_si128((const __m128i *)(ah + i))),
+                                                    _mm_add_epi32(vby, _mm_loadu_si128((const __m128i *)(bh + i))));
+        _mm_storeu_si128((__m128i *)(ox + i), x1);
+        _mm_storeu_si128((__m128i *)(oy + i), y1);
+        _mm_storeu_si128((__m128i *)(ow + i), _mm_sub_epi32(x2, x1));
+        _mm_storeu_si128((__m128i *)(oh + i), _mm_sub_epi32(y2, y1));
+    }
+#endif
+    for (; i < count; ++i) {
+        const int x1 = ax[i] < bx[i] ? ax[i] : bx[i];
+        const int y1 = ay[i] < by[i] ? ay[i] : by[i];
+        const int x2 = ax[i] + aw[i] > bx[i] + bw[i] ? ax[i] + aw[i] : bx[i] + bw[i];
+        const int y2 = ay[i] + ah[i] > by[i] + bh[i] ? ay[i] + ah[i] : by[i] + bh[i];
+        ox[i] = x1;
+        oy[i] = y1;
+        ow[i] = x2 - x1;
+        oh[i] = y2 - y1;
+    }
+}
+
+
+
+/**
+ * Compute bounding rects of @a a and @a b pairwise into @a out, see cvl_rect_union.
+ * Batches must have the same count, @a out may be @a a or @a b. @return false on allocation failure.
+ */
+static inline bool cvl_rect_batch_union(const CVLRectBatch * const a,
+                                        const CVLRectBatch * const b,
+                                        CVLRectBatch * const out)
+{
+    assert(a->count == b->count);
+    const size_t n = a->count;
+    if (!cvl_rect_batch_reserve(out, n)) {
+        return false;
+    }
+    cvl_rect_batch_union_arrays(a->x, a->y, a->width, a->height, b->x, b->y, b->width, b->height,
+                                out->x, out->y, out->width, out->height, n);
+    out->count = n;
+    return true;
+}
+
+
+
+/**
+ * Compute intersection over union of @a count rects of arrays with rect @a r.
+ * IoU of rects with empty union is 0.
+ */
+static inline void cvl_rect_batch_iou_arrays(const int * const x, const int * const y,
+                                             const int * const w, const int * const h,
+                                             const size_t count,
+                                             const CVLRect r,
+                                             float * const CVL_RESTRICT iou)
+{
+    const float r_area = (float)r.width * (float)r.height;
+    size_t i = 0;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rx1 = _mm_set1_epi32(r.x);
+    const __m128i ry1 = _mm_set1_epi32(r.y);
+    const __m128i rx2 = _mm_set1_epi32(r.x + r.width);
+    const __m128i ry2 = _mm_set1_epi32(r.y + r.height);
+    const __m128 vr_area = _mm_set1_ps(r_area);
+    const __m128 fzero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i vx = _mm_loadu_si128((const __m128i *)(x + i));
+        const __m128i vy = _mm_loadu_si128((const __m128i *)(y + i));
+        const __m128i vw = _mm_loadu_si128((const __m128i *)(w + i));
+        const __m128i vh = _mm_loadu_si128((const __m128i *)(h + i));
+        const __m128i iw = cvl_rect_batch_max_epi32(_mm_sub_epi32(cvl_rect_batch_min_epi32(_mm_add_epi32(vx, vw), rx2),
+                                                                  cvl_rect_batch_max_epi32(vx, rx1)), zero);
+        const __m128i ih = cvl_rect_batch_max_epi32(_mm_sub_epi32(cvl_rect_batch_min_epi32(_mm_add_epi32(vy, vh), ry2),
+                                                                  cvl_rect_batch_max_epi32(vy, ry1)), zero);
+        const __m128 inter = _mm_mul_ps(_mm_cvtepi32_ps(iw), _mm_cvtepi32_ps(ih));
+        const __m128 area = _mm_mul_ps(_mm_cvtepi32_ps(vw), _mm_cvtepi32_ps(vh));
+        const __m128 uni = _mm_sub_ps(_mm_add_ps(area, vr_area), inter);
+        const __m128 positive = _mm_cmpgt_ps(uni, fzero);
+        // Division of masked out lanes by 1 avoids floating point exceptions.
+        const __m128 divisor = _mm_or_ps(_mm_and_ps(positive, uni), _mm_andnot_ps(positive, _mm_set1_ps(1.0f)));
+        _mm_storeu_ps(iou + i, _mm_and_ps(positive, _mm_div_ps(inter, divisor)));
+    }
+#endif
+    for (; i < count; ++i) {
+        const int x2 = x[i] + w[i] < r.x + r.width ? x[i] + w[i] : r.x + r.width;
+        const int y2 = y[i] + h[i] < r.y + r.height ? y[i] + h[i] : r.y + r.height;
+        const int x1 = x[i] > r.x ? x[i] : r.x;
+        const int y1 = y[i] > r.y ? y[i] : r.y;
+        const float inter = (float)(x2 > x1 ? x2 - x1 : 0) * (float)(y2 > y1 ? y2 - y1 : 0);
+        const float uni = (float)w[i] * (float)h[i] + r_area - inter;
+        iou[i] = uni > 0.0f ? inter / uni : 0.0f;
+    }
+}
+
+
+
+/** Compute intersection over union of every rect of batch with rect @a r. */
+static inline void cvl_rect_batch_iou_with(const CVLRectBatch * const batch, const CVLRect r, float * const iou) {
+    cvl_rect_batch_iou_arrays(batch->x, batch->y, batch->width, batch->height, batch->count, r, iou);
+}
+
+
+
+/**
+ * Compute intersection over union of @a count rects of arrays (ax, ay, aw, ah) and (bx, by, bw, bh)
+ * pairwise. IoU of rects with empty union is 0.
+ */
+static inline void cvl_rect_batch_iou_pairs_arrays(const int * const CVL_RESTRICT ax, const int * const CVL_RESTRICT ay,
+                                                   const int * const CVL_RESTRICT aw, const int * const CVL_RESTRICT ah,
+                                                   const int * const CVL_RESTRICT bx, const int * const CVL_RESTRICT by,
+                                                   const int * const CVL_RESTRICT bw, const int * const CVL_RESTRICT bh,
+                                                   const size_t count,
+                                                   float * const CVL_RESTRICT iou)
+{
+    size_t i = 0;
+#if CVL_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 fzero = _mm_setzero_ps();
+    const __m128 fone = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i vax = _mm_loadu_si128((const __m128i *)(ax + i));
+        const __m128i vay = _mm_loadu_si128((const __m128i *)(ay + i));
+        const __m128i vaw = _mm_loadu_si128((const __m128i *)(aw + i));
+        const __m128i vah = _mm_loadu_si128((const __m128i *)(ah + i));
+        const __m128i vbx = _mm_loadu_si128((const __m128i *)(bx + i));
+        const __m128i vby = _mm_loadu_si128((const __m128i *)(by + i));
+        const __m128i vbw = _mm_loadu_si128((const __m128i *)(bw + i));
+        const __m128i vbh = _mm_loadu_si128((const __m128i *)(bh + i));
+        const __m128i iw = cvl_rect_batch_max_epi32(_mm_sub_epi32(cvl_rect_batch_min_epi32(_mm_add_epi32(vax, vaw),
+                                                                                           _mm_add_epi32(vbx, vbw)),
+                                                                  cvl_rect_batch_max_epi32(vax, vbx)), zero);
+        const __m128i ih = cvl_rect_batch_max_epi32(_mm_sub_epi32(cvl_rect_batch_min_epi32(_mm_add_epi32(vay, vah),
+                                                                                           _mm_add_epi32(vby, vbh)),
+                                                                  cvl_rect_batch_max_epi32(vay, vby)), zero);
+        const __m128 inter = _mm_mul_ps(_mm_cvtepi32_ps(iw), _mm_cvtepi32_ps(ih));
+        const __m128 a_area = _mm_mul_ps(_mm_cvtepi32_ps(vaw), _mm_cvtepi32_ps(vah));
+        const __m128 b_area = _mm_mul_ps(_mm_cvtepi32_ps(vbw), _mm_cvtepi32_ps(vbh));
+        const __m128 uni = _mm_sub_ps(_mm_add_ps(a_area, b_area), inter);
+        const __m128 positive = _mm_cmpgt_ps(uni, fzero);
+        const __m128 divisor = _mm_or_ps(_mm_and_ps(positive, uni), _mm_andnot_ps(positive, fone));
+        _mm_storeu_ps(iou + i, _mm_and_ps(positive, _mm_div_ps(inter, divisor)));
+    }
+#endif
+    for (; i < count; ++i) {
+        const int x2 = ax[i] + aw[i] < bx[i] + bw[i] ? ax[i] + aw[i] : bx[i] + bw[i];
+        const int y2 = ay[i] + ah[i] < by[i] + bh[i] ? ay[i] + ah[i] : by[i] + bh[i];
+        const int x1 = ax[i] > bx[i] ? ax[i] : bx[i];
+        const int y1 = ay[i] > by[i] ? ay[i] : by[i];
+        const float inter = (float)(x2 > x1 ? x2 - x1 : 0) * (float)(y2 > y1 ? y2 - y1 : 0);
+        const float uni = (float)aw[i] * (float)ah[i] + (float)bw[i] * (float)bh[i] - inter;
+        iou[i] = uni > 0.0f ? inter / uni : 0.0f;
+    }
+}
+
+
+
+/** Compute intersection over union of rects of @a a and @a b pairwise. Batches must have the same count. */
+static inline void cvl_rect_batch_iou(const CVLRectBatch * const a, const CVLRectBatch * const b, float * const iou) {
+    assert(a->count == b->count);
+    cvl_rect_batch_iou_pairs_arrays(a->x, a->y, a->width, a->height, b->x, b->y, b->width, b->height, a->count, iou);
+}
+
+
+
+/** Rect score and index, sorted by cvl_rect_batch_nms. */
+typedef struct {
+    float score;
+    size_t index;
+} CVLRectScore;
+
+
+
+/** Order by descending score, ties by ascending index. */
+static inline int cvl_rect_score_compare(const void * const a, const void * const b) {
+    const CVLRectScore * const sa = (const CVLRectScore *)a;
+    const CVLRectScore * const sb = (const CVLRectScore *)b;
+    if (sa->score != sb->score) {
+        return sa->score > sb->score ? -1 : 1;
+    }
+    return sa->index < sb->index ? -1 : (sa->index > sb->index ? 1 : 0);
+}
+
+
+
+/**
+ * Greedy non-maximum suppression.
+ *
+ * Rects are visited in order of descending score; a rect is kept unless its IoU with an already
+ * kept rect exceeds @a iou_threshold. Rects are reordered by score into a temporary batch, so IoU of
+ * each kept rect against all remaining ones is one vector kernel call.
+ * @param keep Receives indices of kept rects in order of descending score, batch->count entries.
+ * @param keep_count Receives number of kept rects.
+ * @return false on allocation failure.
+ */
+static inline bool cvl_rect_batch_nms(const CVLRectBatch * const batch,
+                                      const float * const scores,
+                                      const float iou_threshold,
+                                      size_t * const keep,
+                                      size_t * const keep_count)
+{
+    const size_t n = batch->count;
+    *keep_count = 0;
+    if (!n) {
+        return true;
+    }
+    CVLRectScore * const order = (CVLRectScore *)malloc(n * sizeof(CVLRectScore));
+    float * const iou = (float *)malloc(n * sizeof(float));
+    uint8_t * const suppressed = (uint8_t *)calloc(n, 1);
+    CVLRectBatch sorted;
+    const bool ok = order && iou && suppressed && cvl_rect_batch_init(&sorted, n);
+    if (!ok) {
+        free(order);
+        free(iou);
+        free(suppressed);
+        return false;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        order[i].score = scores[i];
+        order[i].index = i;
+    }
+    qsort(order, n, sizeof(CVLRectScore), cvl_rect_score_compare);
+    for (size_t i = 0; i < n; ++i) {
+        const size_t j = order[i].index;
+        sorted.x[i] = batch->x[j];
+        sorted.y[i] = batch->y[j];
+        sorted.width[i] = batch->width[j];
+        sorted.height[i] = batch->height[j];
+    }
+    sorted.count = n;
+
+    for (size_t i = 0; i < n; ++i) {
+        if (suppressed[i]) {
+            continue;
+        }
+        keep[(*keep_count)++] = order[i].index;
+        const size_t rest = n - i - 1;
+        cvl_rect_batch_iou_arrays(sorted.x + i + 1, sorted.y + i + 1, sorted.width + i + 1, sorted.height + i + 1,
+                                  rest, cvl_rect_batch_get(&sorted, i), iou);
+        uint8_t * const CVL_RESTRICT flags = suppressed + i + 1;
+        for (size_t k = 0; k < rest; ++k) {
+            flags[k] |= (uint8_t)(iou[k] > iou_threshold);
+        }
+    }
+
+    cvl_rect_batch_release(&sorted);
+    free(order);
+    free(iou);
+    free(suppressed);
+    return true;
+}
+
+
+
+/*
+ * Batched ROI gather.
+ */
+
+/**
+ * Compute layout of ROIs packed into one buffer.
+ *
+ * Every ROI is stored continuous (rowBytes = width * pixel_size) starting at offsets[i], aligned
+ * to CVL_IMAGE_DEFAULT_ALIGNMENT. Empty rects take no space.
+ * @param offsets Receives batch->count byte offsets.
+ * @return Total buffer size in bytes.
+ */
+static inline size_t cvl_rect_batch_packed_layout(const CVLRectBatch * const batch,
+                                                  const CVLImageBytesCount pixel_size,
+                                                  size_t * const offsets)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < batch->count; ++i) {
+        offsets[i] = size;
+        if (batch->width[i] > 0 && batch->height[i] > 0) {
+            const size_t bytes = (size_t)batch->width[i] * (size_t)batch->height[i] * pixel_size;
+            size += (bytes + CVL_IMAGE_DEFAULT_ALIGNMENT - 1) & ~(size_t)(CVL_IMAGE_DEFAULT_ALIGNMENT - 1);
+        }
+    }
+    return size;
+}
+
+
+
+/** Return view of ROI @a i in packed buffer @a data, see cvl_rect_batch_packed_layout. */
+static inline CVLImageBuffer cvl_rect_batch_packed_view(void * const data,
+                                                        const size_t * const offsets,
+                                                        const CVLRectBatch * const batch,
+                                                        const size_t i,
+                                                        const CVLImageBytesCount pixel_size)
+{
+    CVLImageBuffer view = cvl_image_make_empty();
+    if (batch->width[i] > 0 && batch->height[i] > 0) {
+        view.data = (CVLPixel_8 *)data + offsets[i];
+        view.height = (CVLImagePixelCount)batch->height[i];
+        view.width = (CVLImagePixelCount)batch->width[i];
+        view.rowBytes = view.width * pixel_size;
+    }
+    return view;
+}
+
+
+
+/** Context of cvl_image_gather_rois tasks. */
+typedef struct {
+    const CVLImageBuffer *source;
+    const CVLRectBatch *batch;
+    CVLImageBytesCount pixel_size;
+    CVLPixel_8 *data;
+    const size_t *offsets;
+} CVLImageGatherRois;
+
+
+
+static inline void cvl_image_gather_rois_range(void * const context, const size_t begin, const size_t end) {
+    const CVLImageGatherRois * const gather = (const CVLImageGatherRois *)context;
+    const CVLRectBatch * const batch = gather->batch;
+    const CVLImageBytesCount pixel_size = gather->pixel_size;
+    for (size_t i = begin; i < end; ++i) {
+        if (batch->width[i] <= 0 || batch->height[i] <= 0) {
+            continue;
+        }
+        const CVLImageBytesCount row_bytes = (CVLImageBytesCount)batch->width[i] * pixel_size;
+        cvl_simd_copy_rows(gather->data + gather->offsets[i], row_bytes,
+                           CVL_GET_LINE(const CVLPixel_8, gather->source, batch->y[i]) + batch->x[i] * pixel_size,
+                           gather->source->rowBytes, row_bytes, (size_t)batch->height[i]);
+    }
+}
+
+
+
+/**
+ * Copy all ROIs of batch from @a source into packed buffer @a data in one parallel pass.
+ *
+ * Rects must be empty or good ROIs of source (see cvl_rect_batch_clip and
+ * cvl_rect_batch_good_roi_mask). ROI i is then cvl_rect_batch_packed_view(data, offsets, batch, i).
+ * @param pool Thread pool or NULL to copy on the calling thread.
+ * @param data Buffer of cvl_rect_batch_packed_layout size.
+ * @param offsets Offsets computed by cvl_rect_batch_packed_layout.
+ */
+static inline void cvl_image_gather_rois(CVLThreadPool * const pool,
+                                         const CVLImageBuffer * const source,
+                                         const CVLRectBatch * const batch,
+                                         const CVLImageBytesCount pixel_size,
+                                         void * const data,
+                                         const size_t * const offsets)
+{
+    assert(cvl_image_is_good(source, pixel_size));
+#ifndef NDEBUG
+    for (size_t i = 0; i < batch->count; ++i) {
+        const CVLRect roi = cvl_rect_batch_get(batch, i);
+        assert(roi.width <= 0 || roi.height <= 0 || cvl_rect_is_good_roi(roi, source));
+    }
+#endif
+    CVLImageGatherRois gather;
+    gather.source = source;
+    gather.batch = batch;
+    gather.pixel_size = pixel_size;
+    gather.data = (CVLPixel_8 *)data;
+    gather.offsets = offsets;
+    // Packed size is close to offset of the last ROI; small batches are copied on the calling thread.
+    const size_t chunks = cvl_thread_pool_thread_count(pool) * CVL_PARALLEL_BANDS_PER_THREAD;
+    const size_t packed_bytes = batch->count ? offsets[batch->count - 1] : 0;
+    const size_t grain = packed_bytes < CVL_PARALLEL_MIN_IMAGE_BYTES ? batch->count : (batch->count + chunks - 1) / chunks;
+    cvl_parallel_for(pool, batch->count, grain, cvl_image_gather_rois_range, &gather);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+
+#endif //CVL_RECT_BATCH_H
@@ -0,0 +1,831 @@
+#ifndef CVL_SIMD_H
+#define CVL_SIMD_H
+
+
+#include "cvl_image.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CVL_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define CVL_SIMD_X86 0
+#endif
+
+/**
+ * 1 if SSE2 is enabled at compile time (always on x86-64), so kernels can use it without runtime
+ * dispatch, otherwise 0.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CVL_SIMD_SSE2 1
+#else
+#define CVL_SIMD_SSE2 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CVL_SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CVL_SIMD_TARGET(isa)
+#endif
+
+#if defined(_MSC_VER)
+#define CVL_RESTRICT __restrict
+#elif defined(__GNUC__) || defined(__clang__)
+#define CVL_RESTRICT __restrict__
+#else
+#define CVL_RESTRICT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Destination size (in bytes) starting from which row kernels use non-temporal streaming stores.
+ *
+ * Destinations this large do not fit into the last level cache anyway, so bypassing the cache
+ * saves read-for-ownership traffic and does not evict useful data.
+ */
+#ifndef CVL_SIMD_STREAMING_THRESHOLD
+#define CVL_SIMD_STREAMING_THRESHOLD ((size_t)8 * 1024 * 1024)
+#endif
+
+/**
+ * Row size (in bytes) up to which vector row kernels are used instead of memcpy/memset.
+ * Wider rows are dominated by data movement and the C library routines are as fast.
+ */
+#ifndef CVL_SIMD_NARROW_ROW_BYTES
+#define CVL_SIMD_NARROW_ROW_BYTES 256
+#endif
+
+/** Maximal instruction set level used by runtime dispatch, for testing and debugging. */
+#ifndef CVL_SIMD_MAX_LEVEL
+#define CVL_SIMD_MAX_LEVEL CVL_SIMD_LEVEL_AVX512
+#endif
+
+/** Instruction set level detected at runtime. */
+typedef enum {
+    CVL_SIMD_LEVEL_SCALAR = 0, ///< No vector instructions.
+    CVL_SIMD_LEVEL_SSE2,       ///< x86 SSE2.
+    CVL_SIMD_LEVEL_AVX2,       ///< x86 AVX2.
+    CVL_SIMD_LEVEL_AVX512      ///< x86 AVX-512 Foundation.
+} CVLSimdLevel;
+
+
+
+static inline CVLSimdLevel cvl_simd_detect_level(void) {
+#if CVL_SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return CVL_SIMD_LEVEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return CVL_SIMD_LEVEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return CVL_SIMD_LEVEL_SSE2;
+    }
+    return CVL_SIMD_LEVEL_SCALAR;
+#elif CVL_SIMD_X86 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+    __cpuid(info, 1);
+    const bool has_sse2 = (info[3] & (1 << 26)) != 0;
+    const bool has_osxsave = (info[2] & (1 << 27)) != 0;
+    if (max_leaf >= 7 && has_osxsave) {
+        const unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6) {
+            return CVL_SIMD_LEVEL_AVX512;
+        }
+        if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) {
+            return CVL_SIMD_LEVEL_AVX2;
+        }
+    }
+    return has_sse2 ? CVL_SIMD_LEVEL_SSE2 : CVL_SIMD_LEVEL_SCALAR;
+#else
+    return CVL_SIMD_LEVEL_SCALAR;
+#endif
+}
+
+
+
+/**
+ * Return instruction set level supported by CPU (limited by CVL_SIMD_MAX_LEVEL).
+ *
+ * Safe to call from several threads: racing first calls detect and store the same value, so the
+ * cached level needs no ordering, only an untorn int access.
+ */
+static inline CVLSimdLevel cvl_simd_level(void) {
+    static int level_plus_one = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    int level = __atomic_load_n(&level_plus_one, __ATOMIC_RELAXED);
+#else
+    int level = *(volatile int *)&level_plus_one;
+#endif
+    if (level == 0) {
+        const CVLSimdLevel detected = cvl_simd_detect_level();
+        level = (int)(detected < CVL_SIMD_MAX_LEVEL ? detected : CVL_SIMD_MAX_LEVEL) + 1;
+#if defined(__GNUC__) || defined(__clang__)
+        __atomic_store_n(&level_plus_one, level, __ATOMIC_RELAXED);
+#else
+        *(volatile int *)&level_plus_one = level;
+#endif
+    }
+    return (CVLSimdLevel)(level - 1);
+}
+
+
+
+/** Copy less than 16 bytes using overlapping scalar moves. */
+static inline void cvl_simd_copy_small(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    if (n >= 8) {
+        uint64_t head, tail;
+        memcpy(&head, src, 8);
+        memcpy(&tail, src + n - 8, 8);
+        memcpy(dst, &head, 8);
+        memcpy(dst + n - 8, &tail, 8);
+    }
+    else if (n >= 4) {
+        uint32_t head, tail;
+        memcpy(&head, src, 4);
+        memcpy(&tail, src + n - 4, 4);
+        memcpy(dst, &head, 4);
+        memcpy(dst + n - 4, &tail, 4);
+    }
+    else {
+        for (size_t i = 0; i < n; ++i) {
+            dst[i] = src[i];
+        }
+    }
+}
+
+
+
+/** Zero less than 16 bytes using overlapping scalar moves. */
+static inline void cvl_simd_clear_small(CVLPixel_8 * const dst, const size_t n) {
+    const uint64_t zero = 0;
+    if (n >= 8) {
+        memcpy(dst, &zero, 8);
+        memcpy(dst + n - 8, &zero, 8);
+    }
+    else if (n >= 4) {
+        memcpy(dst, &zero, 4);
+        memcpy(dst + n - 4, &zero, 4);
+    }
+    else {
+        for (size_t i = 0; i < n; ++i) {
+            dst[i] = 0;
+        }
+    }
+}
+
+
+
+static inline void cvl_simd_copy_row_scalar(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    if (n < 16) {
+        cvl_simd_copy_small(dst, src, n);
+    }
+    else {
+        memcpy(dst, src, n);
+    }
+}
+
+
+
+static inline void cvl_simd_clear_row_scalar(CVLPixel_8 * const dst, const size_t n) {
+    if (n < 16) {
+        cvl_simd_clear_small(dst, n);
+    }
+    else {
+        memset(dst, 0, n);
+    }
+}
+
+
+
+#if CVL_SIMD_X86
+
+/*
+ * Regular kernels copy full vectors and finish with one overlapping unaligned vector.
+ * Streaming kernels write head and tail with regular stores and stream the aligned middle part,
+ * regular and streaming stores never touch the same bytes.
+ */
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_copy_row_sse2(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    if (n < 16) {
+        cvl_simd_copy_small(dst, src, n);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+    }
+    if (i < n) {
+        _mm_storeu_si128((__m128i *)(dst + n - 16), _mm_loadu_si128((const __m128i *)(src + n - 16)));
+    }
+}
+
+
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_clear_row_sse2(CVLPixel_8 * const dst, const size_t n) {
+    if (n < 16) {
+        cvl_simd_clear_small(dst, n);
+        return;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm_storeu_si128((__m128i *)(dst + i), zero);
+    }
+    if (i < n) {
+        _mm_storeu_si128((__m128i *)(dst + n - 16), zero);
+    }
+}
+
+
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_stream_copy_row_sse2(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    const size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+    if (n < head + 64) {
+        cvl_simd_copy_row_sse2(dst, src, n);
+        return;
+    }
+    cvl_simd_copy_small(dst, src, head);
+    size_t i = head;
+    for (; i + 16 <= n; i += 16) {
+        _mm_stream_si128((__m128i *)(dst + i), _mm_loadu_si128((const __m128i *)(src + i)));
+    }
+    cvl_simd_copy_small(dst + i, src + i, n - i);
+}
+
+
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_stream_clear_row_sse2(CVLPixel_8 * const dst, const size_t n) {
+    const size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+    if (n < head + 64) {
+        cvl_simd_clear_row_sse2(dst, n);
+        return;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    cvl_simd_clear_small(dst, head);
+    size_t i = head;
+    for (; i + 16 <= n; i += 16) {
+        _mm_stream_si128((__m128i *)(dst + i), zero);
+    }
+    cvl_simd_clear_small(dst + i, n - i);
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_copy_row_avx2(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    if (n < 32) {
+        cvl_simd_copy_row_sse2(dst, src, n);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+    }
+    if (i < n) {
+        _mm256_storeu_si256((__m256i *)(dst + n - 32), _mm256_loadu_si256((const __m256i *)(src + n - 32)));
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_clear_row_avx2(CVLPixel_8 * const dst, const size_t n) {
+    if (n < 32) {
+        cvl_simd_clear_row_sse2(dst, n);
+        return;
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        _mm256_storeu_si256((__m256i *)(dst + i), zero);
+    }
+    if (i < n) {
+        _mm256_storeu_si256((__m256i *)(dst + n - 32), zero);
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_stream_copy_row_avx2(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    const size_t head = (32 - ((uintptr_t)dst & 31)) & 31;
+    if (n < head + 128) {
+        cvl_simd_copy_row_avx2(dst, src, n);
+        return;
+    }
+    cvl_simd_copy_row_sse2(dst, src, head);
+    size_t i = head;
+    for (; i + 32 <= n; i += 32) {
+        _mm256_stream_si256((__m256i *)(dst + i), _mm256_loadu_si256((const __m256i *)(src + i)));
+    }
+    cvl_simd_copy_row_sse2(dst + i, src + i, n - i);
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_stream_clear_row_avx2(CVLPixel_8 * const dst, const size_t n) {
+    const size_t head = (32 - ((uintptr_t)dst & 31)) & 31;
+    if (n < head + 128) {
+        cvl_simd_clear_row_avx2(dst, n);
+        return;
+    }
+    const __m256i zero = _mm256_setzero_si256();
+    cvl_simd_clear_row_sse2(dst, head);
+    size_t i = head;
+    for (; i + 32 <= n; i += 32) {
+        _mm256_stream_si256((__m256i *)(dst + i), zero);
+    }
+    cvl_simd_clear_row_sse2(dst + i, n - i);
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_copy_row_avx512(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    if (n < 64) {
+        cvl_simd_copy_row_avx2(dst, src, n);
+        return;
+    }
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        _mm512_storeu_si512((void *)(dst + i), _mm512_loadu_si512((const void *)(src + i)));
+    }
+    if (i < n) {
+        _mm512_storeu_si512((void *)(dst + n - 64), _mm512_loadu_si512((const void *)(src + n - 64)));
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_clear_row_avx512(CVLPixel_8 * const dst, const size_t n) {
+    if (n < 64) {
+        cvl_simd_clear_row_avx2(dst, n);
+        return;
+    }
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        _mm512_storeu_si512((void *)(dst + i), zero);
+    }
+    if (i < n) {
+        _mm512_storeu_si512((void *)(dst + n - 64), zero);
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_stream_copy_row_avx512(CVLPixel_8 * const dst, const CVLPixel_8 * const src, const size_t n) {
+    const size_t head = (64 - ((uintptr_t)dst & 63)) & 63;
+    if (n < head + 256) {
+        cvl_simd_copy_row_avx512(dst, src, n);
+        return;
+    }
+    cvl_simd_copy_row_avx2(dst, src, head);
+    size_t i = head;
+    for (; i + 64 <= n; i += 64) {
+        _mm512_stream_si512((__m512i *)(dst + i), _mm512_loadu_si512((const void *)(src + i)));
+    }
+    cvl_simd_copy_row_avx2(dst + i, src + i, n - i);
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_stream_clear_row_avx512(CVLPixel_8 * const dst, const size_t n) {
+    const size_t head = (64 - ((uintptr_t)dst & 63)) & 63;
+    if (n < head + 256) {
+        cvl_simd_clear_row_avx512(dst, n);
+        return;
+    }
+    const __m512i zero = _mm512_setzero_si512();
+    cvl_simd_clear_row_avx2(dst, head);
+    size_t i = head;
+    for (; i + 64 <= n; i += 64) {
+        _mm512_stream_si512((__m512i *)(dst + i), zero);
+    }
+    cvl_simd_clear_row_avx2(dst + i, n - i);
+}
+
+#endif // CVL_SIMD_X86
+
+
+
+/*
+ * Multi-row kernels own the row loop, so one dispatch per image replaces a call per row.
+ * Narrow rows use the inlined vector row kernel, wider rows are dominated by data movement and
+ * use memcpy/memset. Streaming kernels finish with a store fence.
+ */
+
+static inline void cvl_simd_copy_rows_scalar(CVLPixel_8 * const dst,
+                                            const size_t dst_stride,
+                                            const CVLPixel_8 * const src,
+                                            const size_t src_stride,
+                                            const size_t row_bytes,
+                                            const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_copy_row_scalar(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memcpy(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+}
+
+
+
+static inline void cvl_simd_clear_rows_scalar(CVLPixel_8 * const dst,
+                                             const size_t dst_stride,
+                                             const size_t row_bytes,
+                                             const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_clear_row_scalar(dst + y * dst_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memset(dst + y * dst_stride, 0, row_bytes);
+        }
+    }
+}
+
+
+
+#if CVL_SIMD_X86
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_copy_rows_sse2(CVLPixel_8 * const dst,
+                                          const size_t dst_stride,
+                                          const CVLPixel_8 * const src,
+                                          const size_t src_stride,
+                                          const size_t row_bytes,
+                                          const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_copy_row_sse2(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memcpy(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+}
+
+
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_clear_rows_sse2(CVLPixel_8 * const dst,
+                                           const size_t dst_stride,
+                                           const size_t row_bytes,
+                                           const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_clear_row_sse2(dst + y * dst_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memset(dst + y * dst_stride, 0, row_bytes);
+        }
+    }
+}
+
+
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_stream_copy_rows_sse2(CVLPixel_8 * const dst,
+                                                 const size_t dst_stride,
+                                                 const CVLPixel_8 * const src,
+                                                 const size_t src_stride,
+                                                 const size_t row_bytes,
+                                                 const size_t rows)
+{
+    for (size_t y = 0; y < rows; ++y) {
+        cvl_simd_stream_copy_row_sse2(dst + y * dst_stride, src + y * src_stride, row_bytes);
+    }
+    _mm_sfence();
+}
+
+
+
+CVL_SIMD_TARGET("sse2")
+static inline void cvl_simd_stream_clear_rows_sse2(CVLPixel_8 * const dst,
+                                                  const size_t dst_stride,
+                                                  const size_t row_bytes,
+                                                  const size_t rows)
+{
+    for (size_t y = 0; y < rows; ++y) {
+        cvl_simd_stream_clear_row_sse2(dst + y * dst_stride, row_bytes);
+    }
+    _mm_sfence();
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_copy_rows_avx2(CVLPixel_8 * const dst,
+                                          const size_t dst_stride,
+                                          const CVLPixel_8 * const src,
+                                          const size_t src_stride,
+                                          const size_t row_bytes,
+                                          const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_copy_row_avx2(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memcpy(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_clear_rows_avx2(CVLPixel_8 * const dst,
+                                           const size_t dst_stride,
+                                           const size_t row_bytes,
+                                           const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_clear_row_avx2(dst + y * dst_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memset(dst + y * dst_stride, 0, row_bytes);
+        }
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_stream_copy_rows_avx2(CVLPixel_8 * const dst,
+                                                 const size_t dst_stride,
+                                                 const CVLPixel_8 * const src,
+                                                 const size_t src_stride,
+                                                 const size_t row_bytes,
+                                                 const size_t rows)
+{
+    for (size_t y = 0; y < rows; ++y) {
+        cvl_simd_stream_copy_row_avx2(dst + y * dst_stride, src + y * src_stride, row_bytes);
+    }
+    _mm_sfence();
+}
+
+
+
+CVL_SIMD_TARGET("avx2")
+static inline void cvl_simd_stream_clear_rows_avx2(CVLPixel_8 * const dst,
+                                                  const size_t dst_stride,
+                                                  const size_t row_bytes,
+                                                  const size_t rows)
+{
+    for (size_t y = 0; y < rows; ++y) {
+        cvl_simd_stream_clear_row_avx2(dst + y * dst_stride, row_bytes);
+    }
+    _mm_sfence();
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_copy_rows_avx512(CVLPixel_8 * const dst,
+                                            const size_t dst_stride,
+                                            const CVLPixel_8 * const src,
+                                            const size_t src_stride,
+                                            const size_t row_bytes,
+                                            const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_copy_row_avx512(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memcpy(dst + y * dst_stride, src + y * src_stride, row_bytes);
+        }
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_clear_rows_avx512(CVLPixel_8 * const dst,
+                                             const size_t dst_stride,
+                                             const size_t row_bytes,
+                                             const size_t rows)
+{
+    if (row_bytes <= CVL_SIMD_NARROW_ROW_BYTES) {
+        for (size_t y = 0; y < rows; ++y) {
+            cvl_simd_clear_row_avx512(dst + y * dst_stride, row_bytes);
+        }
+    }
+    else {
+        for (size_t y = 0; y < rows; ++y) {
+            memset(dst + y * dst_stride, 0, row_bytes);
+        }
+    }
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_stream_copy_rows_avx512(CVLPixel_8 * const dst,
+                                                   const size_t dst_stride,
+                                                   const CVLPixel_8 * const src,
+                                                   const size_t src_stride,
+                                                   const size_t row_bytes,
+                                                   const size_t rows)
+{
+    for (size_t y = 0; y < rows; ++y) {
+        cvl_simd_stream_copy_row_avx512(dst + y * dst_stride, src + y * src_stride, row_bytes);
+    }
+    _mm_sfence();
+}
+
+
+
+CVL_SIMD_TARGET("avx512f")
+static inline void cvl_simd_stream_clear_rows_avx512(CVLPixel_8 * const dst,
+                                                    const size_t dst_stride,
+                                                    const size_t row_bytes,
+                                                    const size_t rows)
+{
+    for (size_t y = 0; y < rows; ++y) {
+        cvl_simd_stream_clear_row_avx512(dst + y * dst_stride, row_bytes);
+    }
+    _mm_sfence();
+}
+
+#endif // CVL_SIMD_X86
+
+
+
+/** Multi-row kernels of one instruction set level. */
+typedef struct {
+    void (*copy_rows)(CVLPixel_8 *dst, size_t dst_stride, const CVLPixel_8 *src, size_t src_stride,
+                      size_t row_bytes, size_t rows);
+    void (*clear_rows)(CVLPixel_8 *dst, size_t dst_stride, size_t row_bytes, size_t rows);
+    void (*stream_copy_rows)(CVLPixel_8 *dst, size_t dst_stride, const CVLPixel_8 *src, size_t src_stride,
+                             size_t row_bytes, size_t rows);
+    void (*stream_clear_rows)(CVLPixel_8 *dst, size_t dst_stride, size_t row_bytes, size_t rows);
+} CVLSimdRowsKernels;
+
+
+
+/** Return multi-row kernels for instruction set level supported by CPU. */
+static inline const CVLSimdRowsKernels *cvl_simd_rows_kernels(void) {
+    // Scalar code has no streaming stores, streaming entries use the regular kernels.
+    static const CVLSimdRowsKernels scalar = {
+        cvl_simd_copy_rows_scalar, cvl_simd_clear_rows_scalar,
+        cvl_simd_copy_rows_scalar, cvl_simd_clear_rows_scalar
+    };
+#if CVL_SIMD_X86
+    static const CVLSimdRowsKernels sse2 = {
+        cvl_simd_copy_rows_sse2, cvl_simd_clear_rows_sse2,
+        cvl_simd_stream_copy_rows_sse2, cvl_simd_stream_clear_rows_sse2
+    };
+    static const CVLSimdRowsKernels avx2 = {
+        cvl_simd_copy_rows_avx2, cvl_simd_clear_rows_avx2,
+        cvl_simd_stream_copy_rows_avx2, cvl_simd_stream_clear_rows_avx2
+    };
+    static const CVLSimdRowsKernels avx512 = {
+        cvl_simd_copy_rows_avx512, cvl_simd_clear_rows_avx512,
+        cvl_simd_stream_copy_rows_avx512, cvl_simd_stream_clear_rows_avx512
+    };
+    switch (cvl_simd_level()) {
+        case CVL_SIMD_LEVEL_AVX512: return &avx512;
+        case CVL_SIMD_LEVEL_AVX2:   return &avx2;
+        case CVL_SIMD_LEVEL_SSE2:   return &sse2;
+        default:                    break;
+    }
+#endif
+    return &scalar;
+}
+
+
+
+/**
+ * Copy @a rows rows of @a row_bytes bytes between strided buffers.
+ *
+ * Dispatches once into the multi-row kernel of the detected instruction set level.
+ * Source and destination must not overlap.
+ * @param streaming Write destination with non-temporal stores.
+ */
+static inline void cvl_simd_copy_rows_ex(CVLPixel_8 * const dst,
+                                         const size_t dst_stride,
+                                         const CVLPixel_8 * const src,
+                                         const size_t src_stride,
+                                         const size_t row_bytes,
+                                         const size_t rows,
+                                         const bool streaming)
+{
+    const CVLSimdRowsKernels * const kernels = cvl_simd_rows_kernels();
+    if (streaming) {
+        kernels->stream_copy_rows(dst, dst_stride, src, src_stride, row_bytes, rows);
+    }
+    else {
+        kernels->copy_rows(dst, dst_stride, src, src_stride, row_bytes, rows);
+    }
+}
+
+
+
+/**
+ * Zero @a rows rows of @a row_bytes bytes of strided buffer.
+ *
+ * Dispatches once into the multi-row kernel of the detected instruction set level.
+ * @param streaming Write destination with non-temporal stores.
+ */
+static inline void cvl_simd_clear_rows_ex(CVLPixel_8 * const dst,
+                                          const size_t dst_stride,
+                                          const size_t row_bytes,
+                                          const size_t rows,
+                                          const bool streaming)
+{
+    const CVLSimdRowsKernels * const kernels = cvl_simd_rows_kernels();
+    if (streaming) {
+        kernels->stream_clear_rows(dst, dst_stride, row_bytes, rows);
+    }
+    else {
+        kernels->clear_rows(dst, dst_stride, row_bytes, rows);
+    }
+}
+
+
+
+/**
+ * Copy @a rows rows of @a row_bytes bytes between strided buffers.
+ *
+ * Destinations larger than CVL_SIMD_STREAMING_THRESHOLD are written with non-temporal stores.
+ * @see cvl_simd_copy_rows_ex
+ */
+static inline void cvl_simd_copy_rows(CVLPixel_8 * const dst,
+                                      const size_t dst_stride,
+                                      const CVLPixel_8 * const src,
+                                      const size_t src_stride,
+                                      const size_t row_bytes,
+                                      const size_t rows)
+{
+    cvl_simd_copy_rows_ex(dst, dst_stride, src, src_stride, row_bytes, rows,
+                          row_bytes * rows >= CVL_SIMD_STREAMING_THRESHOLD);
+}
+
+
+
+/**
+ * Zero @a rows rows of @a row_bytes bytes of strided buffer.
+ *
+ * Destinations larger than CVL_SIMD_STREAMING_THRESHOLD are written with non-temporal stores.
+ * @see cvl_simd_clear_rows_ex
+ */
+static inline void cvl_simd_clear_rows(CVLPixel_8 * const dst,
+                                       const size_t dst_stride,
+                                       const size_t row_bytes,
+                                       const size_t rows)
+{
+    cvl_simd_clear_rows_ex(dst, dst_stride, row_bytes, rows, row_bytes * rows >= CVL_SIMD_STREAMING_THRESHOLD);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_SIMD_H
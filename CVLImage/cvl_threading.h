@@ -0,0 +1,439 @@
+#ifndef CVL_THREADING_H
+#define CVL_THREADING_H
+
+
+#include "cvl_image.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32)) && !defined(__CYGWIN__)
+
+// We need only basic WINAPI without crypto functions and min/max macro.
+#ifndef WINDOWS_H
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#endif
+
+#define CVL_THREADING_WINDOWS 1
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define CVL_THREADING_WINDOWS 0
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#if CVL_THREADING_WINDOWS
+
+/** Mutex. */
+typedef CRITICAL_SECTION CVLMutex;
+
+/** Condition variable. */
+typedef CONDITION_VARIABLE CVLCondition;
+
+/** Thread handle. */
+typedef HANDLE CVLThread;
+
+/** Thread specific value key. */
+typedef DWORD CVLThreadKey;
+
+/** Calling convention of CVLThreadKeyDestructor. */
+#define CVL_THREAD_KEY_DESTRUCTOR_API NTAPI
+
+#else
+
+/** Mutex. */
+typedef pthread_mutex_t CVLMutex;
+
+/** Condition variable. */
+typedef pthread_cond_t CVLCondition;
+
+/** Thread handle. */
+typedef pthread_t CVLThread;
+
+/** Thread specific value key. */
+typedef pthread_key_t CVLThreadKey;
+
+/** Calling convention of CVLThreadKeyDestructor. */
+#define CVL_THREAD_KEY_DESTRUCTOR_API
+
+#endif
+
+/** Thread entry point. */
+typedef void (*CVLThreadFunction)(void *argument);
+
+/** Called with non-NULL thread specific value when owning thread exits. */
+typedef void (CVL_THREAD_KEY_DESTRUCTOR_API *CVLThreadKeyDestructor)(void *value);
+
+/** Size value accessed with cvl_atomic_* routines. */
+typedef volatile size_t CVLAtomicSize;
+
+/**
+ * Defines global variable in header: every translation unit emits the definition and the linker
+ * keeps one, so process-wide state of header-only modules is shared by all source files of a
+ * module (executable or shared library). Variable must be initialized for MSVC.
+ */
+#if defined(_MSC_VER)
+#define CVL_SHARED_GLOBAL __declspec(selectany)
+#elif defined(_WIN32) || defined(__CYGWIN__)
+#define CVL_SHARED_GLOBAL __attribute__((selectany))
+#else
+#define CVL_SHARED_GLOBAL __attribute__((weak))
+#endif
+
+
+
+/** Initialize mutex. Return false on failure. */
+static inline bool cvl_mutex_init(CVLMutex * const mutex) {
+#if CVL_THREADING_WINDOWS
+    InitializeCriticalSection(mutex);
+    return true;
+#else
+    return pthread_mutex_init(mutex, NULL) == 0;
+#endif
+}
+
+
+
+/** Destroy mutex initialized with cvl_mutex_init. */
+static inline void cvl_mutex_destroy(CVLMutex * const mutex) {
+#if CVL_THREADING_WINDOWS
+    DeleteCriticalSection(mutex);
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+
+
+/** Lock mutex. */
+static inline void cvl_mutex_lock(CVLMutex * const mutex) {
+#if CVL_THREADING_WINDOWS
+    EnterCriticalSection(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+
+
+/** Unlock mutex. */
+static inline void cvl_mutex_unlock(CVLMutex * const mutex) {
+#if CVL_THREADING_WINDOWS
+    LeaveCriticalSection(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+
+
+/** Initialize condition variable. Return false on failure. */
+static inline bool cvl_condition_init(CVLCondition * const condition) {
+#if CVL_THREADING_WINDOWS
+    InitializeConditionVariable(condition);
+    return true;
+#else
+    return pthread_cond_init(condition, NULL) == 0;
+#endif
+}
+
+
+
+/** Destroy condition variable initialized with cvl_condition_init. */
+static inline void cvl_condition_destroy(CVLCondition * const condition) {
+#if CVL_THREADING_WINDOWS
+    CVL_UNUSED(condition);
+#else
+    pthread_cond_destroy(condition);
+#endif
+}
+
+
+
+/** Atomically unlock @a mutex and wait for condition, @a mutex is locked again on return. */
+static inline void cvl_condition_wait(CVLCondition * const condition, CVLMutex * const mutex) {
+#if CVL_THREADING_WINDOWS
+    SleepConditionVariableCS(condition, mutex, INFINITE);
+#else
+    pthread_cond_wait(condition, mutex);
+#endif
+}
+
+
+
+/** Wake up one thread waiting for condition. */
+static inline void cvl_condition_signal(CVLCondition * const condition) {
+#if CVL_THREADING_WINDOWS
+    WakeConditionVariable(condition);
+#else
+    pthread_cond_signal(condition);
+#endif
+}
+
+
+
+/** Wake up all threads waiting for condition. */
+static inline void cvl_condition_broadcast(CVLCondition * const condition) {
+#if CVL_THREADING_WINDOWS
+    WakeAllConditionVariable(condition);
+#else
+    pthread_cond_broadcast(condition);
+#endif
+}
+
+
+
+/** Thread start record, passed from cvl_thread_create to the new thread. */
+typedef struct {
+    CVLThreadFunction function;
+    void *argument;
+} CVLThreadStart;
+
+
+
+#if CVL_THREADING_WINDOWS
+static DWORD WINAPI cvl_thread_entry(LPVOID parameter) {
+#else
+static inline void *cvl_thread_entry(void *parameter) {
+#endif
+    const CVLThreadStart start = *(CVLThreadStart *)parameter;
+    free(parameter);
+    start.function(start.argument);
+    return 0;
+}
+
+
+
+/**
+ * Start new thread executing @a function with @a argument.
+ *
+ * @return false if thread could not be started.
+ * @see cvl_thread_join
+ */
+static inline bool cvl_thread_create(CVLThread * const thread,
+                                     const CVLThreadFunction function,
+                                     void * const argument)
+{
+    CVLThreadStart * const start = (CVLThreadStart *)malloc(sizeof(CVLThreadStart));
+    if (!start) {
+        return false;
+    }
+    start->function = function;
+    start->argument = argument;
+#if CVL_THREADING_WINDOWS
+    *thread = CreateThread(NULL, 0, cvl_thread_entry, start, 0, NULL);
+    if (*thread == NULL) {
+        free(start);
+        return false;
+    }
+#else
+    if (pthread_create(thread, NULL, cvl_thread_entry, start) != 0) {
+        free(start);
+        return false;
+    }
+#endif
+    return true;
+}
+
+
+
+/** Wait for thread termination. */
+static inline void cvl_thread_join(CVLThread * const thread) {
+#if CVL_THREADING_WINDOWS
+    WaitForSingleObject(*thread, INFINITE);
+    CloseHandle(*thread);
+#else
+    pthread_join(*thread, NULL);
+#endif
+}
+
+
+
+/** Give up the rest of time slice of calling thread. */
+static inline void cvl_thread_yield(void) {
+#if CVL_THREADING_WINDOWS
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+
+
+/**
+ * Create thread specific value key.
+ *
+ * @param destructor Called at thread exit for threads which set non-NULL value.
+ * @return false if no more keys are available.
+ */
+static inline bool cvl_thread_key_create(CVLThreadKey * const key, const CVLThreadKeyDestructor destructor) {
+#if CVL_THREADING_WINDOWS
+    // Fiber local storage is the only Windows TLS flavour with exit callbacks.
+    *key = FlsAlloc(destructor);
+    return *key != FLS_OUT_OF_INDEXES;
+#else
+    return pthread_key_create(key, destructor) == 0;
+#endif
+}
+
+
+
+/** Set value of key for calling thread. */
+static inline void cvl_thread_key_set(const CVLThreadKey key, void * const value) {
+#if CVL_THREADING_WINDOWS
+    FlsSetValue(key, value);
+#else
+    pthread_setspecific(key, value);
+#endif
+}
+
+
+
+/** Return value of key for calling thread, NULL if it was not set. */
+static inline void *cvl_thread_key_get(const CVLThreadKey key) {
+#if CVL_THREADING_WINDOWS
+    return FlsGetValue(key);
+#else
+    return pthread_getspecific(key);
+#endif
+}
+
+
+
+/** Return number of logical processors available. */
+static inline size_t cvl_hardware_concurrency(void) {
+#if CVL_THREADING_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+#else
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+#endif
+}
+
+
+
+/** Atomically load value with acquire semantics. */
+static inline size_t cvl_atomic_load(CVLAtomicSize * const value) {
+#if CVL_THREADING_WINDOWS
+    const size_t result = *value;
+    MemoryBarrier();
+    return result;
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+
+/** Atomically store value with release semantics. */
+static inline void cvl_atomic_store(CVLAtomicSize * const value, const size_t desired) {
+#if CVL_THREADING_WINDOWS
+    MemoryBarrier();
+    *value = desired;
+#else
+    __atomic_store_n(value, desired, __ATOMIC_RELEASE);
+#endif
+}
+
+
+
+/** Atomically add @a delta to value and return previous value. */
+static inline size_t cvl_atomic_fetch_add(CVLAtomicSize * const value, const size_t delta) {
+#if CVL_THREADING_WINDOWS && defined(_WIN64)
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)value, (LONG64)delta);
+#elif CVL_THREADING_WINDOWS
+    return (size_t)InterlockedExchangeAdd((volatile LONG *)value, (LONG)delta);
+#else
+    return __atomic_fetch_add(value, delta, __ATOMIC_ACQ_REL);
+#endif
+}
+
+
+
+/**
+ * Atomically replace value with @a desired if it is equal to @a *expected.
+ *
+ * @return true on success, otherwise @a *expected receives current value.
+ */
+static inline bool cvl_atomic_compare_exchange(CVLAtomicSize * const value,
+                                               size_t * const expected,
+                                               const size_t desired)
+{
+#if CVL_THREADING_WINDOWS
+#ifdef _WIN64
+    const size_t previous = (size_t)InterlockedCompareExchange64((volatile LONG64 *)value,
+                                                                 (LONG64)desired, (LONG64)*expected);
+#else
+    const size_t previous = (size_t)InterlockedCompareExchange((volatile LONG *)value,
+                                                               (LONG)desired, (LONG)*expected);
+#endif
+    if (previous == *expected) {
+        return true;
+    }
+    *expected = previous;
+    return false;
+#else
+    return __atomic_compare_exchange_n(value, expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+
+/** Full memory barrier, no load or store is reordered across it. */
+static inline void cvl_atomic_fence(void) {
+#if CVL_THREADING_WINDOWS
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+
+
+/**
+ * Start one-time initialization guarded by @a state, which must be zero initialized.
+ *
+ * Exactly one caller gets true and must call cvl_once_end after initializing. Other callers wait
+ * until initialization is finished and get false. Data written by the initializer is visible to
+ * every caller after return.
+ */
+static inline bool cvl_once_begin(CVLAtomicSize * const state) {
+    if (cvl_atomic_load(state) == 2) {
+        return false;
+    }
+    size_t expected = 0;
+    if (cvl_atomic_compare_exchange(state, &expected, 1)) {
+        return true;
+    }
+    while (cvl_atomic_load(state) != 2) {
+        cvl_thread_yield();
+    }
+    return false;
+}
+
+
+
+/** Finish one-time initialization started with cvl_once_begin. */
+static inline void cvl_once_end(CVLAtomicSize * const state) {
+    cvl_atomic_store(state, 2);
+}
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_THREADING_H
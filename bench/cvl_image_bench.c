@@ -0,0 +1,1437 @@
+/**
+ * CVLImage benchmark.
+ *
+ * Runs every registered kernel over a matrix of image sizes, pixel types and memory layouts and
+ * reports median and 99th percentile sample time together with throughput. Results can be exported
+ * as JSON to track regressions between releases.
+ *
+ * Usage: cvl_image_bench [--json FILE] [--filter SUBSTRING] [--quick] [--min-time SECONDS]
+ *                        [--threads N] [--max-mb MEGABYTES]
+ *
+ * New kernels are added by appending an entry to cvl_bench_kernels. File kernels create a temporary
+ * file in working directory.
+ */
+
+// clock_gettime and CLOCK_MONOTONIC with strict ISO C compilers.
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "cvl_image_arena.h"
+#include "cvl_image_graph.h"
+#include "cvl_image_integral.h"
+#include "cvl_image_planar.h"
+#include "cvl_image_queue.h"
+#include "cvl_image_resize.h"
+#include "cvl_image_rotate.h"
+#include "cvl_image_sequence.h"
+#include "cvl_image_stats.h"
+#include "cvl_image_tiled.h"
+#include "cvl_image_warp.h"
+#include "cvl_rect_batch.h"
+
+#include "cvl_image_bench_handles.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if (defined(WIN32) || defined(_WIN32) || defined(__WIN32)) && !defined(__CYGWIN__)
+#define CVL_BENCH_WINDOWS 1
+#else
+#define CVL_BENCH_WINDOWS 0
+#include <time.h>
+#endif
+
+
+
+/** Default minimal measured time per case, seconds. */
+#define CVL_BENCH_DEFAULT_MIN_TIME 0.25
+
+/** Minimal measured time per case in quick mode, seconds. */
+#define CVL_BENCH_QUICK_MIN_TIME 0.02
+
+/** Minimal number of samples per case. */
+#define CVL_BENCH_MIN_SAMPLES 7
+
+/** Maximal number of samples per case. */
+#define CVL_BENCH_MAX_SAMPLES 2000
+
+/** Default limit of one image size, larger cases are skipped. */
+#define CVL_BENCH_DEFAULT_MAX_MB 512
+
+/** Number of calls per sample for kernels taking nanoseconds. */
+#define CVL_BENCH_FAST_OPS 1024
+
+
+
+/** Pixel type under test. */
+typedef struct {
+    const char *name;
+    CVLImageBytesCount size;
+} CVLBenchPixel;
+
+enum {
+    CVL_BENCH_PIXEL_8 = 0,
+    CVL_BENCH_PIXEL_F,
+    CVL_BENCH_PIXEL_8888,
+    CVL_BENCH_PIXEL_D,
+    CVL_BENCH_PIXEL_FFFF,
+    CVL_BENCH_PIXEL_DDDD,
+    CVL_BENCH_PIXEL_COUNT
+};
+
+#define CVL_BENCH_PIXEL_BIT(P) (1u << (P))
+#define CVL_BENCH_ALL_PIXELS   ((1u << CVL_BENCH_PIXEL_COUNT) - 1)
+
+static const CVLBenchPixel cvl_bench_pixels[CVL_BENCH_PIXEL_COUNT] = {
+    {"8",    CVLPixel_8_sz},
+    {"F",    CVLPixel_F_sz},
+    {"8888", CVLPixel_8888_sz},
+    {"D",    CVLPixel_D_sz},
+    {"FFFF", CVLPixel_FFFF_sz},
+    {"DDDD", CVLPixel_DDDD_sz}
+};
+
+/** Image size under test. */
+typedef struct {
+    const char *name;
+    CVLImagePixelCount width;
+    CVLImagePixelCount height;
+    bool quick;  ///< Included in quick mode.
+} CVLBenchSize;
+
+static const CVLBenchSize cvl_bench_sizes[] = {
+    {"thumb", 160,  120,  true},
+    {"vga",   640,  480,  true},
+    {"1080p", 1920, 1080, true},
+    {"4k",    3840, 2160, false},
+    {"8k",    7680, 4320, false}
+};
+
+/** Memory layout of images under test. */
+typedef enum {
+    CVL_BENCH_CONTINUOUS = 0, ///< rowBytes == width * pixel_size.
+    CVL_BENCH_STRIDED,        ///< Unaligned ROI of a wider image.
+    CVL_BENCH_LAYOUT_COUNT
+} CVLBenchLayout;
+
+static const char * const cvl_bench_layouts[CVL_BENCH_LAYOUT_COUNT] = {"continuous", "strided"};
+
+/** Strided ROIs start at this column of the parent image. */
+#define CVL_BENCH_ROI_X 3
+
+/** Parent of strided ROIs is wider by this number of pixels. */
+#define CVL_BENCH_ROI_PAD 37
+
+
+
+/** One benchmark case: kernel inputs for a size, pixel type and layout. */
+typedef struct {
+    int pixel;                   ///< Index in cvl_bench_pixels.
+    const CVLBenchSize *size;
+    CVLBenchLayout layout;
+    CVLThreadPool *pool;
+    CVLImageBuffer src;          ///< Source view.
+    CVLImageBuffer dst;          ///< Destination view of the same type and size.
+    CVLImageBuffer owned[8];     ///< Allocated parents of all views.
+    int owned_count;
+    CVLImageBuffer extra[8];     ///< Kernel specific views.
+    void *state;                 ///< Kernel specific state.
+} CVLBenchCase;
+
+/** Benchmarked kernel. */
+typedef struct {
+    const char *name;
+    unsigned pixels;                               ///< Mask of supported cvl_bench_pixels.
+    unsigned ops;                                  ///< Kernel calls per sample, 0 is 1.
+    double (*bytes)(const CVLBenchCase *bench);    ///< Bytes read and written per call, may be NULL.
+    bool (*setup)(CVLBenchCase *bench);            ///< Optional setup of extra images and state.
+    void (*teardown)(CVLBenchCase *bench);         ///< Optional release of state.
+    void (*run)(CVLBenchCase *bench);
+} CVLBenchKernel;
+
+/** Measurement result. */
+typedef struct {
+    const CVLBenchKernel *kernel;
+    const CVLBenchCase *bench;
+    size_t samples;
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    double mean_ns;
+    double gb_per_s;
+    double pixels_per_s;
+} CVLBenchResult;
+
+
+
+static inline double cvl_bench_now_ns(void) {
+#if CVL_BENCH_WINDOWS
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+#endif
+}
+
+
+
+static inline double cvl_bench_pixel_count(const CVLBenchCase * const bench) {
+    return (double)bench->size->width * (double)bench->size->height;
+}
+
+
+
+static inline CVLImageBytesCount cvl_bench_pixel_size(const CVLBenchCase * const bench) {
+    return cvl_bench_pixels[bench->pixel].size;
+}
+
+
+
+/**
+ * Allocate image view of case layout: a continuous image or an unaligned ROI of a wider image.
+ * Returned view is filled with a non-zero pattern and released with the case.
+ */
+static CVLImageBuffer cvl_bench_alloc(CVLBenchCase * const bench,
+                                      const CVLImagePixelCount height,
+                                      const CVLImagePixelCount width,
+                                      const CVLImageBytesCount pixel_size)
+{
+    if (bench->owned_count == (int)(sizeof(bench->owned) / sizeof(bench->owned[0]))) {
+        return cvl_image_make_empty();
+    }
+    const bool strided = bench->layout == CVL_BENCH_STRIDED;
+    CVLImageBuffer parent = cvl_image_create(height + (strided ? 2 : 0),
+                                             width + (strided ? CVL_BENCH_ROI_PAD : 0), pixel_size);
+    if (!parent.data) {
+        return parent;
+    }
+    memset(parent.data, 0x5A, parent.rowBytes * parent.height);
+    bench->owned[bench->owned_count++] = parent;
+    return strided ? cvl_image_subimage(&parent, cvl_rect_make(CVL_BENCH_ROI_X, 1, (int)width, (int)height), pixel_size) :
+                     parent;
+}
+
+
+
+static void cvl_bench_case_release(CVLBenchCase * const bench) {
+    for (int i = 0; i < bench->owned_count; ++i) {
+        cvl_image_release(&bench->owned[i]);
+    }
+    bench->owned_count = 0;
+}
+
+
+
+/*
+ * Byte counts.
+ */
+
+static double cvl_bench_bytes_read_write(const CVLBenchCase * const bench) {
+    return 2.0 * cvl_bench_pixel_count(bench) * (double)cvl_bench_pixel_size(bench);
+}
+
+
+
+static double cvl_bench_bytes_write(const CVLBenchCase * const bench) {
+    return cvl_bench_pixel_count(bench) * (double)cvl_bench_pixel_size(bench);
+}
+
+
+
+static double cvl_bench_bytes_convert_8_F(const CVLBenchCase * const bench) {
+    return cvl_bench_pixel_count(bench) * (double)(CVLPixel_8_sz + CVLPixel_F_sz);
+}
+
+
+
+static double cvl_bench_bytes_8888_to_8(const CVLBenchCase * const bench) {
+    return cvl_bench_pixel_count(bench) * (double)(CVLPixel_8888_sz + CVLPixel_8_sz);
+}
+
+
+
+static double cvl_bench_bytes_integral(const CVLBenchCase * const bench) {
+    const double table_size = bench->pixel == CVL_BENCH_PIXEL_8 ? sizeof(uint32_t) : sizeof(double);
+    return cvl_bench_pixel_count(bench) * ((double)cvl_bench_pixel_size(bench) + table_size);
+}
+
+
+
+/*
+ * cvl_image_utils kernels.
+ */
+
+static void cvl_bench_run_create(CVLBenchCase * const bench) {
+    CVLImageBuffer image = cvl_image_create(bench->size->height, bench->size->width, cvl_bench_pixel_size(bench));
+    cvl_image_release(&image);
+}
+
+
+
+static void cvl_bench_run_create_aligned(CVLBenchCase * const bench) {
+    CVLImageBuffer image = cvl_image_create_aligned(bench->size->height, bench->size->width, cvl_bench_pixel_size(bench),
+                                                    CVL_IMAGE_DEFAULT_ALIGNMENT, CVL_IMAGE_ROW_PADDING_AVOID_ALIASING);
+    cvl_image_release_aligned(&image);
+}
+
+
+
+static void cvl_bench_run_copy(CVLBenchCase * const bench) {
+    cvl_image_copy(&bench->src, &bench->dst, cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_run_clear(CVLBenchCase * const bench) {
+    cvl_image_clear(&bench->dst, cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_run_subimage(CVLBenchCase * const bench) {
+    const CVLImageBytesCount pixel_size = cvl_bench_pixel_size(bench);
+    const int width = (int)bench->src.width;
+    const int height = (int)bench->src.height;
+    volatile uintptr_t sink = 0;
+    for (unsigned i = 0; i < CVL_BENCH_FAST_OPS; ++i) {
+        const int x = (int)(i % (unsigned)width);
+        const int y = (int)(i % (unsigned)height);
+        const CVLImageBuffer roi = cvl_image_subimage(&bench->src, cvl_rect_make(x, y, width - x, height - y), pixel_size);
+        sink += (uintptr_t)roi.data;
+    }
+    CVL_UNUSED(sink);
+}
+
+
+
+static bool cvl_bench_setup_reuse(CVLBenchCase * const bench) {
+    bench->extra[0] = cvl_image_create(bench->size->height, bench->size->width, cvl_bench_pixel_size(bench));
+    return bench->extra[0].data != NULL;
+}
+
+
+
+static void cvl_bench_teardown_reuse(CVLBenchCase * const bench) {
+    cvl_image_release(&bench->extra[0]);
+}
+
+
+
+/** Reuse of a compatible image: layout check only. */
+static void cvl_bench_run_reuse_hit(CVLBenchCase * const bench) {
+    for (unsigned i = 0; i < CVL_BENCH_FAST_OPS; ++i) {
+        cvl_image_reuse(&bench->extra[0], bench->size->height, bench->size->width, cvl_bench_pixel_size(bench));
+    }
+}
+
+
+
+/** Reuse of an incompatible image: release and allocation, alternating between two widths. */
+static void cvl_bench_run_reuse_miss(CVLBenchCase * const bench) {
+    const CVLImagePixelCount width = bench->extra[0].width == bench->size->width ? bench->size->width / 2 :
+                                                                                   bench->size->width;
+    cvl_image_reuse(&bench->extra[0], bench->size->height, width, cvl_bench_pixel_size(bench));
+}
+
+
+
+/*
+ * cvl_image_parallel kernels.
+ */
+
+static void cvl_bench_run_copy_parallel(CVLBenchCase * const bench) {
+    cvl_image_copy_parallel(bench->pool, &bench->src, &bench->dst, cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_run_clear_parallel(CVLBenchCase * const bench) {
+    cvl_image_clear_parallel(bench->pool, &bench->dst, cvl_bench_pixel_size(bench));
+}
+
+
+
+/*
+ * cvl_image_convert kernels.
+ */
+
+static bool cvl_bench_setup_to_8(CVLBenchCase * const bench) {
+    bench->extra[0] = cvl_bench_alloc(bench, bench->size->height, bench->size->width, CVLPixel_8_sz);
+    return bench->extra[0].data != NULL;
+}
+
+
+
+static bool cvl_bench_setup_to_F(CVLBenchCase * const bench) {
+    bench->extra[0] = cvl_bench_alloc(bench, bench->size->height, bench->size->width, CVLPixel_F_sz);
+    return bench->extra[0].data != NULL;
+}
+
+
+
+static void cvl_bench_run_convert_8_to_F(CVLBenchCase * const bench) {
+    cvl_image_convert_8_to_F(&bench->src, &bench->extra[0], 1.0f / 255.0f, 0.0f);
+}
+
+
+
+static void cvl_bench_run_convert_F_to_8(CVLBenchCase * const bench) {
+    cvl_image_convert_F_to_8(&bench->src, &bench->extra[0], 255.0f, 0.0f);
+}
+
+
+
+static void cvl_bench_run_swizzle_8888(CVLBenchCase * const bench) {
+    static const uint8_t order[4] = CVL_SWIZZLE_RGBA_BGRA;
+    cvl_image_swizzle_8888(&bench->src, &bench->dst, order);
+}
+
+
+
+static void cvl_bench_run_rgba_to_gray(CVLBenchCase * const bench) {
+    cvl_image_convert_rgba_to_gray(&bench->src, &bench->extra[0]);
+}
+
+
+
+/*
+ * cvl_image_filter kernels.
+ */
+
+static void cvl_bench_run_box_blur(CVLBenchCase * const bench) {
+    if (bench->pixel == CVL_BENCH_PIXEL_8) {
+        cvl_image_box_blur_8(&bench->src, &bench->dst, 3, 3, CVL_BORDER_REPLICATE, 0);
+    }
+    else {
+        cvl_image_box_blur_F(&bench->src, &bench->dst, 3, 3, CVL_BORDER_REPLICATE, 0.0f);
+    }
+}
+
+
+
+static void cvl_bench_run_gaussian_blur(CVLBenchCase * const bench) {
+    if (bench->pixel == CVL_BENCH_PIXEL_8) {
+        cvl_image_gaussian_blur_8(&bench->src, &bench->dst, 2.0f, CVL_BORDER_REFLECT, 0);
+    }
+    else {
+        cvl_image_gaussian_blur_F(&bench->src, &bench->dst, 2.0f, CVL_BORDER_REFLECT, 0.0f);
+    }
+}
+
+
+
+static void cvl_bench_run_gaussian_blur_fast(CVLBenchCase * const bench) {
+    if (bench->pixel == CVL_BENCH_PIXEL_8) {
+        cvl_image_gaussian_blur_fast_8(&bench->src, &bench->dst, 2.0f, CVL_BORDER_REFLECT, 0);
+    }
+    else {
+        cvl_image_gaussian_blur_fast_F(&bench->src, &bench->dst, 2.0f, CVL_BORDER_REFLECT, 0.0f);
+    }
+}
+
+
+
+/*
+ * cvl_image_resize kernels.
+ */
+
+static bool cvl_bench_setup_resize(CVLBenchCase * const bench) {
+    const CVLImagePixelCount height = (bench->size->height * 2 + 2) / 3;
+    const CVLImagePixelCount width = (bench->size->width * 2 + 2) / 3;
+    CVLResizePlan * const plan = (CVLResizePlan *)malloc(sizeof(CVLResizePlan));
+    bench->extra[0] = cvl_bench_alloc(bench, height, width, cvl_bench_pixel_size(bench));
+    if (!plan || !bench->extra[0].data ||
+        !cvl_resize_plan_init(plan, bench->size->height, bench->size->width, height, width, CVL_RESIZE_BILINEAR))
+    {
+        free(plan);
+        return false;
+    }
+    bench->state = plan;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_resize(CVLBenchCase * const bench) {
+    cvl_resize_plan_release((CVLResizePlan *)bench->state);
+    free(bench->state);
+}
+
+
+
+static double cvl_bench_bytes_resize(const CVLBenchCase * const bench) {
+    return (cvl_bench_pixel_count(bench) + (double)bench->extra[0].width * (double)bench->extra[0].height) *
+           (double)cvl_bench_pixel_size(bench);
+}
+
+
+
+static void cvl_bench_run_resize(CVLBenchCase * const bench) {
+    CVLResizePlan * const plan = (CVLResizePlan *)bench->state;
+    switch (bench->pixel) {
+        case CVL_BENCH_PIXEL_8:    cvl_image_resize_8(plan, &bench->src, &bench->extra[0]); break;
+        case CVL_BENCH_PIXEL_8888: cvl_image_resize_8888(plan, &bench->src, &bench->extra[0]); break;
+        default:                   cvl_image_resize_F(plan, &bench->src, &bench->extra[0]); break;
+    }
+}
+
+
+
+/** Number of levels built by pyramid benchmark. */
+#define CVL_BENCH_PYRAMID_LEVELS 4
+
+static bool cvl_bench_setup_pyramid(CVLBenchCase * const bench) {
+    for (int i = 0; i < CVL_BENCH_PYRAMID_LEVELS; ++i) {
+        bench->extra[i] = cvl_bench_alloc(bench, cvl_image_pyramid_level_size(bench->size->height, i),
+                                          cvl_image_pyramid_level_size(bench->size->width, i),
+                                          cvl_bench_pixel_size(bench));
+        if (!bench->extra[i].data) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+
+static void cvl_bench_run_pyramid(CVLBenchCase * const bench) {
+    switch (bench->pixel) {
+        case CVL_BENCH_PIXEL_8:
+            cvl_image_pyramid_down_8(&bench->src, bench->extra, CVL_BENCH_PYRAMID_LEVELS);
+            break;
+        case CVL_BENCH_PIXEL_8888:
+            cvl_image_pyramid_down_8888(&bench->src, bench->extra, CVL_BENCH_PYRAMID_LEVELS);
+            break;
+        default:
+            cvl_image_pyramid_down_F(&bench->src, bench->extra, CVL_BENCH_PYRAMID_LEVELS);
+            break;
+    }
+}
+
+
+
+/*
+ * cvl_image_integral kernels.
+ */
+
+static bool cvl_bench_setup_integral(CVLBenchCase * const bench) {
+    CVLIntegralImage * const integral = (CVLIntegralImage *)malloc(sizeof(CVLIntegralImage));
+    const CVLIntegralType type = bench->pixel == CVL_BENCH_PIXEL_8 ? CVL_INTEGRAL_U32 : CVL_INTEGRAL_D;
+    if (!integral || !cvl_integral_init(integral, bench->size->height, bench->size->width, type, false)) {
+        free(integral);
+        return false;
+    }
+    bench->state = integral;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_integral(CVLBenchCase * const bench) {
+    cvl_integral_release((CVLIntegralImage *)bench->state);
+    free(bench->state);
+}
+
+
+
+static void cvl_bench_run_integral(CVLBenchCase * const bench) {
+    if (bench->pixel == CVL_BENCH_PIXEL_8) {
+        cvl_integral_compute_8(NULL, &bench->src, (CVLIntegralImage *)bench->state);
+    }
+    else {
+        cvl_integral_compute_F(NULL, &bench->src, (CVLIntegralImage *)bench->state);
+    }
+}
+
+
+
+static void cvl_bench_run_integral_parallel(CVLBenchCase * const bench) {
+    if (bench->pixel == CVL_BENCH_PIXEL_8) {
+        cvl_integral_compute_8(bench->pool, &bench->src, (CVLIntegralImage *)bench->state);
+    }
+    else {
+        cvl_integral_compute_F(bench->pool, &bench->src, (CVLIntegralImage *)bench->state);
+    }
+}
+
+
+
+/*
+ * cvl_image_tiled kernels.
+ */
+
+static bool cvl_bench_setup_tiled(CVLBenchCase * const bench) {
+    CVLTiledImage * const tiled = (CVLTiledImage *)malloc(sizeof(CVLTiledImage));
+    if (!tiled) {
+        return false;
+    }
+    *tiled = cvl_tiled_image_create_from_image(NULL, &bench->src, cvl_bench_pixel_size(bench), 0, 0);
+    if (!tiled->data) {
+        free(tiled);
+        return false;
+    }
+    bench->state = tiled;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_tiled(CVLBenchCase * const bench) {
+    cvl_tiled_image_release((CVLTiledImage *)bench->state);
+    free(bench->state);
+}
+
+
+
+static void cvl_bench_run_to_tiled(CVLBenchCase * const bench) {
+    cvl_tiled_image_from_image(NULL, &bench->src, (const CVLTiledImage *)bench->state);
+}
+
+
+
+static void cvl_bench_run_from_tiled(CVLBenchCase * const bench) {
+    cvl_tiled_image_to_image(NULL, (const CVLTiledImage *)bench->state, &bench->dst);
+}
+
+
+
+/*
+ * cvl_image_rotate kernels.
+ */
+
+static bool cvl_bench_setup_rotate(CVLBenchCase * const bench) {
+    bench->extra[0] = cvl_bench_alloc(bench, bench->size->width, bench->size->height, cvl_bench_pixel_size(bench));
+    return bench->extra[0].data != NULL;
+}
+
+
+
+static void cvl_bench_run_flip_horizontal(CVLBenchCase * const bench) {
+    cvl_image_flip_horizontal(NULL, &bench->src, &bench->dst, cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_run_transpose(CVLBenchCase * const bench) {
+    cvl_image_transpose(NULL, &bench->src, &bench->extra[0], cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_run_rotate_90(CVLBenchCase * const bench) {
+    cvl_image_rotate(NULL, &bench->src, &bench->extra[0], CVL_IMAGE_ROTATE_90, cvl_bench_pixel_size(bench));
+}
+
+
+
+/*
+ * cvl_image_warp kernels.
+ */
+
+/** Rotation by 10 degrees around image center. */
+static CVLWarpTransform cvl_bench_warp_transform(const CVLBenchCase * const bench) {
+    const double c = cos(10.0 * 3.14159265358979323846 / 180.0);
+    const double s = sin(10.0 * 3.14159265358979323846 / 180.0);
+    const double cx = 0.5 * (double)(bench->size->width - 1);
+    const double cy = 0.5 * (double)(bench->size->height - 1);
+    const double m[6] = {c, -s, cx - c * cx + s * cy,
+                         s,  c, cy - s * cx - c * cy};
+    return cvl_warp_transform_affine(m);
+}
+
+
+
+static CVLPixelType cvl_bench_pixel_type(const CVLBenchCase * const bench) {
+    switch (bench->pixel) {
+        case CVL_BENCH_PIXEL_8:    return CVL_PIXEL_TYPE_8;
+        case CVL_BENCH_PIXEL_8888: return CVL_PIXEL_TYPE_8888;
+        default:                   return CVL_PIXEL_TYPE_F;
+    }
+}
+
+
+
+static bool cvl_bench_setup_remap(CVLBenchCase * const bench) {
+    CVLWarpMap * const map = (CVLWarpMap *)malloc(sizeof(CVLWarpMap));
+    const CVLWarpTransform transform = cvl_bench_warp_transform(bench);
+    if (!map || !cvl_warp_map_init(map, bench->size->height, bench->size->width, &transform, CVL_WARP_BILINEAR)) {
+        free(map);
+        return false;
+    }
+    bench->state = map;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_remap(CVLBenchCase * const bench) {
+    cvl_warp_map_release((CVLWarpMap *)bench->state);
+    free(bench->state);
+}
+
+
+
+static void cvl_bench_run_warp_affine(CVLBenchCase * const bench) {
+    const CVLWarpTransform transform = cvl_bench_warp_transform(bench);
+    cvl_image_warp(NULL, &bench->src, &bench->dst, cvl_bench_pixel_type(bench), &transform,
+                   CVL_WARP_BILINEAR, CVL_BORDER_CONSTANT, NULL);
+}
+
+
+
+static void cvl_bench_run_remap(CVLBenchCase * const bench) {
+    cvl_image_remap(NULL, (const CVLWarpMap *)bench->state, &bench->src, &bench->dst, cvl_bench_pixel_type(bench),
+                    CVL_BORDER_CONSTANT, NULL);
+}
+
+
+
+/*
+ * cvl_image_stats kernels.
+ */
+
+static void cvl_bench_run_stats(CVLBenchCase * const bench) {
+    CVLImageStats stats;
+    cvl_image_stats(NULL, &bench->src, NULL, cvl_bench_pixel_type(bench), false, &stats);
+}
+
+
+
+static void cvl_bench_run_histogram(CVLBenchCase * const bench) {
+    CVLImageStats stats;
+    cvl_image_stats(NULL, &bench->src, NULL, cvl_bench_pixel_type(bench), true, &stats);
+}
+
+
+
+/*
+ * cvl_image_planar kernels.
+ */
+
+static bool cvl_bench_setup_planar(CVLBenchCase * const bench) {
+    CVLPlanarImage * const planar = (CVLPlanarImage *)malloc(sizeof(CVLPlanarImage));
+    if (!planar) {
+        return false;
+    }
+    *planar = cvl_planar_image_create(bench->size->height, bench->size->width, 4, cvl_bench_pixel_size(bench) / 4, true);
+    if (planar->plane_count != 4) {
+        free(planar);
+        return false;
+    }
+    bench->state = planar;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_planar(CVLBenchCase * const bench) {
+    cvl_planar_image_release((CVLPlanarImage *)bench->state);
+    free(bench->state);
+}
+
+
+
+static CVLPixelType cvl_bench_interleaved_type(const CVLBenchCase * const bench) {
+    return bench->pixel == CVL_BENCH_PIXEL_8888 ? CVL_PIXEL_TYPE_8888 : CVL_PIXEL_TYPE_FFFF;
+}
+
+
+
+static void cvl_bench_run_deinterleave(CVLBenchCase * const bench) {
+    cvl_planar_image_from_interleaved(NULL, &bench->src, cvl_bench_interleaved_type(bench),
+                                      (const CVLPlanarImage *)bench->state);
+}
+
+
+
+static void cvl_bench_run_interleave(CVLBenchCase * const bench) {
+    cvl_planar_image_to_interleaved(NULL, (const CVLPlanarImage *)bench->state, cvl_bench_interleaved_type(bench),
+                                    &bench->dst);
+}
+
+
+
+/*
+ * cvl_image_graph kernels.
+ */
+
+static bool cvl_bench_setup_graph(CVLBenchCase * const bench) {
+    CVLImageGraph * const graph = (CVLImageGraph *)malloc(sizeof(CVLImageGraph));
+    if (!graph) {
+        return false;
+    }
+    // Normalize to [-1, 1], clear border and convert back: four stages fused into one pass.
+    cvl_image_graph_init(graph, &bench->src, CVL_PIXEL_TYPE_8);
+    cvl_image_graph_convert_8_to_F(graph, 1.0f / 255.0f, 0.0f);
+    cvl_image_graph_scale_offset(graph, 2.0f, -1.0f);
+    cvl_image_graph_clear_border(graph, 8);
+    cvl_image_graph_convert_F_to_8(graph, 127.5f, 127.5f);
+    if (graph->failed) {
+        free(graph);
+        return false;
+    }
+    bench->state = graph;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_graph(CVLBenchCase * const bench) {
+    free(bench->state);
+}
+
+
+
+static void cvl_bench_run_graph(CVLBenchCase * const bench) {
+    cvl_image_graph_execute((const CVLImageGraph *)bench->state, bench->pool, &bench->dst);
+}
+
+
+
+/*
+ * cvl_image_pool and cvl_image_arena kernels.
+ */
+
+static bool cvl_bench_setup_pool(CVLBenchCase * const bench) {
+    CVLImagePool * const pool = (CVLImagePool *)malloc(sizeof(CVLImagePool));
+    if (!pool || !cvl_image_pool_init(pool, 0)) {
+        free(pool);
+        return false;
+    }
+    bench->state = pool;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_pool(CVLBenchCase * const bench) {
+    cvl_image_pool_destroy((CVLImagePool *)bench->state);
+    free(bench->state);
+}
+
+
+
+/** Create and release of a cached image: compare with create. */
+static void cvl_bench_run_pool_create(CVLBenchCase * const bench) {
+    CVLImagePool * const pool = (CVLImagePool *)bench->state;
+    for (unsigned i = 0; i < CVL_BENCH_FAST_OPS; ++i) {
+        CVLImageBuffer image = cvl_image_pool_create(pool, bench->size->height, bench->size->width,
+                                                     cvl_bench_pixel_size(bench));
+        cvl_image_pool_release(pool, &image);
+    }
+}
+
+
+
+static bool cvl_bench_setup_arena(CVLBenchCase * const bench) {
+    CVLImageArena * const arena = (CVLImageArena *)malloc(sizeof(CVLImageArena));
+    const size_t size = (size_t)bench->size->height * bench->size->width * cvl_bench_pixel_size(bench);
+    if (!arena || !cvl_image_arena_init(arena, size, 0)) {
+        free(arena);
+        return false;
+    }
+    bench->state = arena;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_arena(CVLBenchCase * const bench) {
+    cvl_image_arena_destroy((CVLImageArena *)bench->state);
+    free(bench->state);
+}
+
+
+
+/** Create of an image and rewind of arena. */
+static void cvl_bench_run_arena_create(CVLBenchCase * const bench) {
+    CVLImageArena * const arena = (CVLImageArena *)bench->state;
+    volatile uintptr_t sink = 0;
+    for (unsigned i = 0; i < CVL_BENCH_FAST_OPS; ++i) {
+        const size_t mark = cvl_image_arena_mark(arena);
+        const CVLImageBuffer image = cvl_image_create_in_arena(arena, bench->size->height, bench->size->width,
+                                                               cvl_bench_pixel_size(bench));
+        sink += (uintptr_t)image.data;
+        cvl_image_arena_rewind(arena, mark);
+    }
+    CVL_UNUSED(sink);
+}
+
+
+
+/*
+ * cvl_rect_batch kernels, batches of image width rects.
+ */
+
+/** State of rect batch kernels. */
+typedef struct {
+    CVLRectBatch a;
+    CVLRectBatch b;
+    CVLRectBatch out;
+    float *iou;
+} CVLBenchRects;
+
+
+
+static void cvl_bench_teardown_rect_batch(CVLBenchCase * const bench) {
+    CVLBenchRects * const rects = (CVLBenchRects *)bench->state;
+    if (rects) {
+        cvl_rect_batch_release(&rects->a);
+        cvl_rect_batch_release(&rects->b);
+        cvl_rect_batch_release(&rects->out);
+        free(rects->iou);
+        free(rects);
+    }
+}
+
+
+
+static bool cvl_bench_setup_rect_batch(CVLBenchCase * const bench) {
+    CVLBenchRects * const rects = (CVLBenchRects *)calloc(1, sizeof(CVLBenchRects));
+    const size_t count = bench->size->width;
+    if (!rects) {
+        return false;
+    }
+    bench->state = rects;
+    rects->iou = (float *)malloc(count * sizeof(float));
+    if (!rects->iou || !cvl_rect_batch_init(&rects->a, count) || !cvl_rect_batch_init(&rects->b, count) ||
+        !cvl_rect_batch_init(&rects->out, count))
+    {
+        cvl_bench_teardown_rect_batch(bench);
+        return false;
+    }
+    // Overlapping rects of varying size scattered over the image.
+    const int width = (int)bench->size->width;
+    const int height = (int)bench->size->height;
+    for (size_t i = 0; i < count; ++i) {
+        const int x = (int)(i * 37 % (size_t)width);
+        const int y = (int)(i * 53 % (size_t)height);
+        cvl_rect_batch_push(&rects->a, cvl_rect_make(x, y, 16 + (int)(i % 48), 16 + (int)(i % 40)));
+        cvl_rect_batch_push(&rects->b, cvl_rect_make(x + (int)(i % 23) - 11, y + (int)(i % 19) - 9, 32, 24));
+    }
+    return true;
+}
+
+
+
+static double cvl_bench_bytes_rect_batch_iou(const CVLBenchCase * const bench) {
+    return (double)bench->size->width * (8.0 * sizeof(int) + sizeof(float));
+}
+
+
+
+static double cvl_bench_bytes_rect_batch_union(const CVLBenchCase * const bench) {
+    return (double)bench->size->width * 12.0 * sizeof(int);
+}
+
+
+
+static void cvl_bench_run_rect_batch_iou(CVLBenchCase * const bench) {
+    CVLBenchRects * const rects = (CVLBenchRects *)bench->state;
+    cvl_rect_batch_iou(&rects->a, &rects->b, rects->iou);
+}
+
+
+
+static void cvl_bench_run_rect_batch_union(CVLBenchCase * const bench) {
+    CVLBenchRects * const rects = (CVLBenchRects *)bench->state;
+    cvl_rect_batch_union(&rects->a, &rects->b, &rects->out);
+}
+
+
+
+/*
+ * cvl_image_queue kernels.
+ */
+
+/** State of queue kernels. */
+typedef struct {
+    CVLImagePool pool;
+    CVLImageQueue queue;
+    CVLImageBuffer frame;
+} CVLBenchQueue;
+
+
+
+static bool cvl_bench_setup_queue(CVLBenchCase * const bench) {
+    CVLBenchQueue * const state = (CVLBenchQueue *)malloc(sizeof(CVLBenchQueue));
+    if (!state || !cvl_image_pool_init(&state->pool, 0)) {
+        free(state);
+        return false;
+    }
+    if (!cvl_image_queue_init(&state->queue, 8, CVL_IMAGE_QUEUE_SPSC, &state->pool)) {
+        cvl_image_pool_destroy(&state->pool);
+        free(state);
+        return false;
+    }
+    state->frame = cvl_image_queue_acquire_frame(&state->queue, bench->size->height, bench->size->width,
+                                                 cvl_bench_pixel_size(bench));
+    if (!state->frame.data) {
+        cvl_image_queue_destroy(&state->queue);
+        cvl_image_pool_destroy(&state->pool);
+        free(state);
+        return false;
+    }
+    bench->state = state;
+    return true;
+}
+
+
+
+static void cvl_bench_teardown_queue(CVLBenchCase * const bench) {
+    CVLBenchQueue * const state = (CVLBenchQueue *)bench->state;
+    cvl_image_queue_release_frame(&state->queue, &state->frame);
+    cvl_image_queue_destroy(&state->queue);
+    cvl_image_pool_destroy(&state->pool);
+    free(state);
+}
+
+
+
+/** Push and pop of one frame by the same thread: queue overhead without contention. */
+static void cvl_bench_run_queue_push_pop(CVLBenchCase * const bench) {
+    CVLBenchQueue * const state = (CVLBenchQueue *)bench->state;
+    for (unsigned i = 0; i < CVL_BENCH_FAST_OPS; ++i) {
+        cvl_image_queue_try_push(&state->queue, &state->frame);
+        cvl_image_queue_try_pop(&state->queue, &state->frame);
+    }
+}
+
+
+
+/*
+ * cvl_image_file and cvl_image_sequence kernels, the file is created in working directory.
+ */
+
+/** Benchmark file path. */
+#define CVL_BENCH_FILE_PATH "cvl_image_bench.cvlraw"
+
+/** Number of frames in benchmark file read by sequence kernel. */
+#define CVL_BENCH_FILE_FRAMES 4
+
+
+
+static bool cvl_bench_setup_file(CVLBenchCase * const bench) {
+    const CVLImageBuffer frames[CVL_BENCH_FILE_FRAMES] = {bench->src, bench->src, bench->src, bench->src};
+    return cvl_image_file_write(CVL_BENCH_FILE_PATH, frames, CVL_BENCH_FILE_FRAMES, cvl_bench_pixel_type(bench),
+                                cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_teardown_file(CVLBenchCase * const bench) {
+    CVL_UNUSED(bench);
+    remove(CVL_BENCH_FILE_PATH);
+}
+
+
+
+static double cvl_bench_bytes_file_sequence(const CVLBenchCase * const bench) {
+    return CVL_BENCH_FILE_FRAMES * cvl_bench_bytes_write(bench);
+}
+
+
+
+/** Write of one frame file, served from page cache. */
+static void cvl_bench_run_file_write(CVLBenchCase * const bench) {
+    cvl_image_file_write(CVL_BENCH_FILE_PATH, &bench->src, 1, cvl_bench_pixel_type(bench), cvl_bench_pixel_size(bench));
+}
+
+
+
+/** Open, copy of the first frame out of the mapping and close. */
+static void cvl_bench_run_file_read(CVLBenchCase * const bench) {
+    CVLImageFile file;
+    if (cvl_image_file_open(&file, CVL_BENCH_FILE_PATH, false)) {
+        const CVLImageBuffer frame = cvl_image_file_frame(&file, 0);
+        cvl_image_copy(&frame, &bench->dst, cvl_bench_pixel_size(bench));
+        cvl_image_file_close(&file);
+    }
+}
+
+
+
+/** Read of all frames through prefetching reader, including start and stop of its thread. */
+static void cvl_bench_run_sequence_read(CVLBenchCase * const bench) {
+    const char * const paths[1] = {CVL_BENCH_FILE_PATH};
+    CVLSequenceFiles files;
+    CVLSequenceReader reader;
+    cvl_sequence_files_init(&files, paths, 1);
+    if (cvl_sequence_reader_open(&reader, 2, cvl_sequence_files_load, &files)) {
+        const CVLImageBuffer *frame;
+        while ((frame = cvl_sequence_reader_next(&reader))) {
+            cvl_image_copy(frame, &bench->dst, cvl_bench_pixel_size(bench));
+        }
+        cvl_sequence_reader_close(&reader);
+    }
+    cvl_sequence_files_close(&files);
+}
+
+
+
+/*
+ * cvl::Image handle kernels, see cvl_image_bench_handles.cpp.
+ */
+
+static bool cvl_bench_setup_handle(CVLBenchCase * const bench) {
+    bench->state = cvl_bench_handle_new(bench->size->height, bench->size->width, cvl_bench_pixel_size(bench));
+    return bench->state != NULL;
+}
+
+
+
+static void cvl_bench_teardown_handle(CVLBenchCase * const bench) {
+    cvl_bench_handle_delete(bench->state);
+}
+
+
+
+static void cvl_bench_run_handle_create(CVLBenchCase * const bench) {
+    cvl_bench_handle_create(bench->size->height, bench->size->width, cvl_bench_pixel_size(bench));
+}
+
+
+
+static void cvl_bench_run_handle_share(CVLBenchCase * const bench) {
+    cvl_bench_handle_share(bench->state, CVL_BENCH_FAST_OPS);
+}
+
+
+
+static void cvl_bench_run_handle_write(CVLBenchCase * const bench) {
+    cvl_bench_handle_write(bench->state);
+}
+
+
+
+#define CVL_BENCH_8_F       (CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8) | CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_F))
+#define CVL_BENCH_8_8888_F  (CVL_BENCH_8_F | CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8888))
+
+/** Registry of benchmarked kernels. */
+static const CVLBenchKernel cvl_bench_kernels[] = {
+    {"create",             CVL_BENCH_ALL_PIXELS, 0, NULL,
+     NULL, NULL, cvl_bench_run_create},
+    {"create_aligned",     CVL_BENCH_ALL_PIXELS, 0, NULL,
+     NULL, NULL, cvl_bench_run_create_aligned},
+    {"pool_create",        CVL_BENCH_ALL_PIXELS, CVL_BENCH_FAST_OPS, NULL,
+     cvl_bench_setup_pool, cvl_bench_teardown_pool, cvl_bench_run_pool_create},
+    {"arena_create",       CVL_BENCH_ALL_PIXELS, CVL_BENCH_FAST_OPS, NULL,
+     cvl_bench_setup_arena, cvl_bench_teardown_arena, cvl_bench_run_arena_create},
+    {"copy",               CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_copy},
+    {"clear",              CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_write,
+     NULL, NULL, cvl_bench_run_clear},
+    {"subimage",           CVL_BENCH_ALL_PIXELS, CVL_BENCH_FAST_OPS, NULL,
+     NULL, NULL, cvl_bench_run_subimage},
+    {"reuse_hit",          CVL_BENCH_ALL_PIXELS, CVL_BENCH_FAST_OPS, NULL,
+     cvl_bench_setup_reuse, cvl_bench_teardown_reuse, cvl_bench_run_reuse_hit},
+    {"reuse_miss",         CVL_BENCH_ALL_PIXELS, 0, NULL,
+     cvl_bench_setup_reuse, cvl_bench_teardown_reuse, cvl_bench_run_reuse_miss},
+    {"copy_parallel",      CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_copy_parallel},
+    {"clear_parallel",     CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_write,
+     NULL, NULL, cvl_bench_run_clear_parallel},
+    {"convert_8_to_F",     CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8), 0, cvl_bench_bytes_convert_8_F,
+     cvl_bench_setup_to_F, NULL, cvl_bench_run_convert_8_to_F},
+    {"convert_F_to_8",     CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_F), 0, cvl_bench_bytes_convert_8_F,
+     cvl_bench_setup_to_8, NULL, cvl_bench_run_convert_F_to_8},
+    {"swizzle_8888",       CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8888), 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_swizzle_8888},
+    {"rgba_to_gray",       CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8888), 0, cvl_bench_bytes_8888_to_8,
+     cvl_bench_setup_to_8, NULL, cvl_bench_run_rgba_to_gray},
+    {"box_blur_r3",        CVL_BENCH_8_F, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_box_blur},
+    {"gaussian_blur_s2",   CVL_BENCH_8_F, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_gaussian_blur},
+    {"gaussian_fast_s2",   CVL_BENCH_8_F, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_gaussian_blur_fast},
+    {"resize_bilinear",    CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_resize,
+     cvl_bench_setup_resize, cvl_bench_teardown_resize, cvl_bench_run_resize},
+    {"pyramid_down_4",     CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_write,
+     cvl_bench_setup_pyramid, NULL, cvl_bench_run_pyramid},
+    {"integral",           CVL_BENCH_8_F, 0, cvl_bench_bytes_integral,
+     cvl_bench_setup_integral, cvl_bench_teardown_integral, cvl_bench_run_integral},
+    {"integral_parallel",  CVL_BENCH_8_F, 0, cvl_bench_bytes_integral,
+     cvl_bench_setup_integral, cvl_bench_teardown_integral, cvl_bench_run_integral_parallel},
+    {"to_tiled",           CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_tiled, cvl_bench_teardown_tiled, cvl_bench_run_to_tiled},
+    {"from_tiled",         CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_tiled, cvl_bench_teardown_tiled, cvl_bench_run_from_tiled},
+    {"flip_horizontal",    CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_flip_horizontal},
+    {"transpose",          CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_rotate, NULL, cvl_bench_run_transpose},
+    {"rotate_90",          CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_rotate, NULL, cvl_bench_run_rotate_90},
+    {"warp_affine",        CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_read_write,
+     NULL, NULL, cvl_bench_run_warp_affine},
+    {"remap",              CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_remap, cvl_bench_teardown_remap, cvl_bench_run_remap},
+    {"stats",              CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_write,
+     NULL, NULL, cvl_bench_run_stats},
+    {"histogram",          CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8) | CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8888), 0,
+     cvl_bench_bytes_write, NULL, NULL, cvl_bench_run_histogram},
+    {"deinterleave",       CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8888) | CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_FFFF), 0,
+     cvl_bench_bytes_read_write, cvl_bench_setup_planar, cvl_bench_teardown_planar, cvl_bench_run_deinterleave},
+    {"interleave",         CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8888) | CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_FFFF), 0,
+     cvl_bench_bytes_read_write, cvl_bench_setup_planar, cvl_bench_teardown_planar, cvl_bench_run_interleave},
+    {"graph_normalize",    CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8), 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_graph, cvl_bench_teardown_graph, cvl_bench_run_graph},
+    {"rect_batch_iou",     CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8), 0, cvl_bench_bytes_rect_batch_iou,
+     cvl_bench_setup_rect_batch, cvl_bench_teardown_rect_batch, cvl_bench_run_rect_batch_iou},
+    {"rect_batch_union",   CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8), 0, cvl_bench_bytes_rect_batch_union,
+     cvl_bench_setup_rect_batch, cvl_bench_teardown_rect_batch, cvl_bench_run_rect_batch_union},
+    {"queue_push_pop",     CVL_BENCH_PIXEL_BIT(CVL_BENCH_PIXEL_8), CVL_BENCH_FAST_OPS, NULL,
+     cvl_bench_setup_queue, cvl_bench_teardown_queue, cvl_bench_run_queue_push_pop},
+    {"file_write",         CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_write,
+     NULL, cvl_bench_teardown_file, cvl_bench_run_file_write},
+    {"file_read",          CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_file, cvl_bench_teardown_file, cvl_bench_run_file_read},
+    {"sequence_read",      CVL_BENCH_8_8888_F, 0, cvl_bench_bytes_file_sequence,
+     cvl_bench_setup_file, cvl_bench_teardown_file, cvl_bench_run_sequence_read},
+    {"handle_create",      CVL_BENCH_ALL_PIXELS, 0, NULL,
+     NULL, NULL, cvl_bench_run_handle_create},
+    {"handle_share",       CVL_BENCH_ALL_PIXELS, CVL_BENCH_FAST_OPS, NULL,
+     cvl_bench_setup_handle, cvl_bench_teardown_handle, cvl_bench_run_handle_share},
+    {"handle_write",       CVL_BENCH_ALL_PIXELS, 0, cvl_bench_bytes_read_write,
+     cvl_bench_setup_handle, cvl_bench_teardown_handle, cvl_bench_run_handle_write}
+};
+
+
+
+static int cvl_bench_compare_double(const void * const a, const void * const b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+
+
+/** Sample kernel until both minimal time and minimal sample count are reached. */
+static void cvl_bench_measure(const CVLBenchKernel * const kernel,
+                              CVLBenchCase * const bench,
+                              const double min_time_ns,
+                              double * const samples,
+                              CVLBenchResult * const result)
+{
+    const double ops = kernel->ops ? (double)kernel->ops : 1.0;
+    kernel->run(bench);  // Warm up caches, page tables and lazily initialized state.
+
+    size_t count = 0;
+    double total = 0.0;
+    while (count < CVL_BENCH_MAX_SAMPLES && (count < CVL_BENCH_MIN_SAMPLES || total < min_time_ns)) {
+        const double start = cvl_bench_now_ns();
+        kernel->run(bench);
+        const double elapsed = cvl_bench_now_ns() - start;
+        samples[count++] = elapsed / ops;
+        total += elapsed;
+    }
+    qsort(samples, count, sizeof(double), cvl_bench_compare_double);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        sum += samples[i];
+    }
+    const size_t p99_index = (count * 99 + 99) / 100 - 1;
+
+    result->kernel = kernel;
+    result->bench = bench;
+    result->samples = count;
+    result->median_ns = count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+    result->p99_ns = samples[p99_index < count ? p99_index : count - 1];
+    result->min_ns = samples[0];
+    result->mean_ns = sum / (double)count;
+    result->gb_per_s = kernel->bytes && result->median_ns > 0.0 ? kernel->bytes(bench) / result->median_ns : 0.0;
+    result->pixels_per_s = kernel->ops || result->median_ns <= 0.0 ? 0.0 :
+                           cvl_bench_pixel_count(bench) * 1e9 / result->median_ns;
+}
+
+
+
+static void cvl_bench_print_result(const CVLBenchResult * const result) {
+    const CVLBenchCase * const bench = result->bench;
+    printf("%-18s %-5s %-5s %-10s %12.3f %12.3f %9.2f %10.1f\n",
+           result->kernel->name, cvl_bench_pixels[bench->pixel].name, bench->size->name,
+           cvl_bench_layouts[bench->layout], result->median_ns / 1e3, result->p99_ns / 1e3,
+           result->gb_per_s, result->pixels_per_s / 1e6);
+    fflush(stdout);
+}
+
+
+
+static void cvl_bench_write_json_result(FILE * const file, const CVLBenchResult * const result, const bool last) {
+    const CVLBenchCase * const bench = result->bench;
+    fprintf(file,
+            "    {\"kernel\": \"%s\", \"pixel\": \"%s\", \"size\": \"%s\", \"width\": %u, \"height\": %u, "
+            "\"layout\": \"%s\", \"samples\": %u, \"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, "
+            "\"mean_ns\": %.1f, \"gb_per_s\": %.4f, \"pixels_per_s\": %.1f}%s\n",
+            result->kernel->name, cvl_bench_pixels[bench->pixel].name, bench->size->name,
+            (unsigned)bench->size->width, (unsigned)bench->size->height, cvl_bench_layouts[bench->layout],
+            (unsigned)result->samples, result->median_ns, result->p99_ns, result->min_ns, result->mean_ns,
+            result->gb_per_s, result->pixels_per_s, last ? "" : ",");
+}
+
+
+
+static const char *cvl_bench_simd_name(const CVLSimdLevel level) {
+    switch (level) {
+        case CVL_SIMD_LEVEL_SSE2: return "sse2";
+        case CVL_SIMD_LEVEL_AVX2: return "avx2";
+        case CVL_SIMD_LEVEL_AVX512: return "avx512";
+        default:              return "scalar";
+    }
+}
+
+
+
+static void cvl_bench_usage(const char * const program) {
+    fprintf(stderr,
+            "Usage: %s [--json FILE] [--filter SUBSTRING] [--quick] [--min-time SECONDS]\n"
+            "          [--threads N] [--max-mb MEGABYTES]\n", program);
+}
+
+
+
+/** Release buffers and thread pool of main, any of them may be NULL. */
+static void cvl_bench_cleanup(CVLThreadPool * const pool,
+                              double * const samples,
+                              CVLBenchCase * const cases,
+                              CVLBenchResult * const results)
+{
+    cvl_thread_pool_destroy(pool);
+    free(samples);
+    free(cases);
+    free(results);
+}
+
+
+
+int main(int argc, char **argv) {
+    const char *json_path = NULL;
+    const char *filter = NULL;
+    bool quick = false;
+    double min_time = -1.0;
+    size_t threads = 0;
+    double max_mb = CVL_BENCH_DEFAULT_MAX_MB;
+
+    for (int i = 1; i < argc; ++i) {
+        const bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--json") && has_value) {
+            json_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--filter") && has_value) {
+            filter = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--quick")) {
+            quick = true;
+        }
+        else if (!strcmp(argv[i], "--min-time") && has_value) {
+            min_time = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--threads") && has_value) {
+            threads = (size_t)atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--max-mb") && has_value) {
+            max_mb = atof(argv[++i]);
+        }
+        else {
+            cvl_bench_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (min_time < 0.0) {
+        min_time = quick ? CVL_BENCH_QUICK_MIN_TIME : CVL_BENCH_DEFAULT_MIN_TIME;
+    }
+
+    const size_t kernel_count = sizeof(cvl_bench_kernels) / sizeof(cvl_bench_kernels[0]);
+    const size_t size_count = sizeof(cvl_bench_sizes) / sizeof(cvl_bench_sizes[0]);
+    const size_t max_results = kernel_count * size_count * CVL_BENCH_PIXEL_COUNT * CVL_BENCH_LAYOUT_COUNT;
+    CVLBenchResult * const results = (CVLBenchResult *)malloc(max_results * sizeof(CVLBenchResult));
+    CVLBenchCase * const cases = (CVLBenchCase *)calloc(max_results, sizeof(CVLBenchCase));
+    double * const samples = (double *)malloc(CVL_BENCH_MAX_SAMPLES * sizeof(double));
+    CVLThreadPool * const pool = cvl_thread_pool_create(threads);
+    if (!results || !cases || !samples || !pool) {
+        fprintf(stderr, "cvl_image_bench: out of memory\n");
+        cvl_bench_cleanup(pool, samples, cases, results);
+        return 1;
+    }
+
+    printf("simd: %s, threads: %u\n", cvl_bench_simd_name(cvl_simd_level()),
+           (unsigned)cvl_thread_pool_thread_count(pool));
+    printf("%-18s %-5s %-5s %-10s %12s %12s %9s %10s\n",
+           "kernel", "pixel", "size", "layout", "median_us", "p99_us", "GB/s", "Mpix/s");
+
+    size_t result_count = 0;
+    int failures = 0;
+    for (size_t k = 0; k < kernel_count; ++k) {
+        const CVLBenchKernel * const kernel = &cvl_bench_kernels[k];
+        if (filter && !strstr(kernel->name, filter)) {
+            continue;
+        }
+        for (size_t s = 0; s < size_count; ++s) {
+            if (quick && !cvl_bench_sizes[s].quick) {
+                continue;
+            }
+            for (int p = 0; p < CVL_BENCH_PIXEL_COUNT; ++p) {
+                const double image_mb = (double)cvl_bench_sizes[s].width * cvl_bench_sizes[s].height *
+                                        (double)cvl_bench_pixels[p].size / (1024.0 * 1024.0);
+                if (!(kernel->pixels & CVL_BENCH_PIXEL_BIT(p)) || image_mb > max_mb) {
+                    continue;
+                }
+                for (int layout = 0; layout < CVL_BENCH_LAYOUT_COUNT; ++layout) {
+                    CVLBenchCase * const bench = &cases[result_count];
+                    bench->pixel = p;
+                    bench->size = &cvl_bench_sizes[s];
+                    bench->layout = (CVLBenchLayout)layout;
+                    bench->pool = pool;
+                    bench->src = cvl_bench_alloc(bench, bench->size->height, bench->size->width, cvl_bench_pixels[p].size);
+                    bench->dst = cvl_bench_alloc(bench, bench->size->height, bench->size->width, cvl_bench_pixels[p].size);
+                    if (!bench->src.data || !bench->dst.data || (kernel->setup && !kernel->setup(bench))) {
+                        fprintf(stderr, "cvl_image_bench: setup of %s %s %s failed\n",
+                                kernel->name, cvl_bench_pixels[p].name, bench->size->name);
+                        cvl_bench_case_release(bench);
+                        ++failures;
+                        continue;
+                    }
+                    cvl_bench_measure(kernel, bench, min_time * 1e9, samples, &results[result_count]);
+                    cvl_bench_print_result(&results[result_count]);
+                    if (kernel->teardown) {
+                        kernel->teardown(bench);
+                    }
+                    cvl_bench_case_release(bench);
+                    ++result_count;
+                }
+            }
+        }
+    }
+
+    if (json_path) {
+        FILE * const file = fopen(json_path, "w");
+        if (!file) {
+            fprintf(stderr, "cvl_image_bench: cannot open %s\n", json_path);
+            ++failures;
+        }
+        else {
+            fprintf(file, "{\n  \"benchmark\": \"cvl_image_bench\",\n  \"simd\": \"%s\",\n  \"threads\": %u,\n"
+                          "  \"min_time_s\": %g,\n  \"results\": [\n",
+                    cvl_bench_simd_name(cvl_simd_level()), (unsigned)cvl_thread_pool_thread_count(pool), min_time);
+            for (size_t i = 0; i < result_count; ++i) {
+                cvl_bench_write_json_result(file, &results[i], i + 1 == result_count);
+            }
+            fprintf(file, "  ]\n}\n");
+            fclose(file);
+        }
+    }
+
+    cvl_bench_cleanup(pool, samples, cases, results);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+/**
+ * cvl::Image handle kernels of cvl_image_bench.
+ */
+
+#include "cvl_image_bench_handles.h"
+#include "cvl_image.hpp"
+
+
+
+void *cvl_bench_handle_new(const CVLImagePixelCount height,
+                           const CVLImagePixelCount width,
+                           const CVLImageBytesCount pixel_size)
+{
+    cvl::Image * const image = new (std::nothrow) cvl::Image(height, width, pixel_size);
+    if (image && image->empty()) {
+        delete image;
+        return NULL;
+    }
+    return image;
+}
+
+
+
+void cvl_bench_handle_delete(void * const handle) {
+    delete static_cast<cvl::Image *>(handle);
+}
+
+
+
+void cvl_bench_handle_create(const CVLImagePixelCount height,
+                             const CVLImagePixelCount width,
+                             const CVLImageBytesCount pixel_size)
+{
+    cvl::Image image(height, width, pixel_size);
+    CVL_UNUSED(image);
+}
+
+
+
+void cvl_bench_handle_share(const void * const handle, const unsigned count) {
+    const cvl::Image &image = *static_cast<const cvl::Image *>(handle);
+    const int width = (int)image.width();
+    const int height = (int)image.height();
+    for (unsigned i = 0; i < count; ++i) {
+        const int x = (int)(i % (unsigned)width);
+        const int y = (int)(i % (unsigned)height);
+        const cvl::Image copy(image);
+        const cvl::Image roi = copy.subimage(cvl_rect_make(x, y, width - x, height - y));
+        CVL_UNUSED(roi);
+    }
+}
+
+
+
+void cvl_bench_handle_write(const void * const handle) {
+    cvl::Image copy(*static_cast<const cvl::Image *>(handle));
+    copy.mutable_buffer();
+}
@@ -0,0 +1,36 @@
+#ifndef CVL_IMAGE_BENCH_HANDLES_H
+#define CVL_IMAGE_BENCH_HANDLES_H
+
+
+#include "cvl_image_utils.h"
+
+/*
+ * cvl::Image handle kernels of cvl_image_bench, compiled as C++ in cvl_image_bench_handles.cpp.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/** Allocate cvl::Image of given geometry. @return NULL on allocation failure. */
+void *cvl_bench_handle_new(CVLImagePixelCount height, CVLImagePixelCount width, CVLImageBytesCount pixel_size);
+
+/** Destroy handle created by cvl_bench_handle_new. */
+void cvl_bench_handle_delete(void *handle);
+
+/** Allocate and destroy one handle: image allocation plus shared storage block. */
+void cvl_bench_handle_create(CVLImagePixelCount height, CVLImagePixelCount width, CVLImageBytesCount pixel_size);
+
+/** Make @a count copies and subimages of handle and destroy them: reference counting only. */
+void cvl_bench_handle_share(const void *handle, unsigned count);
+
+/** Write through a copy of handle: copy-on-write of the whole image. */
+void cvl_bench_handle_write(const void *handle);
+
+#ifdef __cplusplus
+}  //extern "C" {
+#endif
+
+#endif //CVL_IMAGE_BENCH_HANDLES_H